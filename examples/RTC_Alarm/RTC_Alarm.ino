@@ -19,7 +19,7 @@ int hours = 12;
 int minutes = 45;
 int seconds = 57;
 
-bool alarm_flag = false;
+volatile bool alarm_flag = false;
 int counter = 1;
 
 void callback_alarm();
@@ -46,18 +46,16 @@ void setup() {
   // set the minutes at which the alarm should rise
   MachineControl_RTCController.setMinuteAlarm(46);
 
-  // Attach an interrupt to the RTC interrupt pin
-  attachInterrupt(RTC_INT, callback_alarm, FALLING);
+  // Call callback_alarm on each alarm: the RTC interrupt pin is handled by the library,
+  // which also clears the alarm flag, so the RTC does not need to be polled
+  MachineControl_RTCController.attachAlarm(callback_alarm);
 }
 
 void loop() {
   if (alarm_flag) {
     Serial.println("Alarm!!");
-    detachInterrupt(RTC_INT);
     MachineControl_RTCController.setSeconds(seconds);
     MachineControl_RTCController.setMinuteAlarm(minutes + counter);
-    MachineControl_RTCController.clearAlarm();
-    attachInterrupt(RTC_INT, callback_alarm, FALLING);
     alarm_flag = false;
 
     // To disable the alarm uncomment the following line:
@@ -74,6 +72,7 @@ void loop() {
   delay(1000);
 }
 
+// Called from the RTC event thread, not from the interrupt
 void callback_alarm () {
   alarm_flag = true;
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+ * Host replacement of the Arduino core for the tests: only the types and
+ * functions used by the library, time is driven by the tests.
+ */
+
+#ifndef ARDUINO_H_HOST_
+#define ARDUINO_H_HOST_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef enum {
+    NC = -1,
+    PA_0,
+    PA_10,
+    PA_13,
+    PA_14,
+    PA_1C,
+    PA_4,
+    PA_6,
+    PA_8,
+    PA_9,
+    PB_14,
+    PB_15,
+    PB_2,
+    PB_8,
+    PB_9,
+    PC_13,
+    PC_15,
+    PC_2C,
+    PC_3C,
+    PC_6,
+    PC_7,
+    PD_3,
+    PD_4,
+    PD_5,
+    PD_6,
+    PD_7,
+    PE_2,
+    PE_3,
+    PG_10,
+    PG_14,
+    PG_3,
+    PG_7,
+    PG_9,
+    PH_10,
+    PH_11,
+    PH_12,
+    PH_13,
+    PH_14,
+    PH_15,
+    PH_6,
+    PH_9,
+    PI_0,
+    PI_10,
+    PI_13,
+    PI_14,
+    PI_15,
+    PI_2,
+    PI_3,
+    PI_4,
+    PI_6,
+    PI_7,
+    PI_9,
+    PJ_10,
+    PJ_11,
+    PJ_7,
+    PJ_8,
+    PJ_9,
+    PK_1
+} PinName;
+
+typedef enum { LOW = 0, HIGH = 1, CHANGE = 2, FALLING = 3, RISING = 4 } PinStatus;
+typedef enum { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN } PinMode;
+
+// frame formats of the UARTs, as in HardwareSerial.h of the core
+#define SERIAL_PARITY_EVEN      (0x1ul)
+#define SERIAL_PARITY_ODD       (0x2ul)
+#define SERIAL_PARITY_NONE      (0x3ul)
+#define SERIAL_PARITY_MARK      (0x4ul)
+#define SERIAL_PARITY_SPACE     (0x5ul)
+#define SERIAL_PARITY_MASK      (0xFul)
+#define SERIAL_STOP_BIT_1       (0x10ul)
+#define SERIAL_STOP_BIT_1_5     (0x20ul)
+#define SERIAL_STOP_BIT_2       (0x30ul)
+#define SERIAL_STOP_BIT_MASK    (0xF0ul)
+#define SERIAL_DATA_5           (0x100ul)
+#define SERIAL_DATA_6           (0x200ul)
+#define SERIAL_DATA_7           (0x300ul)
+#define SERIAL_DATA_8           (0x400ul)
+#define SERIAL_DATA_MASK        (0xF00ul)
+#define SERIAL_7E1              (SERIAL_STOP_BIT_1 | SERIAL_PARITY_EVEN | SERIAL_DATA_7)
+#define SERIAL_8N1              (SERIAL_STOP_BIT_1 | SERIAL_PARITY_NONE | SERIAL_DATA_8)
+#define SERIAL_8N2              (SERIAL_STOP_BIT_2 | SERIAL_PARITY_NONE | SERIAL_DATA_8)
+#define SERIAL_8E1              (SERIAL_STOP_BIT_1 | SERIAL_PARITY_EVEN | SERIAL_DATA_8)
+#define SERIAL_8O1              (SERIAL_STOP_BIT_1 | SERIAL_PARITY_ODD | SERIAL_DATA_8)
+
+void pinMode(PinName pin, PinMode mode);
+void digitalWrite(PinName pin, PinStatus value);
+inline void digitalWrite(PinName pin, int value) { digitalWrite(pin, (PinStatus)value); }
+PinStatus digitalRead(PinName pin);
+int analogRead(PinName pin);
+void analogReadResolution(int bits);
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// host time, advanced by the tests
+extern uint64_t host_time_us;
+
+// level of a pin as last written by the library or set by the tests
+PinStatus host_pin_state(PinName pin);
+void host_pin_set(PinName pin, PinStatus value);
+
+#endif
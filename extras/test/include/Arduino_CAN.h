@@ -0,0 +1,52 @@
+/*
+ * Host replacement of Arduino_CAN: the frames received by the controller
+ * are queued by the tests, the frames sent are kept for them.
+ */
+
+#ifndef ARDUINO_CAN_H_HOST_
+#define ARDUINO_CAN_H_HOST_
+
+#include <deque>
+#include <vector>
+#include "Arduino.h"
+
+enum class CanBitRate : int {
+    BR_125k = 125000,
+    BR_250k = 250000,
+    BR_500k = 500000,
+    BR_1000k = 1000000
+};
+
+class CanMsg {
+public:
+    static uint32_t constexpr CAN_EFF_FLAG = 0x80000000U;
+
+    CanMsg() : id(0), data_length(0), data{0} {}
+    CanMsg(uint32_t const can_id, uint8_t const can_data_len, uint8_t const * can_data_ptr) : id(can_id), data_length(can_data_len), data{0} {
+        memcpy(data, can_data_ptr, (data_length < 8) ? data_length : 8);
+    }
+
+    uint32_t id;
+    uint8_t data_length;
+    uint8_t data[8];
+};
+
+inline uint32_t CanStandardId(uint32_t const id) { return id & 0x7FFU; }
+inline uint32_t CanExtendedId(uint32_t const id) { return (id & 0x1FFFFFFFU) | CanMsg::CAN_EFF_FLAG; }
+
+class Arduino_CAN {
+public:
+    Arduino_CAN(PinName const can_tx_pin, PinName const can_rx_pin) {}
+
+    bool begin(CanBitRate const can_bitrate);
+    void end();
+    int write(CanMsg const & msg);
+    size_t available();
+    CanMsg read();
+};
+
+// host only: frames accepted by the controller, frames sent
+extern std::deque<CanMsg> host_can_rx;
+extern std::vector<CanMsg> host_can_tx;
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Host replacement of the Arduino SPI library for the tests: the bytes
+ * are exchanged with the simulated chip whose chip select pin is low.
+ */
+
+#ifndef SPI_H_HOST_
+#define SPI_H_HOST_
+
+#include "Arduino.h"
+
+#define MSBFIRST    1
+#define LSBFIRST    0
+#define SPI_MODE0   0
+#define SPI_MODE1   1
+#define SPI_MODE2   2
+#define SPI_MODE3   3
+
+class SPISettings {
+public:
+    SPISettings(uint32_t clock = 4000000, uint8_t order = MSBFIRST, uint8_t mode = SPI_MODE0)
+        : clock(clock), order(order), mode(mode) {}
+
+    uint32_t clock;
+    uint8_t order;
+    uint8_t mode;
+};
+
+class SPIClass;
+
+/*
+ * Simulated SPI chip: attached to a chip select pin, it sees the frames
+ * between the falling and the rising edge of the pin. A frame is bad if
+ * it starts outside of a transaction, with the wrong SPI mode or while
+ * another chip is selected.
+ */
+class HostSpiDevice {
+public:
+    HostSpiDevice(PinName cs, uint8_t mode, SPIClass& spi);
+    HostSpiDevice(PinName cs, uint8_t mode);
+    virtual ~HostSpiDevice();
+
+    virtual void select() {}
+    virtual uint8_t exchange(uint8_t mosi) = 0;
+    virtual void deselect() {}
+
+    PinName cs;
+    uint8_t mode;
+    SPIClass* spi;
+    uint32_t frames = 0;      // Frames seen (chip select cycles)
+    uint32_t bytes = 0;       // Bytes exchanged
+    uint32_t bad_frames = 0;  // Frames outside of a transaction, in the wrong mode or overlapping
+};
+
+class SPIClass {
+public:
+    void begin() { begun++; }
+    void end() { ended++; }
+    void beginTransaction(SPISettings settings) { this->settings = settings; transactions++; open = true; }
+    void endTransaction() { open = false; }
+    uint8_t transfer(uint8_t data);
+    uint16_t transfer16(uint16_t data);
+    void transfer(void* buffer, size_t len);
+
+    SPISettings settings;
+    uint32_t begun = 0;          // begin() calls
+    uint32_t ended = 0;          // end() calls
+    uint32_t transactions = 0;   // beginTransaction() calls
+    uint32_t blocks = 0;         // Multi-byte transfer() calls
+    bool open = false;           // Inside beginTransaction()/endTransaction()
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Host replacement of the Arduino Wire library for the tests: the
+ * transfers are forwarded to the simulated chip at the addressed slave
+ * address, an absent address is not acknowledged.
+ */
+
+#ifndef WIRE_H_HOST_
+#define WIRE_H_HOST_
+
+#include "Arduino.h"
+
+#define HOST_I2C_BUFFER 32
+
+class TwoWire;
+
+/*
+ * Simulated I2C chip. A write transfer delivers its bytes to receive(), a
+ * read transfer asks transmit() for each byte, stop() ends the transfer
+ * (a repeated start does not call it).
+ */
+class HostI2cDevice {
+public:
+    HostI2cDevice(uint8_t address, TwoWire& bus);
+    virtual ~HostI2cDevice();
+
+    virtual void start() {}
+    virtual void receive(uint8_t data) = 0;
+    virtual uint8_t transmit() = 0;
+    virtual void stop() {}
+
+    uint8_t address;
+    TwoWire* bus;
+    uint32_t transfers = 0;   // Transfers addressed to the chip
+};
+
+class TwoWire {
+public:
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t freq) {}
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t len);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t address, size_t len, bool stop = true);
+    int available();
+    int read();
+
+    HostI2cDevice* devices[4] = { nullptr, nullptr, nullptr, nullptr };
+    uint32_t transfers = 0;   // Transfers on the bus (write and read phases)
+
+private:
+    HostI2cDevice* find(uint8_t address);
+
+    uint8_t _address = 0;
+    uint8_t _tx[HOST_I2C_BUFFER];
+    size_t _tx_len = 0;
+    uint8_t _rx[HOST_I2C_BUFFER];
+    size_t _rx_len = 0;
+    size_t _rx_pos = 0;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
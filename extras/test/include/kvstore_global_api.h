@@ -0,0 +1,19 @@
+/*
+ * Host replacement of the mbed KVStore global API for the tests: each key
+ * is stored in its own file under the directory set with kv_host_set_dir().
+ */
+
+#ifndef KVSTORE_GLOBAL_API_H_HOST_
+#define KVSTORE_GLOBAL_API_H_HOST_
+
+#include <stdint.h>
+#include <stddef.h>
+
+int kv_set(const char* full_name_key, const void* buffer, size_t size, uint32_t create_flags);
+int kv_get(const char* full_name_key, void* buffer, size_t buffer_size, size_t* actual_size);
+int kv_remove(const char* full_name_key);
+
+// host only: directory backing the store
+void kv_host_set_dir(const char* dir);
+
+#endif
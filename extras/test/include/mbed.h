@@ -0,0 +1,337 @@
+/*
+ * Host replacement of the mbed OS API for the tests: the RTOS objects
+ * are backed by the standard library, timers and interrupts do nothing.
+ */
+
+#ifndef MBED_H_HOST_
+#define MBED_H_HOST_
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <functional>
+#include <set>
+#include "Arduino.h"
+
+using namespace std::chrono_literals;
+
+void core_util_critical_section_enter();
+void core_util_critical_section_exit();
+
+#define MBED_SUCCESS 0
+
+#define MBED_MODULE_DRIVER_SPI              0
+#define MBED_MODULE_DRIVER_I2C              1
+#define MBED_ERROR_CODE_OUT_OF_RESOURCES    0
+#define MBED_MAKE_ERROR(module, code)       ((module) << 16 | (code))
+#define MBED_ERROR(status, message)         host_error(status, message)
+
+[[noreturn]] void host_error(int status, const char* message);
+
+#define osOK                    0
+#define osWaitForever           0xFFFFFFFFU
+#define osFlagsError            0x80000000U
+#define osPriorityBelowNormal   16
+#define osPriorityNormal        24
+#define osPriorityAboveNormal   32
+#define osPriorityHigh          40
+#define osPriorityRealtime      48
+#define OS_STACK_SIZE           4096
+
+/* STM32 timer registers, the tests play the hardware ---------------------*/
+typedef struct {
+    volatile uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR, CCR1, CCR2, CCR3, CCR4, BDTR;
+} TIM_TypeDef;
+
+#define TIM_CR1_UDIS    (1U << 1)
+#define TIM_DIER_UIE    (1U << 0)
+#define TIM_SR_UIF      (1U << 0)
+#define TIM_EGR_UG      (1U << 0)
+
+// timer input clock of the host PwmOut
+#define HOST_TIM_CLOCK  200000000UL
+
+extern TIM_TypeDef host_timers[3];
+
+#define TIM1            (&host_timers[0])
+#define TIM3            (&host_timers[1])
+#define TIM8            (&host_timers[2])
+
+// HRTIM registers, a PWM source the library must leave to mbed
+typedef struct {
+    volatile uint32_t REG[64];
+} HRTIM_TypeDef;
+
+extern HRTIM_TypeDef host_hrtim1;
+
+#define HRTIM1          (&host_hrtim1)
+
+/* Pinmap, the peripheral is the register block and the function the channel */
+typedef struct {
+    PinName pin;
+    intptr_t peripheral;
+    int function;
+} PinMap;
+
+extern const PinMap PinMap_PWM[];
+
+uintptr_t pinmap_find_peripheral(PinName pin, const PinMap* map);
+
+/* FDCAN registers, the controller takes some polls to change mode ----------*/
+#define FDCAN_CCCR_INIT         (1U << 0)
+#define FDCAN_CCCR_CCE          (1U << 1)
+#define FDCAN_GFC_ANFE_Pos      2
+#define FDCAN_GFC_ANFE          (3U << FDCAN_GFC_ANFE_Pos)
+#define FDCAN_GFC_ANFS_Pos      4
+#define FDCAN_GFC_ANFS          (3U << FDCAN_GFC_ANFS_Pos)
+#define FDCAN_SIDFC_FLSSA       (0x3FFFU << 2)
+#define FDCAN_SIDFC_LSS_Pos     16
+#define FDCAN_SIDFC_LSS         (0xFFU << FDCAN_SIDFC_LSS_Pos)
+#define FDCAN_XIDFC_FLESA       (0x3FFFU << 2)
+#define FDCAN_XIDFC_LSE_Pos     16
+#define FDCAN_XIDFC_LSE         (0x7FU << FDCAN_XIDFC_LSE_Pos)
+
+// CCCR: INIT is seen after latency reads (never if negative), each read takes 1 us, CCE is cleared with INIT
+class HostFdcanCccr {
+public:
+    operator uint32_t();
+    HostFdcanCccr& operator=(uint32_t value);
+    HostFdcanCccr& operator|=(uint32_t bits) { return *this = _requested | bits; }
+    HostFdcanCccr& operator&=(uint32_t bits) { return *this = _requested & bits; }
+
+    int latency = 0;
+    int init_entries = 0;       // Times the controller entered the configuration mode
+    bool configurable() { return (_value & (FDCAN_CCCR_INIT | FDCAN_CCCR_CCE)) == (FDCAN_CCCR_INIT | FDCAN_CCCR_CCE); }
+private:
+    uint32_t _requested = 0;
+    uint32_t _value = 0;
+    int _pending = 0;
+};
+
+// register only writable in configuration mode, the other writes are counted and ignored
+class HostFdcanProtected {
+public:
+    HostFdcanProtected(HostFdcanCccr* cccr) : _cccr(cccr) {}
+    operator uint32_t() { return _value; }
+    HostFdcanProtected& operator=(uint32_t value) {
+        if (_cccr->configurable()) {
+            _value = value;
+        } else {
+            rejected_writes++;
+        }
+        return *this;
+    }
+
+    int rejected_writes = 0;
+private:
+    HostFdcanCccr* _cccr;
+    uint32_t _value = 0;
+};
+
+typedef struct FDCAN_GlobalTypeDef {
+    HostFdcanCccr CCCR;
+    HostFdcanProtected GFC{&CCCR};
+    volatile uint32_t SIDFC = 0;
+    volatile uint32_t XIDFC = 0;
+} FDCAN_GlobalTypeDef;
+
+#define HOST_SRAMCAN_WORDS      2560
+
+extern FDCAN_GlobalTypeDef host_fdcan1;
+extern uint32_t host_sramcan[HOST_SRAMCAN_WORDS];
+
+#define FDCAN1                  (&host_fdcan1)
+#define SRAMCAN_BASE            ((uintptr_t)host_sramcan)
+
+/* NVIC, the vectors are run by host_timer_update() ---------------------------*/
+typedef enum {
+    TIM1_UP_IRQn = 25,
+    TIM3_IRQn = 29,
+    TIM8_UP_TIM13_IRQn = 44,
+    HOST_IRQ_COUNT = 150
+} IRQn_Type;
+
+void NVIC_SetVector(IRQn_Type irq, uintptr_t vector);
+uintptr_t NVIC_GetVector(IRQn_Type irq);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+
+// host only: update event of a timer, sets UIF and runs the interrupt unless UDIS is set
+void host_timer_update(TIM_TypeDef* tim);
+
+/* Pull of the mbed pins, PinMode is the Arduino one on the host -------------*/
+enum { PullNone = 0, PullUp = 1, PullDown = 2 };
+
+/* Microsecond ticker, the host time ------------------------------------------*/
+typedef uint64_t us_timestamp_t;
+typedef struct ticker_data_t ticker_data_t;
+
+inline const ticker_data_t* get_us_ticker_data() { return nullptr; }
+inline us_timestamp_t ticker_read_us(const ticker_data_t* ticker) { return host_time_us; }
+
+typedef struct {
+    void* pwm;
+    uint8_t channel;
+    uint32_t prescaler;
+    uint32_t period;
+    uint32_t pulse;
+    uint8_t inverted;
+} pwmout_t;
+
+namespace mbed {
+
+template<typename F> class Callback;
+
+template<typename R, typename... A> class Callback<R(A...)> {
+public:
+    Callback() {}
+    Callback(R (*f)(A...)) : _f(f) {}
+    template<typename T> Callback(T* obj, R (T::*method)(A...)) : _f([obj, method](A... a) { return (obj->*method)(a...); }) {}
+    explicit operator bool() const { return (bool)_f; }
+    R operator()(A... a) const { return _f(a...); }
+private:
+    std::function<R(A...)> _f;
+};
+
+template<typename T, typename R, typename... A> Callback<R(A...)> callback(T* obj, R (T::*method)(A...)) {
+    return Callback<R(A...)>(obj, method);
+}
+
+// host only: host_pin_set() of a high pin to low runs the fall handler
+class InterruptIn {
+public:
+    InterruptIn(PinName pin, int mode = PullNone);
+    ~InterruptIn();
+    void fall(Callback<void()> cb) { _fall = cb; }
+    void disable_irq() { _enabled = false; }
+    void enable_irq() { _enabled = true; }
+
+    static void host_edge(PinName pin, PinStatus previous, PinStatus value);
+private:
+    PinName _pin;
+    Callback<void()> _fall;
+    bool _enabled = true;
+};
+
+// host only: the period and duty cycle written through mbed are kept
+class PwmOut {
+public:
+    PwmOut(PinName pin);
+    void period_ms(int ms) { host_period_us = ms * 1000; }
+    void period_us(int us) { host_period_us = us; }
+    void write(float value) { host_value = value; }
+    float read() { return host_value; }
+
+    int host_period_us = 20000;
+    float host_value = 0.0f;
+protected:
+    pwmout_t _pwm;
+};
+
+class Ticker {
+public:
+    ~Ticker() { detach(); }
+    void attach(Callback<void()> cb, std::chrono::microseconds period) { _cb = cb; _period = period; active().insert(this); }
+    void detach() { _cb = Callback<void()>(); active().erase(this); }
+
+    // host only: the attached tickers, fired by the tests in place of the timer interrupt
+    static std::set<Ticker*>& active() { static std::set<Ticker*> tickers; return tickers; }
+    static void fireAll() { std::set<Ticker*> tickers = active(); for (Ticker* t : tickers) if (active().count(t)) t->_cb(); }
+    bool attached() const { return (bool)_cb; }
+    std::chrono::microseconds period() const { return _period; }
+private:
+    Callback<void()> _cb;
+    std::chrono::microseconds _period;
+};
+
+class Timer {
+public:
+    void start() {}
+    void stop() {}
+    void reset() {}
+    std::chrono::microseconds elapsed_time() { return std::chrono::microseconds(0); }
+};
+
+} // namespace mbed
+
+namespace rtos {
+
+class Mutex {
+public:
+    void lock() { _m.lock(); }
+    bool trylock() { return _m.try_lock(); }
+    void unlock() { _m.unlock(); }
+private:
+    std::recursive_mutex _m;
+};
+
+namespace Kernel {
+struct Clock {
+    typedef std::chrono::milliseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<Clock> time_point;
+    static const bool is_steady = true;
+    static time_point now() { return time_point(duration(host_time_us / 1000)); }
+};
+} // namespace Kernel
+
+class EventFlags {
+public:
+    // host only: run by a thread about to wait, in place of the other threads and interrupts
+    static std::function<void()>& host_waiting() { static std::function<void()> hook; return hook; }
+
+    uint32_t set(uint32_t flags) { _flags |= flags; return _flags; }
+    uint32_t get() const { return _flags; }
+    uint32_t clear(uint32_t flags = 0x7FFFFFFF) { uint32_t old = _flags; _flags &= ~flags; return old; }
+    uint32_t wait_any(uint32_t flags, uint32_t ms = osWaitForever, bool clear = true) {
+        uint32_t got = _flags & flags;
+        if (clear) _flags &= ~got;
+        return got;
+    }
+    // nobody else runs while waiting: a timeout elapses at once
+    uint32_t wait_any_for(uint32_t flags, std::chrono::milliseconds timeout, bool clear = true) {
+        if (host_waiting()) {
+            host_waiting()();
+        }
+        uint32_t got = wait_any(flags, osWaitForever, clear);
+        if (got == 0) {
+            host_time_us += timeout.count() * 1000;
+        }
+        return got;
+    }
+private:
+    uint32_t _flags = 0;
+};
+
+class Thread {
+public:
+    Thread(int priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE, unsigned char* stack_mem = nullptr, const char* name = nullptr) {}
+    int start(mbed::Callback<void()> task) { return osOK; }
+    int join() { return osOK; }
+    uint32_t flags_set(uint32_t flags) { return flags; }
+};
+
+namespace ThisThread {
+inline void sleep_for(std::chrono::milliseconds ms) { host_time_us += ms.count() * 1000; }
+inline uint32_t flags_wait_any_for(uint32_t flags, std::chrono::milliseconds timeout) { host_time_us += timeout.count() * 1000; return 0; }
+}
+
+} // namespace rtos
+
+namespace events {
+
+#define EVENTS_EVENT_SIZE       64
+
+// the events are run at once, in the context of the caller
+class EventQueue {
+public:
+    EventQueue(unsigned size = 32 * EVENTS_EVENT_SIZE) {}
+    template<typename T, typename R> int call(T* obj, R (T::*method)()) { (obj->*method)(); return 1; }
+    void dispatch_forever() {}
+    void break_dispatch() {}
+};
+
+} // namespace events
+
+#endif
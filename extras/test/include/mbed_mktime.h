@@ -0,0 +1,23 @@
+/*
+ * Host replacement of the mbed OS time conversions, based on the C library.
+ */
+
+#ifndef MBED_MKTIME_H_HOST_
+#define MBED_MKTIME_H_HOST_
+
+#include <time.h>
+
+typedef enum {
+    RTC_FULL_LEAP_YEAR_SUPPORT,
+    RTC_4_YEAR_LEAP_YEAR_SUPPORT
+} rtc_leap_year_support_t;
+
+// as in mbed OS, the years before 1970 cannot be converted
+bool _rtc_maketime(const struct tm* time, time_t* seconds, rtc_leap_year_support_t leap_year_support);
+bool _rtc_localtime(time_t timestamp, struct tm* time_info, rtc_leap_year_support_t leap_year_support);
+
+// time of the system RTC, kept by the host
+void set_time(time_t t);
+extern time_t host_rtc_time;
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * Host replacement of the pin table of the core: the pins keep their names.
+ */
+
+#ifndef PIN_DEFINITIONS_H_HOST_
+#define PIN_DEFINITIONS_H_HOST_
+
+#include "Arduino.h"
+
+inline PinName PinNameToIndex(PinName pin) { return pin; }
+
+#endif
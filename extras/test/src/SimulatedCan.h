@@ -0,0 +1,91 @@
+/*
+ * Simulated FDCAN1 receiver: the filter lists are laid out in the message
+ * RAM as mbed does, each frame goes through the acceptance filtering of
+ * the controller (filter elements in list order, then the non-matching
+ * frame policy of GFC) and the accepted ones are queued for Arduino_CAN.
+ */
+
+#ifndef SIMULATED_CAN_H_
+#define SIMULATED_CAN_H_
+
+#include <Arduino_CAN.h>
+#include <mbed.h>
+
+#include "utility/CAN/CanDispatchTable.h"
+
+// filter lists of std_size and ext_size elements, every frame accepted
+static inline void simCanReset(int std_size, int ext_size) {
+    memset(host_sramcan, 0, sizeof(host_sramcan));
+    host_fdcan1.SIDFC = (uint32_t)std_size << FDCAN_SIDFC_LSS_Pos;
+    host_fdcan1.XIDFC = ((uint32_t)ext_size << FDCAN_XIDFC_LSE_Pos) | (uint32_t)(std_size * 4);
+    host_fdcan1.CCCR.latency = 0;
+    host_fdcan1.CCCR |= FDCAN_CCCR_INIT;
+    while (!(host_fdcan1.CCCR & FDCAN_CCCR_INIT)) {
+    }
+    host_fdcan1.CCCR |= FDCAN_CCCR_CCE;
+    host_fdcan1.GFC = 0;
+    host_fdcan1.CCCR &= ~FDCAN_CCCR_INIT;
+    while (host_fdcan1.CCCR & FDCAN_CCCR_INIT) {
+    }
+    host_fdcan1.CCCR.init_entries = 0;
+    host_fdcan1.GFC.rejected_writes = 0;
+    host_can_rx.clear();
+}
+
+// true while the controller is seen in configuration mode
+static inline bool simCanInit() {
+    return ((uint32_t)host_fdcan1.CCCR & FDCAN_CCCR_INIT) != 0;
+}
+
+// acceptance filtering of a frame, CanMsg::id with the extended flag
+static inline bool simCanAccepts(uint32_t id) {
+    bool extended = (id & CAN_ID_EXTENDED_FLAG) != 0;
+    uint32_t raw = id & (extended ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK);
+    int size;
+
+    if (!extended) {
+        size = (host_fdcan1.SIDFC & FDCAN_SIDFC_LSS) >> FDCAN_SIDFC_LSS_Pos;
+        const uint32_t* list = &host_sramcan[(host_fdcan1.SIDFC & FDCAN_SIDFC_FLSSA) / 4];
+        for (int i = 0; i < size; i++) {
+            uint32_t type = list[i] >> 30;
+            uint32_t config = (list[i] >> 27) & 0x7;
+            uint32_t id1 = (list[i] >> 16) & 0x7FF;
+            uint32_t id2 = list[i] & 0x7FF;
+            bool match = (type == 0 && raw >= id1 && raw <= id2) || (type == 1 && (raw == id1 || raw == id2)) ||
+                         (type == 2 && (raw & id2) == (id1 & id2));
+            if (config != 0 && type != 3 && match) {
+                return config != 3;
+            }
+        }
+        return size == 0 || ((host_fdcan1.GFC & FDCAN_GFC_ANFS) >> FDCAN_GFC_ANFS_Pos) < 2;
+    }
+
+    size = (host_fdcan1.XIDFC & FDCAN_XIDFC_LSE) >> FDCAN_XIDFC_LSE_Pos;
+    const uint32_t* list = &host_sramcan[(host_fdcan1.XIDFC & FDCAN_XIDFC_FLESA) / 4];
+    for (int i = 0; i < size; i++) {
+        uint32_t config = list[2 * i] >> 29;
+        uint32_t id1 = list[2 * i] & CAN_EXTENDED_ID_MASK;
+        uint32_t type = list[2 * i + 1] >> 30;
+        uint32_t id2 = list[2 * i + 1] & CAN_EXTENDED_ID_MASK;
+        // the XIDAM mask is left at its reset value, all ones
+        bool match = ((type == 0 || type == 3) && raw >= id1 && raw <= id2) || (type == 1 && (raw == id1 || raw == id2)) ||
+                     (type == 2 && (raw & id2) == (id1 & id2));
+        if (config != 0 && match) {
+            return config != 3;
+        }
+    }
+    return size == 0 || ((host_fdcan1.GFC & FDCAN_GFC_ANFE) >> FDCAN_GFC_ANFE_Pos) < 2;
+}
+
+// frame on the bus, queued if the controller accepts it
+static inline bool simCanReceive(uint32_t id) {
+    if (!simCanAccepts(id)) {
+        return false;
+    }
+
+    uint8_t data[4] = {(uint8_t)id, (uint8_t)(id >> 8), (uint8_t)(id >> 16), (uint8_t)(id >> 24)};
+    host_can_rx.push_back(CanMsg(id, sizeof(data), data));
+    return true;
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Simulated temperature converters for the host SPI bus.
+ */
+
+#ifndef SIMULATED_CHIPS_H_
+#define SIMULATED_CHIPS_H_
+
+#include <SPI.h>
+#include "pins_mc.h"
+
+/*
+ * Register map of the MAX31865 behind the host SPI bus: every frame is an
+ * address byte (bit 7 set for a write) followed by data bytes on
+ * consecutive registers. The conversions return a code set by the test.
+ */
+class Max31865Model : public HostSpiDevice {
+public:
+    Max31865Model() : HostSpiDevice(MC_RTD_CS_PIN, SPI_MODE1) {
+        memset(reg, 0, sizeof(reg));
+        reg[3] = reg[4] = 0xFF;
+    }
+
+    void select() override {
+        first = true;
+        // in auto mode the RTD registers always hold the latest conversion
+        if ((reg[0] & 0xC0) == 0xC0) {
+            loadConversion();
+        }
+    }
+
+    uint8_t exchange(uint8_t mosi) override {
+        if (first) {
+            first = false;
+            addr = mosi & 0x7F;
+            write = mosi & 0x80;
+            if (write) {
+                writes++;
+            } else {
+                reads++;
+            }
+            return 0xFF;
+        }
+
+        uint8_t miso = 0xFF;
+        if (write) {
+            writeReg(addr, mosi);
+        } else {
+            miso = reg[addr & 7];
+        }
+        addr++;
+        return miso;
+    }
+
+    void loadConversion() {
+        uint16_t value = code << 1;
+        reg[1] = value >> 8;
+        reg[2] = value & 0xFF;
+    }
+
+    void writeReg(uint8_t a, uint8_t value) {
+        switch (a) {
+            case 0:
+                if ((value & 0x20) && (value & 0x80)) {
+                    loadConversion();
+                    conversions++;
+                }
+                if ((value & 0x0C) == 0x04) {
+                    reg[7] = detect_fault;
+                }
+                if (value & 0x02) {
+                    reg[7] = 0;
+                }
+                // one shot, fault cycle and fault clear bits are self-clearing
+                reg[0] = value & ~(0x20 | 0x0C | 0x02);
+                break;
+            case 3: case 4: case 5: case 6:
+                reg[a] = value;
+                break;
+            default:
+                // RTD and fault status registers are read-only
+                break;
+        }
+    }
+
+    void resetCounters() {
+        reads = writes = conversions = 0;
+        frames = bytes = 0;
+    }
+
+    uint8_t reg[8];
+    uint16_t code = 8192;
+    uint8_t detect_fault = 0;
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t conversions = 0;
+
+private:
+    uint8_t addr = 0;
+    bool first = false;
+    bool write = false;
+};
+
+/*
+ * MAX31855: every frame shifts out the 32-bit conversion word, a missing
+ * chip reads as all ones.
+ */
+class Max31855Model : public HostSpiDevice {
+public:
+    Max31855Model() : HostSpiDevice(MC_TC_CS_PIN, SPI_MODE0) {}
+
+    void select() override {
+        shift = 0;
+    }
+
+    uint8_t exchange(uint8_t mosi) override {
+        if (missing) {
+            return 0xFF;
+        }
+        uint8_t miso = (uint8_t)(word >> (24 - shift));
+        shift += 8;
+        return miso;
+    }
+
+    // hot junction in 0.25 °C steps, cold junction in 0.0625 °C steps
+    void set(float hot, float cold, uint8_t fault = 0) {
+        int32_t hot_raw = (int32_t)lroundf(hot * 4) & 0x3FFF;
+        int32_t cold_raw = (int32_t)lroundf(cold * 16) & 0xFFF;
+
+        word = (uint32_t)hot_raw << 18 | (fault ? 1u << 16 : 0) | (uint32_t)cold_raw << 4 | (fault & 0x07);
+    }
+
+    uint32_t word = 0;
+    bool missing = false;
+
+private:
+    uint8_t shift = 0;
+};
+
+#endif
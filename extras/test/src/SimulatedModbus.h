@@ -0,0 +1,176 @@
+/*
+ * Simulated Modbus RTU slave answering the frames sent through a
+ * ModbusFramePort with timestamped response frames, as cut by the DMA
+ * receiver at each idle character.
+ */
+
+#ifndef SIMULATED_MODBUS_H_
+#define SIMULATED_MODBUS_H_
+
+#include <string.h>
+
+#include "utility/MODBUS/ModbusRtu.h"
+#include "utility/SERIAL/SerialFramer.h"
+
+class SimModbusSlave {
+public:
+    SimModbusSlave(uint32_t baudrate, uint32_t* clock) : clock(clock) {
+        char_us = modbusCharTimeUs(baudrate);
+        for (int i = 0; i < 32; i++) {
+            regs[i] = 0x1000 + i;
+        }
+    }
+
+    static bool write(void* context, const uint8_t* frame, size_t len) {
+        return static_cast<SimModbusSlave*>(context)->receive(frame, len);
+    }
+
+    // next response frame queued by the receiver at the time of the clock
+    static bool read(void* context, SerialFrame* frame) {
+        SimModbusSlave* slave = static_cast<SimModbusSlave*>(context);
+
+        if (slave->next >= slave->count || (int32_t)(slave->detected(slave->next) - *slave->clock) > 0) {
+            return false;
+        }
+        *frame = slave->frames[slave->next++];
+        return true;
+    }
+
+    // time the receiver reports the next frame, 0 if none
+    bool pending(uint32_t* at_us) {
+        if (next >= count) {
+            return false;
+        }
+        *at_us = detected(next);
+        return true;
+    }
+
+    uint8_t address = 1;
+    uint16_t regs[32];
+    uint32_t char_us;
+    uint32_t delay_us = 2000;   // Turnaround from the end of the request to the response
+    int split_at = 0;           // Byte of the response starting a second frame, 0 for one frame
+    uint32_t gap_us = 0;        // Silence before the second frame
+    int silent = 0;             // Requests left unanswered
+    int corrupt = 0;            // Responses sent with a bad CRC
+    int truncate = 0;           // Bytes missing at the end of the next response
+    int requests = 0;
+    int broadcasts = 0;
+    uint32_t request_end_us = 0;
+
+private:
+    uint32_t* clock;
+    SerialFrame frames[2];
+    int count = 0;
+    int next = 0;
+
+    uint32_t detected(int i) {
+        // the idle line is detected one character after the last stop bit
+        return (uint32_t)frames[i].end_us + char_us;
+    }
+
+    bool receive(const uint8_t* req, size_t len) {
+        uint8_t rsp[MODBUS_MAX_ADU];
+        size_t n = 0;
+
+        count = 0;
+        next = 0;
+        request_end_us = *clock + len * char_us;
+        if (len < 4 || modbusCrc16(req, len - 2) != (req[len - 2] | req[len - 1] << 8)) {
+            return true;
+        }
+        if (req[0] == MODBUS_BROADCAST) {
+            broadcasts++;
+            return true;
+        }
+        if (req[0] != address) {
+            return true;
+        }
+        requests++;
+        if (silent > 0) {
+            silent--;
+            return true;
+        }
+
+        uint16_t first = modbusGetU16(&req[2]);
+        uint16_t quantity = modbusGetU16(&req[4]);
+        rsp[n++] = address;
+        rsp[n++] = req[1];
+        switch (req[1]) {
+            case MODBUS_FC_READ_HOLDING_REGISTERS:
+            case MODBUS_FC_READ_INPUT_REGISTERS:
+                if (first + quantity > 32) {
+                    n = exception(rsp, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+                    break;
+                }
+                rsp[n++] = quantity * 2;
+                for (uint16_t i = 0; i < quantity; i++) {
+                    modbusPutU16(&rsp[n], regs[first + i]);
+                    n += 2;
+                }
+                break;
+            case MODBUS_FC_WRITE_SINGLE_REGISTER:
+                if (first >= 32) {
+                    n = exception(rsp, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+                    break;
+                }
+                regs[first] = quantity;
+                memcpy(rsp, req, 6);
+                n = 6;
+                break;
+            case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+                if (first + quantity > 32) {
+                    n = exception(rsp, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+                    break;
+                }
+                for (uint16_t i = 0; i < quantity; i++) {
+                    regs[first + i] = modbusGetU16(&req[7 + 2 * i]);
+                }
+                memcpy(rsp, req, 6);
+                n = 6;
+                break;
+            default:
+                n = exception(rsp, MODBUS_EX_ILLEGAL_FUNCTION);
+                break;
+        }
+        uint16_t crc = modbusCrc16(rsp, n);
+        if (corrupt > 0) {
+            corrupt--;
+            crc ^= 0x5555;
+        }
+        rsp[n++] = crc & 0xFF;
+        rsp[n++] = crc >> 8;
+        if (truncate > 0) {
+            n -= truncate;
+            truncate = 0;
+        }
+
+        uint64_t start = request_end_us + delay_us;
+        if (split_at > 0 && (size_t)split_at < n) {
+            start = frame(rsp, split_at, start) + gap_us;
+            frame(rsp + split_at, n - split_at, start);
+        } else {
+            frame(rsp, n, start);
+        }
+        return true;
+    }
+
+    size_t exception(uint8_t* rsp, uint8_t code) {
+        rsp[1] |= 0x80;
+        rsp[2] = code;
+        return 3;
+    }
+
+    uint64_t frame(const uint8_t* data, size_t len, uint64_t start_us) {
+        SerialFrame* f = &frames[count++];
+
+        memcpy(f->data, data, len);
+        f->length = (uint16_t)len;
+        f->flags = 0;
+        f->start_us = start_us;
+        f->end_us = start_us + len * char_us;
+        return f->end_us;
+    }
+};
+
+#endif
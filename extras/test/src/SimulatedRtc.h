@@ -0,0 +1,187 @@
+/*
+ * Simulated PCF8563 real-time clock on the host Wire1 bus.
+ */
+
+#ifndef SIMULATED_RTC_H_
+#define SIMULATED_RTC_H_
+
+#include <string.h>
+#include <Wire.h>
+#include "pins_mc.h"
+
+static inline uint8_t simBcd(uint8_t value) {
+    return (uint8_t)((value / 10) << 4 | (value % 10));
+}
+
+static inline uint8_t simBin(uint8_t bcd) {
+    return (uint8_t)((bcd >> 4) * 10 + (bcd & 0x0F));
+}
+
+/*
+ * Register map of the PCF8563: the register pointer is set by the first
+ * byte of a write and auto-increments. As on the chip, the time counters
+ * are frozen during a transfer: a second elapsing meanwhile is applied at
+ * the stop condition, so a burst read cannot tear across a rollover.
+ *
+ * The alarm (AF) and timer (TF) flags of control/status 2 are cleared by
+ * writing 0 and left unchanged by writing 1, the INT pin is low while a
+ * flag is set with its interrupt enabled (AIE, TIE). The INT pin follows
+ * the register at the stop condition. The countdown timer runs on tick()
+ * from its 1 Hz source.
+ */
+class Pcf8563Model : public HostI2cDevice {
+public:
+    Pcf8563Model() : HostI2cDevice(0x51, Wire1) {
+        memset(reg, 0, sizeof(reg));
+        reg[0x05] = 0x01;
+        reg[0x07] = 0x01;
+        // alarms disabled at power-on
+        reg[0x09] = reg[0x0A] = reg[0x0B] = reg[0x0C] = 0x80;
+        reg[0x0E] = 0x03;
+        host_pin_set(MC_RTC_INT_PIN, HIGH);
+    }
+
+    void start() override {
+        busy = true;
+        first = true;
+        bytes = 0;
+    }
+
+    void receive(uint8_t data) override {
+        if (first) {
+            first = false;
+            pointer = data & 0x0F;
+            return;
+        }
+        writeReg(pointer, data);
+        pointer = (pointer + 1) & 0x0F;
+    }
+
+    uint8_t transmit() override {
+        uint8_t data = reg[pointer];
+
+        pointer = (pointer + 1) & 0x0F;
+        if (++bytes == tick_after_byte) {
+            tick();
+        }
+        return data;
+    }
+
+    void stop() override {
+        busy = false;
+        while (pending > 0) {
+            pending--;
+            advance();
+        }
+        updateInt();
+    }
+
+    // one second of the 1 Hz counter chain
+    void tick() {
+        if (busy) {
+            pending++;
+        } else {
+            advance();
+        }
+    }
+
+    void set(uint8_t years, uint8_t months, uint8_t days, uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t weekday = 0, bool century = false) {
+        reg[0x02] = simBcd(seconds) | (reg[0x02] & 0x80);
+        reg[0x03] = simBcd(minutes);
+        reg[0x04] = simBcd(hours);
+        reg[0x05] = simBcd(days);
+        reg[0x06] = weekday;
+        reg[0x07] = simBcd(months) | (century ? 0x80 : 0);
+        reg[0x08] = simBcd(years);
+    }
+
+    // an alarm match or a timer expiry
+    void raise(uint8_t flag) {
+        reg[0x01] |= flag;
+        if (!busy) {
+            updateInt();
+        }
+    }
+
+    uint8_t reg[16];
+    int tick_after_byte = -1;   // Byte of the next read transfers after which a second elapses
+
+private:
+    void writeReg(uint8_t address, uint8_t data) {
+        if (address == 0x01) {
+            // a flag written as 1 is left unchanged
+            reg[0x01] = (data & ~0x0C) | (reg[0x01] & data & 0x0C);
+            return;
+        }
+        if (address == 0x0F) {
+            countdown = data;
+        }
+        reg[address] = data;
+    }
+
+    void updateInt() {
+        bool active = ((reg[0x01] & 0x08) && (reg[0x01] & 0x02)) || ((reg[0x01] & 0x04) && (reg[0x01] & 0x01));
+        host_pin_set(MC_RTC_INT_PIN, active ? LOW : HIGH);
+    }
+
+    static uint8_t monthDays(uint8_t month, uint8_t year) {
+        static const uint8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        // the chip takes every year divisible by 4 as a leap year
+        return (month == 2 && year % 4 == 0) ? 29 : days[month - 1];
+    }
+
+    void advance() {
+        // countdown timer enabled on its 1 Hz source
+        if ((reg[0x0E] & 0x83) == 0x82 && countdown > 0 && --countdown == 0) {
+            countdown = reg[0x0F];
+            raise(0x04);
+        }
+
+        uint8_t vl = reg[0x02] & 0x80;
+        uint8_t seconds = simBin(reg[0x02] & 0x7F);
+        uint8_t minutes = simBin(reg[0x03] & 0x7F);
+        uint8_t hours = simBin(reg[0x04] & 0x3F);
+        uint8_t days = simBin(reg[0x05] & 0x3F);
+        uint8_t weekday = reg[0x06] & 0x07;
+        uint8_t century = reg[0x07] & 0x80;
+        uint8_t months = simBin(reg[0x07] & 0x1F);
+        uint8_t years = simBin(reg[0x08]);
+
+        if (++seconds == 60) {
+            seconds = 0;
+            if (++minutes == 60) {
+                minutes = 0;
+                if (++hours == 24) {
+                    hours = 0;
+                    weekday = (weekday + 1) % 7;
+                    if (++days > monthDays(months, years)) {
+                        days = 1;
+                        if (++months == 13) {
+                            months = 1;
+                            if (++years == 100) {
+                                years = 0;
+                                century ^= 0x80;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        reg[0x02] = simBcd(seconds) | vl;
+        reg[0x03] = simBcd(minutes);
+        reg[0x04] = simBcd(hours);
+        reg[0x05] = simBcd(days);
+        reg[0x06] = weekday;
+        reg[0x07] = simBcd(months) | century;
+        reg[0x08] = simBcd(years);
+    }
+
+    uint8_t pointer = 0;
+    bool first = false;
+    bool busy = false;
+    int bytes = 0;
+    int pending = 0;
+    uint8_t countdown = 0;
+};
+
+#endif
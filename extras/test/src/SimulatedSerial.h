@@ -0,0 +1,115 @@
+/*
+ * Simulated serial backend and the byte stream of a bus: the bytes are
+ * written into the receive ring at the character rate and the listener
+ * sees the DMA events of the board (half and full ring, idle line one
+ * character after the last stop bit) late by the interrupt latency.
+ * A transmission is accepted at once and completes on txComplete().
+ */
+
+#ifndef SIMULATED_SERIAL_H_
+#define SIMULATED_SERIAL_H_
+
+#include <random>
+#include <vector>
+
+#include "utility/SERIAL/SerialBackend.h"
+
+class SimSerialBackend : public SerialBackend {
+public:
+    SimSerialBackend(uint32_t char_ns) : char_ns(char_ns) {}
+
+    bool start(uint8_t* ring, size_t size, SerialBackendListener* listener) override {
+        this->ring = ring;
+        this->size = size;
+        this->listener = listener;
+        return true;
+    }
+
+    void stop() override {
+        listener = nullptr;
+    }
+
+    bool transmit(const uint8_t* data, size_t len) override {
+        tx_data = data;
+        tx_len = len;
+        return true;
+    }
+
+    uint32_t charTimeNs() override {
+        return char_ns;
+    }
+
+    // the stop bit of the last byte sent
+    void txComplete() {
+        tx_data = nullptr;
+        tx_len = 0;
+        listener->onTxComplete();
+    }
+
+    uint8_t* ring = nullptr;
+    size_t size = 0;
+    SerialBackendListener* listener = nullptr;
+    uint32_t char_ns;
+    const uint8_t* tx_data = nullptr;
+    size_t tx_len = 0;
+};
+
+class SimByteStream {
+public:
+    SimByteStream(SimSerialBackend& backend, uint64_t start_us, uint32_t seed = 1)
+        : backend(backend), random(seed), now_ns(start_us * 1000) {}
+
+    // random frame of len bytes from now, followed by the idle event; a line
+    // error on the first byte of the next frame can be reported in the same
+    // interrupt, before the idle line
+    void frame(size_t len, uint8_t next_errors = 0) {
+        frame_start.push_back(now());
+        frame_offset.push_back(sent.size());
+        for (size_t i = 0; i < len; i++) {
+            uint8_t byte = (uint8_t)random();
+            backend.ring[head] = byte;
+            sent.push_back(byte);
+            head = (head + 1) % backend.size;
+            now_ns += backend.char_ns;
+            if (head == 0 || head == backend.size / 2) {
+                backend.listener->onRxProgress(head, now() + latency_us, false);
+            }
+        }
+        now_ns += backend.char_ns;
+        if (next_errors != 0) {
+            backend.listener->onRxProgress(head, now() + latency_us, false);
+            backend.listener->onRxError(next_errors);
+        }
+        backend.listener->onRxProgress(head, now() + latency_us, true);
+    }
+
+    // line error on the next byte received
+    void error(uint8_t errors) {
+        backend.listener->onRxError(errors);
+    }
+
+    void idle(uint64_t us) {
+        now_ns += us * 1000;
+    }
+
+    uint64_t now() {
+        return now_ns / 1000;
+    }
+
+    uint32_t next(uint32_t range) {
+        return random() % range;
+    }
+
+    uint32_t latency_us = 3;
+    std::vector<uint8_t> sent;
+    std::vector<uint64_t> frame_start;      // Start bit of the first byte of each frame
+    std::vector<size_t> frame_offset;       // Position of each frame in sent
+
+private:
+    SimSerialBackend& backend;
+    std::mt19937 random;
+    uint64_t now_ns;
+    size_t head = 0;
+};
+
+#endif
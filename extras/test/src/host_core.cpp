@@ -0,0 +1,462 @@
+/*
+ * Implementation of the host replacements of the Arduino core, mbed OS
+ * and KVStore APIs.
+ */
+
+#include <Arduino.h>
+#include <mbed.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <Arduino_CAN.h>
+#include <mbed_mktime.h>
+#include <kvstore_global_api.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+
+uint64_t host_time_us = 0;
+
+static std::recursive_mutex critical_section;
+
+void core_util_critical_section_enter() { critical_section.lock(); }
+void core_util_critical_section_exit() { critical_section.unlock(); }
+
+void host_error(int status, const char* message) {
+    fprintf(stderr, "mbed error 0x%x: %s\n", status, message);
+    abort();
+}
+
+/* Pins ----------------------------------------------------------------------*/
+static std::map<int, PinStatus>& pinStates() {
+    static std::map<int, PinStatus> states;
+    return states;
+}
+
+static std::map<int, PinMode>& pinModes() {
+    static std::map<int, PinMode> modes;
+    return modes;
+}
+
+// a chip is selected by its chip select driven low, an input pin does not select it
+static bool spiSelected(PinName cs) {
+    auto it = pinModes().find(cs);
+    return host_pin_state(cs) == LOW && (it == pinModes().end() || it->second == OUTPUT);
+}
+
+static std::map<int, HostSpiDevice*>& spiDevices() {
+    static std::map<int, HostSpiDevice*> devices;
+    return devices;
+}
+
+PinStatus host_pin_state(PinName pin) {
+    auto it = pinStates().find(pin);
+    return (it == pinStates().end()) ? LOW : it->second;
+}
+
+void host_pin_set(PinName pin, PinStatus value) {
+    PinStatus previous = host_pin_state(pin);
+
+    pinStates()[pin] = value;
+    mbed::InterruptIn::host_edge(pin, previous, value);
+}
+
+void pinMode(PinName pin, PinMode mode) {
+    pinModes()[pin] = mode;
+}
+
+void digitalWrite(PinName pin, PinStatus value) {
+    bool previous = spiSelected(pin);
+    auto it = spiDevices().find(pin);
+
+    host_pin_set(pin, value);
+    if (it == spiDevices().end() || previous == spiSelected(pin)) {
+        return;
+    }
+    if (spiSelected(pin)) {
+        HostSpiDevice* device = it->second;
+        bool overlap = false;
+
+        for (auto& other : spiDevices()) {
+            if (other.second != device && spiSelected((PinName)other.first)) {
+                overlap = true;
+            }
+        }
+        if (overlap || !device->spi->open || device->spi->settings.mode != device->mode) {
+            device->bad_frames++;
+        }
+        device->frames++;
+        device->select();
+    } else {
+        it->second->deselect();
+    }
+}
+
+PinStatus digitalRead(PinName pin) { return host_pin_state(pin); }
+int analogRead(PinName pin) { return 0; }
+void analogReadResolution(int bits) {}
+
+unsigned long micros() { return (unsigned long)host_time_us; }
+unsigned long millis() { return (unsigned long)(host_time_us / 1000); }
+void delay(unsigned long ms) { host_time_us += (uint64_t)ms * 1000; }
+void delayMicroseconds(unsigned int us) { host_time_us += us; }
+
+/* Timers and NVIC -----------------------------------------------------------*/
+TIM_TypeDef host_timers[3];
+
+static uintptr_t nvic_vector[HOST_IRQ_COUNT];
+static bool nvic_enabled[HOST_IRQ_COUNT];
+
+void NVIC_SetVector(IRQn_Type irq, uintptr_t vector) { nvic_vector[irq] = vector; }
+uintptr_t NVIC_GetVector(IRQn_Type irq) { return nvic_vector[irq]; }
+void NVIC_EnableIRQ(IRQn_Type irq) { nvic_enabled[irq] = true; }
+void NVIC_DisableIRQ(IRQn_Type irq) { nvic_enabled[irq] = false; }
+
+void host_timer_update(TIM_TypeDef* tim) {
+    IRQn_Type irq = (tim == TIM1) ? TIM1_UP_IRQn : (tim == TIM3) ? TIM3_IRQn : TIM8_UP_TIM13_IRQn;
+
+    if (tim->CR1 & TIM_CR1_UDIS) {
+        return;
+    }
+    tim->SR |= TIM_SR_UIF;
+    if ((tim->DIER & TIM_DIER_UIE) && nvic_enabled[irq] && nvic_vector[irq] != 0) {
+        ((void (*)(void))nvic_vector[irq])();
+    }
+}
+
+HRTIM_TypeDef host_hrtim1;
+
+// PWM pins of the analog outputs: AO0 and AO1 share TIM8, AO2 runs on the HRTIM as on the Portenta
+const PinMap PinMap_PWM[] = {
+    { PJ_11, (intptr_t)TIM8, 2 },
+    { PK_1, (intptr_t)TIM8, 3 },
+    { PG_7, (intptr_t)HRTIM1, 2 },
+    { PC_7, (intptr_t)TIM3, 2 },
+    { NC, 0, 0 }
+};
+
+uintptr_t pinmap_find_peripheral(PinName pin, const PinMap* map) {
+    for (; map->pin != NC; map++) {
+        if (map->pin == pin) {
+            return (uintptr_t)map->peripheral;
+        }
+    }
+    return (uintptr_t)NC;
+}
+
+mbed::PwmOut::PwmOut(PinName pin) {
+    const PinMap* map = PinMap_PWM;
+
+    while (map->pin != NC && map->pin != pin) {
+        map++;
+    }
+    memset(&_pwm, 0, sizeof(_pwm));
+    _pwm.pwm = (void*)map->peripheral;
+    _pwm.channel = map->function;
+    _pwm.prescaler = 1;
+
+    TIM_TypeDef* tim = (TIM_TypeDef*)map->peripheral;
+    if (tim != TIM1 && tim != TIM3 && tim != TIM8) {
+        return;
+    }
+    memset((void*)tim, 0, sizeof(*tim));
+    // 1 us tick and 2 ms period as programmed by mbed
+    tim->PSC = HOST_TIM_CLOCK / 1000000 - 1;
+    tim->ARR = 1999;
+}
+
+/* Pin interrupts ------------------------------------------------------------*/
+static std::map<int, mbed::InterruptIn*>& pinInterrupts() {
+    static std::map<int, mbed::InterruptIn*> interrupts;
+    return interrupts;
+}
+
+mbed::InterruptIn::InterruptIn(PinName pin, int mode) : _pin(pin) {
+    pinInterrupts()[pin] = this;
+}
+
+mbed::InterruptIn::~InterruptIn() {
+    pinInterrupts().erase(_pin);
+}
+
+void mbed::InterruptIn::host_edge(PinName pin, PinStatus previous, PinStatus value) {
+    auto it = pinInterrupts().find(pin);
+
+    if (it != pinInterrupts().end() && previous == HIGH && value == LOW && it->second->_enabled && it->second->_fall) {
+        it->second->_fall();
+    }
+}
+
+/* FDCAN ---------------------------------------------------------------------*/
+FDCAN_GlobalTypeDef host_fdcan1;
+uint32_t host_sramcan[HOST_SRAMCAN_WORDS];
+
+HostFdcanCccr::operator uint32_t() {
+    host_time_us++;
+    if (((_requested ^ _value) & FDCAN_CCCR_INIT) && latency >= 0 && _pending-- <= 0) {
+        _value ^= FDCAN_CCCR_INIT;
+        if (_value & FDCAN_CCCR_INIT) {
+            init_entries++;
+        } else {
+            _requested &= ~FDCAN_CCCR_CCE;
+        }
+    }
+    *this = _requested;
+    return _value;
+}
+
+HostFdcanCccr& HostFdcanCccr::operator=(uint32_t value) {
+    if ((value ^ _requested) & FDCAN_CCCR_INIT) {
+        _pending = latency;
+    }
+    _requested = value;
+    // INIT follows the controller, CCE can only be set while INIT is
+    uint32_t cce = (_value & FDCAN_CCCR_INIT) ? (_requested & FDCAN_CCCR_CCE) : 0;
+    _value = (_value & FDCAN_CCCR_INIT) | cce | (_requested & ~(FDCAN_CCCR_INIT | FDCAN_CCCR_CCE));
+    return *this;
+}
+
+/* CAN -----------------------------------------------------------------------*/
+std::deque<CanMsg> host_can_rx;
+std::vector<CanMsg> host_can_tx;
+
+bool Arduino_CAN::begin(CanBitRate const can_bitrate) {
+    host_can_rx.clear();
+    return true;
+}
+
+void Arduino_CAN::end() {
+}
+
+int Arduino_CAN::write(CanMsg const & msg) {
+    host_can_tx.push_back(msg);
+    return msg.data_length;
+}
+
+size_t Arduino_CAN::available() {
+    return host_can_rx.size();
+}
+
+CanMsg Arduino_CAN::read() {
+    CanMsg msg = host_can_rx.front();
+    host_can_rx.pop_front();
+    return msg;
+}
+
+/* SPI -----------------------------------------------------------------------*/
+SPIClass SPI;
+SPIClass SPI1;
+
+HostSpiDevice::HostSpiDevice(PinName cs, uint8_t mode) : HostSpiDevice(cs, mode, SPI) {
+}
+
+HostSpiDevice::HostSpiDevice(PinName cs, uint8_t mode, SPIClass& spi) : cs(cs), mode(mode), spi(&spi) {
+    spiDevices()[cs] = this;
+    pinModes().erase(cs);
+    host_pin_set(cs, HIGH);
+}
+
+HostSpiDevice::~HostSpiDevice() {
+    spiDevices().erase(cs);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    for (auto& device : spiDevices()) {
+        if (spiSelected((PinName)device.first)) {
+            device.second->bytes++;
+            return device.second->exchange(data);
+        }
+    }
+    return 0xFF;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data) {
+    uint16_t msb = transfer((uint8_t)(data >> 8));
+    return (msb << 8) | transfer((uint8_t)data);
+}
+
+void SPIClass::transfer(void* buffer, size_t len) {
+    uint8_t* data = (uint8_t*)buffer;
+
+    blocks++;
+    for (size_t i = 0; i < len; i++) {
+        data[i] = transfer(data[i]);
+    }
+}
+
+/* I2C -----------------------------------------------------------------------*/
+TwoWire Wire;
+TwoWire Wire1;
+
+HostI2cDevice::HostI2cDevice(uint8_t address, TwoWire& bus) : address(address), bus(&bus) {
+    for (auto& slot : bus.devices) {
+        if (slot == nullptr) {
+            slot = this;
+            break;
+        }
+    }
+}
+
+HostI2cDevice::~HostI2cDevice() {
+    for (auto& slot : bus->devices) {
+        if (slot == this) {
+            slot = nullptr;
+        }
+    }
+}
+
+HostI2cDevice* TwoWire::find(uint8_t address) {
+    for (auto device : devices) {
+        if (device != nullptr && device->address == address) {
+            return device;
+        }
+    }
+    return nullptr;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _address = address;
+    _tx_len = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (_tx_len == HOST_I2C_BUFFER) {
+        return 0;
+    }
+    _tx[_tx_len++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+    size_t written = 0;
+
+    while (written < len && write(data[written])) {
+        written++;
+    }
+    return written;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+    HostI2cDevice* device = find(_address);
+
+    transfers++;
+    if (device == nullptr) {
+        return 2;
+    }
+    device->transfers++;
+    device->start();
+    for (size_t i = 0; i < _tx_len; i++) {
+        device->receive(_tx[i]);
+    }
+    if (stop) {
+        device->stop();
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t len, bool stop) {
+    HostI2cDevice* device = find(address);
+
+    transfers++;
+    _rx_len = 0;
+    _rx_pos = 0;
+    if (device == nullptr || len > HOST_I2C_BUFFER) {
+        return 0;
+    }
+    device->transfers++;
+    device->start();
+    for (size_t i = 0; i < len; i++) {
+        _rx[_rx_len++] = device->transmit();
+    }
+    if (stop) {
+        device->stop();
+    }
+    return (uint8_t)_rx_len;
+}
+
+int TwoWire::available() {
+    return (int)(_rx_len - _rx_pos);
+}
+
+int TwoWire::read() {
+    return (_rx_pos < _rx_len) ? _rx[_rx_pos++] : -1;
+}
+
+/* Calendar ------------------------------------------------------------------*/
+time_t host_rtc_time = 0;
+
+bool _rtc_maketime(const struct tm* time, time_t* seconds, rtc_leap_year_support_t leap_year_support) {
+    struct tm copy = *time;
+
+    if (seconds == nullptr || time->tm_year < 70) {
+        return false;
+    }
+    *seconds = timegm(&copy);
+    return true;
+}
+
+bool _rtc_localtime(time_t timestamp, struct tm* time_info, rtc_leap_year_support_t leap_year_support) {
+    return gmtime_r(&timestamp, time_info) != nullptr;
+}
+
+void set_time(time_t t) {
+    host_rtc_time = t;
+}
+
+/* KVStore backed by files ---------------------------------------------------*/
+#define KV_HOST_ERROR_NOT_FOUND   -1
+#define KV_HOST_ERROR_IO          -2
+#define KV_HOST_ERROR_SIZE        -3
+
+static std::string kv_dir = ".";
+
+static std::string kvPath(const char* key) {
+    std::string name = key;
+
+    for (size_t i = 0; i < name.size(); i++) {
+        if (name[i] == '/') {
+            name[i] = '_';
+        }
+    }
+    return kv_dir + "/" + name;
+}
+
+void kv_host_set_dir(const char* dir) {
+    kv_dir = dir;
+}
+
+int kv_set(const char* full_name_key, const void* buffer, size_t size, uint32_t create_flags) {
+    FILE* f = fopen(kvPath(full_name_key).c_str(), "wb");
+
+    if (f == nullptr) {
+        return KV_HOST_ERROR_IO;
+    }
+    size_t written = fwrite(buffer, 1, size, f);
+    fclose(f);
+
+    return (written == size) ? MBED_SUCCESS : KV_HOST_ERROR_IO;
+}
+
+int kv_get(const char* full_name_key, void* buffer, size_t buffer_size, size_t* actual_size) {
+    FILE* f = fopen(kvPath(full_name_key).c_str(), "rb");
+
+    if (f == nullptr) {
+        return KV_HOST_ERROR_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0 || (size_t)size > buffer_size) {
+        fclose(f);
+        return KV_HOST_ERROR_SIZE;
+    }
+    *actual_size = fread(buffer, 1, size, f);
+    fclose(f);
+
+    return MBED_SUCCESS;
+}
+
+int kv_remove(const char* full_name_key) {
+    return (remove(kvPath(full_name_key).c_str()) == 0) ? MBED_SUCCESS : KV_HOST_ERROR_NOT_FOUND;
+}
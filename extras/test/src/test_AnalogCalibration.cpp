@@ -0,0 +1,99 @@
+#include <catch2/catch.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <kvstore_global_api.h>
+
+#include "AnalogCalibrationClass.h"
+
+/*
+ * AnalogCalibrationClass persisted through the host KVStore, which keeps
+ * each key in a file of a temporary directory.
+ */
+
+struct KvDir {
+    char path[32];
+
+    KvDir() {
+        strcpy(path, "/tmp/pmc_kv_XXXXXX");
+        REQUIRE(mkdtemp(path) != nullptr);
+        kv_host_set_dir(path);
+    }
+    ~KvDir() {
+        kv_remove("/kv/pmc_analog_cal");
+        rmdir(path);
+    }
+};
+
+TEST_CASE("Calibration is saved and loaded through the KVStore", "[AnalogCalibration]") {
+    KvDir dir;
+    AnalogCalibrationClass cal;
+    uint8_t in_slot = AnalogCalibrationClass::inputSlot(1, SensorType::V_0_10);
+    uint8_t out_slot = AnalogCalibrationClass::outputSlot(2);
+    const uint16_t raw[] = { 0, 30000, 65535 };
+    const uint16_t ref[] = { 100, 30500, 65000 };
+
+    REQUIRE_FALSE(cal.begin());
+
+    REQUIRE(cal.setInputGainOffset(1, SensorType::V_0_10, 1.01f, -20));
+    REQUIRE(cal.setOutputTable(2, raw, ref, 3));
+    uint16_t in_value = cal.apply(in_slot, 40000);
+    uint16_t out_value = cal.apply(out_slot, 20000);
+    REQUIRE(in_value == 40380);
+    REQUIRE(cal.save());
+
+    AnalogCalibrationClass loaded;
+    REQUIRE(loaded.begin());
+    REQUIRE(loaded.isActive(in_slot));
+    REQUIRE(loaded.isActive(out_slot));
+    REQUIRE_FALSE(loaded.isActive(AnalogCalibrationClass::inputSlot(1, SensorType::NTC)));
+    REQUIRE(loaded.apply(in_slot, 40000) == in_value);
+    REQUIRE(loaded.apply(out_slot, 20000) == out_value);
+
+    SECTION("a corrupted store keeps the current calibration") {
+        std::string path = std::string(dir.path) + "/_kv_pmc_analog_cal";
+        FILE* f = fopen(path.c_str(), "r+b");
+        REQUIRE(f != nullptr);
+        fseek(f, 8, SEEK_SET);
+        fputc(0x55, f);
+        fclose(f);
+
+        REQUIRE_FALSE(loaded.load());
+        REQUIRE(loaded.apply(in_slot, 40000) == in_value);
+    }
+
+    SECTION("each import replaces the whole calibration") {
+        uint8_t blob[CAL_BLOB_MAX_SIZE];
+        AnalogCalibrationClass other;
+
+        REQUIRE(other.setInputGainOffset(0, SensorType::NTC, 2.0f, 0));
+        size_t len = other.exportBlob(blob, sizeof(blob));
+        REQUIRE(len > 0);
+
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(loaded.importBlob(blob, len));
+            REQUIRE_FALSE(loaded.isActive(in_slot));
+            REQUIRE(loaded.apply(AnalogCalibrationClass::inputSlot(0, SensorType::NTC), 1000) == 2000);
+            REQUIRE(loaded.load());
+            REQUIRE(loaded.apply(in_slot, 40000) == in_value);
+            REQUIRE_FALSE(loaded.isActive(AnalogCalibrationClass::inputSlot(0, SensorType::NTC)));
+        }
+    }
+
+    SECTION("erase") {
+        REQUIRE(loaded.erase());
+        REQUIRE_FALSE(loaded.load());
+        loaded.reset();
+        REQUIRE(loaded.apply(in_slot, 40000) == 40000);
+    }
+}
+
+TEST_CASE("Calibration slots", "[AnalogCalibration]") {
+    REQUIRE(AnalogCalibrationClass::inputSlot(0, SensorType::NTC) == 0);
+    REQUIRE(AnalogCalibrationClass::inputSlot(2, SensorType::MA_4_20) == 8);
+    REQUIRE(AnalogCalibrationClass::inputSlot(3, SensorType::NTC) == CAL_SLOTS);
+    REQUIRE(AnalogCalibrationClass::outputSlot(0) == 9);
+    REQUIRE(AnalogCalibrationClass::outputSlot(MC_AO_CHANNELS) == CAL_SLOTS);
+}
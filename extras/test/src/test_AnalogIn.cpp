@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+
+#include "AnalogInClass.h"
+#include "DigitalOutputsClass.h"
+
+/*
+ * Alarm outputs of AnalogInClass: the blocks of samples are fed with
+ * processSamples() as the ADC callback does, the digital outputs are the
+ * host pins.
+ */
+
+static const uint16_t quiet[4] = { 30000, 30000, 30000, 30000 };
+static const uint16_t above[4] = { 30000, 50000, 50000, 50000 };
+
+TEST_CASE("AnalogInClass drives the bound output from the alarm", "[AnalogIn]") {
+    AnalogInClass ai;
+
+    REQUIRE(ai.begin(SensorType::V_0_10));
+    host_pin_set(MC_DO_DO2_PIN, LOW);
+    ai.setAlarmWindow(1, 20000, 40000);
+    ai.bindAlarmOutput(1, 2);
+
+    ai.processSamples(1, quiet, 4);
+    REQUIRE(host_pin_state(MC_DO_DO2_PIN) == LOW);
+    ai.processSamples(1, above, 4);
+    REQUIRE(host_pin_state(MC_DO_DO2_PIN) == HIGH);
+
+    SECTION("disableAlarm() releases the output") {
+        ai.disableAlarm(1);
+        REQUIRE(host_pin_state(MC_DO_DO2_PIN) == LOW);
+        REQUIRE(ai.getAlarmStatus(1).state == WINDOW_ALARM_NONE);
+    }
+
+    SECTION("a new window releases the output until the alarm trips again") {
+        ai.setAlarmWindow(1, 20000, 60000);
+        REQUIRE(host_pin_state(MC_DO_DO2_PIN) == LOW);
+        ai.processSamples(1, above, 4);
+        REQUIRE(host_pin_state(MC_DO_DO2_PIN) == LOW);
+
+        ai.setAlarmWindow(1, 20000, 40000);
+        ai.processSamples(1, above, 4);
+        REQUIRE(host_pin_state(MC_DO_DO2_PIN) == HIGH);
+    }
+
+    SECTION("an active low output is released high") {
+        ai.bindAlarmOutput(1, 2, LOW);
+        ai.disableAlarm(1);
+        REQUIRE(host_pin_state(MC_DO_DO2_PIN) == HIGH);
+    }
+
+    SECTION("resetting a quiet alarm leaves the output alone") {
+        ai.disableAlarm(1);
+        host_pin_set(MC_DO_DO2_PIN, HIGH);
+        ai.setAlarmWindow(1, 20000, 40000);
+        ai.disableAlarm(1);
+        REQUIRE(host_pin_state(MC_DO_DO2_PIN) == HIGH);
+    }
+}
+
+TEST_CASE("AnalogInClass ignores the sample blocks while the monitor runs", "[AnalogIn]") {
+    AnalogInClass ai;
+
+    REQUIRE(ai.begin(SensorType::V_0_10));
+    ai.setAlarmWindow(0, 20000, 40000);
+
+    REQUIRE(ai.startMonitor(1000));
+    ai.processSamples(0, above, 4);
+    REQUIRE(ai.getAlarmStatus(0).high_count == 0);
+
+    ai.stopMonitor();
+    ai.processSamples(0, above, 4);
+    REQUIRE(ai.getAlarmStatus(0).high_count == 1);
+}
@@ -0,0 +1,147 @@
+#include <catch2/catch.hpp>
+
+#include "AnalogOutClass.h"
+
+/*
+ * AnalogOutClass on the host timers of the PwmOut stubs. The waveform timer
+ * interrupt is played by mbed::Ticker::fireAll().
+ */
+
+static bool tickerAttached() {
+    return !mbed::Ticker::active().empty();
+}
+
+TEST_CASE("The waveform timer stops once the one-shots are over", "[AnalogOut]") {
+    AnalogOutClass ao;
+    const uint16_t ramp[] = { 0, 10000, 20000 };
+
+    REQUIRE(ao.begin());
+    REQUIRE_FALSE(tickerAttached());
+
+    REQUIRE(ao.playWaveform(0, ramp, 3, 1000, WAVEFORM_ONESHOT));
+    REQUIRE(ao.playWaveform(1, ramp, 2, 1000, WAVEFORM_ONESHOT));
+    REQUIRE(tickerAttached());
+
+    mbed::Ticker::fireAll();
+    mbed::Ticker::fireAll();
+    REQUIRE_FALSE(ao.isWaveformPlaying(1));
+    REQUIRE(ao.isWaveformPlaying(0));
+    REQUIRE(tickerAttached());
+
+    mbed::Ticker::fireAll();
+    REQUIRE_FALSE(ao.isWaveformPlaying(0));
+    REQUIRE_FALSE(tickerAttached());
+
+    // a new waveform restarts the timer
+    REQUIRE(ao.playWaveform(2, ramp, 3, 1000, WAVEFORM_LOOP));
+    REQUIRE(tickerAttached());
+    ao.write(2, 5.0f);
+    REQUIRE_FALSE(tickerAttached());
+}
+
+TEST_CASE("A direct write leaves the waveform timer alone", "[AnalogOut]") {
+    AnalogOutClass ao;
+    const uint16_t ramp[] = { 0, 10000, 20000 };
+
+    REQUIRE(ao.begin());
+    REQUIRE(ao.playWaveform(0, ramp, 3, 1000, WAVEFORM_LOOP));
+
+    ao.write(1, 2.0f);
+    REQUIRE(ao.isWaveformPlaying(0));
+    REQUIRE(tickerAttached());
+
+    ao.stopWaveform(0);
+    REQUIRE_FALSE(tickerAttached());
+}
+
+static uint32_t ccr(int channel) {
+    // host timers: AO0 TIM8 CH2, AO1 TIM8 CH3, AO3 TIM3 CH2, AO2 is on the HRTIM through mbed
+    static TIM_TypeDef* const tim[MC_AO_CHANNELS] = { TIM8, TIM8, nullptr, TIM3 };
+    static const int index[MC_AO_CHANNELS] = { 1, 2, 0, 1 };
+    return (&tim[channel]->CCR1)[index[channel]];
+}
+
+static bool hrtimUntouched() {
+    for (uint32_t reg : host_hrtim1.REG) {
+        if (reg != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("writeRaw() stages the values until the update event of every timer", "[AnalogOut]") {
+    AnalogOutClass ao;
+    const uint16_t duty[MC_AO_CHANNELS] = { 0, 0x4000, 0x8000, 0xFFFF };
+
+    REQUIRE(ao.begin());
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        REQUIRE(ao.setPeriodUs(ch, 100));
+    }
+    REQUIRE_FALSE(ao.isUpdatePending());
+
+    ao.writeRaw(duty);
+
+    // the compare values are in the preload registers, the update events are enabled again
+    REQUIRE(ccr(0) == 0);
+    REQUIRE(ccr(1) == 5000);
+    REQUIRE(ccr(3) == 20000);
+    REQUIRE(ao.getPeriodCounts(2) == 100);
+    REQUIRE(hrtimUntouched());
+    REQUIRE_FALSE(TIM3->CR1 & TIM_CR1_UDIS);
+    REQUIRE_FALSE(TIM8->CR1 & TIM_CR1_UDIS);
+    REQUIRE(ao.isUpdatePending());
+
+    // pending until each timer had its update event, the mbed output is written at once
+    host_timer_update(TIM8);
+    REQUIRE(ao.isUpdatePending());
+    host_timer_update(TIM3);
+    REQUIRE_FALSE(ao.isUpdatePending());
+
+    SECTION("an update event before the staging does not count") {
+        TIM3->SR |= TIM_SR_UIF;
+        TIM8->SR |= TIM_SR_UIF;
+        ao.writeRaw(duty);
+        REQUIRE(ao.isUpdatePending());
+        host_timer_update(TIM3);
+        REQUIRE(ao.isUpdatePending());
+        host_timer_update(TIM8);
+        REQUIRE_FALSE(ao.isUpdatePending());
+    }
+
+    SECTION("the staged values stop the waveforms") {
+        const uint16_t ramp[] = { 0, 10000, 20000 };
+        REQUIRE(ao.playWaveform(3, ramp, 3, 1000));
+        ao.writeRaw(duty);
+        REQUIRE_FALSE(ao.isWaveformPlaying(3));
+        REQUIRE_FALSE(tickerAttached());
+    }
+}
+
+TEST_CASE("writeAll() converts the voltages before staging them", "[AnalogOut]") {
+    AnalogOutClass ao;
+    const float voltage[MC_AO_CHANNELS] = { 10.5f, 5.25f, 0.0f, -1.0f };
+
+    REQUIRE(ao.begin());
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        REQUIRE(ao.setPeriodUs(ch, 100));
+    }
+
+    ao.writeAll(voltage);
+    REQUIRE(ccr(0) == 20000);
+    REQUIRE(ccr(1) == 10000);
+    REQUIRE(ccr(3) == 0);
+    REQUIRE(ao.isUpdatePending());
+}
+
+TEST_CASE("alignPeriods() restarts every timer", "[AnalogOut]") {
+    AnalogOutClass ao;
+
+    REQUIRE(ao.begin());
+    TIM3->EGR = 0;
+    TIM8->EGR = 0;
+    ao.alignPeriods();
+    REQUIRE(TIM3->EGR == TIM_EGR_UG);
+    REQUIRE(TIM8->EGR == TIM_EGR_UG);
+    REQUIRE(hrtimUntouched());
+}
@@ -0,0 +1,404 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "CANCommClass.h"
+#include "utility/CAN/FdcanFilter.h"
+
+#include "SimulatedCan.h"
+
+/*
+ * Synthetic traffic through the simulated acceptance filters and
+ * dispatch(), checked against a linear scan of the rules: exact
+ * identifiers first, then the ranges and the masks ignoring low bits in
+ * registration order, then the other masks.
+ */
+typedef void (*CanHandler)(CanMsg const & msg);
+
+struct TestRule {
+    uint8_t type;
+    uint32_t first;
+    uint32_t last;      // Last identifier of a range, mask of a mask
+    int slot;           // Index returned at registration, -1 once removed
+};
+
+static std::vector<std::pair<int, uint32_t>> can_calls;
+
+template<size_t N> static void recordFrame(CanMsg const & msg) {
+    can_calls.push_back(std::make_pair((int)N, msg.id));
+}
+
+template<size_t... N> static std::array<CanHandler, sizeof...(N)> makeHandlers(std::index_sequence<N...>) {
+    return {{&recordFrame<N>...}};
+}
+
+static const std::array<CanHandler, MC_CAN_HANDLERS> can_handlers = makeHandlers(std::make_index_sequence<MC_CAN_HANDLERS>());
+
+static uint32_t formatBits(uint32_t id) {
+    return CAN_ID_EXTENDED_FLAG | ((id & CAN_ID_EXTENDED_FLAG) ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK);
+}
+
+static bool ruleMatches(const TestRule& rule, uint32_t id) {
+    if (rule.type == CAN_RULE_MASK) {
+        uint32_t mask = (rule.last | CAN_ID_EXTENDED_FLAG) & formatBits(rule.first);
+        return (id & mask) == (rule.first & mask);
+    }
+    return id >= rule.first && id <= rule.last;
+}
+
+static bool ruleIsInterval(const TestRule& rule) {
+    if (rule.type != CAN_RULE_MASK) {
+        return true;
+    }
+    uint32_t ignored = ~((rule.last | CAN_ID_EXTENDED_FLAG) & formatBits(rule.first)) & formatBits(rule.first);
+    return (ignored & (ignored + 1)) == 0;
+}
+
+// handler (index of the rule) of an identifier, -1 if none
+static int referenceRoute(const std::vector<TestRule>& rules, uint32_t id) {
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (rules[i].slot >= 0 && rules[i].type == CAN_RULE_ID && rules[i].first == id) {
+            return (int)i;
+        }
+    }
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (rules[i].slot >= 0 && rules[i].type != CAN_RULE_ID && ruleIsInterval(rules[i]) && ruleMatches(rules[i], id)) {
+            return (int)i;
+        }
+    }
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (rules[i].slot >= 0 && !ruleIsInterval(rules[i]) && ruleMatches(rules[i], id)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static TestRule randomRule(std::mt19937& random) {
+    bool extended = random() % 4 == 0;
+    uint32_t bits = extended ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK;
+    TestRule rule;
+
+    rule.slot = -1;
+    rule.first = random() % 64;
+    if (extended) {
+        rule.first |= CAN_ID_EXTENDED_FLAG | (random() % 4) << 20;
+    }
+    rule.type = random() % 3;
+    if (rule.type == CAN_RULE_ID) {
+        rule.last = rule.first;
+    } else if (rule.type == CAN_RULE_RANGE) {
+        rule.last = rule.first + random() % 20;
+    } else if (random() % 2) {
+        rule.last = bits & ~((1U << (random() % 4)) - 1);
+    } else {
+        rule.last = bits & ~(uint32_t)(random() % 16);
+    }
+    return rule;
+}
+
+static int registerRule(CANCommClass& can, const TestRule& rule, int handler) {
+    switch (rule.type) {
+        case CAN_RULE_ID:
+            return can.onReceive(rule.first, can_handlers[handler]);
+        case CAN_RULE_RANGE:
+            return can.onReceiveRange(rule.first, rule.last, can_handlers[handler]);
+        default:
+            return can.onReceive(rule.first, rule.last, can_handlers[handler]);
+    }
+}
+
+// identifiers around the ones of randomRule(), both formats
+static std::vector<uint32_t> syntheticTraffic(std::mt19937& random, int frames) {
+    std::vector<uint32_t> ids;
+
+    for (int i = 0; i < frames; i++) {
+        uint32_t id = random() % 0x100;
+        if (random() % 4 == 0) {
+            id |= CAN_ID_EXTENDED_FLAG | (random() % 4) << 20;
+        }
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+// bus traffic drained by batches of 8 every 5 frames, then to the end
+static void runTraffic(CANCommClass& can, const std::vector<uint32_t>& ids, std::vector<uint32_t>* accepted) {
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (simCanReceive(ids[i])) {
+            accepted->push_back(ids[i]);
+        }
+        if (i % 5 == 4) {
+            can.dispatch(8);
+        }
+    }
+    while (can.dispatch() > 0) {
+    }
+}
+
+static int activeRules(const std::vector<TestRule>& rules) {
+    int count = 0;
+
+    for (const TestRule& rule : rules) {
+        count += (rule.slot >= 0);
+    }
+    return count;
+}
+
+TEST_CASE("CANCommClass routes synthetic traffic like a linear scan of the rules", "[CANComm]") {
+    std::mt19937 random(7);
+
+    for (int round = 0; round < 100; round++) {
+        INFO("round " << round);
+        CANCommClass can;
+        std::vector<TestRule> rules;
+
+        simCanReset(128, 64);
+        can_calls.clear();
+
+        // the handler of each rule is its index, some rules are removed on the way
+        int count = 1 + random() % MC_CAN_HANDLERS;
+        for (int i = 0; i < count; i++) {
+            rules.push_back(randomRule(random));
+            rules.back().slot = registerRule(can, rules.back(), rules.size() - 1);
+            REQUIRE(rules.back().slot >= 0);
+            if (random() % 10 == 0) {
+                TestRule& victim = rules[random() % rules.size()];
+                if (victim.slot >= 0) {
+                    REQUIRE(can.removeHandler(victim.slot));
+                    victim.slot = -1;
+                }
+            }
+        }
+
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        REQUIRE(can.getDispatchStats().hw_filters == activeRules(rules));
+
+        std::vector<uint32_t> ids = syntheticTraffic(random, 2000);
+        std::vector<uint32_t> accepted;
+        runTraffic(can, ids, &accepted);
+
+        // one filter element per rule: only the routed frames are received
+        std::vector<std::pair<int, uint32_t>> expected;
+        std::vector<uint32_t> routed;
+        for (uint32_t id : ids) {
+            int rule = referenceRoute(rules, id);
+            if (rule >= 0) {
+                expected.push_back(std::make_pair(rule, id));
+                routed.push_back(id);
+            }
+        }
+        REQUIRE(accepted == routed);
+        REQUIRE(can_calls == expected);
+
+        CanDispatchStats stats = can.getDispatchStats();
+        REQUIRE(stats.unmatched == 0);
+        REQUIRE(stats.frames == routed.size());
+        REQUIRE(stats.max_batch <= MC_CAN_BATCH);
+        can.end();
+    }
+}
+
+TEST_CASE("CANCommClass covers the rules with one filter when the lists are short", "[CANComm]") {
+    std::mt19937 random(11);
+
+    for (int round = 0; round < 50; round++) {
+        INFO("round " << round);
+        CANCommClass can;
+        std::vector<TestRule> rules;
+
+        simCanReset(1, 1);
+        can_calls.clear();
+
+        int count = 2 + random() % (MC_CAN_HANDLERS - 1);
+        for (int i = 0; i < count; i++) {
+            rules.push_back(randomRule(random));
+            rules.back().slot = registerRule(can, rules.back(), rules.size() - 1);
+            REQUIRE(rules.back().slot >= 0);
+        }
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        REQUIRE(can.getDispatchStats().hw_filters >= 1);
+        REQUIRE(can.getDispatchStats().hw_filters <= 2);
+
+        std::vector<uint32_t> ids = syntheticTraffic(random, 2000);
+        std::vector<uint32_t> accepted;
+        runTraffic(can, ids, &accepted);
+
+        // no routed frame is lost, the other frames let in by the cover are unmatched
+        std::vector<std::pair<int, uint32_t>> expected;
+        uint32_t unmatched = 0;
+        bool covered = true;
+        for (uint32_t id : ids) {
+            int rule = referenceRoute(rules, id);
+            bool in = simCanAccepts(id);
+            if (rule >= 0) {
+                covered = covered && in;
+                expected.push_back(std::make_pair(rule, id));
+            } else if (in) {
+                unmatched++;
+            }
+        }
+        REQUIRE(covered);
+        REQUIRE(can_calls == expected);
+        REQUIRE(can.getDispatchStats().unmatched == unmatched);
+        REQUIRE(can.getDispatchStats().frames == accepted.size());
+        can.end();
+    }
+}
+
+TEST_CASE("CANCommClass only writes the filters in begin()", "[CANComm]") {
+    CANCommClass can;
+    std::vector<uint32_t> accepted;
+
+    simCanReset(128, 64);
+    can_calls.clear();
+    REQUIRE(can.onReceiveRange(CanStandardId(0x100), CanStandardId(0x10F), can_handlers[0]) >= 0);
+    REQUIRE(can.onReceive(CanStandardId(0x200), 0x7F0, can_handlers[1]) >= 0);
+
+    SECTION("the filters are programmed in configuration mode") {
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        REQUIRE(host_fdcan1.CCCR.init_entries == 1);
+        REQUIRE(host_fdcan1.GFC.rejected_writes == 0);
+        REQUIRE_FALSE(simCanInit());
+        REQUIRE(can.getDispatchStats().hw_filters == 2);
+    }
+
+    SECTION("the controller is back on the bus when begin() returns") {
+        host_fdcan1.CCCR.latency = 5;
+
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        REQUIRE(can.getDispatchStats().hw_filters == 2);
+        REQUIRE_FALSE(simCanInit());
+    }
+
+    SECTION("changes while running are routed in software only") {
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        std::vector<uint32_t> ram(host_sramcan, host_sramcan + HOST_SRAMCAN_WORDS);
+        uint32_t gfc = host_fdcan1.GFC;
+
+        // inside the mask of handler 1: routed to the new exact identifier
+        REQUIRE(can.onReceive(CanStandardId(0x205), can_handlers[2]) >= 0);
+        // outside the filters: never received until the next begin()
+        REQUIRE(can.onReceive(CanStandardId(0x300), can_handlers[3]) >= 0);
+        can.setHardwareFilter(false);
+        can.onUnmatched(can_handlers[4]);
+        runTraffic(can, {0x105, 0x205, 0x206, 0x300}, &accepted);
+
+        REQUIRE(host_fdcan1.CCCR.init_entries == 1);
+        REQUIRE(host_fdcan1.GFC.rejected_writes == 0);
+        REQUIRE(std::vector<uint32_t>(host_sramcan, host_sramcan + HOST_SRAMCAN_WORDS) == ram);
+        REQUIRE((uint32_t)host_fdcan1.GFC == gfc);
+        REQUIRE(can_calls == (std::vector<std::pair<int, uint32_t>>{{0, 0x105}, {2, 0x205}, {1, 0x206}}));
+
+        // the next begin() opens the filters for the unmatched handler
+        can.end();
+        can_calls.clear();
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        REQUIRE(host_fdcan1.CCCR.init_entries == 2);
+        REQUIRE(can.getDispatchStats().hw_filters == -1);
+        runTraffic(can, {0x300, 0x400}, &accepted);
+        REQUIRE(can_calls == (std::vector<std::pair<int, uint32_t>>{{3, 0x300}, {4, 0x400}}));
+    }
+
+    SECTION("a controller that does not enter the configuration mode leaves the filtering to dispatch()") {
+        host_fdcan1.CCCR.latency = -1;
+        uint64_t start_us = host_time_us;
+
+        REQUIRE(can.begin(CanBitRate::BR_500k));
+        REQUIRE(host_time_us - start_us >= MC_FDCAN_INIT_TIMEOUT_US);
+        REQUIRE(host_time_us - start_us < 2 * MC_FDCAN_INIT_TIMEOUT_US);
+        REQUIRE(can.getDispatchStats().hw_filters == -1);
+        REQUIRE(host_fdcan1.CCCR.init_entries == 0);
+        REQUIRE(host_fdcan1.GFC.rejected_writes == 0);
+
+        // the request is withdrawn: the controller stays on the bus once it answers
+        host_fdcan1.CCCR.latency = 0;
+        REQUIRE_FALSE(simCanInit());
+
+        runTraffic(can, {0x101, 0x300, 0x20F}, &accepted);
+        REQUIRE(accepted.size() == 3);
+        REQUIRE(can_calls == (std::vector<std::pair<int, uint32_t>>{{0, 0x101}, {1, 0x20F}}));
+        REQUIRE(can.getDispatchStats().unmatched == 1);
+    }
+    can.end();
+}
+
+TEST_CASE("CANCommClass dispatches by batches", "[CANComm]") {
+    CANCommClass can;
+
+    simCanReset(128, 64);
+    can_calls.clear();
+    REQUIRE(can.onReceiveRange(CanExtendedId(0x18FF0000), CanExtendedId(0x18FFFFFF), can_handlers[0]) >= 0);
+    REQUIRE(can.begin(CanBitRate::BR_250k));
+
+    for (uint32_t i = 0; i < 40; i++) {
+        REQUIRE(simCanReceive(CanExtendedId(0x18FF0000 + i)));
+    }
+    REQUIRE_FALSE(simCanReceive(CanExtendedId(0x18FE0000)));
+    REQUIRE_FALSE(simCanReceive(CanStandardId(0x123)));
+
+    REQUIRE(can.dispatch(10) == 10);
+    REQUIRE(can.dispatch() == MC_CAN_BATCH);
+    REQUIRE(can.dispatch(100) == 40 - 10 - MC_CAN_BATCH);
+    REQUIRE(can.dispatch() == 0);
+
+    CanDispatchStats stats = can.getDispatchStats();
+    REQUIRE(stats.frames == 40);
+    REQUIRE(stats.batches == 3);
+    REQUIRE(stats.max_batch == MC_CAN_BATCH);
+    REQUIRE(can_calls.size() == 40);
+    REQUIRE(can_calls.back().second == CanExtendedId(0x18FF0027));
+    can.end();
+}
+
+TEST_CASE("CANCommClass dispatch time with a full handler table", "[CANComm]") {
+    const int frames = 50000;
+    std::mt19937 random(13);
+    CANCommClass can;
+    std::vector<TestRule> rules;
+
+    simCanReset(128, 64);
+    can_calls.clear();
+    can_calls.reserve(frames);
+    for (int i = 0; i < MC_CAN_HANDLERS; i++) {
+        rules.push_back(randomRule(random));
+        rules.back().slot = registerRule(can, rules.back(), i);
+        REQUIRE(rules.back().slot >= 0);
+    }
+    // every frame reaches dispatch(), the unmatched ones included
+    can.setHardwareFilter(false);
+    REQUIRE(can.begin(CanBitRate::BR_500k));
+
+    std::vector<uint32_t> ids = syntheticTraffic(random, frames);
+    int queued = 0;
+    for (uint32_t id : ids) {
+        queued += simCanReceive(id);
+    }
+    REQUIRE(queued == frames);
+
+    auto start = std::chrono::steady_clock::now();
+    while (can.dispatch() > 0) {
+    }
+    auto dispatched = std::chrono::steady_clock::now() - start;
+
+    // the same routing by a linear scan of the rules
+    volatile int sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t id : ids) {
+        sink = sink + referenceRoute(rules, id);
+    }
+    auto scanned = std::chrono::steady_clock::now() - start;
+
+    double dispatch_ns = std::chrono::duration<double, std::nano>(dispatched).count() / frames;
+    double scan_ns = std::chrono::duration<double, std::nano>(scanned).count() / frames;
+
+    WARN("dispatch " << dispatch_ns << " ns per frame, linear scan " << scan_ns << " ns per frame, " << MC_CAN_HANDLERS << " handlers");
+    CanDispatchStats stats = can.getDispatchStats();
+    REQUIRE(stats.frames == (uint32_t)frames);
+    REQUIRE(stats.frames == can_calls.size() + stats.unmatched);
+    can.end();
+}
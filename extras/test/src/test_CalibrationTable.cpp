@@ -0,0 +1,156 @@
+#include <catch2/catch.hpp>
+
+#include <string.h>
+
+#include "utility/ANALOG/CalibrationTable.h"
+
+static const uint16_t table_raw[] = { 1000, 20000, 40000, 60000 };
+static const uint16_t table_ref[] = { 0, 20500, 41200, 62000 };
+
+static void fill(CalibrationTable& table) {
+    table.setLinear(0, (int32_t)(1.02 * 65536), -150);
+    table.setTable(5, table_raw, table_ref, 4);
+    table.setLinear(15, 1 << 16, 42);
+}
+
+TEST_CASE("CRC16 is CRC-16/CCITT-FALSE", "[CalibrationTable]") {
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+
+    REQUIRE(CalibrationTable::crc16(check, sizeof(check)) == 0x29B1);
+    REQUIRE(CalibrationTable::crc16(check, 0) == 0xFFFF);
+}
+
+TEST_CASE("Calibration corrections", "[CalibrationTable]") {
+    CalibrationTable table;
+
+    SECTION("identity by default") {
+        for (uint8_t slot = 0; slot < CAL_SLOTS; slot++) {
+            REQUIRE_FALSE(table.isActive(slot));
+            REQUIRE(table.apply(slot, 12345) == 12345);
+        }
+    }
+
+    SECTION("gain/offset with rounding and saturation") {
+        table.setLinear(0, (int32_t)(1.5 * 65536), -100);
+        REQUIRE(table.apply(0, 1000) == 1400);
+        REQUIRE(table.apply(0, 0) == 0);
+        REQUIRE(table.apply(0, 50000) == 65535);
+    }
+
+    SECTION("multi-point interpolation and extrapolation") {
+        REQUIRE(table.setTable(1, table_raw, table_ref, 4));
+        for (int i = 0; i < 4; i++) {
+            REQUIRE(table.apply(1, table_raw[i]) == table_ref[i]);
+        }
+        REQUIRE(table.apply(1, 30000) == 30850);
+        // below the first point the first segment is extrapolated and clamped
+        REQUIRE(table.apply(1, 0) == 0);
+        REQUIRE(table.apply(1, 65535) == 65535);
+    }
+
+    SECTION("tables must be strictly increasing") {
+        const uint16_t raw[] = { 100, 100, 200 };
+        REQUIRE_FALSE(table.setTable(1, raw, table_ref, 3));
+        REQUIRE_FALSE(table.setTable(1, table_raw, table_ref, 1));
+        REQUIRE_FALSE(table.isActive(1));
+    }
+
+    SECTION("the slopes must fit in Q16.16") {
+        const uint16_t raw[] = { 100, 101, 103 };
+        const uint16_t rise[] = { 0, 32767, 0 };
+        const uint16_t jump[] = { 0, 65535, 0 };
+        const uint16_t fall[] = { 65535, 0, 0 };
+
+        REQUIRE(table.setTable(1, raw, rise, 3));
+        REQUIRE(table.apply(1, 101) == 32767);
+        REQUIRE(table.apply(1, 102) == 16384);
+        REQUIRE_FALSE(table.setTable(2, raw, jump, 3));
+        REQUIRE_FALSE(table.setTable(2, raw, fall, 3));
+        REQUIRE_FALSE(table.isActive(2));
+    }
+}
+
+TEST_CASE("Calibration blob round-trip", "[CalibrationTable]") {
+    CalibrationTable table;
+    uint8_t blob[CAL_BLOB_MAX_SIZE];
+
+    fill(table);
+    size_t len = table.serialize(blob, sizeof(blob));
+    REQUIRE(len == table.serializedSize());
+    REQUIRE(len == 6 + (2 + 8) + (2 + 1 + 4 * 4) + (2 + 8) + 2);
+    REQUIRE(memcmp(blob, "PMCA", 4) == 0);
+    REQUIRE(blob[4] == CAL_BLOB_VERSION);
+    REQUIRE(blob[5] == 3);
+
+    CalibrationTable copy;
+    REQUIRE(copy.deserialize(blob, len));
+    for (uint8_t slot = 0; slot < CAL_SLOTS; slot++) {
+        REQUIRE(copy.isActive(slot) == table.isActive(slot));
+        for (uint32_t value = 0; value <= 0xFFFF; value += 997) {
+            REQUIRE(copy.apply(slot, value) == table.apply(slot, value));
+        }
+    }
+
+    SECTION("a full table fits in CAL_BLOB_MAX_SIZE") {
+        uint16_t raw[CAL_MAX_POINTS];
+        uint16_t ref[CAL_MAX_POINTS];
+        for (int i = 0; i < CAL_MAX_POINTS; i++) {
+            raw[i] = ref[i] = i * 8000;
+        }
+        for (uint8_t slot = 0; slot < CAL_SLOTS; slot++) {
+            table.setTable(slot, raw, ref, CAL_MAX_POINTS);
+        }
+        REQUIRE(table.serializedSize() == CAL_BLOB_MAX_SIZE);
+        REQUIRE(table.serialize(blob, sizeof(blob)) == CAL_BLOB_MAX_SIZE);
+        REQUIRE(table.serialize(blob, sizeof(blob) - 1) == 0);
+    }
+}
+
+TEST_CASE("Corrupted calibration blobs are rejected", "[CalibrationTable]") {
+    CalibrationTable table;
+    uint8_t blob[CAL_BLOB_MAX_SIZE];
+
+    fill(table);
+    size_t len = table.serialize(blob, sizeof(blob));
+
+    SECTION("any single bit flip") {
+        for (size_t i = 0; i < len; i++) {
+            for (int bit = 0; bit < 8; bit++) {
+                CalibrationTable copy;
+                copy.setLinear(3, 2 << 16, 0);
+
+                blob[i] ^= 1 << bit;
+                REQUIRE_FALSE(copy.deserialize(blob, len));
+                blob[i] ^= 1 << bit;
+
+                // the current corrections are kept
+                REQUIRE(copy.apply(3, 100) == 200);
+            }
+        }
+    }
+
+    SECTION("truncated blob") {
+        CalibrationTable copy;
+        for (size_t n = 0; n < len; n++) {
+            REQUIRE_FALSE(copy.deserialize(blob, n));
+        }
+    }
+
+    SECTION("other version with a valid CRC") {
+        CalibrationTable copy;
+        blob[4] = CAL_BLOB_VERSION + 1;
+        uint16_t crc = CalibrationTable::crc16(blob, len - 2);
+        blob[len - 2] = crc & 0xFF;
+        blob[len - 1] = crc >> 8;
+        REQUIRE_FALSE(copy.deserialize(blob, len));
+    }
+
+    SECTION("entry count larger than the payload with a valid CRC") {
+        CalibrationTable copy;
+        blob[5]++;
+        uint16_t crc = CalibrationTable::crc16(blob, len - 2);
+        blob[len - 2] = crc & 0xFF;
+        blob[len - 1] = crc >> 8;
+        REQUIRE_FALSE(copy.deserialize(blob, len));
+    }
+}
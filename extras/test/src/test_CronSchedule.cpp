@@ -0,0 +1,251 @@
+#include <catch2/catch.hpp>
+
+#include <time.h>
+#include <stdlib.h>
+
+#include "utility/SCHEDULER/CronSchedule.h"
+
+static time_t utc(int year, int month, int day, int hour = 0, int minute = 0, int second = 0) {
+    struct tm tm = {};
+
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    return timegm(&tm);
+}
+
+static CronRule rule(const char* spec) {
+    CronRule r;
+
+    REQUIRE(r.parse(spec));
+    return r;
+}
+
+// reference: scan minute by minute with the C library calendar
+static time_t scanNext(const CronRule& r, time_t time, int max_minutes) {
+    time_t t = (time / 60 + 1) * 60;
+
+    for (int i = 0; i < max_minutes; i++, t += 60) {
+        if (r.matches(t)) {
+            return t;
+        }
+    }
+    return CRON_NEVER;
+}
+
+TEST_CASE("CronRule parses cron fields", "[CronSchedule]") {
+    CronRule r;
+
+    REQUIRE(r.parse("* * * * *"));
+    REQUIRE(r.parse("0 6,14,22 * * 1-5"));
+    REQUIRE(r.parse("*/15 8-17/3 1,15 */2 7"));
+    REQUIRE(r.parse("  59 23 31 12 0  "));
+
+    REQUIRE_FALSE(r.parse(nullptr));
+    REQUIRE_FALSE(r.parse(""));
+    REQUIRE_FALSE(r.parse("* * * *"));
+    REQUIRE_FALSE(r.parse("* * * * * *"));
+    REQUIRE_FALSE(r.parse("60 * * * *"));
+    REQUIRE_FALSE(r.parse("* 24 * * *"));
+    REQUIRE_FALSE(r.parse("* * 0 * *"));
+    REQUIRE_FALSE(r.parse("* * 32 * *"));
+    REQUIRE_FALSE(r.parse("* * * 13 *"));
+    REQUIRE_FALSE(r.parse("* * * * 8"));
+    REQUIRE_FALSE(r.parse("5-1 * * * *"));
+    REQUIRE_FALSE(r.parse("*/0 * * * *"));
+    REQUIRE_FALSE(r.parse("1, * * * *"));
+    REQUIRE_FALSE(r.parse("a * * * *"));
+}
+
+TEST_CASE("CronRule finds the next occurrence", "[CronSchedule]") {
+    SECTION("strictly after the given time") {
+        CronRule r = rule("30 12 * * *");
+
+        REQUIRE(r.next(utc(2024, 3, 10, 12, 29, 59)) == utc(2024, 3, 10, 12, 30));
+        REQUIRE(r.next(utc(2024, 3, 10, 12, 30, 0)) == utc(2024, 3, 11, 12, 30));
+        REQUIRE(r.next(utc(2024, 3, 10, 12, 30, 30)) == utc(2024, 3, 11, 12, 30));
+    }
+
+    SECTION("every minute") {
+        CronRule r = rule("* * * * *");
+
+        REQUIRE(r.next(utc(2024, 12, 31, 23, 59, 0)) == utc(2025, 1, 1, 0, 0));
+    }
+
+    SECTION("steps and lists") {
+        CronRule r = rule("*/20 6,14,22 * * *");
+
+        REQUIRE(r.next(utc(2024, 5, 1, 6, 41)) == utc(2024, 5, 1, 14, 0));
+        REQUIRE(r.next(utc(2024, 5, 1, 22, 40)) == utc(2024, 5, 2, 6, 0));
+    }
+
+    SECTION("weekdays, 0 and 7 are Sunday") {
+        // 2024-10-19 is a Saturday
+        REQUIRE(rule("0 8 * * 1-5").next(utc(2024, 10, 19)) == utc(2024, 10, 21, 8, 0));
+        REQUIRE(rule("0 8 * * 0").next(utc(2024, 10, 19)) == utc(2024, 10, 20, 8, 0));
+        REQUIRE(rule("0 8 * * 7").next(utc(2024, 10, 19)) == utc(2024, 10, 20, 8, 0));
+    }
+
+    SECTION("a day and a weekday match either") {
+        // the 13th or any Friday: 2024-10-18 is a Friday
+        CronRule r = rule("0 0 13 * 5");
+
+        REQUIRE(r.next(utc(2024, 10, 12)) == utc(2024, 10, 13));
+        REQUIRE(r.next(utc(2024, 10, 13)) == utc(2024, 10, 18));
+    }
+
+    SECTION("the 31st skips the short months") {
+        CronRule r = rule("0 0 31 * *");
+
+        REQUIRE(r.next(utc(2024, 1, 31)) == utc(2024, 3, 31));
+        REQUIRE(r.next(utc(2024, 3, 31)) == utc(2024, 5, 31));
+    }
+
+    SECTION("a rule that never matches") {
+        REQUIRE(rule("0 0 30 2 *").next(utc(2024, 1, 1)) == CRON_NEVER);
+        REQUIRE(rule("0 0 31 4 *").next(utc(2024, 1, 1)) == CRON_NEVER);
+    }
+}
+
+TEST_CASE("CronRule handles leap years", "[CronSchedule]") {
+    CronRule r = rule("0 12 29 2 *");
+
+    REQUIRE(r.next(utc(2024, 1, 1)) == utc(2024, 2, 29, 12, 0));
+    REQUIRE(r.next(utc(2024, 2, 29, 12, 0)) == utc(2028, 2, 29, 12, 0));
+    // 2100 is not a leap year, 2000 is
+    REQUIRE(r.next(utc(2096, 3, 1)) == utc(2104, 2, 29, 12, 0));
+    REQUIRE(r.next(utc(1999, 1, 1)) == utc(2000, 2, 29, 12, 0));
+
+    SECTION("the day after Feb 28") {
+        CronRule every = rule("0 0 * 2-3 *");
+
+        REQUIRE(every.next(utc(2023, 2, 28)) == utc(2023, 3, 1));
+        REQUIRE(every.next(utc(2024, 2, 28)) == utc(2024, 2, 29));
+    }
+
+    SECTION("Feb 29 or a weekday matches either") {
+        // the first Monday of February 2025 comes before the next Feb 29
+        CronRule monday29 = rule("0 0 29 2 1");
+        REQUIRE(monday29.next(utc(2024, 2, 26)) == utc(2024, 2, 29));
+        REQUIRE(monday29.next(utc(2024, 3, 1)) == utc(2025, 2, 3));
+    }
+}
+
+TEST_CASE("CronRule works on RTC time across DST changes", "[CronSchedule]") {
+    // the rules apply to the UTC time of the RTC: a local DST change neither skips nor repeats an occurrence
+    CronRule r = rule("30 1 * * *");
+    time_t t = utc(2024, 3, 30);
+    int count = 0;
+
+    // EU spring forward on 2024-03-31 at 01:00 UTC, fall back on 2024-10-27 at 01:00 UTC
+    for (time_t next = r.next(t); next < utc(2024, 4, 2); next = r.next(next)) {
+        REQUIRE((next - utc(2024, 3, 30)) % 86400 == 5400);
+        count++;
+    }
+    REQUIRE(count == 3);
+
+    count = 0;
+    for (time_t next = r.next(utc(2024, 10, 26)); next < utc(2024, 10, 29); next = r.next(next)) {
+        REQUIRE((next - utc(2024, 10, 26)) % 86400 == 5400);
+        count++;
+    }
+    REQUIRE(count == 3);
+}
+
+TEST_CASE("CronRule agrees with a minute-by-minute scan", "[CronSchedule]") {
+    const char* specs[] = {
+        "*/7 * * * *",
+        "0 */5 * * *",
+        "15 3 1,15 * *",
+        "0 0 * * 0",
+        "45 23 * 2 1-5",
+        "0 12 13 * 5",
+        "10-20/5 8-17 * 1,6,12 *",
+        "0 0 29 2 *",
+    };
+
+    srand(42);
+    for (const char* spec : specs) {
+        CronRule r = rule(spec);
+
+        for (int i = 0; i < 50; i++) {
+            // times from 2020 to 2031
+            time_t t = utc(2020, 1, 1) + (time_t)(((uint64_t)rand() << 15 ^ rand()) % (12ULL * 365 * 86400));
+            time_t expected = scanNext(r, t, 4 * 366 * 24 * 60 + 1);
+
+            INFO(spec << " after " << t);
+            REQUIRE(r.next(t) == expected);
+        }
+    }
+}
+
+TEST_CASE("CronSchedule runs the nearest rule first", "[CronSchedule]") {
+    CronSchedule schedule;
+    time_t now = utc(2024, 10, 18, 10, 0);
+
+    REQUIRE(schedule.nextTime() == CRON_NEVER);
+    REQUIRE(schedule.popDue(now) == -1);
+
+    int hourly = schedule.add(rule("0 * * * *"), now);
+    int daily = schedule.add(rule("30 10 * * *"), now);
+    int yearly = schedule.add(rule("0 0 1 1 *"), now);
+    REQUIRE(schedule.count() == 3);
+    REQUIRE(schedule.nextTime() == utc(2024, 10, 18, 10, 30));
+
+    REQUIRE(schedule.popDue(utc(2024, 10, 18, 10, 29)) == -1);
+    REQUIRE(schedule.popDue(utc(2024, 10, 18, 10, 30)) == daily);
+    REQUIRE(schedule.popDue(utc(2024, 10, 18, 10, 30)) == -1);
+    REQUIRE(schedule.nextTime() == utc(2024, 10, 18, 11, 0));
+
+    SECTION("missed occurrences are run once") {
+        time_t late = utc(2024, 10, 18, 15, 10);
+
+        REQUIRE(schedule.popDue(late) == hourly);
+        REQUIRE(schedule.popDue(late) == -1);
+        REQUIRE(schedule.nextTime() == utc(2024, 10, 18, 16, 0));
+    }
+
+    SECTION("a removed rule is not run") {
+        REQUIRE(schedule.remove(hourly));
+        REQUIRE_FALSE(schedule.remove(hourly));
+        REQUIRE(schedule.nextTime() == utc(2024, 10, 19, 10, 30));
+        REQUIRE(schedule.popDue(utc(2025, 1, 1)) == daily);
+        REQUIRE(schedule.popDue(utc(2025, 1, 1)) == yearly);
+    }
+
+    SECTION("rescheduling after the clock was set") {
+        schedule.reschedule(utc(2024, 12, 31, 23, 45));
+        REQUIRE(schedule.nextTime() == utc(2025, 1, 1, 0, 0));
+        int first = schedule.popDue(utc(2025, 1, 1));
+        int second = schedule.popDue(utc(2025, 1, 1));
+        REQUIRE(first != second);
+        REQUIRE((first == hourly || first == yearly));
+        REQUIRE((second == hourly || second == yearly));
+    }
+}
+
+TEST_CASE("CronSchedule keeps the heap ordered", "[CronSchedule]") {
+    CronSchedule schedule;
+    time_t now = utc(2024, 1, 1);
+    char spec[32];
+
+    for (int i = 0; i < MC_SCHED_RULES; i++) {
+        snprintf(spec, sizeof(spec), "%d %d * * *", (i * 37) % 60, (i * 7) % 24);
+        REQUIRE(schedule.add(rule(spec), now) == i);
+    }
+    REQUIRE(schedule.add(rule("* * * * *"), now) == -1);
+
+    REQUIRE(schedule.remove(3));
+    REQUIRE(schedule.remove(11));
+
+    time_t last = now;
+    for (int i = 0; i < 200; i++) {
+        time_t next = schedule.nextTime();
+        REQUIRE(next >= last);
+        REQUIRE(schedule.popDue(next) >= 0);
+        last = next;
+    }
+}
@@ -0,0 +1,160 @@
+#include <catch2/catch.hpp>
+
+#include "utility/ANALOG/HighResPwmOut.h"
+
+/*
+ * HighResPwmOut on the host timers: host_timer_update() plays the update
+ * event at the end of each PWM period, running the update interrupt when
+ * it is enabled.
+ */
+
+static uint32_t ccr(TIM_TypeDef* tim, int channel) {
+    return (&tim->CCR1)[channel - 1];
+}
+
+TEST_CASE("PWM period and duty in timer counts", "[HighResPwmOut]") {
+    HighResPwmOut pwm(PC_7);
+
+    REQUIRE(pwm.setPeriodUs(50));
+    REQUIRE(pwm.getPeriodCounts() == 10000);
+    REQUIRE(TIM3->PSC == 0);
+
+    pwm.writeDuty(32768);
+    REQUIRE(ccr(TIM3, 2) == 5000);
+    pwm.writeDuty(65535);
+    REQUIRE(ccr(TIM3, 2) == 10000);
+
+    // long periods use the prescaler
+    REQUIRE(pwm.setPeriodUs(2000));
+    REQUIRE(TIM3->PSC == 6);
+    REQUIRE(pwm.getPeriodCounts() == 57142);
+}
+
+TEST_CASE("The dither runs once per PWM period from the update interrupt", "[HighResPwmOut]") {
+    HighResPwmOut pwm(PC_7);
+
+    REQUIRE(pwm.setPeriodUs(5));
+    REQUIRE(pwm.getPeriodCounts() == 1000);
+
+    // 1000 * 12345 / 65535 = 188.37 counts
+    pwm.writeDuty(12345);
+    REQUIRE(ccr(TIM3, 2) == 188);
+
+    REQUIRE(pwm.setDither(true));
+    REQUIRE(TIM3->DIER & TIM_DIER_UIE);
+
+    uint64_t sum = 0;
+    uint32_t min = 0xFFFFFFFF;
+    uint32_t max = 0;
+    for (int period = 0; period < 65536; period++) {
+        host_timer_update(TIM3);
+        REQUIRE_FALSE(TIM3->SR & TIM_SR_UIF);
+        uint32_t counts = ccr(TIM3, 2);
+        sum += counts;
+        min = (counts < min) ? counts : min;
+        max = (counts > max) ? counts : max;
+    }
+
+    // the average over the periods recovers the fractional count
+    uint64_t product = 12345ULL * 1000;
+    uint64_t target_q16 = product + (product >> 16);
+    int64_t error = (int64_t)(sum << 16) / 65536 - (int64_t)target_q16;
+    REQUIRE(min == 188);
+    REQUIRE(max == 189);
+    REQUIRE(error >= -1);
+    REQUIRE(error <= 1);
+
+    REQUIRE(pwm.setDither(false));
+    REQUIRE_FALSE(TIM3->DIER & TIM_DIER_UIE);
+    REQUIRE(ccr(TIM3, 2) == 188);
+}
+
+TEST_CASE("Outputs sharing a timer are served by the same interrupt", "[HighResPwmOut]") {
+    HighResPwmOut a(PJ_11);
+    HighResPwmOut b(PK_1);
+
+    REQUIRE(a.setPeriodUs(5));
+    a.writeDuty(0x8000);
+    b.writeDuty(0x4000);
+    REQUIRE(a.setDither(true));
+    REQUIRE(b.setDither(true));
+
+    uint64_t sum_a = 0;
+    uint64_t sum_b = 0;
+    for (int period = 0; period < 1024; period++) {
+        host_timer_update(TIM8);
+        sum_a += ccr(TIM8, 2);
+        sum_b += ccr(TIM8, 3);
+    }
+    // first order sigma-delta: one extra count each time the fraction overflows
+    uint64_t target_a = 0x8000ULL * 1000 + ((0x8000ULL * 1000) >> 16);
+    uint64_t target_b = 0x4000ULL * 1000 + ((0x4000ULL * 1000) >> 16);
+    REQUIRE(sum_a == ((1024 * target_a) >> 16));
+    REQUIRE(sum_b == ((1024 * target_b) >> 16));
+
+    // the interrupt stays enabled while one output of the timer dithers
+    a.setDither(false);
+    REQUIRE(TIM8->DIER & TIM_DIER_UIE);
+    b.setDither(false);
+    REQUIRE_FALSE(TIM8->DIER & TIM_DIER_UIE);
+}
+
+TEST_CASE("Held updates are reported latched after the next update event", "[HighResPwmOut]") {
+    HighResPwmOut pwm(PC_7);
+
+    REQUIRE(pwm.setPeriodUs(5));
+    REQUIRE(pwm.updateLatched());
+
+    SECTION("polled flag") {
+        pwm.holdUpdate();
+        pwm.writeDuty(1000);
+        host_timer_update(TIM3);
+        pwm.releaseUpdate();
+        REQUIRE_FALSE(pwm.updateLatched());
+        host_timer_update(TIM3);
+        REQUIRE(pwm.updateLatched());
+    }
+
+    SECTION("flag cleared by the dither interrupt") {
+        REQUIRE(pwm.setDither(true));
+        pwm.holdUpdate();
+        pwm.writeDuty(1000);
+        pwm.releaseUpdate();
+        REQUIRE_FALSE(pwm.updateLatched());
+        host_timer_update(TIM3);
+        REQUIRE_FALSE(TIM3->SR & TIM_SR_UIF);
+        REQUIRE(pwm.updateLatched());
+        pwm.setDither(false);
+    }
+}
+
+TEST_CASE("A pin off the general purpose timers keeps the mbed driver", "[HighResPwmOut]") {
+    // PG_7 is on the HRTIM: its registers and TIM1 must not be written
+    memset((void*)TIM1, 0, sizeof(*TIM1));
+    HighResPwmOut pwm(PG_7);
+
+    REQUIRE(pwm.setPeriodUs(100));
+    REQUIRE(pwm.read() == 0.0f);
+    REQUIRE(pwm.getPeriodCounts() == 100);
+    pwm.writeDuty(0x8000);
+    REQUIRE(pwm.getDuty() == 0x8000);
+    REQUIRE(pwm.read() == Approx(0.5f).epsilon(0.001));
+    pwm.writeCounts(25);
+    REQUIRE(pwm.read() == Approx(0.25f));
+
+    REQUIRE_FALSE(pwm.setDither(true));
+    REQUIRE(pwm.setDither(false));
+    pwm.holdUpdate();
+    pwm.releaseUpdate();
+    pwm.restartPeriod();
+    REQUIRE(pwm.updateLatched());
+
+    for (uint32_t reg : host_hrtim1.REG) {
+        REQUIRE(reg == 0);
+    }
+    REQUIRE(TIM1->PSC == 0);
+    REQUIRE(TIM1->ARR == 0);
+    REQUIRE(TIM1->CCR2 == 0);
+    REQUIRE(TIM1->CR1 == 0);
+    REQUIRE(TIM1->EGR == 0);
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch.hpp>
+
+#include <math.h>
+
+#include "utility/THERMOCOUPLE/MAX31855.h"
+
+/*
+ * NIST ITS-90 reference points of the thermocouple types E, N, R, S and B
+ * (NIST Monograph 175 tables, mV to 3 decimals), range edges included.
+ * The inverse functions are checked against the same points: a rounding of
+ * 0.5 uV is up to 0.1 C for the noble metal types at low temperature.
+ */
+
+struct TcPoint {
+    double temp;
+    double mv;
+};
+
+static void checkType(uint8_t type, const TcPoint* points, int count, double inverse_margin) {
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    tc.setTCType(type);
+
+    for (int i = 0; i < count; i++) {
+        INFO("type " << (int)type << " at " << points[i].temp << " C");
+        REQUIRE(tc.tempTomv(points[i].temp) == Approx(points[i].mv).margin(0.0006));
+        REQUIRE(tc.mvtoTemp(points[i].mv) == Approx(points[i].temp).margin(inverse_margin));
+    }
+}
+
+TEST_CASE("Type E against the NIST reference", "[MAX31855]") {
+    // the inverse function covers -200 C to 1000 C
+    const TcPoint points[] = {
+        {-200, -8.825}, {-100, -5.237}, {0, 0.000}, {100, 6.319}, {500, 37.005}, {1000, 76.373},
+    };
+    checkType(PROBE_TC_E, points, sizeof(points) / sizeof(points[0]), 0.02);
+
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    tc.setTCType(PROBE_TC_E);
+    REQUIRE(tc.tempTomv(-270) == Approx(-9.835).margin(0.0006));
+    REQUIRE(isnan(tc.tempTomv(-270.1)));
+    REQUIRE(isnan(tc.tempTomv(1000.1)));
+    REQUIRE(isnan(tc.mvtoTemp(-8.826)));
+    REQUIRE(isnan(tc.mvtoTemp(76.374)));
+}
+
+TEST_CASE("Type N against the NIST reference", "[MAX31855]") {
+    // the inverse function covers -200 C to 1300 C
+    const TcPoint points[] = {
+        {-200, -3.990}, {-100, -2.407}, {0, 0.000}, {100, 2.774}, {500, 16.748}, {1000, 36.256}, {1300, 47.513},
+    };
+    checkType(PROBE_TC_N, points, sizeof(points) / sizeof(points[0]), 0.07);
+
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    tc.setTCType(PROBE_TC_N);
+    REQUIRE(tc.tempTomv(-270) == Approx(-4.345).margin(0.0006));
+    REQUIRE(isnan(tc.tempTomv(-270.1)));
+    REQUIRE(isnan(tc.tempTomv(1300.1)));
+    REQUIRE(isnan(tc.mvtoTemp(-3.991)));
+    REQUIRE(isnan(tc.mvtoTemp(47.514)));
+}
+
+TEST_CASE("Type R against the NIST reference", "[MAX31855]") {
+    const TcPoint points[] = {
+        {-50, -0.226}, {0, 0.000}, {100, 0.647}, {500, 4.471}, {1000, 10.506}, {1500, 17.451}, {1768.1, 21.103},
+    };
+    checkType(PROBE_TC_R, points, sizeof(points) / sizeof(points[0]), 0.15);
+
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    tc.setTCType(PROBE_TC_R);
+    REQUIRE(isnan(tc.tempTomv(-50.1)));
+    REQUIRE(isnan(tc.tempTomv(1768.2)));
+    REQUIRE(isnan(tc.mvtoTemp(-0.227)));
+    REQUIRE(isnan(tc.mvtoTemp(21.104)));
+}
+
+TEST_CASE("Type S against the NIST reference", "[MAX31855]") {
+    // the inverse function starts at -0.235 mV, 0.1 C above the forward one
+    const TcPoint points[] = {
+        {0, 0.000}, {100, 0.646}, {500, 4.233}, {1000, 9.587}, {1500, 15.582}, {1768.1, 18.693},
+    };
+    checkType(PROBE_TC_S, points, sizeof(points) / sizeof(points[0]), 0.1);
+
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    tc.setTCType(PROBE_TC_S);
+    REQUIRE(tc.tempTomv(-50) == Approx(-0.236).margin(0.0006));
+    REQUIRE(tc.mvtoTemp(-0.235) == Approx(-50).margin(0.2));
+    REQUIRE(isnan(tc.tempTomv(-50.1)));
+    REQUIRE(isnan(tc.tempTomv(1768.2)));
+    REQUIRE(isnan(tc.mvtoTemp(-0.236)));
+    REQUIRE(isnan(tc.mvtoTemp(18.694)));
+}
+
+TEST_CASE("Type B against the NIST reference", "[MAX31855]") {
+    // the inverse function covers 250 C to 1820 C: below, the output is too flat
+    const TcPoint points[] = {
+        {250, 0.291}, {500, 1.242}, {1000, 4.834}, {1500, 10.099}, {1820, 13.820},
+    };
+    checkType(PROBE_TC_B, points, sizeof(points) / sizeof(points[0]), 0.1);
+
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    tc.setTCType(PROBE_TC_B);
+    REQUIRE(tc.tempTomv(0) == Approx(0.000).margin(0.0006));
+    REQUIRE(tc.tempTomv(100) == Approx(0.033).margin(0.0006));
+    REQUIRE(isnan(tc.tempTomv(-0.1)));
+    REQUIRE(isnan(tc.tempTomv(1820.1)));
+    REQUIRE(isnan(tc.mvtoTemp(0.290)));
+    REQUIRE(isnan(tc.mvtoTemp(13.821)));
+}
+
+TEST_CASE("The inverse functions invert the reference functions", "[MAX31855]") {
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    // NIST error bound of the inverse functions over each range, the N, R and
+    // S inverse ranges are slightly narrower than the forward ones
+    const struct {
+        uint8_t type;
+        double low;
+        double high;
+        double margin;
+    } ranges[] = {
+        {PROBE_TC_E, -200, 1000, 0.03},
+        {PROBE_TC_N, -199.9, 1300, 0.04},
+        {PROBE_TC_R, -49.5, 1768.1, 0.02},
+        {PROBE_TC_S, -49.5, 1768, 0.02},
+        {PROBE_TC_B, 250, 1820, 0.03},
+    };
+
+    for (const auto& range : ranges) {
+        tc.setTCType(range.type);
+        for (double t = range.low; t <= range.high; t += (range.high - range.low) / 97) {
+            INFO("type " << (int)range.type << " at " << t << " C");
+            REQUIRE(tc.mvtoTemp(tc.tempTomv(t)) == Approx(t).margin(range.margin));
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#include <catch2/catch.hpp>
+
+#include "utility/RTD/MAX31865.h"
+
+#include "SimulatedChips.h"
+
+TEST_CASE("MAX31865 keeps the config register in a shadow", "[MAX31865]") {
+    Max31865Model chip;
+    MAX31865Class rtd(MC_RTD_CS_PIN, SPI);
+
+    chip.reg[0] = MAX31856_CONFIG_3_WIRE | MAX31856_CONFIG_BIAS_ON;
+
+    SECTION("begin() is one read and one write and keeps the wiring") {
+        rtd.begin();
+        REQUIRE(chip.reads == 1);
+        REQUIRE(chip.writes == 1);
+        REQUIRE(chip.reg[0] == MAX31856_CONFIG_3_WIRE);
+        rtd.end();
+    }
+
+    SECTION("config changes are a single write") {
+        rtd.begin();
+        chip.resetCounters();
+
+        rtd.setRTDType(PROBE_RTD_2W);
+        REQUIRE(chip.frames == 1);
+        REQUIRE(chip.writes == 1);
+        REQUIRE(chip.reg[0] == 0x00);
+
+        rtd.setRTDFilter(50);
+        REQUIRE(chip.frames == 2);
+        REQUIRE(chip.reads == 0);
+        REQUIRE(chip.reg[0] == MAX31856_CONFIG_50_HZ_FILTER);
+
+        rtd.setRTDType(PROBE_RTD_3W);
+        REQUIRE(chip.reg[0] == (MAX31856_CONFIG_50_HZ_FILTER | MAX31856_CONFIG_3_WIRE));
+        rtd.end();
+    }
+
+    SECTION("end() switches the bias off and releases the bus") {
+        uint32_t ended = SPI.ended;
+
+        rtd.begin();
+        rtd.setRTDAutoConvert(true);
+        REQUIRE((chip.reg[0] & MAX31856_CONFIG_BIAS_ON) != 0);
+        rtd.end();
+        REQUIRE((chip.reg[0] & (MAX31856_CONFIG_BIAS_ON | MAX31856_CONFIG_CONV_MODE_AUTO)) == 0);
+        REQUIRE(SPI.ended == ended + 1);
+        REQUIRE_FALSE(SPI.open);
+    }
+}
+
+TEST_CASE("MAX31865 one-shot and auto-convert reads", "[MAX31865]") {
+    Max31865Model chip;
+    MAX31865Class rtd(MC_RTD_CS_PIN, SPI);
+
+    rtd.begin(PROBE_RTD_3W);
+    chip.code = 12345;
+
+    SECTION("one shot: 4 writes and 1 word read, bias off afterwards") {
+        chip.resetCounters();
+        uint64_t start = host_time_us;
+
+        REQUIRE(rtd.readRTD() == 12345);
+        REQUIRE(chip.writes == 4);
+        REQUIRE(chip.reads == 1);
+        REQUIRE(chip.bytes == 4 * 2 + 3);
+        REQUIRE(chip.conversions == 1);
+        REQUIRE((chip.reg[0] & MAX31856_CONFIG_BIAS_ON) == 0);
+        REQUIRE(host_time_us - start >= 75000);
+    }
+
+    SECTION("auto convert: one 2-byte read once the first conversion is ready") {
+        rtd.setRTDAutoConvert(true);
+        REQUIRE(rtd.getRTDAutoConvert());
+
+        /* The filter cannot change while converting */
+        chip.resetCounters();
+        rtd.setRTDFilter(50);
+        REQUIRE(chip.frames == 0);
+
+        uint64_t start = host_time_us;
+        REQUIRE(rtd.readRTD() == 12345);
+        REQUIRE(host_time_us - start >= MAX31865_AUTO_CONVERT_SETTLE_MS * 1000 - 1000);
+
+        for (int i = 0; i < 10; i++) {
+            chip.code = 10000 + i;
+            start = host_time_us;
+            REQUIRE(rtd.readRTD() == (uint32_t)(10000 + i));
+            REQUIRE(host_time_us == start);
+        }
+        REQUIRE(chip.frames == 11);
+        REQUIRE(chip.bytes == 11 * 3);
+        REQUIRE(chip.writes == 0);
+    }
+
+    SECTION("temperature of the converted code") {
+        // 100 ohm on a 400 ohm reference is 0 °C
+        chip.code = 8192;
+        REQUIRE(rtd.convertRTDTemperature(100.0f, 400.0f) == Approx(0.0f).margin(0.01f));
+
+        chip.code = RtdLinearizer::code(100.0, 100.0, 400.0);
+        REQUIRE(rtd.convertRTDTemperature(100.0f, 400.0f) == Approx(100.0f).margin(0.05f));
+    }
+
+    rtd.end();
+}
+
+TEST_CASE("MAX31865 faults and thresholds", "[MAX31865]") {
+    Max31865Model chip;
+    MAX31865Class rtd(MC_RTD_CS_PIN, SPI);
+
+    rtd.begin(PROBE_RTD_2W);
+
+    SECTION("thresholds are written in one burst") {
+        chip.resetCounters();
+        rtd.setRTDThresholdCodes(1000, 20000);
+        REQUIRE(chip.frames == 1);
+        REQUIRE(chip.bytes == 5);
+        REQUIRE(((chip.reg[3] << 8 | chip.reg[4]) >> 1) == 20000);
+        REQUIRE(((chip.reg[5] << 8 | chip.reg[6]) >> 1) == 1000);
+
+        rtd.clearRTDThresholds();
+        REQUIRE(chip.reg[3] == 0xFF);
+        REQUIRE(chip.reg[4] == 0xFF);
+        REQUIRE(chip.reg[5] == 0x00);
+        REQUIRE(chip.reg[6] == 0x00);
+    }
+
+    SECTION("status is read in one burst") {
+        chip.code = 4321;
+        chip.loadConversion();
+        chip.reg[7] = MAX31865_FAULT_HIGH_THRESH | MAX31865_FAULT_LOW_RTDIN;
+        rtd.setRTDThresholdCodes(100, 30000);
+        chip.resetCounters();
+
+        RTDStatus status = rtd.readRTDStatus();
+        REQUIRE(chip.frames == 1);
+        REQUIRE(chip.bytes == 8);
+        REQUIRE(status.rtd == 4321);
+        REQUIRE(status.highThreshold == 30000);
+        REQUIRE(status.lowThreshold == 100);
+        REQUIRE(status.highThresholdFault);
+        REQUIRE(status.lowRTDINFault);
+        REQUIRE_FALSE(status.voltageFault);
+    }
+
+    SECTION("the fault detection cycle reports and clears the fault") {
+        chip.detect_fault = MAX31865_FAULT_LOW_REFIN;
+        REQUIRE(rtd.runRTDFaultDetection() == MAX31865_FAULT_LOW_REFIN);
+        REQUIRE(chip.reg[7] == 0);
+        REQUIRE((chip.reg[0] & MAX31856_CONFIG_BIAS_ON) == 0);
+    }
+
+    SECTION("the SPI statistics count the transactions") {
+        SpiDeviceStats stats;
+
+        rtd.getRTDSpiStats(&stats);
+        uint32_t before = stats.transactions;
+        rtd.readRTD();
+        rtd.getRTDSpiStats(&stats);
+        REQUIRE(stats.transactions - before == 5);
+    }
+
+    rtd.end();
+}
@@ -0,0 +1,285 @@
+#include <catch2/catch.hpp>
+
+#include "utility/MODBUS/ModbusMaster.h"
+#include "utility/MODBUS/ModbusFramePort.h"
+
+#include "SimulatedModbus.h"
+
+/*
+ * Bus with a master and one simulated slave at 9600 baud: t1.5 is 1719 us,
+ * t3.5 is 4011 us. transact() runs the master as its thread does, sleeping
+ * until the next frame or the delay given by pollDelayUs(), and waking up
+ * late by the latency of the thread.
+ */
+struct Bus {
+    uint32_t now = 1000000;
+    SimModbusSlave slave{9600, &now};
+    ModbusFramePort port{&SimModbusSlave::read, &SimModbusSlave::write, &slave};
+    ModbusMaster master;
+    uint32_t latency_us = 0;
+    int polls = 0;
+
+    Bus() {
+        master.begin(&port, 9600);
+        master.setDefaultPolicy(50, 2);
+    }
+
+    uint8_t transact(ModbusRequest* request) {
+        REQUIRE(master.submit(request));
+        while (request->result == MODBUS_RESULT_PENDING) {
+            REQUIRE(polls < 1000);
+            polls++;
+            REQUIRE(master.poll(now));
+            if (request->result != MODBUS_RESULT_PENDING) {
+                break;
+            }
+            uint32_t delay = master.pollDelayUs(now);
+            REQUIRE(delay != MODBUS_POLL_NEVER);
+            uint32_t at;
+            if (master.isReceiving() && slave.pending(&at) && (int32_t)(at - (now + delay)) <= 0) {
+                if ((int32_t)(at - now) > 0) {
+                    now = at;
+                }
+            } else {
+                now += delay;
+            }
+            now += latency_us;
+        }
+        return request->result;
+    }
+};
+
+static ModbusRequest makeRequest(uint8_t slave, uint8_t function, uint16_t address, uint16_t quantity, uint16_t* registers) {
+    ModbusRequest request = {};
+
+    request.slave = slave;
+    request.function = function;
+    request.address = address;
+    request.quantity = quantity;
+    request.registers = registers;
+    return request;
+}
+
+static ModbusRequest readRequest(uint8_t slave, uint16_t address, uint16_t quantity, uint16_t* registers) {
+    return makeRequest(slave, MODBUS_FC_READ_HOLDING_REGISTERS, address, quantity, registers);
+}
+
+TEST_CASE("ModbusMaster reads and writes a simulated slave", "[ModbusMaster]") {
+    Bus bus;
+    uint16_t regs[8] = {};
+
+    SECTION("read holding registers") {
+        ModbusRequest request = readRequest(1, 4, 8, regs);
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        for (int i = 0; i < 8; i++) {
+            REQUIRE(regs[i] == 0x1004 + i);
+        }
+        REQUIRE(request.attempts == 1);
+        // turnaround plus the 21 bytes of the response
+        REQUIRE(request.response_us == bus.slave.delay_us + 21 * bus.slave.char_us + bus.slave.char_us);
+        REQUIRE(bus.master.getStats().responses == 1);
+    }
+
+    SECTION("write multiple registers") {
+        uint16_t values[3] = { 7, 8, 9 };
+        ModbusRequest request = makeRequest(1, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 10, 3, values);
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(bus.slave.regs[10] == 7);
+        REQUIRE(bus.slave.regs[12] == 9);
+    }
+
+    SECTION("exception response") {
+        ModbusRequest request = readRequest(1, 30, 8, regs);
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_EXCEPTION);
+        REQUIRE(request.exception == MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+        REQUIRE(bus.master.getStats().exceptions == 1);
+    }
+
+    SECTION("broadcast is not answered and holds the bus") {
+        uint16_t value = 5;
+        ModbusRequest broadcast = makeRequest(MODBUS_BROADCAST, MODBUS_FC_WRITE_SINGLE_REGISTER, 0, 1, &value);
+        ModbusRequest request = readRequest(1, 0, 1, regs);
+
+        REQUIRE(bus.transact(&broadcast) == MODBUS_RESULT_OK);
+        uint32_t sent = bus.now;
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(bus.slave.broadcasts == 1);
+        // the next request waits for the broadcast delay after the end of the broadcast
+        REQUIRE(bus.slave.request_end_us - sent >= MODBUS_BROADCAST_DELAY_MS * 1000 + 8 * bus.slave.char_us);
+    }
+}
+
+TEST_CASE("ModbusMaster checks t1.5 with the frame timestamps", "[ModbusMaster]") {
+    Bus bus;
+    uint16_t regs[8] = {};
+    ModbusRequest request = readRequest(1, 0, 8, regs);
+
+    SECTION("a response split by a silence shorter than t1.5 is one frame") {
+        bus.slave.split_at = 9;
+        bus.slave.gap_us = bus.slave.char_us * 13 / 10;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(request.attempts == 1);
+        REQUIRE(regs[7] == 0x1007);
+        REQUIRE(bus.master.getStats().frame_errors == 0);
+    }
+
+    SECTION("a late thread sees the frames together") {
+        bus.slave.split_at = 9;
+        bus.slave.gap_us = bus.slave.char_us * 13 / 10;
+        bus.latency_us = 20000;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(request.attempts == 1);
+        REQUIRE(regs[7] == 0x1007);
+    }
+
+    SECTION("a late thread still checks the silence inside the response") {
+        bus.slave.split_at = 9;
+        bus.slave.gap_us = bus.slave.char_us * 2;
+        bus.latency_us = 20000;
+
+        bus.master.setDefaultPolicy(50, 0);
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_TIMEOUT);
+        REQUIRE(bus.master.getStats().frame_errors == 1);
+        REQUIRE(bus.master.getStats().crc_errors == 0);
+    }
+
+    SECTION("a silence longer than t1.5 invalidates the response") {
+        bus.slave.split_at = 9;
+        bus.slave.gap_us = bus.slave.char_us * 2;
+
+        bus.master.setDefaultPolicy(50, 0);
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_TIMEOUT);
+        REQUIRE(bus.master.getStats().frame_errors == 1);
+        REQUIRE(bus.master.getStats().responses == 0);
+    }
+
+    SECTION("the request is retried after an invalid response") {
+        bus.slave.split_at = 3;
+        bus.slave.gap_us = modbusT15Us(9600) + 10;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_TIMEOUT);
+        REQUIRE(request.attempts == 3);
+        REQUIRE(bus.master.getStats().frame_errors == 3);
+
+        bus.slave.split_at = 0;
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(request.attempts == 1);
+    }
+}
+
+TEST_CASE("ModbusMaster retries and times out", "[ModbusMaster]") {
+    Bus bus;
+    uint16_t regs[2] = {};
+    ModbusRequest request = readRequest(1, 0, 2, regs);
+
+    SECTION("a silent slave is retried then times out") {
+        bus.slave.silent = 10;
+        uint32_t start = bus.now;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_TIMEOUT);
+        REQUIRE(request.attempts == 3);
+        REQUIRE(bus.slave.requests == 3);
+        REQUIRE(bus.master.getStats().timeouts == 3);
+        REQUIRE(bus.master.getStats().retries == 2);
+        // three times the request, the timeout and t3.5
+        uint32_t attempt = 8 * bus.slave.char_us + 50000;
+        REQUIRE(bus.now - start >= 3 * attempt);
+        REQUIRE(bus.now - start <= 3 * (attempt + modbusT35Us(9600)));
+    }
+
+    SECTION("a slave answering the retry") {
+        bus.slave.silent = 1;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(request.attempts == 2);
+    }
+
+    SECTION("a bad CRC is retried") {
+        bus.slave.corrupt = 1;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(request.attempts == 2);
+        REQUIRE(bus.master.getStats().crc_errors == 1);
+    }
+
+    SECTION("a truncated response ends after t3.5") {
+        bus.slave.truncate = 2;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+        REQUIRE(request.attempts == 2);
+        REQUIRE(bus.master.getStats().frame_errors == 1);
+    }
+
+    SECTION("a slave policy overrides the default") {
+        bus.master.setSlavePolicy(1, 20, 0);
+        bus.slave.silent = 1;
+        uint32_t start = bus.now;
+
+        REQUIRE(bus.transact(&request) == MODBUS_RESULT_TIMEOUT);
+        REQUIRE(request.attempts == 1);
+        REQUIRE(bus.now - start < 20000 + 8 * bus.slave.char_us + modbusT35Us(9600));
+    }
+}
+
+TEST_CASE("ModbusMaster sleeps between the bus events", "[ModbusMaster]") {
+    Bus bus;
+    uint16_t regs[2] = {};
+    ModbusRequest request = readRequest(1, 0, 2, regs);
+
+    REQUIRE(bus.master.pollDelayUs(bus.now) == MODBUS_POLL_NEVER);
+    REQUIRE_FALSE(bus.master.poll(bus.now));
+
+    // submit, t3.5, transmit, response frame: a handful of polls instead of one per ms
+    REQUIRE(bus.transact(&request) == MODBUS_RESULT_OK);
+    REQUIRE(bus.polls <= 4);
+
+    // a timeout is a single wait
+    bus.polls = 0;
+    bus.slave.silent = 1;
+    bus.master.setDefaultPolicy(50, 0);
+    REQUIRE(bus.transact(&request) == MODBUS_RESULT_TIMEOUT);
+    REQUIRE(bus.polls <= 4);
+    REQUIRE(bus.master.pollDelayUs(bus.now) == MODBUS_POLL_NEVER);
+}
+
+TEST_CASE("ModbusFramePort timestamps the bytes of the frames", "[ModbusMaster]") {
+    uint32_t now = 100000;
+    SimModbusSlave slave(9600, &now);
+    ModbusFramePort port(&SimModbusSlave::read, &SimModbusSlave::write, &slave);
+    uint16_t regs[2] = {};
+    ModbusRequest request = readRequest(1, 0, 2, regs);
+    ModbusMaster master;
+    uint32_t end_us;
+    uint32_t c = slave.char_us;
+
+    REQUIRE(port.stamped());
+    REQUIRE(port.read() == -1);
+
+    // a 9-byte response in two frames: 3 bytes, a silence of 2 characters, 6 bytes
+    slave.split_at = 3;
+    slave.gap_us = 2 * c;
+    master.begin(&port, 9600);
+    master.submit(&request);
+    master.poll(now);
+    uint32_t start = slave.request_end_us + slave.delay_us;
+
+    now = start + 12 * c;
+    REQUIRE(port.readStamped(&end_us) == 1);
+    REQUIRE(end_us == start + c);
+    REQUIRE(port.readStamped(&end_us) == MODBUS_FC_READ_HOLDING_REGISTERS);
+    REQUIRE(port.readStamped(&end_us) == 4);
+    REQUIRE(end_us == start + 3 * c);
+    // the second frame follows the silence
+    REQUIRE(port.readStamped(&end_us) == 0x10);
+    REQUIRE(end_us == start + 6 * c);
+    for (int i = 0; i < 5; i++) {
+        REQUIRE(port.readStamped(&end_us) >= 0);
+    }
+    REQUIRE(end_us == start + 11 * c);
+    REQUIRE(port.readStamped(&end_us) == -1);
+}
@@ -0,0 +1,270 @@
+#include <catch2/catch.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "utility/MODBUS/ModbusSlave.h"
+
+/*
+ * Modbus TCP slave behind a real socket on the loopback interface: the
+ * server thread reads the stream as it comes, in whatever segments the
+ * stack delivers, and answers with pollTcp() as ModbusSlaveClass does.
+ * The client writes with TCP_NODELAY so that the requests split across
+ * writes reach the server in several segments.
+ */
+struct Loopback {
+    uint16_t holding[16] = {};
+    uint16_t input[16] = {};
+    uint8_t coils[2] = {};
+    uint8_t inputs[2] = {};
+    ModbusDataMap map;
+    ModbusSlave slave;
+    int listener = -1;
+    int client = -1;
+    bool closed = false;
+    std::thread server;
+
+    Loopback(uint8_t unit_id = 1) {
+        for (int i = 0; i < 16; i++) {
+            input[i] = 0x2000 + i;
+        }
+        map = {coils, 16, inputs, 16, input, 16, holding, 16};
+        slave.begin(unit_id, &map);
+
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(listener >= 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        REQUIRE(bind(listener, (sockaddr*)&addr, sizeof(addr)) == 0);
+        REQUIRE(listen(listener, 1) == 0);
+        socklen_t addr_len = sizeof(addr);
+        REQUIRE(getsockname(listener, (sockaddr*)&addr, &addr_len) == 0);
+
+        server = std::thread(&Loopback::serve, this);
+
+        client = socket(AF_INET, SOCK_STREAM, 0);
+        REQUIRE(client >= 0);
+        int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        REQUIRE(connect(client, (sockaddr*)&addr, sizeof(addr)) == 0);
+    }
+
+    ~Loopback() {
+        if (client >= 0) {
+            close(client);
+        }
+        server.join();
+        close(listener);
+    }
+
+    void serve() {
+        int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0) {
+            return;
+        }
+
+        uint8_t rx[MODBUS_TCP_MAX_ADU];
+        uint8_t tx[MODBUS_TCP_MAX_ADU];
+        size_t rx_len = 0;
+        for (;;) {
+            ssize_t n = recv(conn, &rx[rx_len], sizeof(rx) - rx_len, 0);
+            if (n <= 0) {
+                break;
+            }
+            rx_len += n;
+
+            int out;
+            while ((out = slave.pollTcp(rx, &rx_len, tx)) > 0) {
+                send(conn, tx, out, 0);
+            }
+            if (out < 0) {
+                break;
+            }
+        }
+        close(conn);
+    }
+
+    void write(const std::vector<uint8_t>& data) {
+        REQUIRE(send(client, data.data(), data.size(), 0) == (ssize_t)data.size());
+    }
+
+    // read len bytes, false if the server closed the connection or nothing came within 1 s
+    bool read(uint8_t* data, size_t len) {
+        size_t got = 0;
+        while (got < len) {
+            pollfd fd = {client, POLLIN, 0};
+            if (::poll(&fd, 1, 1000) != 1) {
+                return false;
+            }
+            ssize_t n = recv(client, &data[got], len - got, 0);
+            if (n <= 0) {
+                closed = true;
+                return false;
+            }
+            got += n;
+        }
+        return true;
+    }
+
+    // true if the server closed the connection without sending anything
+    bool peerClosed() {
+        uint8_t byte;
+        return !read(&byte, 1) && closed;
+    }
+};
+
+static std::vector<uint8_t> mbap(uint16_t transaction, uint8_t unit, const std::vector<uint8_t>& pdu) {
+    std::vector<uint8_t> adu(MODBUS_TCP_HEADER + pdu.size());
+
+    modbusPutU16(&adu[0], transaction);
+    modbusPutU16(&adu[2], 0);
+    modbusPutU16(&adu[4], pdu.size() + 1);
+    adu[6] = unit;
+    memcpy(&adu[MODBUS_TCP_HEADER], pdu.data(), pdu.size());
+    return adu;
+}
+
+static std::vector<uint8_t> readInputs(uint16_t transaction, uint16_t address, uint16_t quantity) {
+    return mbap(transaction, 1, {MODBUS_FC_READ_INPUT_REGISTERS, 0, (uint8_t)address, 0, (uint8_t)quantity});
+}
+
+TEST_CASE("ModbusSlave answers TCP requests over the loopback", "[ModbusSlave]") {
+    Loopback loop;
+    uint8_t rsp[MODBUS_TCP_MAX_ADU];
+
+    SECTION("read input registers") {
+        loop.write(readInputs(0x1234, 2, 3));
+
+        REQUIRE(loop.read(rsp, 15));
+        REQUIRE(rsp[0] == 0x12);
+        REQUIRE(rsp[1] == 0x34);
+        REQUIRE(modbusGetU16(&rsp[2]) == 0);
+        REQUIRE(modbusGetU16(&rsp[4]) == 9);
+        REQUIRE(rsp[6] == 1);
+        REQUIRE(rsp[7] == MODBUS_FC_READ_INPUT_REGISTERS);
+        REQUIRE(rsp[8] == 6);
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(modbusGetU16(&rsp[9 + 2 * i]) == 0x2002 + i);
+        }
+    }
+
+    SECTION("write multiple registers") {
+        loop.write(mbap(7, 1, {MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 0, 4, 0, 2, 4, 0xAB, 0xCD, 0x01, 0x02}));
+
+        REQUIRE(loop.read(rsp, 12));
+        REQUIRE(rsp[7] == MODBUS_FC_WRITE_MULTIPLE_REGISTERS);
+        REQUIRE(modbusGetU16(&rsp[8]) == 4);
+        REQUIRE(modbusGetU16(&rsp[10]) == 2);
+        REQUIRE(loop.holding[4] == 0xABCD);
+        REQUIRE(loop.holding[5] == 0x0102);
+    }
+
+    SECTION("a request split across segments is answered once complete") {
+        std::vector<uint8_t> request = readInputs(1, 0, 1);
+
+        // byte by byte, the header itself split
+        for (size_t i = 0; i < request.size(); i++) {
+            loop.write({request[i]});
+            if (i + 1 < request.size()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+        REQUIRE(loop.read(rsp, 11));
+        REQUIRE(modbusGetU16(&rsp[9]) == 0x2000);
+    }
+
+    SECTION("pipelined requests are answered in order") {
+        std::vector<uint8_t> stream;
+        for (uint16_t t = 0; t < 20; t++) {
+            std::vector<uint8_t> request = readInputs(100 + t, t % 16, 1);
+            stream.insert(stream.end(), request.begin(), request.end());
+        }
+        // the requests straddle the writes
+        loop.write(std::vector<uint8_t>(stream.begin(), stream.begin() + 17));
+        loop.write(std::vector<uint8_t>(stream.begin() + 17, stream.end()));
+
+        for (uint16_t t = 0; t < 20; t++) {
+            REQUIRE(loop.read(rsp, 11));
+            REQUIRE(modbusGetU16(&rsp[0]) == 100 + t);
+            REQUIRE(modbusGetU16(&rsp[9]) == 0x2000 + t % 16);
+        }
+        REQUIRE(loop.slave.getStats().requests == 20);
+    }
+
+    SECTION("exceptions are answered") {
+        loop.write(readInputs(3, 15, 2));
+
+        REQUIRE(loop.read(rsp, 9));
+        REQUIRE(modbusGetU16(&rsp[4]) == 3);
+        REQUIRE(rsp[7] == (MODBUS_FC_READ_INPUT_REGISTERS | 0x80));
+        REQUIRE(rsp[8] == MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+    }
+
+    SECTION("other unit identifiers are ignored, 0 and 255 are answered") {
+        std::vector<uint8_t> other = mbap(1, 9, {MODBUS_FC_READ_INPUT_REGISTERS, 0, 0, 0, 1});
+        std::vector<uint8_t> any = mbap(2, 0xFF, {MODBUS_FC_READ_INPUT_REGISTERS, 0, 1, 0, 1});
+        std::vector<uint8_t> none = mbap(3, 0, {MODBUS_FC_READ_INPUT_REGISTERS, 0, 2, 0, 1});
+        other.insert(other.end(), any.begin(), any.end());
+        other.insert(other.end(), none.begin(), none.end());
+        loop.write(other);
+
+        REQUIRE(loop.read(rsp, 11));
+        REQUIRE(modbusGetU16(&rsp[0]) == 2);
+        REQUIRE(rsp[6] == 0xFF);
+        REQUIRE(loop.read(rsp, 11));
+        REQUIRE(modbusGetU16(&rsp[0]) == 3);
+        REQUIRE(modbusGetU16(&rsp[9]) == 0x2002);
+        REQUIRE(loop.slave.getStats().ignored == 1);
+    }
+
+    SECTION("an invalid protocol identifier closes the connection") {
+        std::vector<uint8_t> request = readInputs(1, 0, 1);
+        request[3] = 1;
+        loop.write(request);
+
+        REQUIRE(loop.peerClosed());
+    }
+
+    SECTION("a length beyond the largest ADU closes the connection") {
+        loop.write({0, 1, 0, 0, 0x01, 0x00, 1});
+
+        REQUIRE(loop.peerClosed());
+    }
+}
+
+TEST_CASE("ModbusSlave drops only the consumed TCP requests", "[ModbusSlave]") {
+    uint16_t regs[4] = {1, 2, 3, 4};
+    ModbusDataMap map = {nullptr, 0, nullptr, 0, regs, 4, regs, 4};
+    ModbusSlave slave;
+    uint8_t rx[MODBUS_TCP_MAX_ADU];
+    uint8_t tx[MODBUS_TCP_MAX_ADU];
+
+    slave.begin(1, &map);
+    std::vector<uint8_t> first = readInputs(1, 0, 1);
+    std::vector<uint8_t> second = readInputs(2, 3, 1);
+    memcpy(rx, first.data(), first.size());
+    memcpy(&rx[first.size()], second.data(), 5);
+    size_t rx_len = first.size() + 5;
+
+    REQUIRE(slave.pollTcp(rx, &rx_len, tx) == 11);
+    REQUIRE(rx_len == 5);
+    REQUIRE(memcmp(rx, second.data(), 5) == 0);
+    REQUIRE(slave.pollTcp(rx, &rx_len, tx) == 0);
+    REQUIRE(rx_len == 5);
+
+    memcpy(&rx[5], &second[5], second.size() - 5);
+    rx_len = second.size();
+    REQUIRE(slave.pollTcp(rx, &rx_len, tx) == 11);
+    REQUIRE(rx_len == 0);
+    REQUIRE(modbusGetU16(&tx[9]) == 4);
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch.hpp>
+
+#include "utility/TIME/MonotonicClock.h"
+
+/*
+ * The raw counter runs 100 ppm fast against the true time, the references
+ * are the true time with up to +-1 ms of noise (e.g. NTP over a busy
+ * network), one every 64 s.
+ */
+#define SIM_PPM         100
+#define SIM_NOISE_US    1000
+#define SIM_POLL_US     64000000ULL
+#define SIM_EPOCH_US    1700000000000000ULL
+
+struct FastCounter {
+    uint64_t ppm = SIM_PPM;
+
+    uint64_t raw(uint64_t true_us) {
+        return true_us + (true_us / 1000000) * ppm + ((true_us % 1000000) * ppm) / 1000000;
+    }
+};
+
+// deterministic noise in [-SIM_NOISE_US, SIM_NOISE_US]
+static int64_t noise(uint32_t& seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (int64_t)(seed >> 8) % (2 * SIM_NOISE_US + 1) - SIM_NOISE_US;
+}
+
+TEST_CASE("MonotonicClock disciplines a fast counter with noisy references", "[MonotonicClock]") {
+    MonotonicClock clock;
+    FastCounter counter;
+    uint32_t seed = 12345;
+    uint64_t last = 0;
+    int64_t worst = 0;
+
+    clock.reset(counter.raw(0), SIM_EPOCH_US);
+
+    for (int poll = 1; poll <= 200; poll++) {
+        // the time between two references, every 100 ms
+        for (uint64_t t = (poll - 1) * SIM_POLL_US; t < poll * SIM_POLL_US; t += 100000) {
+            uint64_t time = clock.toTime(counter.raw(t));
+            REQUIRE(time >= last);
+            last = time;
+
+            // past the first 20 references the frequency has converged
+            if (poll > 20) {
+                int64_t error = (int64_t)(time - (SIM_EPOCH_US + t));
+                worst = (error > worst) ? error : (-error > worst) ? -error : worst;
+            }
+        }
+
+        uint64_t t = poll * SIM_POLL_US;
+        clock.discipline(counter.raw(t), SIM_EPOCH_US + t + noise(seed));
+    }
+
+    // the phase error stays within twice the reference noise, the frequency within 20 ppm
+    INFO("worst error " << worst << " us");
+    REQUIRE(worst <= 2 * SIM_NOISE_US);
+    REQUIRE(clock.getFrequency() == Approx(-SIM_PPM * 1000).margin(20000));
+    REQUIRE(clock.getReferenceCount() == 200);
+}
+
+TEST_CASE("MonotonicClock holds its correction without references", "[MonotonicClock]") {
+    MonotonicClock clock;
+    FastCounter counter;
+
+    // close to the largest correction: delta * frequency passes INT64_MAX after
+    // about 237 days, the measured frequency error after 24 days
+    counter.ppm = 450;
+    clock.reset(counter.raw(0), SIM_EPOCH_US);
+    for (int poll = 1; poll <= 40; poll++) {
+        uint64_t t = poll * SIM_POLL_US;
+        clock.discipline(counter.raw(t), SIM_EPOCH_US + t);
+    }
+    REQUIRE(clock.getFrequency() == Approx(-450000 / 1.00045).margin(10));
+
+    SECTION("the time keeps the correction after a year") {
+        uint64_t start = 40 * SIM_POLL_US;
+        uint64_t last = clock.toTime(counter.raw(start));
+
+        for (uint64_t day = 1; day <= 366; day++) {
+            uint64_t t = start + day * 86400000000ULL;
+            uint64_t time = clock.toTime(counter.raw(t));
+            INFO("day " << day);
+            REQUIRE(time > last);
+            // a few ppb of residual frequency error: under 1 ms a day
+            REQUIRE((int64_t)(time - (SIM_EPOCH_US + t)) == Approx(0).margin(1000 * day));
+            last = time;
+        }
+    }
+
+    SECTION("a reference after a year keeps a sane frequency") {
+        uint64_t t = 40 * SIM_POLL_US + 366 * 86400000000ULL;
+        clock.discipline(counter.raw(t), SIM_EPOCH_US + t);
+        REQUIRE(clock.getFrequency() == Approx(-450000 / 1.00045).margin(10));
+        REQUIRE(clock.toTime(counter.raw(t)) >= SIM_EPOCH_US + t - 1);
+
+        // a reference stepped by an hour clamps the measured frequency
+        t += SIM_POLL_US;
+        clock.discipline(counter.raw(t), SIM_EPOCH_US + t + 3600000000ULL);
+        REQUIRE(clock.getFrequency() > -450000);
+        REQUIRE(clock.getFrequency() <= MCLOCK_MAX_FREQ_PPB);
+    }
+
+    SECTION("timestamps far before the last reference") {
+        uint64_t base = 40 * SIM_POLL_US + 366 * 86400000000ULL;
+        clock.discipline(counter.raw(base), SIM_EPOCH_US + base);
+
+        uint64_t time = clock.toTime(counter.raw(SIM_POLL_US));
+        REQUIRE((int64_t)(time - (SIM_EPOCH_US + SIM_POLL_US)) == Approx(0).margin(1000 * 366));
+        REQUIRE(time < clock.toTime(counter.raw(2 * SIM_POLL_US)));
+    }
+}
@@ -0,0 +1,274 @@
+#include <catch2/catch.hpp>
+
+#include "utility/RTC/PCF8563T.h"
+
+#include "SimulatedRtc.h"
+
+static PCF8563TTime makeTime(uint8_t years, uint8_t months, uint8_t days, uint8_t hours, uint8_t minutes, uint8_t seconds, uint8_t weekdays = 0, bool century = false) {
+    PCF8563TTime time;
+
+    time.seconds = seconds;
+    time.minutes = minutes;
+    time.hours = hours;
+    time.days = days;
+    time.weekdays = weekdays;
+    time.months = months;
+    time.years = years;
+    time.century = century;
+    time.voltageLow = false;
+    return time;
+}
+
+TEST_CASE("PCF8563T time registers are BCD", "[PCF8563T]") {
+    Pcf8563Model chip;
+    PCF8563TClass rtc;
+    PCF8563TTime time;
+
+    REQUIRE(rtc.begin());
+
+    SECTION("writeTime() encodes every field in one transfer") {
+        PCF8563TTime set = makeTime(39, 12, 28, 23, 58, 47, 3, true);
+
+        chip.transfers = 0;
+        REQUIRE(rtc.writeTime(&set));
+        REQUIRE(chip.transfers == 1);
+        REQUIRE(chip.reg[0x02] == 0x47);
+        REQUIRE(chip.reg[0x03] == 0x58);
+        REQUIRE(chip.reg[0x04] == 0x23);
+        REQUIRE(chip.reg[0x05] == 0x28);
+        REQUIRE(chip.reg[0x06] == 0x03);
+        REQUIRE(chip.reg[0x07] == 0x92);
+        REQUIRE(chip.reg[0x08] == 0x39);
+    }
+
+    SECTION("readTime() decodes every field in one burst") {
+        chip.set(24, 10, 19, 9, 5, 30, 6);
+        chip.transfers = 0;
+
+        REQUIRE(rtc.readTime(&time));
+        REQUIRE(chip.transfers == 2);   // register pointer, then the burst read
+        REQUIRE(time.seconds == 30);
+        REQUIRE(time.minutes == 5);
+        REQUIRE(time.hours == 9);
+        REQUIRE(time.days == 19);
+        REQUIRE(time.weekdays == 6);
+        REQUIRE(time.months == 10);
+        REQUIRE(time.years == 24);
+        REQUIRE_FALSE(time.century);
+        REQUIRE_FALSE(time.voltageLow);
+    }
+
+    SECTION("every value round-trips") {
+        for (uint8_t value = 0; value < 60; value++) {
+            PCF8563TTime set = makeTime(value, value % 12 + 1, value % 31 + 1, value % 24, value, 59 - value, value % 7);
+
+            REQUIRE(rtc.writeTime(&set));
+            REQUIRE(rtc.readTime(&time));
+            REQUIRE(time.seconds == 59 - value);
+            REQUIRE(time.minutes == value);
+            REQUIRE(time.hours == value % 24);
+            REQUIRE(time.days == value % 31 + 1);
+            REQUIRE(time.weekdays == value % 7);
+            REQUIRE(time.months == value % 12 + 1);
+            REQUIRE(time.years == value);
+        }
+    }
+
+    SECTION("the unused bits are ignored") {
+        chip.set(1, 2, 3, 4, 5, 6);
+        chip.reg[0x03] |= 0x80;
+        chip.reg[0x04] |= 0xC0;
+        chip.reg[0x05] |= 0xC0;
+        chip.reg[0x06] |= 0xF8;
+        chip.reg[0x07] |= 0x60;
+
+        REQUIRE(rtc.readTime(&time));
+        REQUIRE(time.minutes == 5);
+        REQUIRE(time.hours == 4);
+        REQUIRE(time.days == 3);
+        REQUIRE(time.weekdays == 0);
+        REQUIRE(time.months == 2);
+    }
+
+    SECTION("a register that is not valid BCD fails the read") {
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x03] = 0x1A;
+        REQUIRE_FALSE(rtc.readTime(&time));
+
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x08] = 0xA0;
+        REQUIRE_FALSE(rtc.readTime(&time));
+    }
+
+    SECTION("a value out of range fails the read") {
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x07] = 0x00;          // month 0
+        REQUIRE_FALSE(rtc.readTime(&time));
+
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x07] = 0x13;          // month 13
+        REQUIRE_FALSE(rtc.readTime(&time));
+
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x05] = 0x00;          // day 0
+        REQUIRE_FALSE(rtc.readTime(&time));
+
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x04] = 0x24;          // hour 24
+        REQUIRE_FALSE(rtc.readTime(&time));
+
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x02] = 0x60;          // second 60
+        REQUIRE_FALSE(rtc.readTime(&time));
+
+        chip.set(24, 10, 19, 9, 5, 30);
+        chip.reg[0x06] = 0x07;          // weekday 7
+        REQUIRE_FALSE(rtc.readTime(&time));
+    }
+}
+
+TEST_CASE("PCF8563T reports the VL bit", "[PCF8563T]") {
+    Pcf8563Model chip;
+    PCF8563TClass rtc;
+    PCF8563TTime time;
+
+    rtc.begin();
+    chip.set(24, 10, 19, 9, 5, 30);
+    REQUIRE(rtc.isTimeValid());
+
+    // oscillator stop: the VL bit does not change the seconds
+    chip.reg[0x02] |= 0x80;
+    REQUIRE(rtc.readTime(&time));
+    REQUIRE(time.voltageLow);
+    REQUIRE(time.seconds == 30);
+    REQUIRE_FALSE(rtc.isTimeValid());
+
+    // the VL bit is not cleared by reading, only by setting the time
+    REQUIRE_FALSE(rtc.isTimeValid());
+    PCF8563TTime set = makeTime(24, 10, 19, 9, 6, 0);
+    set.voltageLow = true;
+    REQUIRE(rtc.writeTime(&set));
+    REQUIRE((chip.reg[0x02] & 0x80) == 0);
+    REQUIRE(rtc.isTimeValid());
+}
+
+TEST_CASE("PCF8563T burst read does not tear across a rollover", "[PCF8563T]") {
+    Pcf8563Model chip;
+    PCF8563TClass rtc;
+    PCF8563TTime time;
+
+    rtc.begin();
+
+    SECTION("the counters are frozen during the transfer") {
+        chip.set(99, 12, 31, 23, 59, 59, 5);
+
+        // a second elapses after the seconds byte went out
+        chip.tick_after_byte = 1;
+        REQUIRE(rtc.readTime(&time));
+        REQUIRE(time.seconds == 59);
+        REQUIRE(time.minutes == 59);
+        REQUIRE(time.hours == 23);
+        REQUIRE(time.days == 31);
+        REQUIRE(time.months == 12);
+        REQUIRE(time.years == 99);
+        REQUIRE_FALSE(time.century);
+
+        // the pending second was applied at the stop condition
+        chip.tick_after_byte = -1;
+        REQUIRE(rtc.readTime(&time));
+        REQUIRE(time.seconds == 0);
+        REQUIRE(time.minutes == 0);
+        REQUIRE(time.hours == 0);
+        REQUIRE(time.days == 1);
+        REQUIRE(time.weekdays == 6);
+        REQUIRE(time.months == 1);
+        REQUIRE(time.years == 0);
+        REQUIRE(time.century);
+    }
+
+    SECTION("the byte-wise getters can tear") {
+        // the legacy getters are one transfer per field: reading the
+        // seconds before the minutes across 10:59:59 gives 10:00:59
+        chip.set(24, 10, 19, 10, 59, 59);
+        uint8_t seconds = rtc.getSeconds();
+        chip.tick();
+        uint8_t minutes = rtc.getMinutes();
+        REQUIRE(seconds == 59);
+        REQUIRE(minutes == 0);
+
+        chip.set(24, 10, 19, 10, 59, 59);
+        chip.tick_after_byte = 1;
+        time_t epoch = rtc.getEpoch();
+        struct tm tm;
+        gmtime_r(&epoch, &tm);
+        REQUIRE(tm.tm_hour == 10);
+        REQUIRE(tm.tm_min == 59);
+        REQUIRE(tm.tm_sec == 59);
+    }
+
+    SECTION("February has 29 days in leap years") {
+        chip.set(24, 2, 28, 23, 59, 59);
+        chip.tick();
+        REQUIRE(rtc.readTime(&time));
+        REQUIRE(time.months == 2);
+        REQUIRE(time.days == 29);
+
+        chip.set(25, 2, 28, 23, 59, 59);
+        chip.tick();
+        REQUIRE(rtc.readTime(&time));
+        REQUIRE(time.months == 3);
+        REQUIRE(time.days == 1);
+    }
+}
+
+TEST_CASE("PCF8563T converts the time to Epoch", "[PCF8563T]") {
+    PCF8563TClass rtc;
+    time_t seconds;
+
+    PCF8563TTime time = makeTime(21, 7, 6, 11, 55, 27);
+    REQUIRE(rtc.timeToEpoch(&time, &seconds));
+    REQUIRE(seconds == 1625572527);
+
+    time = makeTime(24, 2, 29, 0, 0, 0);
+    REQUIRE(rtc.timeToEpoch(&time, &seconds));
+    REQUIRE(seconds == 1709164800);
+
+    time = makeTime(0, 1, 1, 0, 0, 0);
+    REQUIRE(rtc.timeToEpoch(&time, &seconds));
+    REQUIRE(seconds == 946684800);
+}
+
+TEST_CASE("PCF8563T setEpoch() writes the RTC and the system time", "[PCF8563T]") {
+    Pcf8563Model chip;
+    PCF8563TClass rtc;
+    PCF8563TTime time;
+
+    rtc.begin();
+    rtc.setEpoch((time_t)1709251199);    // Thu, 29 Feb 2024 23:59:59
+    REQUIRE(host_rtc_time == 1709251199);
+    REQUIRE(rtc.readTime(&time));
+    REQUIRE(time.years == 24);
+    REQUIRE(time.months == 2);
+    REQUIRE(time.days == 29);
+    REQUIRE(time.weekdays == 4);
+    REQUIRE(time.hours == 23);
+    REQUIRE(time.minutes == 59);
+    REQUIRE(time.seconds == 59);
+
+    chip.tick();
+    REQUIRE(rtc.getEpoch() == 1709251200);
+    host_rtc_time = 0;
+    rtc.setEpoch();
+    REQUIRE(host_rtc_time == 1709251200);
+}
+
+TEST_CASE("PCF8563T reports a missing chip", "[PCF8563T]") {
+    PCF8563TClass rtc;
+    PCF8563TTime time = makeTime(24, 10, 19, 9, 5, 30);
+
+    REQUIRE_FALSE(rtc.begin());
+    REQUIRE_FALSE(rtc.readTime(&time));
+    REQUIRE_FALSE(rtc.writeTime(&time));
+    REQUIRE_FALSE(rtc.isTimeValid());
+    REQUIRE(rtc.getEpoch() == (time_t)-1);
+}
@@ -0,0 +1,205 @@
+#include <catch2/catch.hpp>
+
+#include <math.h>
+
+#include "utility/CONTROL/PidController.h"
+
+/*
+ * Closed loop on a simulated first order plant: gain 2, time constant 5 s,
+ * integrated exactly over each 50 ms step of the controller. The PI
+ * tunings are the IMC ones for a 2 s closed loop time constant, so the
+ * response has no overshoot in theory.
+ */
+#define PLANT_GAIN      2.0f
+#define PLANT_TAU_S     5.0f
+#define PLANT_DT_S      0.05f
+#define LOOP_LAMBDA_S   2.0f
+
+struct FirstOrderPlant {
+    float y = 0;
+
+    float step(float u) {
+        y = PLANT_GAIN * u + (y - PLANT_GAIN * u) * expf(-PLANT_DT_S / PLANT_TAU_S);
+        return y;
+    }
+};
+
+struct StepResponse {
+    float peak = 0;          // Largest overshoot past the setpoint
+    float settling_s = 0;    // Time of the last sample outside the band
+    float final_value = 0;
+    float max_output = -INFINITY;
+};
+
+// run the loop for duration_s from the current state, with a band around the setpoint
+static StepResponse runLoop(PidController& pid, FirstOrderPlant& plant, float duration_s, float band) {
+    StepResponse response;
+    float setpoint = pid.getSetpoint();
+    float start = plant.y;
+    float direction = (setpoint >= start) ? 1.0f : -1.0f;
+    int steps = (int)(duration_s / PLANT_DT_S + 0.5f);
+
+    for (int i = 1; i <= steps; i++) {
+        float u = pid.update(plant.y, PLANT_DT_S);
+        plant.step(u);
+        float overshoot = direction * (plant.y - setpoint);
+        if (overshoot > response.peak) {
+            response.peak = overshoot;
+        }
+        if (fabsf(plant.y - setpoint) > band) {
+            response.settling_s = i * PLANT_DT_S;
+        }
+        if (u > response.max_output) {
+            response.max_output = u;
+        }
+    }
+    response.final_value = plant.y;
+    return response;
+}
+
+static void tunePlantLoop(PidController& pid) {
+    float kp = PLANT_TAU_S / (PLANT_GAIN * LOOP_LAMBDA_S);
+    pid.setTunings(kp, kp / PLANT_TAU_S, 0.0f);
+    pid.setOutputLimits(0, 100);
+}
+
+TEST_CASE("PID holds the output on a step without elapsed time", "[PidController]") {
+    PidController pid;
+    pid.setOutputLimits(0, 100);
+    pid.setTunings(2.0f, 1.0f, 5.0f);
+    pid.setSetpoint(50.0f);
+    pid.setAutomatic(40.0f);
+
+    float seeded = pid.getOutput();
+
+    /* dt = 0 must not divide by zero in the derivative nor integrate */
+    REQUIRE(pid.update(10.0f, 0.0f) == seeded);
+    REQUIRE(pid.update(10.0f, 0.0f) == seeded);
+
+    float output = pid.update(45.0f, 0.1f);
+    REQUIRE_FALSE(std::isnan(output));
+    REQUIRE(output >= 0.0f);
+    REQUIRE(output <= 100.0f);
+}
+
+TEST_CASE("PID exposes its output limits", "[PidController]") {
+    PidController pid;
+    pid.setOutputLimits(-20.0f, 80.0f);
+    REQUIRE(pid.getOutputMin() == -20.0f);
+    REQUIRE(pid.getOutputMax() == 80.0f);
+
+    /* Inverted limits are rejected */
+    pid.setOutputLimits(10.0f, 5.0f);
+    REQUIRE(pid.getOutputMin() == -20.0f);
+    REQUIRE(pid.getOutputMax() == 80.0f);
+}
+
+TEST_CASE("PID settles a first order plant without overshoot", "[PidController]") {
+    PidController pid;
+    FirstOrderPlant plant;
+
+    tunePlantLoop(pid);
+    pid.setSetpoint(50.0f);
+
+    // 2% band: about 4 closed loop time constants
+    StepResponse response = runLoop(pid, plant, 30.0f, 1.0f);
+    REQUIRE(response.settling_s > 3 * LOOP_LAMBDA_S);
+    REQUIRE(response.settling_s < 5 * LOOP_LAMBDA_S);
+    REQUIRE(response.peak < 0.01f * 50.0f);
+    REQUIRE(response.final_value == Approx(50.0f).epsilon(0.001));
+    REQUIRE(pid.getOutput() == Approx(50.0f / PLANT_GAIN).epsilon(0.001));
+}
+
+TEST_CASE("PID tracks setpoint steps on a first order plant", "[PidController]") {
+    PidController pid;
+    FirstOrderPlant plant;
+
+    tunePlantLoop(pid);
+    pid.setSetpoint(50.0f);
+    runLoop(pid, plant, 30.0f, 1.0f);
+
+    SECTION("step up") {
+        // derivative on measurement: the output only jumps by the proportional
+        // step and one integration step
+        float kp = PLANT_TAU_S / (PLANT_GAIN * LOOP_LAMBDA_S);
+        float before = pid.getOutput();
+        pid.setSetpoint(80.0f);
+        float first = pid.update(plant.y, PLANT_DT_S);
+        REQUIRE(first - before == Approx(30.0f * kp + 30.0f * (kp / PLANT_TAU_S) * PLANT_DT_S).margin(0.01));
+        plant.step(first);
+
+        StepResponse response = runLoop(pid, plant, 30.0f, 0.6f);
+        REQUIRE(response.settling_s < 5 * LOOP_LAMBDA_S);
+        REQUIRE(response.peak < 0.01f * 80.0f);
+        REQUIRE(response.final_value == Approx(80.0f).epsilon(0.001));
+    }
+
+    SECTION("step down") {
+        // small enough for the proportional kick to stay above 0%
+        pid.setSetpoint(35.0f);
+        StepResponse response = runLoop(pid, plant, 30.0f, 0.3f);
+        REQUIRE(response.settling_s < 5 * LOOP_LAMBDA_S);
+        REQUIRE(response.peak < 0.01f * 35.0f);
+        REQUIRE(response.final_value == Approx(35.0f).epsilon(0.001));
+    }
+
+    SECTION("reverse acting loop") {
+        // the same plant seen with a negative gain
+        PidController reverse;
+        FirstOrderPlant inverted;
+        tunePlantLoop(reverse);
+        reverse.setDirection(PID_REVERSE);
+        reverse.setSetpoint(-40.0f);
+        for (int i = 0; i < 600; i++) {
+            inverted.step(reverse.update(-inverted.y, PLANT_DT_S));
+        }
+        REQUIRE(-inverted.y == Approx(-40.0f).epsilon(0.001));
+    }
+}
+
+TEST_CASE("PID anti-windup on a saturated first order plant", "[PidController]") {
+    PidController pid;
+    FirstOrderPlant plant;
+
+    tunePlantLoop(pid);
+
+    SECTION("transient saturation on a large step") {
+        // the proportional kick alone asks for 187%
+        pid.setSetpoint(150.0f);
+        StepResponse response = runLoop(pid, plant, 40.0f, 1.5f);
+        REQUIRE(response.max_output == 100.0f);
+        REQUIRE(response.settling_s < 6 * LOOP_LAMBDA_S);
+        REQUIRE(response.peak < 0.01f * 150.0f);
+        REQUIRE(response.final_value == Approx(150.0f).epsilon(0.001));
+    }
+
+    SECTION("recovery from an unreachable setpoint") {
+        // 100% output only reaches 200: a setpoint of 250 saturates the loop for a minute
+        pid.setSetpoint(250.0f);
+        runLoop(pid, plant, 60.0f, 1.0f);
+        REQUIRE(pid.getOutput() == 100.0f);
+        REQUIRE(plant.y == Approx(200.0f).epsilon(0.001));
+
+        // the integral has tracked the limit instead of growing with the error
+        pid.setSetpoint(180.0f);
+        StepResponse recovery = runLoop(pid, plant, 40.0f, 1.8f);
+        REQUIRE(recovery.settling_s < 3 * LOOP_LAMBDA_S);
+        REQUIRE(recovery.peak < 0.01f * 180.0f);
+        REQUIRE(recovery.final_value == Approx(180.0f).epsilon(0.001));
+
+        // same PI with an unbounded integral, the output alone clamped: it is
+        // still stuck at 100% when the loop above has settled
+        float kp = PLANT_TAU_S / (PLANT_GAIN * LOOP_LAMBDA_S);
+        float ki = kp / PLANT_TAU_S;
+        float integral = 0;
+        float u = 0;
+        FirstOrderPlant naive;
+        for (int i = 0; i < (int)((60.0f + 3 * LOOP_LAMBDA_S) / PLANT_DT_S); i++) {
+            float error = ((i < (int)(60.0f / PLANT_DT_S)) ? 250.0f : 180.0f) - naive.y;
+            integral += ki * error * PLANT_DT_S;
+            u = kp * error + integral;
+            naive.step((u > 100) ? 100 : u);
+        }
+        REQUIRE(u > 100.0f);
+    }
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch.hpp>
+
+#include <math.h>
+
+#include "utility/ANALOG/PwmFilterModel.h"
+
+/*
+ * The model is checked against a square wave run through a single pole:
+ * each high and low segment is integrated exactly, the output extrema are
+ * at the switching instants.
+ */
+
+struct RcFilter {
+    double rc_us;
+    double v = 0;
+
+    void run(double target, double us) {
+        v = target + (v - target) * exp(-us / rc_us);
+    }
+};
+
+// peak-to-peak output once the ripple is steady
+static double simulatedRipple(double full_scale, double period_us, double duty, double rc_us) {
+    RcFilter filter{rc_us};
+    int settle = (int)(20 * rc_us / period_us) + 10;
+    double high = 0;
+    double low = 0;
+
+    for (int period = 0; period < settle; period++) {
+        filter.run(full_scale, duty * period_us);
+        high = filter.v;
+        filter.run(0, (1 - duty) * period_us);
+        low = filter.v;
+    }
+    return high - low;
+}
+
+TEST_CASE("PWM ripple of the RC filter", "[PwmFilterModel]") {
+    const double rc_us = 1000;
+
+    for (double period_us : {10.0, 100.0, 500.0, 2000.0}) {
+        for (double duty : {0.1, 0.25, 0.5, 0.9}) {
+            INFO("period " << period_us << " duty " << duty);
+            double expected = simulatedRipple(10, period_us, duty, rc_us);
+            REQUIRE(PwmFilterModel::ripple(10, period_us, duty, rc_us) == Approx(expected).epsilon(1e-4));
+        }
+    }
+
+    SECTION("maximal at 50% duty, V * tanh(T / 4RC)") {
+        REQUIRE(PwmFilterModel::ripple(10, 100, 0.5f, rc_us) == Approx(10 * tanh(100 / (4 * rc_us))).epsilon(1e-4));
+        REQUIRE(PwmFilterModel::ripple(10, 100, 0.5f, rc_us) > PwmFilterModel::ripple(10, 100, 0.3f, rc_us));
+        REQUIRE(PwmFilterModel::ripple(10, 100, 0.5f, rc_us) > PwmFilterModel::ripple(10, 100, 0.7f, rc_us));
+    }
+
+    SECTION("no ripple at 0% and 100% duty or without filter") {
+        REQUIRE(PwmFilterModel::ripple(10, 100, 0, rc_us) == 0);
+        REQUIRE(PwmFilterModel::ripple(10, 100, 1, rc_us) == 0);
+        REQUIRE(PwmFilterModel::ripple(10, 100, 0.5f, 0) == 0);
+    }
+}
+
+TEST_CASE("PWM settling time of the RC filter", "[PwmFilterModel]") {
+    const double rc_us = 1000;
+    const double period_us = 50;
+    const double tolerance = 0.001;
+
+    // worst case: the full scale step is requested just after a period started
+    // and is latched at the next update event
+    RcFilter filter{rc_us};
+    double t = period_us;
+    double step_us = 0.5;
+    while (fabs(filter.v - 10) > tolerance * 10) {
+        filter.run(10, step_us);
+        t += step_us;
+    }
+
+    float settling = PwmFilterModel::settlingTime(period_us, rc_us, tolerance);
+    REQUIRE(settling == Approx(t).margin(step_us));
+    REQUIRE(settling == Approx(rc_us * log(1 / tolerance) + period_us).epsilon(1e-5));
+
+    REQUIRE(PwmFilterModel::settlingTime(period_us, rc_us, 0) == 0);
+    REQUIRE(PwmFilterModel::settlingTime(period_us, 0, tolerance) == 0);
+}
+
+TEST_CASE("PWM filter report", "[PwmFilterModel]") {
+    // 10 kHz carrier counted at 200 MHz, 1 ms filter
+    PwmFilterReport report = PwmFilterModel::evaluate(10, 100, 20000, 1000);
+
+    REQUIRE(report.ripple_v == Approx(PwmFilterModel::ripple(10, 100, 0.5f, 1000)));
+    REQUIRE(report.settling_us == Approx(PwmFilterModel::settlingTime(100, 1000, 0.001f)));
+    REQUIRE(report.lsb_v == Approx(10.0 / 20000));
+    REQUIRE(report.effective_bits == Approx(log2(20000.0)));
+
+    SECTION("the dither adds log2(RC / T) bits") {
+        PwmFilterReport dithered = PwmFilterModel::evaluate(10, 100, 20000, 1000, true);
+        REQUIRE(dithered.effective_bits == Approx(log2(20000.0) + log2(10.0)));
+        REQUIRE(dithered.ripple_v == report.ripple_v);
+
+        // no gain when the filter is faster than the carrier
+        REQUIRE(PwmFilterModel::evaluate(10, 100, 20000, 50, true).effective_bits == Approx(log2(20000.0)));
+    }
+
+    SECTION("the dither gain is bounded by the accumulator") {
+        PwmFilterReport dithered = PwmFilterModel::evaluate(10, 1, 200, 1e6f, true);
+        REQUIRE(dithered.effective_bits == Approx(log2(200.0) + 16));
+    }
+
+    SECTION("invalid period") {
+        REQUIRE(PwmFilterModel::evaluate(10, 100, 0, 1000).effective_bits == 0);
+    }
+}
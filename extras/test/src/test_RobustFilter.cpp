@@ -0,0 +1,177 @@
+#include <catch2/catch.hpp>
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "utility/FILTER/RobustFilter.h"
+
+/*
+ * The filter is fed synthetic temperature traces sampled every 100 ms:
+ * slow ramps with spikes, steps and gaps of invalid samples.
+ */
+
+static uint32_t lcg(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static float medianOf(std::vector<float> values) {
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+/* Output of a pure median filter once the window holds the given samples */
+static float filterMedian(uint8_t size, const std::vector<float>& samples) {
+    RobustFilter filter;
+    uint32_t now = 0;
+
+    filter.configure(size, 0, 1, 0);
+    filter.enable(true);
+    filter.update(-1000.0f, now);
+    float output = NAN;
+    for (float value : samples) {
+        now += 100;
+        output = filter.update(value, now);
+    }
+    return output;
+}
+
+TEST_CASE("Median networks match a sorted reference", "[RobustFilter]") {
+    SECTION("median of 5 on every combination of 5 levels (duplicates included)") {
+        std::vector<float> samples(5);
+
+        for (int n = 0; n < 5 * 5 * 5 * 5 * 5; n++) {
+            int code = n;
+            for (int i = 0; i < 5; i++) {
+                samples[i] = (float)(code % 5);
+                code /= 5;
+            }
+            INFO("combination " << n);
+            REQUIRE(filterMedian(5, samples) == medianOf(samples));
+        }
+    }
+
+    SECTION("median of 3 on every combination of 3 levels") {
+        std::vector<float> samples(3);
+
+        for (int n = 0; n < 3 * 3 * 3; n++) {
+            samples[0] = (float)(n % 3);
+            samples[1] = (float)(n / 3 % 3);
+            samples[2] = (float)(n / 9 % 3);
+            REQUIRE(filterMedian(3, samples) == medianOf(samples));
+        }
+    }
+
+    SECTION("median of 5 on random values") {
+        uint32_t seed = 12345;
+        std::vector<float> samples(5);
+
+        for (int n = 0; n < 10000; n++) {
+            for (int i = 0; i < 5; i++) {
+                samples[i] = (float)(lcg(seed) % 2001) / 10.0f - 100.0f;
+            }
+            // the smoother with alpha = 1 adds the rounding of output += (median - output)
+            REQUIRE(filterMedian(5, samples) == Approx(medianOf(samples)).margin(1e-3));
+        }
+    }
+}
+
+TEST_CASE("Spikes are rejected on a slow ramp", "[RobustFilter]") {
+    RobustFilter filter;
+    uint32_t seed = 42;
+    float max_error = 0;
+
+    REQUIRE(filter.configure(5, 0, 1, 0));
+    filter.enable(true);
+
+    /* 0.1 °C per sample ramp, up to 2 consecutive spikes of +-500 °C every 20 samples */
+    for (int i = 0; i < 2000; i++) {
+        float truth = 20.0f + 0.1f * i;
+        float value = truth;
+        int phase = i % 20;
+
+        if (phase == 10 || (phase == 11 && (lcg(seed) & 1))) {
+            value += (lcg(seed) & 1) ? 500.0f : -500.0f;
+        }
+
+        float output = filter.update(value, i * 100);
+        // the median of a ramp lags by 2 samples
+        float error = fabsf(output - (truth - 0.2f));
+        if (i >= 5 && error > max_error) {
+            max_error = error;
+        }
+    }
+    INFO("max error " << max_error);
+    REQUIRE(max_error < 0.21f);
+}
+
+TEST_CASE("Rate limiter and smoother shape a step", "[RobustFilter]") {
+    RobustFilter filter;
+
+    SECTION("the rate limiter slews at max_rate") {
+        REQUIRE(filter.configure(1, 10.0f, 1, 0));
+        filter.enable(true);
+        filter.update(0.0f, 0);
+
+        /* 10 °C/s at 100 ms per sample: 1 °C per sample up to the step */
+        for (int i = 1; i <= 50; i++) {
+            float expected = (i < 30) ? (float)i : 30.0f;
+            REQUIRE(filter.update(30.0f, i * 100) == Approx(expected).margin(1e-4));
+        }
+    }
+
+    SECTION("the smoother converges exponentially") {
+        const float alpha = 0.25f;
+
+        REQUIRE(filter.configure(1, 0, alpha, 0));
+        filter.enable(true);
+        filter.update(0.0f, 0);
+
+        for (int i = 1; i <= 20; i++) {
+            float expected = 100.0f * (1.0f - powf(1.0f - alpha, (float)i));
+            REQUIRE(filter.update(100.0f, i * 100) == Approx(expected).epsilon(1e-4));
+        }
+    }
+
+    SECTION("invalid configurations are rejected") {
+        REQUIRE_FALSE(filter.configure(4, 0, 1, 0));
+        REQUIRE_FALSE(filter.configure(5, -1, 1, 0));
+        REQUIRE_FALSE(filter.configure(5, 0, 0, 0));
+        REQUIRE_FALSE(filter.configure(5, 0, 1.5f, 0));
+    }
+}
+
+TEST_CASE("Invalid samples are bridged up to max_hold", "[RobustFilter]") {
+    RobustFilter filter;
+
+    REQUIRE(filter.configure(3, 0, 1, 3));
+
+    SECTION("disabled filter passes the samples through") {
+        REQUIRE(filter.update(12.5f, 0) == 12.5f);
+        REQUIRE(isnan(filter.update(NAN, 100)));
+    }
+
+    filter.enable(true);
+
+    SECTION("nothing to hold before the first good sample") {
+        REQUIRE(isnan(filter.update(NAN, 0)));
+        REQUIRE(filter.update(20.0f, 100) == 20.0f);
+    }
+
+    SECTION("a short gap holds, a long gap restarts") {
+        filter.update(20.0f, 0);
+        filter.update(21.0f, 100);
+        float held = filter.update(22.0f, 200);
+
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(filter.update(NAN, 300 + i * 100) == held);
+        }
+        REQUIRE(isnan(filter.update(NAN, 600)));
+        REQUIRE(filter.getInvalidCount() == 4);
+
+        /* Restarted: the window is primed with the first good sample */
+        REQUIRE(filter.update(50.0f, 700) == 50.0f);
+        REQUIRE(filter.update(51.0f, 800) == 50.0f);
+    }
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include "RtcControllerClass.h"
+
+#include "SimulatedRtc.h"
+
+/*
+ * Interrupt handling of RtcControllerClass: the simulated RTC drives the
+ * INT pin, its falling edges run the interrupt and the event queue at once.
+ */
+
+static int timer_calls;
+
+static void onTimer() {
+    timer_calls++;
+}
+
+TEST_CASE("RtcControllerClass clears the enabled flags it does not handle", "[RtcController]") {
+    Pcf8563Model chip;
+    RtcControllerClass rtc;
+
+    REQUIRE(rtc.begin());
+    timer_calls = 0;
+
+    SECTION("an alarm without callback does not hide the timer") {
+        rtc.enableAlarm();
+        REQUIRE(rtc.attachTimer(onTimer, RTC_TIMER_1HZ, 1));
+
+        chip.raise(RTC_FLAG_ALARM);
+        REQUIRE_FALSE(chip.reg[0x01] & RTC_FLAG_ALARM);
+        REQUIRE(host_pin_state(MC_RTC_INT_PIN) == HIGH);
+
+        chip.tick();
+        REQUIRE(timer_calls == 1);
+        chip.tick();
+        REQUIRE(timer_calls == 2);
+        REQUIRE(host_pin_state(MC_RTC_INT_PIN) == HIGH);
+    }
+
+    SECTION("an alarm flag with its interrupt disabled is left for polling") {
+        rtc.disableAlarm();
+        REQUIRE(rtc.attachTimer(onTimer, RTC_TIMER_1HZ, 1));
+
+        chip.raise(RTC_FLAG_ALARM);
+        chip.tick();
+        REQUIRE(timer_calls == 1);
+        REQUIRE(rtc.getInterruptFlags() == RTC_FLAG_ALARM);
+    }
+
+    rtc.detachTimer();
+}
+
+TEST_CASE("RtcControllerClass waits for a second with an unhandled alarm pending", "[RtcController]") {
+    Pcf8563Model chip;
+    RtcControllerClass rtc;
+    uint64_t edge_us = 0;
+    uint64_t tick_us = 0;
+    PCF8563TTime time;
+
+    REQUIRE(rtc.begin());
+    chip.set(24, 6, 1, 12, 0, 41);
+
+    // the alarm has gone off before anything handles the INT pin
+    rtc.enableAlarm();
+    chip.raise(RTC_FLAG_ALARM);
+    REQUIRE(host_pin_state(MC_RTC_INT_PIN) == LOW);
+
+    // the next second elapses while waitSecond() sleeps
+    rtos::EventFlags::host_waiting() = [&]() {
+        host_time_us += 400000;
+        tick_us = host_time_us;
+        chip.tick();
+    };
+    bool seen = rtc.waitSecond(&edge_us, &time);
+    rtos::EventFlags::host_waiting() = nullptr;
+
+    REQUIRE(seen);
+    REQUIRE(edge_us == tick_us);
+    REQUIRE(time.seconds == 42);
+    REQUIRE(host_pin_state(MC_RTC_INT_PIN) == HIGH);
+    REQUIRE(chip.reg[0x01] == 0x02);
+}
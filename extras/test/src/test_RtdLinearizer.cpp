@@ -0,0 +1,117 @@
+#include <catch2/catch.hpp>
+
+#include <math.h>
+#include <chrono>
+
+#include "utility/RTD/RtdLinearizer.h"
+
+/* IEC 60751 Pt100 resistance table (ohm) */
+static const struct {
+    double temp;
+    double resistance;
+} iec60751[] = {
+    { -200, 18.52 }, { -150, 39.72 }, { -100, 60.26 }, { -50, 80.31 }, { 0, 100.00 },
+    { 50, 119.40 }, { 100, 138.51 }, { 200, 175.86 }, { 300, 212.05 }, { 400, 247.09 },
+    { 500, 280.98 }, { 600, 313.71 }, { 700, 345.28 }, { 800, 375.70 }, { 850, 390.48 },
+};
+
+TEST_CASE("Callendar-Van Dusen matches the IEC 60751 table", "[RtdLinearizer]") {
+    for (auto& point : iec60751) {
+        INFO("T = " << point.temp);
+        REQUIRE(RtdLinearizer::resistance(point.temp, 100.0) == Approx(point.resistance).margin(0.005));
+        REQUIRE(RtdLinearizer::resistance(point.temp, 1000.0) == Approx(point.resistance * 10).margin(0.05));
+        // the rounded end points of the table fall just outside the range
+        if (point.temp > RTD_TEMP_MIN && point.temp < RTD_TEMP_MAX) {
+            REQUIRE(RtdLinearizer::temperature(point.resistance, 100.0) == Approx(point.temp).margin(0.015));
+        }
+    }
+
+    /* The inverse is exact on the forward function, including the C term below 0 °C */
+    for (double temp = -200; temp <= 850; temp += 0.5) {
+        REQUIRE(RtdLinearizer::temperature(RtdLinearizer::resistance(temp, 100.0), 100.0) == Approx(temp).margin(1e-6));
+    }
+
+    REQUIRE(isnan(RtdLinearizer::temperature(10.0, 100.0)));
+    REQUIRE(isnan(RtdLinearizer::temperature(400.0, 100.0)));
+}
+
+TEST_CASE("Code table follows the exact inversion", "[RtdLinearizer]") {
+    struct {
+        float r0;
+        float ref;
+    } pairs[] = { { 100.0f, 400.0f }, { 1000.0f, 4300.0f } };
+
+    for (auto& pair : pairs) {
+        RtdLinearizer lut;
+        double max_error = 0;
+
+        REQUIRE_FALSE(lut.matches(pair.r0, pair.ref));
+        REQUIRE(lut.build(pair.r0, pair.ref));
+        REQUIRE(lut.matches(pair.r0, pair.ref));
+
+        uint16_t lo = RtdLinearizer::code(RTD_TEMP_MIN, pair.r0, pair.ref);
+        uint16_t hi = RtdLinearizer::code(RTD_TEMP_MAX, pair.r0, pair.ref);
+
+        for (uint32_t code = lo + 1; code < hi; code++) {
+            double exact = RtdLinearizer::temperature(code * (double)pair.ref / RTD_CODE_FULL_SCALE, pair.r0);
+            double error = fabs(lut.convert(code) - exact);
+
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+        INFO("Pt" << pair.r0 << " / " << pair.ref << " ohm, max error " << max_error << " °C");
+        REQUIRE(max_error < 0.002);
+
+        /* Outside the IEC 60751 range */
+        REQUIRE(isnan(lut.convert(lo - 2)));
+        REQUIRE(isnan(lut.convert(hi + 2)));
+    }
+}
+
+TEST_CASE("Code table is rebuilt for another pair", "[RtdLinearizer]") {
+    RtdLinearizer lut;
+
+    REQUIRE(lut.build(100.0f, 400.0f));
+    REQUIRE(lut.convert(8192) == Approx(0.0f).margin(0.001f));
+
+    REQUIRE(lut.build(1000.0f, 4300.0f));
+    REQUIRE_FALSE(lut.matches(100.0f, 400.0f));
+    REQUIRE(lut.convert(RtdLinearizer::code(0, 1000.0, 4300.0)) == Approx(0.0f).margin(0.02f));
+
+    REQUIRE_FALSE(lut.build(0.0f, 400.0f));
+    REQUIRE(lut.matches(1000.0f, 4300.0f));
+}
+
+TEST_CASE("Code table conversion is faster than the exact inversion", "[RtdLinearizer]") {
+    const int rounds = 20;
+    RtdLinearizer lut;
+    REQUIRE(lut.build(100.0f, 400.0f));
+
+    uint16_t lo = RtdLinearizer::code(RTD_TEMP_MIN, 100.0, 400.0) + 1;
+    uint16_t hi = RtdLinearizer::code(RTD_TEMP_MAX, 100.0, 400.0) - 1;
+    volatile double sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t code = lo; code < hi; code++) {
+            sink = sink + lut.convert(code);
+        }
+    }
+    auto table = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t code = lo; code < hi; code++) {
+            sink = sink + RtdLinearizer::temperature(code * 400.0 / RTD_CODE_FULL_SCALE, 100.0);
+        }
+    }
+    auto exact = std::chrono::steady_clock::now() - start;
+
+    double conversions = (double)rounds * (hi - lo);
+    double table_ns = std::chrono::duration<double, std::nano>(table).count() / conversions;
+    double exact_ns = std::chrono::duration<double, std::nano>(exact).count() / conversions;
+
+    INFO("table " << table_ns << " ns, exact " << exact_ns << " ns per conversion");
+    REQUIRE(table_ns < exact_ns);
+}
@@ -0,0 +1,193 @@
+#include <catch2/catch.hpp>
+
+#include <string.h>
+
+#include "utility/SERIAL/SerialCapture.h"
+
+#include "SimulatedSerial.h"
+
+/*
+ * 1 Mbaud 8N1: 10 us per character, records split at the 3.5 character
+ * gaps of Modbus RTU.
+ */
+#define CAPTURE_CHAR_NS     10000
+#define CAPTURE_GAP_US      35
+
+static uint8_t capture_log[MC_CAPTURE_LOG_SIZE];
+static SerialCaptureRecord capture_record;
+
+static void drain(SerialCapture& capture, std::vector<uint8_t>& bytes, std::vector<SerialCaptureRecord>& records) {
+    while (capture.readRecord(&capture_record)) {
+        bytes.insert(bytes.end(), capture_record.data, capture_record.data + capture_record.length);
+        records.push_back(capture_record);
+    }
+}
+
+TEST_CASE("SerialCapture records a saturated 1 Mbaud line without loss", "[SerialCapture]") {
+    SimSerialBackend backend(CAPTURE_CHAR_NS);
+    SerialCapture capture(capture_log, sizeof(capture_log));
+    SimByteStream line(backend, 1000);
+    std::vector<uint8_t> bytes;
+    std::vector<SerialCaptureRecord> records;
+    size_t gaps = 0;
+
+    REQUIRE(capture.begin(&backend, CAPTURE_GAP_US, 1000));
+
+    // 3 MB in frames of 1 to 300 bytes, back to back or separated by a gap,
+    // drained every 8 frames
+    for (int f = 0; f < 20000; f++) {
+        line.frame(1 + line.next(300));
+        uint64_t idle = (line.next(3) == 0) ? 5 : 40 + line.next(500);
+        if (idle >= CAPTURE_GAP_US && f < 19999) {
+            gaps++;
+        }
+        line.idle(idle);
+        if (f % 8 == 0) {
+            capture.flush(line.now());
+            drain(capture, bytes, records);
+        }
+    }
+    capture.flush(line.now() + 100);
+    drain(capture, bytes, records);
+
+    SerialCaptureStats stats = capture.getStats();
+    REQUIRE(stats.lost == 0);
+    REQUIRE(stats.bytes == line.sent.size());
+    REQUIRE(bytes == line.sent);
+    REQUIRE(stats.max_used < MC_CAPTURE_LOG_SIZE);
+
+    // every record starts a frame after a gap, or continues a record at the size limit
+    size_t frame = 0;
+    size_t offset = 0;
+    size_t continued = 0;
+    uint64_t max_error_us = 0;
+    bool aligned = true;
+    for (const SerialCaptureRecord& record : records) {
+        if (record.flags & SERIAL_RECORD_CONTINUED) {
+            aligned = aligned && (record.length <= MC_CAPTURE_RECORD_SIZE);
+            continued++;
+            offset += record.length;
+            continue;
+        }
+        while (frame < line.frame_offset.size() && line.frame_offset[frame] < offset) {
+            frame++;
+        }
+        if (frame == line.frame_offset.size() || line.frame_offset[frame] != offset) {
+            aligned = false;
+            break;
+        }
+        uint64_t start = line.frame_start[frame];
+        uint64_t error = (record.start_us > start) ? record.start_us - start : start - record.start_us;
+        if (error > max_error_us) {
+            max_error_us = error;
+        }
+        offset += record.length;
+    }
+    REQUIRE(aligned);
+    REQUIRE(records.size() - continued == gaps + 1);
+    REQUIRE(max_error_us <= line.latency_us);
+}
+
+TEST_CASE("SerialCapture counts and flags the bytes lost on a full log", "[SerialCapture]") {
+    SimSerialBackend backend(CAPTURE_CHAR_NS);
+    SerialCapture capture(capture_log, sizeof(capture_log));
+    SimByteStream line(backend, 0);
+
+    REQUIRE(capture.begin(&backend, CAPTURE_GAP_US, 0));
+
+    // 50000 bytes and nobody draining
+    for (int f = 0; f < 200; f++) {
+        line.frame(250);
+        line.idle(100);
+    }
+    capture.flush(line.now());
+
+    SerialCaptureStats stats = capture.getStats();
+    REQUIRE(stats.lost > 0);
+    REQUIRE(stats.bytes + stats.lost == 50000);
+
+    SECTION("the binary stream holds every recorded byte") {
+        static uint8_t stream[MC_CAPTURE_LOG_SIZE];
+        uint8_t header[SERIAL_CAPTURE_HEADER];
+
+        REQUIRE(capture.header(header) == SERIAL_CAPTURE_HEADER);
+        REQUIRE(memcmp(header, SERIAL_CAPTURE_MAGIC, 4) == 0);
+        REQUIRE(header[4] == SERIAL_CAPTURE_VERSION);
+        REQUIRE((header[5] | header[6] << 8 | header[7] << 16) == CAPTURE_CHAR_NS);
+        REQUIRE(header[9] == CAPTURE_GAP_US);
+
+        size_t len = capture.read(stream, sizeof(stream));
+        size_t pos = 0;
+        size_t recorded = 0;
+        while (pos + SERIAL_CAPTURE_RECORD <= len) {
+            uint16_t length = stream[pos + 1] | stream[pos + 2] << 8;
+            recorded += length;
+            pos += SERIAL_CAPTURE_RECORD + length;
+        }
+        REQUIRE(pos == len);
+        REQUIRE(recorded == stats.bytes);
+    }
+
+    SECTION("the first record after the loss is flagged") {
+        std::vector<uint8_t> bytes;
+        std::vector<SerialCaptureRecord> records;
+
+        drain(capture, bytes, records);
+        REQUIRE(records.size() > 0);
+        REQUIRE_FALSE(records.back().flags & SERIAL_RECORD_LOST);
+
+        line.frame(10);
+        line.idle(100);
+        capture.flush(line.now());
+        REQUIRE(capture.readRecord(&capture_record));
+        REQUIRE(capture_record.flags & SERIAL_RECORD_LOST);
+        REQUIRE(capture_record.length == 10);
+    }
+}
+
+TEST_CASE("SerialCapture flags the line errors on their record", "[SerialCapture]") {
+    SimSerialBackend backend(CAPTURE_CHAR_NS);
+    SerialCapture capture(capture_log, sizeof(capture_log));
+    SimByteStream line(backend, 0);
+
+    REQUIRE(capture.begin(&backend, CAPTURE_GAP_US, 0));
+
+    line.frame(8);
+    line.idle(100);
+    line.error(SERIAL_ERROR_PARITY);
+    line.frame(8);
+    line.idle(100);
+    line.error(SERIAL_ERROR_OVERRUN);
+    line.frame(8);
+    line.idle(100);
+    capture.flush(line.now());
+
+    REQUIRE(capture.readRecord(&capture_record));
+    REQUIRE(capture_record.flags == 0);
+    REQUIRE(capture.readRecord(&capture_record));
+    REQUIRE(capture_record.flags == SERIAL_RECORD_ERROR);
+    REQUIRE(capture.readRecord(&capture_record));
+    REQUIRE(capture_record.flags == SERIAL_RECORD_OVERRUN);
+    REQUIRE(capture.getStats().errors == 1);
+    REQUIRE(capture.getStats().overruns == 1);
+}
+
+TEST_CASE("SerialCapture keeps the time across long gaps", "[SerialCapture]") {
+    // 1 ms per character at 10000 baud
+    SimSerialBackend backend(1000000);
+    SerialCapture capture(capture_log, sizeof(capture_log));
+    SimByteStream line(backend, 0);
+
+    REQUIRE(capture.begin(&backend, 3500, 0));
+
+    // beyond the 71 minutes of the record delta
+    line.frame(3);
+    line.idle(5000000000ULL);
+    line.frame(3);
+    capture.flush(line.now() + 1000000);
+
+    REQUIRE(capture.readRecord(&capture_record));
+    uint64_t first = capture_record.start_us;
+    REQUIRE(capture.readRecord(&capture_record));
+    REQUIRE(capture_record.start_us - first == 5000000000ULL + 4000);
+}
@@ -0,0 +1,198 @@
+#include <catch2/catch.hpp>
+
+#include <string.h>
+
+#include "utility/SERIAL/SerialFramer.h"
+
+#include "SimulatedSerial.h"
+
+/*
+ * 1 Mbaud 8N1: 10 us per character.
+ */
+#define FRAMER_CHAR_NS      10000
+#define FRAMER_CHAR_US      (FRAMER_CHAR_NS / 1000)
+
+static SerialFramer framer;
+static SerialFrame framer_frame;
+
+static int frame_calls;
+
+static void onFrame(void* context) {
+    frame_calls++;
+}
+
+static void checkFrame(SimByteStream& line, size_t index, size_t offset, size_t length) {
+    INFO("frame " << index << " at byte " << offset);
+    REQUIRE(framer_frame.length == length);
+    REQUIRE(memcmp(framer_frame.data, &line.sent[line.frame_offset[index] + offset], length) == 0);
+}
+
+TEST_CASE("SerialFramer hands over the frames across the ring wraparound", "[SerialFramer]") {
+    SimSerialBackend backend(FRAMER_CHAR_NS);
+    SimByteStream line(backend, 1000);
+
+    REQUIRE(framer.begin(&backend));
+    framer.resetStats();
+    framer.setFrameCallback(onFrame, nullptr);
+    frame_calls = 0;
+
+    // random lengths: the frames start and end all over the ring, some across its end
+    size_t received = 0;
+    for (size_t i = 0; i < 100; i++) {
+        size_t length = 1 + line.next(MC_SERIAL_FRAME_SIZE);
+        line.frame(length);
+        line.idle(50);
+
+        REQUIRE(framer.available() == 1);
+        REQUIRE(framer.pop(&framer_frame));
+        checkFrame(line, i, 0, length);
+        REQUIRE(framer_frame.flags == 0);
+        received += length;
+    }
+
+    REQUIRE(received > 4 * MC_SERIAL_RING_SIZE);
+    REQUIRE_FALSE(framer.pop(&framer_frame));
+    REQUIRE(frame_calls == 100);
+    REQUIRE(framer.getStats().frames == 100);
+    REQUIRE(framer.getStats().bytes == received);
+    framer.setFrameCallback(nullptr, nullptr);
+    framer.end();
+}
+
+TEST_CASE("SerialFramer timestamps the frames", "[SerialFramer]") {
+    SimSerialBackend backend(FRAMER_CHAR_NS);
+    SimByteStream line(backend, 1000);
+
+    REQUIRE(framer.begin(&backend));
+
+    for (size_t i = 0; i < 20; i++) {
+        size_t length = 1 + line.next(MC_SERIAL_FRAME_SIZE);
+        line.frame(length);
+        line.idle(35 + line.next(500));
+
+        REQUIRE(framer.pop(&framer_frame));
+        INFO("frame " << i << " of " << length << " bytes");
+        // late by the interrupt latency, the start is derived from the end
+        REQUIRE(framer_frame.start_us == Approx(line.frame_start[i]).margin(line.latency_us));
+        REQUIRE(framer_frame.end_us == framer_frame.start_us + length * FRAMER_CHAR_US);
+    }
+    framer.end();
+}
+
+TEST_CASE("SerialFramer splits the frames longer than a slot", "[SerialFramer]") {
+    SimSerialBackend backend(FRAMER_CHAR_NS);
+    SimByteStream line(backend, 1000);
+    size_t length = 2 * MC_SERIAL_FRAME_SIZE + 40;
+
+    REQUIRE(framer.begin(&backend));
+    framer.resetStats();
+
+    line.frame(length);
+    REQUIRE(framer.available() == 3);
+
+    for (size_t part = 0; part < 3; part++) {
+        size_t offset = part * MC_SERIAL_FRAME_SIZE;
+
+        REQUIRE(framer.pop(&framer_frame));
+        checkFrame(line, 0, offset, (part < 2) ? MC_SERIAL_FRAME_SIZE : 40);
+        REQUIRE(framer_frame.flags == ((part < 2) ? SERIAL_FRAME_TRUNCATED : 0));
+        // each part keeps the time of its own bytes
+        REQUIRE(framer_frame.start_us == Approx(line.frame_start[0] + offset * FRAMER_CHAR_US).margin(line.latency_us));
+    }
+
+    REQUIRE(framer.getStats().truncated == 2);
+    REQUIRE(framer.getStats().frames == 3);
+    framer.end();
+}
+
+TEST_CASE("SerialFramer drops the frames when the queue is full", "[SerialFramer]") {
+    SimSerialBackend backend(FRAMER_CHAR_NS);
+    SimByteStream line(backend, 1000);
+
+    REQUIRE(framer.begin(&backend));
+    framer.resetStats();
+
+    // one slot is the frame being received
+    for (size_t i = 0; i < MC_SERIAL_FRAMES + 2; i++) {
+        line.frame(16);
+        line.idle(50);
+    }
+    REQUIRE(framer.available() == MC_SERIAL_FRAMES - 1);
+    REQUIRE(framer.getStats().dropped == 3);
+
+    // the oldest frames are kept
+    for (size_t i = 0; i < MC_SERIAL_FRAMES - 1; i++) {
+        REQUIRE(framer.pop(&framer_frame));
+        checkFrame(line, i, 0, 16);
+    }
+    REQUIRE_FALSE(framer.pop(&framer_frame));
+
+    // the queue takes frames again once read
+    line.frame(20);
+    REQUIRE(framer.pop(&framer_frame));
+    checkFrame(line, MC_SERIAL_FRAMES + 2, 0, 20);
+    REQUIRE(framer_frame.flags == 0);
+    framer.end();
+}
+
+TEST_CASE("SerialFramer flags the line errors on their frame", "[SerialFramer]") {
+    SimSerialBackend backend(FRAMER_CHAR_NS);
+    SimByteStream line(backend, 1000);
+
+    REQUIRE(framer.begin(&backend));
+    framer.resetStats();
+
+    line.frame(8);
+    line.idle(100);
+    line.error(SERIAL_ERROR_PARITY);
+    line.frame(8);
+    line.idle(100);
+    // the first byte of the next frame is in error, reported with the idle line
+    line.frame(8, SERIAL_ERROR_OVERRUN);
+    line.idle(100);
+    line.frame(8);
+    line.idle(100);
+    line.frame(8);
+
+    const uint8_t expected[] = { 0, SERIAL_FRAME_ERROR, 0, SERIAL_FRAME_OVERRUN, 0 };
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        INFO("frame " << i);
+        REQUIRE(framer.pop(&framer_frame));
+        REQUIRE(framer_frame.flags == expected[i]);
+    }
+    REQUIRE(framer.getStats().errors == 1);
+    REQUIRE(framer.getStats().overruns == 1);
+    framer.end();
+}
+
+TEST_CASE("SerialFramer reports the end of the transmissions", "[SerialFramer]") {
+    SimSerialBackend backend(FRAMER_CHAR_NS);
+    const uint8_t request[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x02, 0xC4, 0x0B };
+    int tx_calls = 0;
+
+    REQUIRE_FALSE(framer.write(request, sizeof(request)));
+    REQUIRE(framer.begin(&backend));
+    framer.resetStats();
+
+    REQUIRE(framer.write(request, sizeof(request), [](void* context) { (*(int*)context)++; }, &tx_calls));
+    // sent from the caller buffer
+    REQUIRE(backend.tx_data == request);
+    REQUIRE(backend.tx_len == sizeof(request));
+    REQUIRE(framer.isWriting());
+    REQUIRE_FALSE(framer.write(request, sizeof(request)));
+
+    backend.txComplete();
+    REQUIRE_FALSE(framer.isWriting());
+    REQUIRE(tx_calls == 1);
+    REQUIRE(framer.getStats().tx_frames == 1);
+
+    // without callback
+    REQUIRE(framer.write(request, 4));
+    backend.txComplete();
+    REQUIRE(tx_calls == 1);
+    REQUIRE(framer.getStats().tx_frames == 2);
+
+    REQUIRE_FALSE(framer.write(request, 0));
+    framer.end();
+    REQUIRE_FALSE(framer.write(request, sizeof(request)));
+}
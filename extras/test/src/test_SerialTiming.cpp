@@ -0,0 +1,75 @@
+#include <catch2/catch.hpp>
+
+#include "utility/SERIAL/SerialTiming.h"
+
+TEST_CASE("serialFrameHalfBits counts every bit of the frame format", "[SerialTiming]") {
+    REQUIRE(serialFrameHalfBits(SERIAL_8N1) == 20);
+    REQUIRE(serialFrameHalfBits(SERIAL_8E1) == 22);
+    REQUIRE(serialFrameHalfBits(SERIAL_8O1) == 22);
+    REQUIRE(serialFrameHalfBits(SERIAL_8N2) == 22);
+    REQUIRE(serialFrameHalfBits(SERIAL_7E1) == 20);
+    REQUIRE(serialFrameHalfBits(SERIAL_STOP_BIT_1_5 | SERIAL_PARITY_NONE | SERIAL_DATA_5) == 15);
+    REQUIRE(serialFrameHalfBits(SERIAL_STOP_BIT_2 | SERIAL_PARITY_MARK | SERIAL_DATA_6) == 20);
+
+    SECTION("invalid formats") {
+        REQUIRE(serialFrameHalfBits(0) == 0);
+        REQUIRE(serialFrameHalfBits(SERIAL_STOP_BIT_1 | SERIAL_PARITY_NONE) == 0);
+        REQUIRE(serialFrameHalfBits(SERIAL_STOP_BIT_1 | SERIAL_DATA_8) == 0);
+        REQUIRE(serialFrameHalfBits(SERIAL_PARITY_NONE | SERIAL_DATA_8) == 0);
+        REQUIRE(serialFrameHalfBits(SERIAL_STOP_BIT_1 | 0x6 | SERIAL_DATA_8) == 0);
+    }
+}
+
+TEST_CASE("serialTiming covers the frame from 1200 baud to 1 Mbaud", "[SerialTiming]") {
+    const uint32_t bauds[] = {1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1000000};
+    const uint16_t configs[] = {SERIAL_8N1, SERIAL_8E1, SERIAL_8N2, SERIAL_7E1};
+
+    for (uint32_t baud : bauds) {
+        for (uint16_t config : configs) {
+            INFO("baud " << baud << " config 0x" << std::hex << config);
+            SerialTiming timing;
+            REQUIRE(serialTiming(baud, config, &timing));
+
+            double bit_ns = 1e9 / baud;
+            double char_ns = bit_ns * serialFrameHalfBits(config) / 2;
+
+            // rounded up to the next ns
+            REQUIRE(timing.bit_ns >= bit_ns);
+            REQUIRE(timing.bit_ns < bit_ns + 1);
+            REQUIRE(timing.char_ns >= char_ns);
+            REQUIRE(timing.char_ns < char_ns + 1);
+
+            // one idle bit before the first start bit, never less than the enable time of the transceiver
+            REQUIRE(timing.predelay_us * 1000.0 >= bit_ns);
+            REQUIRE(timing.predelay_us >= MC_RS485_DE_SETUP_US);
+            REQUIRE(timing.predelay_us * 1000.0 < bit_ns + 1000 + MC_RS485_DE_SETUP_US * 1000);
+
+            // the character in the shift register plus half a bit, within 1 us
+            REQUIRE(timing.postdelay_us * 1000.0 >= char_ns + bit_ns / 2);
+            REQUIRE(timing.postdelay_us * 1000.0 < char_ns + bit_ns / 2 + 1002);
+        }
+    }
+}
+
+TEST_CASE("serialTiming of the usual Modbus rates", "[SerialTiming]") {
+    SerialTiming timing;
+
+    REQUIRE(serialTiming(9600, SERIAL_8E1, &timing));
+    REQUIRE(timing.bit_ns == 104167);
+    REQUIRE(timing.char_ns == 1145834);
+    REQUIRE(timing.predelay_us == 105);
+    REQUIRE(timing.postdelay_us == 1198);
+
+    REQUIRE(serialTiming(1000000, SERIAL_8N1, &timing));
+    REQUIRE(timing.bit_ns == 1000);
+    REQUIRE(timing.char_ns == 10000);
+    REQUIRE(timing.predelay_us == MC_RS485_DE_SETUP_US);
+    REQUIRE(timing.postdelay_us == 11);
+}
+
+TEST_CASE("serialTiming rejects invalid settings", "[SerialTiming]") {
+    SerialTiming timing;
+
+    REQUIRE_FALSE(serialTiming(0, SERIAL_8N1, &timing));
+    REQUIRE_FALSE(serialTiming(9600, 0, &timing));
+}
@@ -0,0 +1,164 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+#include "utility/RTD/MAX31865.h"
+#include "utility/THERMOCOUPLE/MAX31855.h"
+
+#include "SimulatedChips.h"
+
+/*
+ * The MAX31855 (mode 0) and the MAX31865 (mode 1) share the host SPI bus
+ * through the bus manager, as on the board.
+ */
+
+TEST_CASE("SPI bus is begun by the first device and ended by the last", "[SpiBusManager]") {
+    Max31855Model tc_chip;
+    Max31865Model rtd_chip;
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    MAX31865Class rtd(MC_RTD_CS_PIN, SPI);
+    SpiBusManager& bus = SpiBusManager::forBus(SPI);
+    uint32_t begun = SPI.begun;
+    uint32_t ended = SPI.ended;
+
+    tc_chip.set(25.0f, 24.0f);
+    REQUIRE(bus.users() == 0);
+
+    SECTION("both drivers hold one reference each") {
+        REQUIRE(tc.begin());
+        REQUIRE(rtd.begin());
+        REQUIRE(SPI.begun == begun + 1);
+        REQUIRE(bus.users() == 2);
+
+        /* A repeated begin() or end() does not count twice */
+        REQUIRE(tc.begin());
+        REQUIRE(bus.users() == 2);
+        tc.end();
+        tc.end();
+        REQUIRE(bus.users() == 1);
+        REQUIRE(SPI.ended == ended);
+
+        rtd.end();
+        REQUIRE(bus.users() == 0);
+        REQUIRE(SPI.ended == ended + 1);
+    }
+
+    SECTION("a failed begin() followed by end() does not steal the RTD reference") {
+        REQUIRE(rtd.begin());
+        tc_chip.missing = true;
+
+        REQUIRE_FALSE(tc.begin());
+        REQUIRE(bus.users() == 1);
+        tc.end();
+        REQUIRE(bus.users() == 1);
+        REQUIRE(SPI.ended == ended);
+
+        /* The RTD converter still works */
+        rtd_chip.code = 9000;
+        REQUIRE(rtd.readRTD() == 9000);
+
+        rtd.end();
+        REQUIRE(SPI.ended == ended + 1);
+    }
+
+    REQUIRE(tc_chip.bad_frames == 0);
+    REQUIRE(rtd_chip.bad_frames == 0);
+}
+
+TEST_CASE("SPI transactions are closed and use the device settings", "[SpiBusManager]") {
+    Max31855Model tc_chip;
+    Max31865Model rtd_chip;
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    MAX31865Class rtd(MC_RTD_CS_PIN, SPI);
+    SpiDeviceStats stats;
+
+    tc_chip.set(100.0f, 25.0f);
+    REQUIRE(tc.begin());
+    REQUIRE(rtd.begin());
+    tc.setTCType(PROBE_TC_K);
+    tc.getTCSpiStats(&stats);
+    uint32_t tc_reconfigurations = stats.reconfigurations;
+
+    /* Alternating devices: every frame in its own transaction with its own mode */
+    for (int i = 0; i < 10; i++) {
+        uint32_t transactions = SPI.transactions;
+
+        TCSample sample = tc.readTCSample();
+        REQUIRE_FALSE(SPI.open);
+        REQUIRE(SPI.transactions == transactions + 1);
+        REQUIRE(sample.fault == TC_FAULT_NONE);
+        REQUIRE(sample.hot_junction == 100.0f);
+        REQUIRE(sample.temperature == Approx(100.0).margin(2.5));
+
+        rtd.readRTDStatus();
+        REQUIRE_FALSE(SPI.open);
+        REQUIRE(SPI.transactions == transactions + 2);
+    }
+    tc.getTCSpiStats(&stats);
+    REQUIRE(stats.reconfigurations - tc_reconfigurations == 10);
+
+    /* The same device repeating does not switch the settings */
+    for (int i = 0; i < 10; i++) {
+        tc.readTCSample();
+    }
+    tc.getTCSpiStats(&stats);
+    REQUIRE(stats.reconfigurations - tc_reconfigurations == 11);
+
+    tc.end();
+    rtd.end();
+    REQUIRE(tc_chip.bad_frames == 0);
+    REQUIRE(rtd_chip.bad_frames == 0);
+}
+
+TEST_CASE("SPI transactions from two threads queue on the bus", "[SpiBusManager]") {
+    const int rounds = 500;
+    Max31855Model tc_chip;
+    Max31865Model rtd_chip;
+    MAX31855Class tc(MC_TC_CS_PIN, SPI);
+    MAX31865Class rtd(MC_RTD_CS_PIN, SPI);
+    SpiDeviceStats tc_stats, rtd_stats;
+
+    tc_chip.set(50.0f, 20.0f);
+    rtd_chip.code = 7777;
+    rtd_chip.loadConversion();
+    REQUIRE(tc.begin());
+    REQUIRE(rtd.begin());
+    tc.getTCSpiStats(&tc_stats);
+    rtd.getRTDSpiStats(&rtd_stats);
+    uint32_t tc_frames = tc_chip.frames;
+    uint32_t rtd_frames = rtd_chip.frames;
+    int tc_bad = 0, rtd_bad = 0;
+
+    std::thread tc_thread([&]() {
+        for (int i = 0; i < rounds; i++) {
+            if (tc.readTCSample().hot_junction != 50.0f) {
+                tc_bad++;
+            }
+        }
+    });
+    std::thread rtd_thread([&]() {
+        for (int i = 0; i < rounds; i++) {
+            if (rtd.readRTDStatus().rtd != 7777) {
+                rtd_bad++;
+            }
+        }
+    });
+    tc_thread.join();
+    rtd_thread.join();
+
+    REQUIRE(tc_bad == 0);
+    REQUIRE(rtd_bad == 0);
+    REQUIRE(tc_chip.frames - tc_frames == rounds);
+    REQUIRE(rtd_chip.frames - rtd_frames == rounds);
+    REQUIRE(tc_chip.bad_frames == 0);
+    REQUIRE(rtd_chip.bad_frames == 0);
+
+    SpiDeviceStats stats;
+    tc.getTCSpiStats(&stats);
+    REQUIRE(stats.transactions - tc_stats.transactions == rounds);
+    rtd.getRTDSpiStats(&stats);
+    REQUIRE(stats.transactions - rtd_stats.transactions == rounds);
+
+    tc.end();
+    rtd.end();
+}
@@ -0,0 +1,228 @@
+#include <catch2/catch.hpp>
+
+#include "RTDTempProbeClass.h"
+#include "TempProbeClass.h"
+
+#include "SimulatedChips.h"
+
+/*
+ * Temperature probe connector with simulated probes: the converters
+ * present the probe of the channel selected by the multiplexer pins, in
+ * the mode selected by the RTD/TC pin.
+ */
+
+enum SimProbe { SIM_EMPTY, SIM_TC, SIM_RTD_2W, SIM_RTD_3W };
+
+static int selectedChannel() {
+    if (host_pin_state(MC_TP_SEL0_PIN) == HIGH) {
+        return 0;
+    }
+    if (host_pin_state(MC_TP_SEL1_PIN) == HIGH) {
+        return 1;
+    }
+    if (host_pin_state(MC_TP_SEL2_PIN) == HIGH) {
+        return 2;
+    }
+    return -1;
+}
+
+class SimRtd : public Max31865Model {
+public:
+    void select() override {
+        int ch = selectedChannel();
+        SimProbe probe = (ch < 0 || host_pin_state(MC_RTD_TH_PIN) != HIGH) ? SIM_EMPTY : probes[ch];
+        bool three_wire = reg[0] & MAX31856_CONFIG_3_WIRE;
+
+        detect_fault = 0;
+        switch (probe) {
+            case SIM_RTD_3W:
+                code = RtdLinearizer::code(25.0, 100.0, 400.0);
+                break;
+            case SIM_RTD_2W:
+                // without the jumper the 3-wire compensation input is open
+                code = RtdLinearizer::code(25.0, 100.0, 400.0);
+                detect_fault = three_wire ? MAX31865_FAULT_LOW_REFIN : 0;
+                break;
+            case SIM_TC:
+                // a thermocouple is close to 0 ohm
+                code = 10;
+                break;
+            default:
+                // open inputs read close to the reference resistor
+                code = 32760;
+                detect_fault = MAX31865_FAULT_HIGH_THRESH;
+                break;
+        }
+        Max31865Model::select();
+    }
+
+    SimProbe probes[MC_TP_CHANNELS] = { SIM_EMPTY, SIM_EMPTY, SIM_EMPTY };
+};
+
+class SimTc : public Max31855Model {
+public:
+    void select() override {
+        int ch = selectedChannel();
+        SimProbe probe = (ch < 0 || host_pin_state(MC_RTD_TH_PIN) != LOW) ? SIM_EMPTY : probes[ch];
+
+        switch (probe) {
+            case SIM_TC:
+                set(300.0f, 25.0f);
+                break;
+            case SIM_RTD_2W:
+            case SIM_RTD_3W:
+                // an RTD shorts the thermocouple input: the cold junction is read back
+                set(25.0f, 25.0f);
+                break;
+            default:
+                set(0.0f, 25.0f, TC_FAULT_OPEN);
+                break;
+        }
+        Max31855Model::select();
+    }
+
+    SimProbe probes[MC_TP_CHANNELS] = { SIM_EMPTY, SIM_EMPTY, SIM_EMPTY };
+};
+
+TEST_CASE("Probe discovery finds the simulated probes", "[TempProbe]") {
+    SimRtd rtd_chip;
+    SimTc tc_chip;
+    TempProbeClass probe;
+    SpiBusManager& bus = SpiBusManager::forBus(SPI);
+
+    auto connect = [&](int ch, SimProbe kind) {
+        rtd_chip.probes[ch] = kind;
+        tc_chip.probes[ch] = kind;
+    };
+
+    SECTION("one probe of each kind") {
+        connect(0, SIM_RTD_3W);
+        connect(1, SIM_TC);
+        connect(2, SIM_RTD_2W);
+
+        ProbeMap map = probe.discoverProbes(100.0f, 400.0f);
+
+        REQUIRE(map.type[0] == PROBE_RTD_3W);
+        REQUIRE(map.type[1] == PROBE_TC_UNKNOWN);
+        REQUIRE(map.type[2] == PROBE_RTD_2W);
+        REQUIRE(map.tc_fault[1] == TC_FAULT_NONE);
+        REQUIRE(map.rtd_fault[2] == 0);
+    }
+
+    SECTION("empty channels report the open thermocouple") {
+        connect(1, SIM_TC);
+
+        ProbeMap map = probe.discoverProbes(100.0f, 400.0f);
+
+        REQUIRE(map.type[0] == PROBE_NONE);
+        REQUIRE(map.type[1] == PROBE_TC_UNKNOWN);
+        REQUIRE(map.type[2] == PROBE_NONE);
+        REQUIRE(map.tc_fault[0] == TC_FAULT_OPEN);
+        REQUIRE(map.tc_fault[2] == TC_FAULT_OPEN);
+    }
+
+    SECTION("the converters are left uninitialized when they were") {
+        connect(0, SIM_TC);
+
+        probe.discoverProbes(100.0f, 400.0f);
+        REQUIRE(bus.users() == 0);
+        REQUIRE_FALSE(rtd_chip.reg[0] & MAX31856_CONFIG_BIAS_ON);
+    }
+
+    SECTION("an initialized RTD converter keeps its wiring and the TC type is kept") {
+        connect(0, SIM_RTD_3W);
+        connect(1, SIM_RTD_2W);
+        probe.beginRTD();
+        probe.selectChannel(1, PROBE_RTD_2W);
+        probe.setTCType(PROBE_TC_J);
+        REQUIRE(bus.users() == 1);
+
+        probe.discoverProbes(100.0f, 400.0f);
+
+        /* The scan ended on a 3-wire attempt, the 2-wire setup is restored */
+        REQUIRE(bus.users() == 1);
+        REQUIRE((rtd_chip.reg[0] & MAX31856_CONFIG_3_WIRE) == 0);
+        REQUIRE(probe.getRTDType() == PROBE_RTD_2W);
+        REQUIRE(probe.getTCType() == PROBE_TC_J);
+
+        probe.endRTD();
+        REQUIRE(bus.users() == 0);
+    }
+
+    SECTION("the discovered types select the channels") {
+        connect(0, SIM_TC);
+        connect(2, SIM_RTD_3W);
+
+        ProbeMap map = probe.discoverProbes(100.0f, 400.0f);
+        probe.beginTC();
+        probe.beginRTD();
+        probe.setTCType(PROBE_TC_K);
+
+        probe.selectChannel(0, map.type[0]);
+        REQUIRE(host_pin_state(MC_RTD_TH_PIN) == LOW);
+        REQUIRE(probe.getTCType() == PROBE_TC_K);
+        REQUIRE(probe.readTCSample().hot_junction == 300.0f);
+
+        probe.selectChannel(2, map.type[2]);
+        REQUIRE(host_pin_state(MC_RTD_TH_PIN) == HIGH);
+        REQUIRE(probe.convertRTDTemperature(100.0f, 400.0f) == Approx(25.0f).margin(0.05f));
+
+        probe.endTC();
+        probe.endRTD();
+    }
+
+    REQUIRE(rtd_chip.bad_frames == 0);
+    REQUIRE(tc_chip.bad_frames == 0);
+}
+
+TEST_CASE("Probe objects on the same converter share its configuration", "[TempProbe]") {
+    SimRtd rtd_chip;
+    TempProbeClass probe;
+    RTDTempProbeClass rtd;
+
+    rtd_chip.probes[0] = SIM_RTD_2W;
+    rtd_chip.probes[1] = SIM_RTD_3W;
+    probe.beginRTD();
+    probe.selectChannel(1, PROBE_RTD_3W);
+    REQUIRE(rtd_chip.reg[0] & MAX31856_CONFIG_3_WIRE);
+
+    SECTION("the wiring set by one object is kept by the other") {
+        rtd.begin(PROBE_RTD_2W);
+        rtd.selectChannel(0);
+        REQUIRE(probe.getRTDType() == PROBE_RTD_2W);
+
+        probe.convertRTDTemperature(100.0f, 400.0f);
+        REQUIRE_FALSE(rtd_chip.reg[0] & MAX31856_CONFIG_3_WIRE);
+        REQUIRE(rtd.readTemperature(100.0f, 400.0f) == Approx(25.0f).margin(0.05f));
+    }
+
+    SECTION("the wiring is restored when the multiplexer does not move") {
+        probe.selectChannel(0, PROBE_RTD_2W);
+        rtd.begin(PROBE_RTD_3W);
+        REQUIRE(rtd_chip.reg[0] & MAX31856_CONFIG_3_WIRE);
+
+        probe.selectChannel(0, PROBE_RTD_2W);
+        REQUIRE_FALSE(rtd_chip.reg[0] & MAX31856_CONFIG_3_WIRE);
+        REQUIRE(rtd.getRTDType() == PROBE_RTD_2W);
+    }
+
+    SECTION("a one shot read does not stop the auto conversion of the other object") {
+        rtd.begin(PROBE_RTD_3W);
+        rtd.setRTDAutoConvert(true);
+        REQUIRE((rtd_chip.reg[0] & 0xC0) == 0xC0);
+
+        REQUIRE(probe.getRTDAutoConvert());
+        rtd_chip.resetCounters();
+        probe.readRTD();
+        REQUIRE((rtd_chip.reg[0] & 0xC0) == 0xC0);
+        REQUIRE(rtd_chip.conversions == 0);
+
+        rtd.setRTDAutoConvert(false);
+        REQUIRE_FALSE(probe.getRTDAutoConvert());
+    }
+
+    rtd.end();
+    probe.endRTD();
+    REQUIRE_FALSE(rtd_chip.reg[0] & MAX31856_CONFIG_BIAS_ON);
+    REQUIRE(rtd_chip.bad_frames == 0);
+}
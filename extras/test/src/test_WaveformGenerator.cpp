@@ -0,0 +1,77 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "utility/ANALOG/WaveformGenerator.h"
+
+static std::vector<uint16_t> run(WaveformGenerator& wave, size_t ticks) {
+    std::vector<uint16_t> out;
+
+    for (size_t i = 0; i < ticks; i++) {
+        wave.tick();
+        out.push_back(wave.getOutput());
+    }
+    return out;
+}
+
+TEST_CASE("Waveform duty sequences", "[WaveformGenerator]") {
+    const uint16_t table[] = { 100, 200, 300 };
+    WaveformGenerator wave;
+
+    SECTION("loop mode repeats the table, one entry every divider ticks") {
+        REQUIRE(wave.start(table, 3, 2, WAVEFORM_LOOP));
+        std::vector<uint16_t> expected = { 100, 100, 200, 200, 300, 300, 100, 100, 200 };
+        REQUIRE(run(wave, expected.size()) == expected);
+        REQUIRE(wave.isRunning());
+    }
+
+    SECTION("one-shot mode holds the last entry and stops") {
+        REQUIRE(wave.start(table, 3, 1, WAVEFORM_ONESHOT));
+        std::vector<uint16_t> expected = { 100, 200, 300, 300 };
+        REQUIRE(run(wave, expected.size()) == expected);
+        REQUIRE_FALSE(wave.isRunning());
+        REQUIRE_FALSE(wave.tick());
+    }
+
+    SECTION("the slew limiter ramps towards each entry") {
+        const uint16_t step[] = { 0, 1000 };
+        wave.setOutput(0);
+        wave.setSlewLimit(300);
+        REQUIRE(wave.start(step, 2, 1, WAVEFORM_ONESHOT));
+        std::vector<uint16_t> expected = { 0, 300, 600, 900, 1000 };
+        REQUIRE(run(wave, expected.size()) == expected);
+        // a one-shot runs until the output has reached the last entry
+        REQUIRE_FALSE(wave.isRunning());
+    }
+
+    SECTION("the slew limiter also limits downward steps") {
+        const uint16_t step[] = { 500 };
+        wave.setOutput(1000);
+        wave.setSlewLimit(200);
+        REQUIRE(wave.start(step, 1, 1, WAVEFORM_ONESHOT));
+        std::vector<uint16_t> expected = { 800, 600, 500 };
+        REQUIRE(run(wave, expected.size()) == expected);
+    }
+
+    SECTION("invalid tables are refused") {
+        REQUIRE_FALSE(wave.start(nullptr, 3, 1));
+        REQUIRE_FALSE(wave.start(table, 0, 1));
+    }
+}
+
+TEST_CASE("Waveform table builders", "[WaveformGenerator]") {
+    uint16_t table[64];
+
+    WaveformGenerator::fillRamp(table, 5, 1000, 2000);
+    REQUIRE(table[0] == 1000);
+    REQUIRE(table[2] == 1500);
+    REQUIRE(table[4] == 2000);
+
+    WaveformGenerator::fillRamp(table, 3, 60000, 0);
+    REQUIRE(table[1] == 30000);
+
+    WaveformGenerator::fillSine(table, 64, 32768, 30000);
+    REQUIRE(table[0] == 32768);
+    REQUIRE(table[16] == 62768);
+    REQUIRE(table[48] == 2768);
+}
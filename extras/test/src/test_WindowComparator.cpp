@@ -0,0 +1,157 @@
+#include <catch2/catch.hpp>
+
+#include <math.h>
+#include <vector>
+
+#include "utility/ANALOG/WindowComparator.h"
+
+/*
+ * Synthetic waveforms are fed sample by sample, the detection latency is the
+ * distance in samples between the first sample outside the window and the
+ * sample on which update() reports the transition.
+ */
+
+static uint32_t lcg(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+static std::vector<uint16_t> noisySine(size_t length, float center, float amplitude, float period, uint16_t noise, uint32_t seed) {
+    std::vector<uint16_t> wave(length);
+
+    for (size_t i = 0; i < length; i++) {
+        float value = center + amplitude * sinf(2.0f * (float)M_PI * i / period);
+        if (noise > 0) {
+            value += (float)(lcg(seed) % (2 * noise + 1)) - noise;
+        }
+        wave[i] = (value < 0) ? 0 : (value > 65535) ? 65535 : (uint16_t)value;
+    }
+    return wave;
+}
+
+TEST_CASE("Window comparator trips on the first sample outside the window", "[WindowComparator]") {
+    WindowComparator alarm;
+    alarm.setWindow(20000, 40000);
+
+    SECTION("step above the high threshold") {
+        for (uint32_t i = 0; i < 100; i++) {
+            REQUIRE_FALSE(alarm.update(30000, i, 0));
+        }
+        REQUIRE(alarm.update(40001, 100, 1234));
+        REQUIRE(alarm.getState() == WINDOW_ALARM_HIGH);
+
+        WindowAlarmStatus status = alarm.getStatus();
+        REQUIRE(status.high_count == 1);
+        REQUIRE(status.low_count == 0);
+        REQUIRE(status.last_trip_sample == 100);
+        REQUIRE(status.last_trip_us == 1234);
+    }
+
+    SECTION("thresholds are inclusive") {
+        REQUIRE_FALSE(alarm.update(40000, 0, 0));
+        REQUIRE_FALSE(alarm.update(20000, 1, 0));
+        REQUIRE(alarm.update(19999, 2, 0));
+        REQUIRE(alarm.getState() == WINDOW_ALARM_LOW);
+    }
+
+    SECTION("direct transition from high to low") {
+        REQUIRE(alarm.update(50000, 0, 0));
+        REQUIRE(alarm.update(10000, 1, 0));
+        REQUIRE(alarm.getState() == WINDOW_ALARM_LOW);
+        REQUIRE(alarm.getStatus().high_count == 1);
+        REQUIRE(alarm.getStatus().low_count == 1);
+    }
+
+    SECTION("disabled comparator never trips") {
+        alarm.disable();
+        REQUIRE_FALSE(alarm.update(65535, 0, 0));
+        REQUIRE(alarm.getState() == WINDOW_ALARM_NONE);
+    }
+}
+
+TEST_CASE("Window comparator detection latency on synthetic waveforms is zero samples", "[WindowComparator]") {
+    const uint16_t low = 15000;
+    const uint16_t high = 50000;
+    const uint16_t hysteresis = 1000;
+
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        std::vector<uint16_t> wave = noisySine(20000, 32768, 25000 + seed * 200, 500 + seed * 37, 300, seed);
+        WindowComparator alarm;
+        uint8_t expected = WINDOW_ALARM_NONE;
+        uint32_t trips = 0;
+
+        alarm.setWindow(low, high, hysteresis);
+
+        for (uint32_t i = 0; i < wave.size(); i++) {
+            uint16_t s = wave[i];
+
+            // reference model of the comparator
+            uint8_t next = expected;
+            if (s > high) {
+                next = WINDOW_ALARM_HIGH;
+            } else if (s < low) {
+                next = WINDOW_ALARM_LOW;
+            } else if (expected == WINDOW_ALARM_HIGH && s <= high - hysteresis) {
+                next = WINDOW_ALARM_NONE;
+            } else if (expected == WINDOW_ALARM_LOW && s >= low + hysteresis) {
+                next = WINDOW_ALARM_NONE;
+            }
+
+            bool changed = alarm.update(s, i, i * 10);
+            REQUIRE(changed == (next != expected));
+            REQUIRE(alarm.getState() == next);
+
+            if (changed && next != WINDOW_ALARM_NONE) {
+                trips++;
+                REQUIRE(alarm.getStatus().last_trip_sample == i);
+            }
+            expected = next;
+        }
+
+        WindowAlarmStatus status = alarm.getStatus();
+        REQUIRE(status.high_count + status.low_count == trips);
+        REQUIRE(trips > 0);
+    }
+}
+
+TEST_CASE("Window comparator hysteresis suppresses chatter", "[WindowComparator]") {
+    // 10 slow excursions above the high threshold with +/-400 counts of noise
+    std::vector<uint16_t> wave = noisySine(10000, 40000, 2000, 1000, 400, 7);
+
+    SECTION("hysteresis larger than the noise gives one trip per excursion") {
+        WindowComparator alarm;
+        alarm.setWindow(10000, 41000, 1000);
+        for (uint32_t i = 0; i < wave.size(); i++) {
+            alarm.update(wave[i], i, 0);
+        }
+        REQUIRE(alarm.getStatus().high_count == 10);
+    }
+
+    SECTION("without hysteresis the noise makes the alarm chatter") {
+        WindowComparator alarm;
+        alarm.setWindow(10000, 41000, 0);
+        for (uint32_t i = 0; i < wave.size(); i++) {
+            alarm.update(wave[i], i, 0);
+        }
+        REQUIRE(alarm.getStatus().high_count > 10);
+    }
+
+    SECTION("the alarm clears exactly at the release point") {
+        WindowComparator alarm;
+        alarm.setWindow(10000, 41000, 1000);
+        REQUIRE(alarm.update(41001, 0, 0));
+        REQUIRE_FALSE(alarm.update(40001, 1, 0));
+        REQUIRE(alarm.update(40000, 2, 500));
+        REQUIRE(alarm.getState() == WINDOW_ALARM_NONE);
+        REQUIRE(alarm.getStatus().last_clear_us == 500);
+    }
+
+    SECTION("a hysteresis wider than the window saturates at the opposite threshold") {
+        WindowComparator alarm;
+        alarm.setWindow(30000, 31000, 5000);
+        REQUIRE(alarm.update(29000, 0, 0));
+        REQUIRE_FALSE(alarm.update(30999, 1, 0));
+        REQUIRE(alarm.update(31000, 2, 0));
+        REQUIRE(alarm.getState() == WINDOW_ALARM_NONE);
+    }
+}
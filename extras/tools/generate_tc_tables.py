@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""
+Generate the NIST ITS-90 thermocouple coefficient tables used by MAX31855Class
+for the thermocouple types E, N, R, S and B.
+
+Usage:
+    python3 generate_tc_tables.py            # validate and write src/utility/THERMOCOUPLE/TCTables.h
+    python3 generate_tc_tables.py --check    # validate only
+
+The coefficients are validated against NIST reference points (forward
+function) and by round trip through the inverse function before the header
+is written.
+"""
+
+import argparse
+import math
+import os
+import sys
+
+# Forward functions: E(t) in mV, list of (upper temperature limit in degC, coefficients)
+# Inverse functions: t(E) in degC, list of (upper voltage limit in mV, coefficients)
+# The first range starts at the lower limit of the type.
+TYPES = {
+    "E": {
+        "min_t": -270.0,
+        "min_mv": -8.825,
+        "forward": [
+            (0.0, [0.0, 0.586655087080E-01, 0.454109771240E-04, -0.779980486860E-06, -0.258001608430E-07,
+                   -0.594525830570E-09, -0.932140586670E-11, -0.102876055340E-12, -0.803701236210E-15,
+                   -0.439794973910E-17, -0.164147763550E-19, -0.396736195160E-22, -0.558273287210E-25,
+                   -0.346578420130E-28]),
+            (1000.0, [0.0, 0.586655087100E-01, 0.450322755820E-04, 0.289084072120E-07, -0.330568966520E-09,
+                      0.650244032700E-12, -0.191974955040E-15, -0.125366004970E-17, 0.214892175690E-20,
+                      -0.143880417820E-23, 0.359608994810E-27]),
+        ],
+        "inverse": [
+            (0.0, [0.0, 1.6977288E+01, -4.3514970E-01, -1.5859697E-01, -9.2502871E-02, -2.6084314E-02,
+                   -4.1360199E-03, -3.4034030E-04, -1.1564890E-05, 0.0]),
+            (76.373, [0.0, 1.7057035E+01, -2.3301759E-01, 6.5435585E-03, -7.3562749E-05, -1.7896001E-06,
+                      8.4036165E-08, -1.3735879E-09, 1.0629823E-11, -3.2447087E-14]),
+        ],
+        "reference": [(-200, -8.825), (-100, -5.237), (100, 6.319), (500, 37.005), (900, 68.787)],
+        "inverse_range": (-200.0, 1000.0),
+        "inverse_tolerance": 0.03,
+    },
+    "N": {
+        "min_t": -270.0,
+        "min_mv": -3.990,
+        "forward": [
+            (0.0, [0.0, 0.261591059620E-01, 0.109574842280E-04, -0.938411115540E-07, -0.464120397590E-10,
+                   -0.263033577160E-11, -0.226534380030E-13, -0.760893007910E-16, -0.934196678350E-19]),
+            (1300.0, [0.0, 0.259293946010E-01, 0.157101418800E-04, 0.438256272370E-07, -0.252611697940E-09,
+                      0.643118193390E-12, -0.100634715190E-14, 0.997453389920E-18, -0.608632456070E-21,
+                      0.208492293390E-24, -0.306821961510E-28]),
+        ],
+        "inverse": [
+            (0.0, [0.0, 3.8436847E+01, 1.1010485E+00, 5.2229312E+00, 7.2060525E+00, 5.8488586E+00,
+                   2.7754916E+00, 7.7075166E-01, 1.1582665E-01, 7.3138868E-03]),
+            (20.613, [0.0, 3.86896E+01, -1.08267E+00, 4.70205E-02, -2.12169E-06, -1.17272E-04, 5.39280E-06,
+                      -7.98156E-08]),
+            (47.513, [1.972485E+01, 3.300943E+01, -3.915159E-01, 9.855391E-03, -1.274371E-04, 7.767022E-07]),
+        ],
+        "reference": [(-200, -3.990), (-100, -2.407), (100, 2.774), (500, 16.748), (1000, 36.256), (1200, 43.846)],
+        "inverse_range": (-200.0, 1300.0),
+        "inverse_tolerance": 0.04,
+    },
+    "R": {
+        "min_t": -50.0,
+        "min_mv": -0.226,
+        "forward": [
+            (1064.18, [0.0, 0.528961729765E-02, 0.139166589782E-04, -0.238855693017E-07, 0.356916001063E-10,
+                       -0.462347666298E-13, 0.500777441034E-16, -0.373105886191E-19, 0.157716482367E-22,
+                       -0.281038625251E-26]),
+            (1664.5, [0.295157925316E+01, -0.252061251332E-02, 0.159564501865E-04, -0.764085947576E-08,
+                      0.205305291024E-11, -0.293359668173E-15]),
+            (1768.1, [0.152232118209E+03, -0.268819888545E+00, 0.171280280471E-03, -0.345895706453E-07,
+                      -0.934633971046E-14]),
+        ],
+        "inverse": [
+            (1.923, [0.0, 1.8891380E+02, -9.3835290E+01, 1.3068619E+02, -2.2703580E+02, 3.5145659E+02,
+                     -3.8953900E+02, 2.8239471E+02, -1.2607281E+02, 3.1353611E+01, -3.3187769E+00]),
+            (11.361, [1.334584505E+01, 1.472644573E+02, -1.844024844E+01, 4.031129726E+00, -6.249428360E-01,
+                      6.468412046E-02, -4.458750426E-03, 1.994710149E-04, -5.313401790E-06, 6.481976217E-08]),
+            (19.739, [-8.199599416E+01, 1.553962042E+02, -8.342197663E+00, 4.279433549E-01, -1.191577910E-02,
+                      1.492290091E-04]),
+            (21.103, [3.406177836E+04, -7.023729171E+03, 5.582903813E+02, -1.952394635E+01, 2.560740231E-01]),
+        ],
+        "reference": [(0, 0.000), (100, 0.647), (500, 4.471), (1000, 10.506), (1500, 17.451), (1700, 20.222), (1768, 21.101)],
+        "inverse_range": (-50.0, 1768.0),
+        "inverse_tolerance": 0.03,
+    },
+    "S": {
+        "min_t": -50.0,
+        "min_mv": -0.235,
+        "forward": [
+            (1064.18, [0.0, 0.540313308631E-02, 0.125934289740E-04, -0.232477968689E-07, 0.322028823036E-10,
+                       -0.331465196389E-13, 0.255744251786E-16, -0.125068871393E-19, 0.271443176145E-23]),
+            (1664.5, [0.132900444085E+01, 0.334509311344E-02, 0.654805192818E-05, -0.164856259209E-08,
+                      0.129989605174E-13]),
+            (1768.1, [0.146628232636E+03, -0.258430516752E+00, 0.163693574641E-03, -0.330439046987E-07,
+                      -0.943223690612E-14]),
+        ],
+        "inverse": [
+            (1.874, [0.0, 1.84949460E+02, -8.00504062E+01, 1.02237430E+02, -1.52248592E+02, 1.88821343E+02,
+                     -1.59085941E+02, 8.23027880E+01, -2.34181944E+01, 2.79786260E+00]),
+            (10.332, [1.291507177E+01, 1.466298863E+02, -1.534713402E+01, 3.145945973E+00, -4.163257839E-01,
+                      3.187963771E-02, -1.291637500E-03, 2.183475087E-05, -1.447379511E-07, 8.211272125E-09]),
+            (17.536, [-8.087801117E+01, 1.621573104E+02, -8.536869453E+00, 4.719686976E-01, -1.441693666E-02,
+                      2.081618890E-04]),
+            (18.693, [5.333875126E+04, -1.235892298E+04, 1.092657613E+03, -4.265693686E+01, 6.247205420E-01]),
+        ],
+        "reference": [(0, 0.000), (100, 0.646), (500, 4.233), (1000, 9.587), (1500, 15.582), (1700, 17.947), (1768, 18.693)],
+        "inverse_range": (-50.0, 1768.0),
+        "inverse_tolerance": 0.03,
+    },
+    "B": {
+        "min_t": 0.0,
+        "min_mv": 0.291,
+        "forward": [
+            (630.615, [0.0, -0.246508183460E-03, 0.590404211710E-05, -0.132579316360E-08, 0.156682919010E-11,
+                       -0.169445292400E-14, 0.629903470940E-18]),
+            (1820.0, [-0.389381686210E+01, 0.285717474700E-01, -0.848851047850E-04, 0.157852801640E-06,
+                      -0.168353448640E-09, 0.111097940130E-12, -0.445154310330E-16, 0.989756408210E-20,
+                      -0.937913302890E-24]),
+        ],
+        "inverse": [
+            (2.431, [9.8423321E+01, 6.9971500E+02, -8.4765304E+02, 1.0052644E+03, -8.3345952E+02, 4.5508542E+02,
+                     -1.5523037E+02, 2.9886750E+01, -2.4742860E+00]),
+            (13.820, [2.1315071E+02, 2.8510504E+02, -5.2742887E+01, 9.9160804E+00, -1.2965303E+00, 1.1195870E-01,
+                      -6.0625199E-03, 1.8661696E-04, -2.4878585E-06]),
+        ],
+        "reference": [(250, 0.291), (500, 1.242), (1000, 4.834), (1500, 10.099), (1800, 13.591)],
+        "inverse_range": (250.0, 1820.0),
+        "inverse_tolerance": 0.03,
+    },
+}
+
+HEADER = "src/utility/THERMOCOUPLE/TCTables.h"
+
+
+def evaluate(ranges, lower, value):
+    """Same lookup as MAX31855Class::polynomial(): first range whose upper limit is above the value."""
+    if value < lower:
+        return math.nan
+    for upper, coeffs in ranges:
+        if value < upper:
+            return sum(c * value ** i for i, c in enumerate(coeffs))
+    return math.nan
+
+
+def validate():
+    ok = True
+    for name, tc in TYPES.items():
+        # forward function against the NIST reference table (3 decimals published)
+        for t, mv in tc["reference"]:
+            calc = evaluate(tc["forward"], tc["min_t"], t)
+            if abs(calc - mv) > 0.0015:
+                print("type %s: E(%g degC) = %.4f mV, NIST %.3f mV" % (name, t, calc, mv))
+                ok = False
+
+        # inverse function by round trip over its range
+        lo, hi = tc["inverse_range"]
+        worst = 0.0
+        t = lo
+        while t < hi:
+            mv = evaluate(tc["forward"], tc["min_t"], t)
+            back = evaluate(tc["inverse"], tc["min_mv"], mv)
+            worst = max(worst, abs(back - t))
+            t += 0.5
+        if not worst <= tc["inverse_tolerance"]:
+            print("type %s: inverse error %.4f degC over %g..%g degC" % (name, worst, lo, hi))
+            ok = False
+        else:
+            print("type %s: ok, inverse error %.4f degC" % (name, worst))
+    return ok
+
+
+def c_array(name, coeffs):
+    values = ", ".join("%.12E" % c for c in coeffs)
+    return "static constexpr double %s[] = { %s };" % (name, values)
+
+
+def generate():
+    out = []
+    out.append("// Generated by extras/tools/generate_tc_tables.py, do not edit.")
+    out.append("// NIST ITS-90 thermocouple reference functions for the types E, N, R, S and B.")
+    out.append("//")
+    out.append("// Each type is compiled only if its MC_TC_TYPE_x macro is not 0, define it to 0")
+    out.append("// in the build flags to remove the tables of a type that is not used.")
+    out.append("")
+    out.append("#ifndef _TC_TABLES_H_")
+    out.append("#define _TC_TABLES_H_")
+    out.append("")
+    out.append("typedef struct {")
+    out.append("    int size;")
+    out.append("    double max;")
+    out.append("    const double *coeffs;")
+    out.append("} TCCoeffTable;")
+    for name, tc in TYPES.items():
+        macro = "MC_TC_TYPE_%s" % name
+        out.append("")
+        out.append("#ifndef %s" % macro)
+        out.append("#define %s 1" % macro)
+        out.append("#endif")
+        out.append("")
+        out.append("#if %s" % macro)
+        for i, (_, coeffs) in enumerate(tc["forward"]):
+            out.append(c_array("TC_%s_FWD%d" % (name, i), coeffs))
+        for i, (_, coeffs) in enumerate(tc["inverse"]):
+            out.append(c_array("TC_%s_INV%d" % (name, i), coeffs))
+        out.append("")
+        out.append("static constexpr TCCoeffTable TC_%s_COEFF[] = {" % name)
+        out.append("    {0, %.6f, nullptr}," % tc["min_t"])
+        for i, (upper, coeffs) in enumerate(tc["forward"]):
+            out.append("    {%d, %.6f, TC_%s_FWD%d}," % (len(coeffs), upper, name, i))
+        out.append("};")
+        out.append("")
+        out.append("static constexpr TCCoeffTable TC_%s_INV_COEFF[] = {" % name)
+        out.append("    {0, %.6f, nullptr}," % tc["min_mv"])
+        for i, (upper, coeffs) in enumerate(tc["inverse"]):
+            out.append("    {%d, %.6f, TC_%s_INV%d}," % (len(coeffs), upper, name, i))
+        out.append("};")
+        out.append("#endif")
+    out.append("")
+    out.append("#endif")
+    out.append("")
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--check", action="store_true", help="validate the coefficients only")
+    args = parser.parse_args()
+
+    if not validate():
+        sys.exit(1)
+    if args.check:
+        return
+
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+    with open(os.path.join(root, HEADER), "w") as f:
+        f.write(generate())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+/**
+ * @file AnalogCalibrationClass.cpp
+ * @brief Source file for the analog calibration store of the Portenta Machine Control library.
+ */
+
+/* Includes -----------------------------------------------------------------*/
+#include "AnalogCalibrationClass.h"
+
+#if __has_include("kvstore_global_api.h")
+#include "kvstore_global_api.h"
+#define MC_CAL_HAS_KVSTORE
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define MC_CAL_KV_KEY       "/kv/pmc_analog_cal"
+
+#define MC_CAL_AI_TYPES     3
+#define MC_CAL_AO_FIRST     (MC_AI_CHANNELS * MC_CAL_AI_TYPES)
+
+/* Functions -----------------------------------------------------------------*/
+AnalogCalibrationClass::AnalogCalibrationClass()
+                : _table{&_tables[0]}
+{ }
+
+AnalogCalibrationClass::~AnalogCalibrationClass()
+{ }
+
+bool AnalogCalibrationClass::begin() {
+    return load();
+}
+
+uint8_t AnalogCalibrationClass::inputSlot(int channel, SensorType sensor_type) {
+    int type = static_cast<int>(sensor_type) - 1;
+
+    if (channel < 0 || channel >= MC_AI_CHANNELS || type < 0 || type >= MC_CAL_AI_TYPES) {
+        return CAL_SLOTS;
+    }
+    return channel * MC_CAL_AI_TYPES + type;
+}
+
+uint8_t AnalogCalibrationClass::outputSlot(int channel) {
+    if (channel < 0 || channel >= MC_AO_CHANNELS) {
+        return CAL_SLOTS;
+    }
+    return MC_CAL_AO_FIRST + channel;
+}
+
+bool AnalogCalibrationClass::setInputGainOffset(int channel, SensorType sensor_type, float gain, float offset) {
+    return _setLinear(inputSlot(channel, sensor_type), gain, offset);
+}
+
+bool AnalogCalibrationClass::setInputTable(int channel, SensorType sensor_type, const uint16_t* raw, const uint16_t* ref, uint8_t points) {
+    return _setTable(inputSlot(channel, sensor_type), raw, ref, points);
+}
+
+void AnalogCalibrationClass::clearInput(int channel, SensorType sensor_type) {
+    _clear(inputSlot(channel, sensor_type));
+}
+
+bool AnalogCalibrationClass::setOutputGainOffset(int channel, float gain, float offset) {
+    return _setLinear(outputSlot(channel), gain, offset);
+}
+
+bool AnalogCalibrationClass::setOutputTable(int channel, const uint16_t* raw, const uint16_t* ref, uint8_t points) {
+    return _setTable(outputSlot(channel), raw, ref, points);
+}
+
+void AnalogCalibrationClass::clearOutput(int channel) {
+    _clear(outputSlot(channel));
+}
+
+void AnalogCalibrationClass::reset() {
+    core_util_critical_section_enter();
+    _table->reset();
+    core_util_critical_section_exit();
+}
+
+bool AnalogCalibrationClass::load() {
+#ifdef MC_CAL_HAS_KVSTORE
+    uint8_t blob[CAL_BLOB_MAX_SIZE];
+    size_t len = 0;
+
+    if (kv_get(MC_CAL_KV_KEY, blob, sizeof(blob), &len) != MBED_SUCCESS) {
+        return false;
+    }
+
+    return importBlob(blob, len);
+#else
+    return false;
+#endif
+}
+
+bool AnalogCalibrationClass::save() {
+#ifdef MC_CAL_HAS_KVSTORE
+    uint8_t blob[CAL_BLOB_MAX_SIZE];
+    size_t len = exportBlob(blob, sizeof(blob));
+
+    if (len == 0) {
+        return false;
+    }
+
+    return kv_set(MC_CAL_KV_KEY, blob, len, 0) == MBED_SUCCESS;
+#else
+    return false;
+#endif
+}
+
+bool AnalogCalibrationClass::erase() {
+#ifdef MC_CAL_HAS_KVSTORE
+    return kv_remove(MC_CAL_KV_KEY) == MBED_SUCCESS;
+#else
+    return false;
+#endif
+}
+
+size_t AnalogCalibrationClass::exportBlob(uint8_t* out, size_t max_len) {
+    return _table->serialize(out, max_len);
+}
+
+bool AnalogCalibrationClass::importBlob(const uint8_t* in, size_t len) {
+    _mutex.lock();
+
+    // load the other table so that a corrupted blob leaves the current calibration untouched,
+    // only the swap is done with the interrupts disabled
+    CalibrationTable* scratch = (_table == &_tables[0]) ? &_tables[1] : &_tables[0];
+    bool ret = scratch->deserialize(in, len);
+    if (ret) {
+        core_util_critical_section_enter();
+        _table = scratch;
+        core_util_critical_section_exit();
+    }
+
+    _mutex.unlock();
+
+    return ret;
+}
+
+uint16_t AnalogCalibrationClass::apply(uint8_t slot, uint16_t value) {
+    return _table->apply(slot, value);
+}
+
+bool AnalogCalibrationClass::isActive(uint8_t slot) {
+    return _table->isActive(slot);
+}
+
+bool AnalogCalibrationClass::_setLinear(uint8_t slot, float gain, float offset) {
+    if (slot >= CAL_SLOTS || gain <= 0 || gain >= 32768.0f) {
+        return false;
+    }
+
+    int32_t gain_q16 = (int32_t)(gain * 65536.0f + 0.5f);
+    int32_t offset_counts = (int32_t)((offset < 0) ? (offset - 0.5f) : (offset + 0.5f));
+
+    core_util_critical_section_enter();
+    bool ret = _table->setLinear(slot, gain_q16, offset_counts);
+    core_util_critical_section_exit();
+
+    return ret;
+}
+
+bool AnalogCalibrationClass::_setTable(uint8_t slot, const uint16_t* raw, const uint16_t* ref, uint8_t points) {
+    if (slot >= CAL_SLOTS) {
+        return false;
+    }
+
+    core_util_critical_section_enter();
+    bool ret = _table->setTable(slot, raw, ref, points);
+    core_util_critical_section_exit();
+
+    return ret;
+}
+
+void AnalogCalibrationClass::_clear(uint8_t slot) {
+    core_util_critical_section_enter();
+    _table->clear(slot);
+    core_util_critical_section_exit();
+}
+
+AnalogCalibrationClass MachineControl_AnalogCalibration;
+/**** END OF FILE ****/
@@ -0,0 +1,202 @@
+/**
+ * @file AnalogCalibrationClass.h
+ * @brief Header file for the analog calibration store of the Portenta Machine Control library.
+ *
+ * This library keeps per-channel gain/offset or multi-point corrections for the ANALOG IN
+ * (one set per sensor type) and ANALOG OUT channels, and persists them in flash.
+ */
+
+#ifndef __ANALOG_CALIBRATION_CLASS_H
+#define __ANALOG_CALIBRATION_CLASS_H
+
+/* Includes -------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <mbed.h>
+#include "AnalogInClass.h"
+#include "AnalogOutClass.h"
+#include "utility/ANALOG/CalibrationTable.h"
+
+/* Class ----------------------------------------------------------------------*/
+
+/**
+ * @class AnalogCalibrationClass
+ * @brief Class for the analog calibration store of the Portenta Machine Control.
+ *
+ * Corrections work on 16-bit counts: raw ADC counts for the inputs (as returned by
+ * MachineControl_AnalogIn.read() with 16-bit resolution) and PWM duty counts (0-65535 for 0-10.5V)
+ * for the outputs. They are applied with integer math in the acquisition and output paths.
+ * The calibration is stored as a compact versioned binary blob in the KVStore.
+ */
+class AnalogCalibrationClass {
+    public:
+        /**
+         * @brief Construct the analog calibration store with identity corrections.
+         */
+        AnalogCalibrationClass();
+
+        /**
+         * @brief Destruct the AnalogCalibrationClass object.
+         */
+        ~AnalogCalibrationClass();
+
+        /**
+         * @brief Load the calibration stored in flash.
+         *
+         * @return true If a valid calibration has been loaded, false otherwise (identity corrections are used)
+         */
+        bool begin();
+
+        /**
+         * @brief Set a gain/offset correction for an analog input channel and sensor type.
+         *
+         * corrected = raw * gain + offset
+         *
+         * @param channel The analog input channel number
+         * @param sensor_type The sensor type the correction applies to
+         * @param gain The gain correction
+         * @param offset The offset correction in counts
+         * @return true If the correction is set, false otherwise
+         */
+        bool setInputGainOffset(int channel, SensorType sensor_type, float gain, float offset);
+
+        /**
+         * @brief Set a multi-point correction for an analog input channel and sensor type.
+         *
+         * Values between points are linearly interpolated, values outside the table extrapolate the end segments.
+         * A segment may not rise or fall by more than 32767 reference counts per measured count.
+         *
+         * @param channel The analog input channel number
+         * @param sensor_type The sensor type the correction applies to
+         * @param raw Measured counts, strictly increasing
+         * @param ref Reference counts for each measured value
+         * @param points Number of points (2 to CAL_MAX_POINTS)
+         * @return true If the correction is set, false otherwise
+         */
+        bool setInputTable(int channel, SensorType sensor_type, const uint16_t* raw, const uint16_t* ref, uint8_t points);
+
+        /**
+         * @brief Remove the correction of an analog input channel and sensor type.
+         *
+         * @param channel The analog input channel number
+         * @param sensor_type The sensor type
+         */
+        void clearInput(int channel, SensorType sensor_type);
+
+        /**
+         * @brief Set a gain/offset correction for an analog output channel.
+         *
+         * @param channel The analog output channel number
+         * @param gain The gain correction
+         * @param offset The offset correction in duty counts
+         * @return true If the correction is set, false otherwise
+         */
+        bool setOutputGainOffset(int channel, float gain, float offset);
+
+        /**
+         * @brief Set a multi-point correction for an analog output channel.
+         *
+         * A segment may not rise or fall by more than 32767 output counts per requested count.
+         *
+         * @param channel The analog output channel number
+         * @param raw Requested duty counts, strictly increasing
+         * @param ref Duty counts to output for each requested value
+         * @param points Number of points (2 to CAL_MAX_POINTS)
+         * @return true If the correction is set, false otherwise
+         */
+        bool setOutputTable(int channel, const uint16_t* raw, const uint16_t* ref, uint8_t points);
+
+        /**
+         * @brief Remove the correction of an analog output channel.
+         *
+         * @param channel The analog output channel number
+         */
+        void clearOutput(int channel);
+
+        /**
+         * @brief Reset all the corrections to identity (the stored calibration is not modified).
+         */
+        void reset();
+
+        /**
+         * @brief Load the calibration from flash.
+         *
+         * @return true If a valid calibration has been loaded, false otherwise
+         */
+        bool load();
+
+        /**
+         * @brief Save the calibration to flash.
+         *
+         * @return true If the calibration has been saved, false otherwise
+         */
+        bool save();
+
+        /**
+         * @brief Erase the calibration stored in flash.
+         *
+         * @return true If the calibration has been erased, false otherwise
+         */
+        bool erase();
+
+        /**
+         * @brief Serialize the calibration into a versioned binary blob.
+         *
+         * @param out The destination buffer (CAL_BLOB_MAX_SIZE bytes are always enough)
+         * @param max_len The size of the destination buffer
+         * @return size_t The number of bytes written, 0 if the buffer is too small
+         */
+        size_t exportBlob(uint8_t* out, size_t max_len);
+
+        /**
+         * @brief Load the calibration from a binary blob created by exportBlob().
+         *
+         * @param in The source buffer
+         * @param len The size of the blob
+         * @return true If the blob is valid and has been loaded, false otherwise (the current calibration is kept)
+         */
+        bool importBlob(const uint8_t* in, size_t len);
+
+        /**
+         * @brief Get the calibration slot of an analog input channel and sensor type.
+         *
+         * @return uint8_t The slot, CAL_SLOTS if the channel or sensor type is invalid
+         */
+        static uint8_t inputSlot(int channel, SensorType sensor_type);
+
+        /**
+         * @brief Get the calibration slot of an analog output channel.
+         *
+         * @return uint8_t The slot, CAL_SLOTS if the channel is invalid
+         */
+        static uint8_t outputSlot(int channel);
+
+        /**
+         * @brief Apply the correction of a slot (hot path, integer math only).
+         *
+         * @param slot The calibration slot
+         * @param value The 16-bit value to correct
+         * @return uint16_t The corrected value
+         */
+        uint16_t apply(uint8_t slot, uint16_t value);
+
+        /**
+         * @brief Check whether a slot has a correction.
+         *
+         * @param slot The calibration slot
+         * @return true If the slot has a gain/offset or multi-point correction, false otherwise
+         */
+        bool isActive(uint8_t slot);
+
+    private:
+        CalibrationTable _tables[2];    // Table in use and validation copy loaded by importBlob()
+        CalibrationTable* volatile _table; // Table in use, swapped by importBlob()
+        rtos::Mutex _mutex;             // Protects the validation copy between concurrent importBlob() calls
+
+        bool _setLinear(uint8_t slot, float gain, float offset);
+        bool _setTable(uint8_t slot, const uint16_t* raw, const uint16_t* ref, uint8_t points);
+        void _clear(uint8_t slot);
+};
+
+extern AnalogCalibrationClass MachineControl_AnalogCalibration;
+
+#endif /* __ANALOG_CALIBRATION_CLASS_H */
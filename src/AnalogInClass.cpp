@@ -6,6 +6,9 @@
 
 /* Includes -----------------------------------------------------------------*/
 #include "AnalogInClass.h"
+#include "DigitalOutputsClass.h"
+#include "AnalogCalibrationClass.h"
+#include "TimeServiceClass.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define CH0_IN1 MC_AI_CH0_IN1_PIN
@@ -23,9 +26,17 @@
 #define CH2_IN3 MC_AI_CH2_IN3_PIN
 #define CH2_IN4 MC_AI_CH2_IN4_PIN
 
+#define MCAI_RES_DIVIDER    0.28057
+#define MCAI_REFERENCE      3.0
+
+#define MCAI_CAL_BLOCK      32
+
+#define MCAI_MONITOR_FLAG   0x01
+
 /* Functions -----------------------------------------------------------------*/
 AnalogInClass::AnalogInClass(PinName ai0_pin, PinName ai1_pin, PinName ai2_pin)
-                : _ai0{ai0_pin}, _ai1{ai1_pin}, _ai2{ai2_pin}
+                : _ai0{ai0_pin}, _ai1{ai1_pin}, _ai2{ai2_pin},
+                _monitor{nullptr}, _monitoring{false}, _monitor_overruns{0}
 {
     // Pin configuration for CH0
     pinMode(CH0_IN1, OUTPUT);
@@ -44,16 +55,28 @@ AnalogInClass::AnalogInClass(PinName ai0_pin, PinName ai1_pin, PinName ai2_pin)
     pinMode(CH2_IN2, OUTPUT);
     pinMode(CH2_IN3, OUTPUT);
     pinMode(CH2_IN4, OUTPUT);
+
+    for (int ch = 0; ch < MC_AI_CHANNELS; ch++) {
+        _alarm_cb[ch] = nullptr;
+        _alarm_do[ch] = -1;
+        _alarm_do_active[ch] = HIGH;
+        _sample_index[ch] = 0;
+        _cal_slot[ch] = CAL_SLOTS;
+    }
+    _res_shift = 0;
 }
 
 AnalogInClass::~AnalogInClass() 
-{ }
+{
+    stopMonitor();
+}
 
 bool AnalogInClass::begin(SensorType sensor_type, int res_bits) {
     bool ret = true;
 
     /* Set bit resolution of ADC */
     analogReadResolution(res_bits);
+    _res_shift = (res_bits > 0 && res_bits < 16) ? (16 - res_bits) : 0;
 
     switch (sensor_type) {
         case SensorType::NTC:
@@ -116,27 +139,324 @@ bool AnalogInClass::begin(SensorType sensor_type, int res_bits) {
             break;
     }
 
+    /* Select the calibration of the configured sensor type */
+    for (int ch = 0; ch < MC_AI_CHANNELS; ch++) {
+        _cal_slot[ch] = AnalogCalibrationClass::inputSlot(ch, sensor_type);
+    }
+
     return ret;
 }
 
 uint16_t AnalogInClass::read(int channel) {
     uint16_t value = 0;
 
+    if (_sample(channel, &value) && _monitor == nullptr) {
+        _evaluate(channel, &value, 1);
+    }
+
+    return value;
+}
+
+uint16_t AnalogInClass::peek(int channel) {
+    uint16_t value = 0;
+
+    _sample(channel, &value);
+
+    return value;
+}
+
+void AnalogInClass::processSamples(int channel, const uint16_t* samples, size_t count) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS || _monitor != nullptr) {
+        return;
+    }
+
+    if (!MachineControl_AnalogCalibration.isActive(_cal_slot[channel])) {
+        _evaluate(channel, samples, count);
+        return;
+    }
+
+    /* Correct the block in small chunks to keep the stack usage bounded in interrupt context */
+    uint16_t block[MCAI_CAL_BLOCK];
+    while (count > 0) {
+        size_t n = (count > MCAI_CAL_BLOCK) ? MCAI_CAL_BLOCK : count;
+        for (size_t i = 0; i < n; i++) {
+            block[i] = _calibrate(channel, samples[i]);
+        }
+        _evaluate(channel, block, n);
+        samples += n;
+        count -= n;
+    }
+}
+
+bool AnalogInClass::startMonitor(uint32_t period_us) {
+    if (_monitor != nullptr || period_us == 0) {
+        return false;
+    }
+
+    _monitor = new rtos::Thread(osPriorityRealtime, MC_AI_MONITOR_STACK_SIZE, nullptr, "AnalogInMonitor");
+    if (_monitor == nullptr) {
+        return false;
+    }
+
+    _monitor_overruns = 0;
+    _monitor_flags.clear(MCAI_MONITOR_FLAG);
+    _monitoring = true;
+    if (_monitor->start(mbed::callback(this, &AnalogInClass::_monitorRun)) != osOK) {
+        _monitoring = false;
+        delete _monitor;
+        _monitor = nullptr;
+        return false;
+    }
+
+    _monitor_ticker.attach(mbed::callback(this, &AnalogInClass::_monitorTick), std::chrono::microseconds(period_us));
+    return true;
+}
+
+void AnalogInClass::stopMonitor() {
+    if (_monitor == nullptr) {
+        return;
+    }
+
+    _monitor_ticker.detach();
+    _monitoring = false;
+    _monitor_flags.set(MCAI_MONITOR_FLAG);
+    _monitor->join();
+    delete _monitor;
+    _monitor = nullptr;
+}
+
+uint32_t AnalogInClass::getMonitorOverruns() {
+    return _monitor_overruns;
+}
+
+void AnalogInClass::_monitorTick() {
+    // the flag is still set when the thread has not finished the previous period
+    if (_monitor_flags.get() & MCAI_MONITOR_FLAG) {
+        _monitor_overruns++;
+    }
+    _monitor_flags.set(MCAI_MONITOR_FLAG);
+}
+
+void AnalogInClass::_monitorRun() {
+    while (true) {
+        _monitor_flags.wait_any(MCAI_MONITOR_FLAG);
+        if (!_monitoring) {
+            break;
+        }
+
+        for (int ch = 0; ch < MC_AI_CHANNELS; ch++) {
+            uint16_t value;
+
+            if (!_alarm[ch].isEnabled() && !(_capture.isRunning() && _capture.getChannel() == ch)) {
+                continue;
+            }
+            if (_sample(ch, &value)) {
+                _evaluate(ch, &value, 1);
+            }
+        }
+    }
+}
+
+bool AnalogInClass::_sample(int channel, uint16_t* value) {
     switch (channel) {
         case 0:
-            value = analogRead(_ai0);
+            *value = analogRead(_ai0);
             break;
         case 1:
-            value = analogRead(_ai1);
+            *value = analogRead(_ai1);
             break;
         case 2:
-            value = analogRead(_ai2);
+            *value = analogRead(_ai2);
             break;
         default:
-            break;
+            return false;
+    }
+
+    *value = _calibrate(channel, *value);
+    return true;
+}
+
+uint16_t AnalogInClass::_calibrate(int channel, uint16_t value) {
+    uint8_t slot = _cal_slot[channel];
+    uint32_t max = 0xFFFF >> _res_shift;
+
+    if (value > max) {
+        value = max;
+    }
+    return MachineControl_AnalogCalibration.apply(slot, value << _res_shift) >> _res_shift;
+}
+
+void AnalogInClass::_evaluate(int channel, const uint16_t* samples, size_t count) {
+    WindowComparator& alarm = _alarm[channel];
+    bool alarm_enabled = alarm.isEnabled();
+    bool capture_running = _capture.isRunning() && (_capture.getChannel() == channel);
+
+    if (!alarm_enabled && !capture_running) {
+        _sample_index[channel] += count;
+        return;
+    }
+
+    uint64_t timestamp = MachineControl_TimeService.now();
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = _sample_index[channel]++;
+
+        if (capture_running) {
+            _capture.update(samples[i], index, timestamp);
         }
 
-    return value;
+        if (alarm_enabled && alarm.update(samples[i], index, timestamp)) {
+            uint8_t state = alarm.getState();
+
+            _writeAlarmOutput(channel, state);
+
+            if (_alarm_cb[channel] != nullptr) {
+                _alarm_cb[channel](channel, state);
+            }
+        }
+    }
+}
+
+void AnalogInClass::_writeAlarmOutput(int channel, uint8_t state) {
+    if (_alarm_do[channel] < 0) {
+        return;
+    }
+
+    PinStatus active = _alarm_do_active[channel];
+    PinStatus inactive = (active == HIGH) ? LOW : HIGH;
+    MachineControl_DigitalOutputs.write(_alarm_do[channel], (state != WINDOW_ALARM_NONE) ? active : inactive);
+}
+
+uint16_t AnalogInClass::voltageToRaw(float voltage) {
+    float raw = voltage * MCAI_RES_DIVIDER / MCAI_REFERENCE * 65535;
+
+    if (raw < 0) {
+        return 0;
+    }
+    if (raw > 65535) {
+        return 65535 >> _res_shift;
+    }
+    return (uint16_t)raw >> _res_shift;
+}
+
+void AnalogInClass::setAlarmWindow(int channel, uint16_t low, uint16_t high, uint16_t hysteresis) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return;
+    }
+
+    /* The state is reset: a raised alarm releases its output */
+    core_util_critical_section_enter();
+    bool raised = (_alarm[channel].getState() != WINDOW_ALARM_NONE);
+    _alarm[channel].setWindow(low, high, hysteresis);
+    if (raised) {
+        _writeAlarmOutput(channel, WINDOW_ALARM_NONE);
+    }
+    core_util_critical_section_exit();
+}
+
+void AnalogInClass::disableAlarm(int channel) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    bool raised = (_alarm[channel].getState() != WINDOW_ALARM_NONE);
+    _alarm[channel].disable();
+    if (raised) {
+        _writeAlarmOutput(channel, WINDOW_ALARM_NONE);
+    }
+    core_util_critical_section_exit();
+}
+
+void AnalogInClass::attachAlarm(int channel, void (*callback)(int channel, uint8_t state)) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return;
+    }
+
+    _alarm_cb[channel] = callback;
+}
+
+void AnalogInClass::detachAlarm(int channel) {
+    attachAlarm(channel, nullptr);
+}
+
+void AnalogInClass::bindAlarmOutput(int channel, uint8_t do_channel, PinStatus active) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS || do_channel > 7) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    _alarm_do_active[channel] = active;
+    _alarm_do[channel] = do_channel;
+    core_util_critical_section_exit();
+}
+
+void AnalogInClass::unbindAlarmOutput(int channel) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return;
+    }
+
+    _alarm_do[channel] = -1;
+}
+
+WindowAlarmStatus AnalogInClass::getAlarmStatus(int channel) {
+    WindowAlarmStatus status = {};
+
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return status;
+    }
+
+    core_util_critical_section_enter();
+    status = _alarm[channel].getStatus();
+    core_util_critical_section_exit();
+
+    return status;
+}
+
+void AnalogInClass::clearAlarmCounters(int channel) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    _alarm[channel].clearCounters();
+    core_util_critical_section_exit();
+}
+
+bool AnalogInClass::armCapture(int channel, uint8_t trigger, uint16_t level, uint16_t pre_samples, uint16_t post_samples) {
+    if (channel < 0 || channel >= MC_AI_CHANNELS) {
+        return false;
+    }
+
+    core_util_critical_section_enter();
+    bool ret = _capture.arm(channel, trigger, level, pre_samples, post_samples);
+    core_util_critical_section_exit();
+
+    return ret;
+}
+
+void AnalogInClass::disarmCapture() {
+    _capture.disarm();
+}
+
+uint8_t AnalogInClass::getCaptureState() {
+    return _capture.getState();
+}
+
+CaptureInfo AnalogInClass::getCaptureInfo() {
+    return _capture.getInfo();
+}
+
+uint16_t AnalogInClass::getCaptureSample(size_t index) {
+    return _capture.getSample(index);
+}
+
+size_t AnalogInClass::getCaptureExportSize(uint8_t format) {
+    return _capture.exportSize(format);
+}
+
+size_t AnalogInClass::exportCapture(uint8_t* out, size_t max_len, uint8_t format) {
+    return _capture.exportRecord(out, max_len, format);
 }
 
 AnalogInClass MachineControl_AnalogIn;
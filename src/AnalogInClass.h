@@ -14,8 +14,16 @@
 #include <Arduino.h>
 #include <mbed.h>
 #include "pins_mc.h"
+#include "utility/ANALOG/WindowComparator.h"
+#include "utility/ANALOG/TransientCapture.h"
 
 /* Exported defines ----------------------------------------------------------*/
+#define MC_AI_CHANNELS  3
+
+#ifndef MC_AI_MONITOR_STACK_SIZE
+#define MC_AI_MONITOR_STACK_SIZE    1024
+#endif
+
 
 /**
  * @brief Enum class that represents different sensor types.
@@ -61,16 +69,230 @@ class AnalogInClass {
 
         /**
          * @brief Read the sampled voltage from the selected channel.
+         *
+         * While the monitor is stopped, the value is also run through the alarms and the transient capture.
          * 
          * @param channel The analog input channel number
-         * @return uint16_t The analog value between 0.0 and 1.0 normalized to a 16-bit value
+         * @return uint16_t The analog value between 0.0 and 1.0 normalized to a 16-bit value, corrected by MachineControl_AnalogCalibration
          */
         uint16_t read(int channel);
 
+        /**
+         * @brief Read the sampled voltage from the selected channel without feeding the alarms and the transient capture.
+         *
+         * @param channel The analog input channel number
+         * @return uint16_t The analog value, corrected by MachineControl_AnalogCalibration
+         */
+        uint16_t peek(int channel);
+
+        /**
+         * @brief Run a block of acquired samples through the acquisition path (calibration, alarm evaluation and transient capture).
+         *
+         * This method is meant to be called from the ADC block-completion path (e.g. the AdvancedADC
+         * buffer callback), so alarms are evaluated at acquisition rate. It is interrupt safe and its cost
+         * is constant per sample. The block is ignored while the monitor is running.
+         *
+         * @param channel The analog input channel number the samples belong to
+         * @param samples Pointer to the raw samples, in the resolution set with begin()
+         * @param count Number of samples in the block
+         */
+        void processSamples(int channel, const uint16_t* samples, size_t count);
+
+        /**
+         * @brief Start sampling the channels with an alarm or a capture at a fixed period.
+         *
+         * A timer wakes a high priority thread every period_us, which converts each monitored channel and
+         * runs the sample through the acquisition path. An alarm is then detected (and its digital output
+         * driven) at most one period plus the conversion time of the monitored channels after the input
+         * leaves its window. While the monitor runs, read() no longer feeds the acquisition path.
+         *
+         * @param period_us The sampling period in us
+         * @return true If the monitor is started, false otherwise
+         */
+        bool startMonitor(uint32_t period_us = 500);
+
+        /**
+         * @brief Stop the monitor.
+         */
+        void stopMonitor();
+
+        /**
+         * @brief Get the number of sampling periods missed by the monitor since it was started.
+         *
+         * @return uint32_t The number of periods that started while the previous one was still running
+         */
+        uint32_t getMonitorOverruns();
+
+        /**
+         * @brief Convert a voltage on the 0-10V input to the raw value returned by read().
+         *
+         * @param voltage The input voltage (0-10V)
+         * @return uint16_t The corresponding raw value for the resolution set with begin()
+         */
+        uint16_t voltageToRaw(float voltage);
+
+        /**
+         * @brief Enable the window comparator of the selected channel.
+         *
+         * An alarm trips as soon as a sample leaves the [low, high] window and clears
+         * when it comes back inside the window by more than the hysteresis. A raised alarm is
+         * cleared and its bound digital output set to the inactive level.
+         *
+         * @param channel The analog input channel number
+         * @param low Low threshold in raw ADC counts
+         * @param high High threshold in raw ADC counts
+         * @param hysteresis Hysteresis in raw ADC counts applied when the alarm clears
+         */
+        void setAlarmWindow(int channel, uint16_t low, uint16_t high, uint16_t hysteresis = 0);
+
+        /**
+         * @brief Disable the window comparator of the selected channel.
+         *
+         * A raised alarm is cleared and its bound digital output set to the inactive level.
+         *
+         * @param channel The analog input channel number
+         */
+        void disableAlarm(int channel);
+
+        /**
+         * @brief Attach a callback raised on every alarm state change of the selected channel.
+         *
+         * The callback runs in the context that called processSamples() (possibly an interrupt).
+         *
+         * @param channel The analog input channel number
+         * @param callback Function receiving the channel and the new state (WINDOW_ALARM_NONE, WINDOW_ALARM_LOW or WINDOW_ALARM_HIGH)
+         */
+        void attachAlarm(int channel, void (*callback)(int channel, uint8_t state));
+
+        /**
+         * @brief Detach the alarm callback of the selected channel.
+         *
+         * @param channel The analog input channel number
+         */
+        void detachAlarm(int channel);
+
+        /**
+         * @brief Drive a digital output directly from the alarm state of the selected channel.
+         *
+         * The digital output is set to the active level while the alarm is raised and to the opposite level when it clears.
+         *
+         * @param channel The analog input channel number
+         * @param do_channel The digital output channel (0-7) to drive
+         * @param active The output level while the alarm is raised
+         */
+        void bindAlarmOutput(int channel, uint8_t do_channel, PinStatus active = HIGH);
+
+        /**
+         * @brief Stop driving a digital output from the alarm state of the selected channel.
+         *
+         * @param channel The analog input channel number
+         */
+        void unbindAlarmOutput(int channel);
+
+        /**
+         * @brief Get the alarm state, counters and timestamps of the selected channel.
+         *
+         * @param channel The analog input channel number
+         * @return WindowAlarmStatus The alarm status snapshot
+         */
+        WindowAlarmStatus getAlarmStatus(int channel);
+
+        /**
+         * @brief Reset the alarm counters and timestamps of the selected channel.
+         *
+         * @param channel The analog input channel number
+         */
+        void clearAlarmCounters(int channel);
+
+        /**
+         * @brief Arm the transient capture on the selected channel.
+         *
+         * The capture keeps a circular history of the channel and, once the trigger condition is met,
+         * freezes a record with pre_samples before and post_samples after the trigger (trigger sample included).
+         * Only one channel can be captured at a time; arming a new capture discards the previous record.
+         *
+         * @param channel The analog input channel number
+         * @param trigger Trigger flags: CAPTURE_TRIGGER_RISING and/or CAPTURE_TRIGGER_FALLING, optionally with CAPTURE_TRIGGER_SLOPE
+         * @param level Trigger level in raw ADC counts, or minimum sample-to-sample difference in slope mode
+         * @param pre_samples Number of samples to keep before the trigger
+         * @param post_samples Number of samples to keep after the trigger
+         * @return true If the capture is armed, false if the request exceeds MC_AI_CAPTURE_DEPTH or is invalid
+         */
+        bool armCapture(int channel, uint8_t trigger, uint16_t level, uint16_t pre_samples, uint16_t post_samples);
+
+        /**
+         * @brief Stop the transient capture and discard the current record.
+         */
+        void disarmCapture();
+
+        /**
+         * @brief Get the state of the transient capture.
+         *
+         * @return uint8_t CAPTURE_IDLE, CAPTURE_ARMED, CAPTURE_TRIGGERED or CAPTURE_READY
+         */
+        uint8_t getCaptureState();
+
+        /**
+         * @brief Get the description of the frozen capture record.
+         *
+         * @return CaptureInfo The record information (valid when the state is CAPTURE_READY)
+         */
+        CaptureInfo getCaptureInfo();
+
+        /**
+         * @brief Get one sample of the frozen capture record.
+         *
+         * @param index The sample position in the record (0 is the oldest pre-trigger sample)
+         * @return uint16_t The raw sample value
+         */
+        uint16_t getCaptureSample(size_t index);
+
+        /**
+         * @brief Get the size in bytes of the exported capture record.
+         *
+         * @param format CAPTURE_EXPORT_RAW or CAPTURE_EXPORT_DELTA
+         * @return size_t The number of bytes needed by exportCapture(), 0 if no record is ready
+         */
+        size_t getCaptureExportSize(uint8_t format = CAPTURE_EXPORT_DELTA);
+
+        /**
+         * @brief Serialize the frozen capture record into a compact binary buffer (for Serial or Ethernet).
+         *
+         * @param out The destination buffer
+         * @param max_len The size of the destination buffer
+         * @param format CAPTURE_EXPORT_RAW or CAPTURE_EXPORT_DELTA
+         * @return size_t The number of bytes written, 0 if no record is ready or the buffer is too small
+         */
+        size_t exportCapture(uint8_t* out, size_t max_len, uint8_t format = CAPTURE_EXPORT_DELTA);
+
     private:
         PinName _ai0;   // Analog input pin for channel 0
         PinName _ai1;   // Analog input pin for channel 1
         PinName _ai2;   // Analog input pin for channel 2
+
+        WindowComparator _alarm[MC_AI_CHANNELS];                    // Window comparator of each channel
+        void (*_alarm_cb[MC_AI_CHANNELS])(int channel, uint8_t state); // Alarm callback of each channel
+        int8_t _alarm_do[MC_AI_CHANNELS];                           // Digital output driven by each channel alarm (-1 if none)
+        PinStatus _alarm_do_active[MC_AI_CHANNELS];                 // Active level of the driven digital output
+        uint32_t _sample_index[MC_AI_CHANNELS];                     // Number of samples processed on each channel
+
+        TransientCapture _capture;                                  // Transient capture engine (one channel at a time)
+
+        uint8_t _cal_slot[MC_AI_CHANNELS];                          // Calibration slot of each channel for the current sensor type
+        uint8_t _res_shift;                                         // Shift from the read resolution to 16-bit counts
+
+        rtos::Thread* _monitor;                                     // Monitor thread, nullptr when stopped
+        mbed::Ticker _monitor_ticker;                               // Monitor sampling period
+        rtos::EventFlags _monitor_flags;                            // Set by the ticker at each period
+        volatile bool _monitoring;                                  // Monitor thread state
+        volatile uint32_t _monitor_overruns;                        // Periods started before the previous one ended
+
+        bool _sample(int channel, uint16_t* value);
+        uint16_t _calibrate(int channel, uint16_t value);
+        void _monitorTick();
+        void _monitorRun();
+        void _evaluate(int channel, const uint16_t* samples, size_t count);
+        void _writeAlarmOutput(int channel, uint8_t state);
 };
 
 extern AnalogInClass MachineControl_AnalogIn;
@@ -6,14 +6,21 @@
 
 /* Includes -----------------------------------------------------------------*/
 #include "AnalogOutClass.h"
+#include "AnalogCalibrationClass.h"
 
 /* Private defines -----------------------------------------------------------*/
-#define MCAO_MAX_VOLTAGE    10.5
+#define MCAO_WAVEFORM_TICK_US 1000
 
 /* Functions -----------------------------------------------------------------*/
 AnalogOutClass::AnalogOutClass(PinName ao0_pin, PinName ao1_pin, PinName ao2_pin, PinName ao3_pin)
-                : _ao0{mbed::PwmOut(ao0_pin)}, _ao1{mbed::PwmOut(ao1_pin)}, _ao2{mbed::PwmOut(ao2_pin)}, _ao3{mbed::PwmOut(ao3_pin)}
-{ }
+                : _ao0{ao0_pin}, _ao1{ao1_pin}, _ao2{ao2_pin}, _ao3{ao3_pin},
+                  _wave_tick_us{MCAO_WAVEFORM_TICK_US}, _wave_ticker_running{false},
+                  _update_pending{false}
+{
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        _slew_rate[ch] = 0;
+    }
+}
 
 AnalogOutClass::~AnalogOutClass() 
 { }
@@ -23,49 +30,267 @@ bool AnalogOutClass::begin() {
   setPeriod(1, 2);
   setPeriod(2, 2);
   setPeriod(3, 2);
+  alignPeriods();
 
   return true;
 }
 
 void AnalogOutClass::setPeriod(int channel, uint8_t period_ms) {
-    switch (channel) {
-        case 0:
-            _ao0.period_ms(period_ms);
-            break;
-        case 1:
-            _ao1.period_ms(period_ms);
-            break;
-        case 2:
-            _ao2.period_ms(period_ms);
-            break;
-        case 3:
-            _ao3.period_ms(period_ms);
-            break;
+    setPeriodUs(channel, (uint32_t)period_ms * 1000);
+}
+
+bool AnalogOutClass::setPeriodUs(int channel, uint32_t period_us) {
+    HighResPwmOut* pwm = _pwm(channel);
+
+    if (pwm == nullptr) {
+        return false;
+    }
+
+    return pwm->setPeriodUs(period_us);
+}
+
+uint32_t AnalogOutClass::getPeriodCounts(int channel) {
+    HighResPwmOut* pwm = _pwm(channel);
+
+    if (pwm == nullptr) {
+        return 0;
     }
+
+    return pwm->getPeriodCounts();
+}
+
+bool AnalogOutClass::setDither(int channel, bool enable) {
+    HighResPwmOut* pwm = _pwm(channel);
+
+    if (pwm == nullptr) {
+        return false;
+    }
+
+    return pwm->setDither(enable);
 }
 
 void AnalogOutClass::write(int channel, float voltage) {
+    uint16_t duty = voltageToDuty(voltage);
+
+    if (channel >= 0 && channel < MC_AO_CHANNELS) {
+        /* A direct write takes over the channel from the waveform player */
+        if (_wave[channel].isRunning()) {
+            stopWaveform(channel);
+        }
+        _wave[channel].setOutput(duty);
+    }
+
+    _writeDuty(channel, duty);
+}
+
+void AnalogOutClass::writeAll(const float voltage[MC_AO_CHANNELS]) {
+    uint16_t duty[MC_AO_CHANNELS];
+
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        duty[ch] = voltageToDuty(voltage[ch]);
+    }
+
+    writeRaw(duty);
+}
+
+void AnalogOutClass::writeRaw(const uint16_t duty[MC_AO_CHANNELS]) {
+    uint16_t calibrated[MC_AO_CHANNELS];
+    bool playing = false;
+
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        playing |= _wave[ch].isRunning();
+        _wave[ch].stop();
+        _wave[ch].setOutput(duty[ch]);
+        calibrated[ch] = MachineControl_AnalogCalibration.apply(AnalogCalibrationClass::outputSlot(ch), duty[ch]);
+    }
+    if (playing) {
+        _updateTicker();
+    }
+
+    /* Channels sharing a timer are held/released more than once, which is harmless */
+    core_util_critical_section_enter();
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        _pwm(ch)->holdUpdate();
+    }
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        _pwm(ch)->writeDuty(calibrated[ch]);
+    }
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        _pwm(ch)->releaseUpdate();
+    }
+    _update_pending = true;
+    core_util_critical_section_exit();
+}
+
+bool AnalogOutClass::isUpdatePending() {
+    if (!_update_pending) {
+        return false;
+    }
+
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        if (!_pwm(ch)->updateLatched()) {
+            return true;
+        }
+    }
+
+    _update_pending = false;
+    return false;
+}
+
+void AnalogOutClass::alignPeriods() {
+    core_util_critical_section_enter();
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        _pwm(ch)->restartPeriod();
+    }
+    core_util_critical_section_exit();
+}
+
+uint16_t AnalogOutClass::voltageToDuty(float voltage) {
     if (voltage < 0) {
         voltage = 0;
     }
 
-    if (voltage > MCAO_MAX_VOLTAGE) {
-        voltage = MCAO_MAX_VOLTAGE;
+    if (voltage > MC_AO_MAX_VOLTAGE) {
+        voltage = MC_AO_MAX_VOLTAGE;
+    }
+
+    return (uint16_t)(voltage * (65535 / MC_AO_MAX_VOLTAGE) + 0.5f);
+}
+
+void AnalogOutClass::setWaveformTick(uint32_t tick_us) {
+    if (tick_us == 0) {
+        return;
+    }
+
+    _wave_tick_us = tick_us;
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        _wave[ch].setSlewLimit(_slewStep(_slew_rate[ch]));
+    }
+
+    core_util_critical_section_enter();
+    if (_wave_ticker_running) {
+        _wave_ticker.detach();
+        _wave_ticker_running = false;
+    }
+    core_util_critical_section_exit();
+
+    _updateTicker();
+}
+
+bool AnalogOutClass::playWaveform(int channel, const uint16_t* table, size_t length, uint32_t step_us, uint8_t mode) {
+    if (channel < 0 || channel >= MC_AO_CHANNELS) {
+        return false;
+    }
+
+    uint32_t divider = (step_us + _wave_tick_us / 2) / _wave_tick_us;
+
+    core_util_critical_section_enter();
+    bool ret = _wave[channel].start(table, length, divider, mode);
+    core_util_critical_section_exit();
+
+    _updateTicker();
+
+    return ret;
+}
+
+void AnalogOutClass::stopWaveform(int channel) {
+    if (channel < 0 || channel >= MC_AO_CHANNELS) {
+        return;
+    }
+
+    _wave[channel].stop();
+    _updateTicker();
+}
+
+bool AnalogOutClass::isWaveformPlaying(int channel) {
+    if (channel < 0 || channel >= MC_AO_CHANNELS) {
+        return false;
+    }
+
+    return _wave[channel].isRunning();
+}
+
+void AnalogOutClass::setSlewRate(int channel, float volts_per_second) {
+    if (channel < 0 || channel >= MC_AO_CHANNELS) {
+        return;
     }
 
+    _slew_rate[channel] = (volts_per_second > 0) ? volts_per_second : 0;
+    _wave[channel].setSlewLimit(_slewStep(_slew_rate[channel]));
+}
+
+uint16_t AnalogOutClass::_slewStep(float volts_per_second) {
+    if (volts_per_second <= 0) {
+        return 0;
+    }
+
+    float step = volts_per_second * _wave_tick_us / 1000000.0f * (65535 / MC_AO_MAX_VOLTAGE);
+    if (step < 1) {
+        return 1;
+    }
+    if (step > 65535) {
+        return 0;
+    }
+    return (uint16_t)step;
+}
+
+void AnalogOutClass::_updateTicker() {
+    bool playing = false;
+
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        playing |= _wave[ch].isRunning();
+    }
+
+    /* _waveformTick() also stops the ticker once the last one-shot is over */
+    core_util_critical_section_enter();
+    if (playing && !_wave_ticker_running) {
+        _wave_ticker.attach(mbed::callback(this, &AnalogOutClass::_waveformTick), std::chrono::microseconds(_wave_tick_us));
+        _wave_ticker_running = true;
+    } else if (!playing && _wave_ticker_running) {
+        _wave_ticker.detach();
+        _wave_ticker_running = false;
+    }
+    core_util_critical_section_exit();
+}
+
+void AnalogOutClass::_waveformTick() {
+    bool playing = false;
+
+    for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+        if (_wave[ch].tick()) {
+            _writeDuty(ch, _wave[ch].getOutput());
+        }
+        playing |= _wave[ch].isRunning();
+    }
+
+    if (!playing) {
+        _wave_ticker.detach();
+        _wave_ticker_running = false;
+    }
+}
+
+void AnalogOutClass::_writeDuty(int channel, uint16_t duty) {
+    HighResPwmOut* pwm = _pwm(channel);
+
+    if (pwm == nullptr) {
+        return;
+    }
+
+    pwm->writeDuty(MachineControl_AnalogCalibration.apply(AnalogCalibrationClass::outputSlot(channel), duty));
+}
+
+HighResPwmOut* AnalogOutClass::_pwm(int channel) {
     switch (channel) {
         case 0:
-            _ao0.write(voltage / MCAO_MAX_VOLTAGE);
-            break;
+            return &_ao0;
         case 1:
-            _ao1.write(voltage / MCAO_MAX_VOLTAGE);
-            break;
+            return &_ao1;
         case 2:
-            _ao2.write(voltage / MCAO_MAX_VOLTAGE);
-            break;
+            return &_ao2;
         case 3:
-            _ao3.write(voltage / MCAO_MAX_VOLTAGE);
-            break;
+            return &_ao3;
+        default:
+            return nullptr;
     }
 }
 
@@ -13,6 +13,12 @@
 #include <Arduino.h>
 #include <mbed.h>
 #include "pins_mc.h"
+#include "utility/ANALOG/WaveformGenerator.h"
+#include "utility/ANALOG/HighResPwmOut.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#define MC_AO_CHANNELS  4
+#define MC_AO_MAX_VOLTAGE   10.5    // Output voltage at 100% duty cycle
 
 /* Class ----------------------------------------------------------------------*/
 
@@ -54,19 +60,172 @@ class AnalogOutClass {
          */
         void setPeriod(int channel, uint8_t period_ms);
 
+        /**
+         * @brief Set the PWM period (frequency) on the selected channel with microsecond resolution
+         *
+         * The timer runs from its full input clock, so shorter periods trade duty cycle resolution
+         * for a faster carrier (see getPeriodCounts()). Channel 2 is driven from the HRTIM by mbed
+         * and keeps its 1 us resolution.
+         * 
+         * @param channel selected channel
+         * @param period_us PWM period in us
+         * @return true If the period is supported by the timer, false otherwise
+         */
+        bool setPeriodUs(int channel, uint32_t period_us);
+
+        /**
+         * @brief Get the number of timer counts of a PWM period on the selected channel (duty cycle resolution)
+         * 
+         * @param channel selected channel
+         * @return uint32_t number of counts of a PWM period, 0 if the channel is invalid
+         */
+        uint32_t getPeriodCounts(int channel);
+
+        /**
+         * @brief Enable the sigma-delta dither of the selected channel
+         *
+         * The fractional part of the duty cycle (below one timer count) is spread over consecutive
+         * PWM periods, raising the effective resolution after the output filter. The dither runs in the
+         * update interrupt of the channel timer, once per PWM period, so very short periods cost CPU time.
+         * PwmFilterModel (utility/ANALOG/PwmFilterModel.h) estimates the ripple, settling time and effective
+         * resolution of a period and output filter.
+         * 
+         * @param channel selected channel
+         * @param enable true to enable the dither, false to disable it
+         * @return true If the dither is set, false if the channel timer has no update interrupt (channel 2)
+         */
+        bool setDither(int channel, bool enable);
+
         /**
          * @brief Set output voltage value on the selected channel
          * 
          * @param channel selected channel
-         * @param voltage desired output voltage (max 10.5V)
+         * @param voltage desired output voltage (max 10.5V), corrected by MachineControl_AnalogCalibration
          */
         void write(int channel, float voltage);
 
+        /**
+         * @brief Set the output voltage of all channels in the same PWM period
+         *
+         * The new compare values are staged on all timers and latched by the next timer update event,
+         * so that coordinated outputs change together. Waveforms playing on the channels are stopped.
+         *
+         * The channels do not share one timer: each one latches on the update event of its own timer.
+         * They change in the same PWM period only when they have the same period and their periods have
+         * been aligned with alignPeriods(), otherwise they change within one period of each other.
+         * 
+         * @param voltage desired output voltage of each channel (max 10.5V), corrected by MachineControl_AnalogCalibration
+         */
+        void writeAll(const float voltage[MC_AO_CHANNELS]);
+
+        /**
+         * @brief Set the duty cycle of all channels in the same PWM period (see writeAll())
+         * 
+         * @param duty duty cycle of each channel in 16-bit counts (65535 is 10.5V), corrected by MachineControl_AnalogCalibration
+         */
+        void writeRaw(const uint16_t duty[MC_AO_CHANNELS]);
+
+        /**
+         * @brief Check if the values of the last writeAll()/writeRaw() are still waiting for the timer update event
+         * 
+         * @return true If at least one channel has not latched the staged value yet, false once all channels are applied
+         */
+        bool isUpdatePending();
+
+        /**
+         * @brief Restart the PWM period of all channels at the same time
+         *
+         * The timers of the channels are restarted back to back with interrupts disabled, so that channels
+         * with the same period keep their update events aligned. Call it after changing the periods: the
+         * current period of each channel is cut short once.
+         */
+        void alignPeriods();
+
+        /**
+         * @brief Convert an output voltage to the duty counts used by the waveform tables
+         *
+         * @param voltage output voltage (max 10.5V)
+         * @return uint16_t duty cycle in 16-bit counts (65535 is 10.5V)
+         */
+        static uint16_t voltageToDuty(float voltage);
+
+        /**
+         * @brief Set the period of the waveform timer shared by all channels (default 1ms)
+         *
+         * @param tick_us timer period in us
+         */
+        void setWaveformTick(uint32_t tick_us);
+
+        /**
+         * @brief Play a precomputed duty cycle table on the selected channel from the waveform timer interrupt
+         *
+         * The table is not copied and must stay valid while the waveform is playing.
+         * Use WaveformGenerator::fillRamp() and WaveformGenerator::fillSine() or voltageToDuty() to build it.
+         *
+         * @param channel selected channel
+         * @param table duty cycle table in 16-bit counts
+         * @param length number of entries of the table
+         * @param step_us time between two entries in us (rounded to a multiple of the waveform tick)
+         * @param mode WAVEFORM_LOOP or WAVEFORM_ONESHOT
+         * @return true If the waveform is started, false otherwise
+         */
+        bool playWaveform(int channel, const uint16_t* table, size_t length, uint32_t step_us, uint8_t mode = WAVEFORM_LOOP);
+
+        /**
+         * @brief Stop the waveform of the selected channel, the output holds its last value
+         *
+         * @param channel selected channel
+         */
+        void stopWaveform(int channel);
+
+        /**
+         * @brief Check if a waveform is playing on the selected channel
+         *
+         * @param channel selected channel
+         * @return true If a waveform is playing (or a one-shot is still settling), false otherwise
+         */
+        bool isWaveformPlaying(int channel);
+
+        /**
+         * @brief Limit the slew rate of the waveform output of the selected channel
+         *
+         * @param channel selected channel
+         * @param volts_per_second maximum output change rate, 0 to disable the limiter
+         */
+        void setSlewRate(int channel, float volts_per_second);
+
     private:
-        mbed::PwmOut _ao0;   // PWM output for Analog Out channel 0
-        mbed::PwmOut _ao1;   // PWM output for Analog Out channel 1
-        mbed::PwmOut _ao2;   // PWM output for Analog Out channel 2
-        mbed::PwmOut _ao3;   // PWM output for Analog Out channel 3
+        HighResPwmOut _ao0;  // PWM output for Analog Out channel 0
+        HighResPwmOut _ao1;  // PWM output for Analog Out channel 1
+        HighResPwmOut _ao2;  // PWM output for Analog Out channel 2
+        HighResPwmOut _ao3;  // PWM output for Analog Out channel 3
+
+        /**
+         * @brief Get the PWM output of the selected channel
+         *
+         * @param channel selected channel
+         * @return HighResPwmOut* the PWM output, nullptr if the channel is invalid
+         */
+        HighResPwmOut* _pwm(int channel);
+
+        /**
+         * @brief Apply the channel calibration and set the PWM duty cycle
+         *
+         * @param channel selected channel
+         * @param duty duty cycle in 16-bit counts (65535 is 100%)
+         */
+        void _writeDuty(int channel, uint16_t duty);
+
+        WaveformGenerator _wave[MC_AO_CHANNELS];   // Waveform player of each channel
+        float _slew_rate[MC_AO_CHANNELS];           // Slew rate limit of each channel in V/s
+        mbed::Ticker _wave_ticker;                  // Waveform timer
+        uint32_t _wave_tick_us;                     // Waveform timer period in us
+        volatile bool _wave_ticker_running;         // Waveform timer state
+        bool _update_pending;                       // Staged values not latched by all the timers yet
+
+        void _waveformTick();
+        void _updateTicker();
+        uint16_t _slewStep(float volts_per_second);
 };
 
 extern AnalogOutClass MachineControl_AnalogOut;
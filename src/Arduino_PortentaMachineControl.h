@@ -3,6 +3,7 @@
 
 #include "AnalogInClass.h"
 #include "AnalogOutClass.h"
+#include "AnalogCalibrationClass.h"
 #include "DigitalOutputsClass.h"
 #include "ProgrammableDIOClass.h"
 #include "ProgrammableDINClass.h"
@@ -10,9 +11,14 @@
 #include "RTDTempProbeClass.h"
 #include "TCTempProbeClass.h"
 #include "RtcControllerClass.h"
+#include "TimeServiceClass.h"
+#include "SchedulerClass.h"
 #include "USBClass.h"
 #include "EncoderClass.h"
 #include "CANCommClass.h"
+#include "ControlLoopClass.h"
 #include "RS485CommClass.h"
+#include "ModbusMasterClass.h"
+#include "ModbusSlaveClass.h"
 
 #endif /* __ARDUINO_PORTENTA_MACHINE_CONTROL_H */
@@ -7,11 +7,19 @@
 /* Includes -----------------------------------------------------------------*/
 #include "CANCommClass.h"
 #include <pinDefinitions.h>
+#include <string.h>
+#include "utility/CAN/FdcanFilter.h"
 
 /* Functions -----------------------------------------------------------------*/
 CANCommClass::CANCommClass(PinName can_tx_pin, PinName can_rx_pin, PinName can_stb_pin) :
-			_can(can_rx_pin, can_tx_pin), _tx{can_tx_pin}, _rx{can_rx_pin}, _stb{can_stb_pin}
-{ }
+			_can(can_rx_pin, can_tx_pin), _tx{can_tx_pin}, _rx{can_rx_pin}, _stb{can_stb_pin},
+			_unmatched{nullptr}, _hw_filter{true}, _running{false}
+{
+	for (int i = 0; i < MC_CAN_HANDLERS; i++) {
+		_handlers[i] = nullptr;
+	}
+	resetDispatchStats();
+}
 
 CANCommClass::~CANCommClass() 
 { }
@@ -21,7 +29,13 @@ bool CANCommClass::begin(CanBitRate can_bitrate) {
 
 	_enable();
 
-	return _can.begin(can_bitrate);
+	_running = _can.begin(can_bitrate);
+	if (_running) {
+		/* The filters are only written before the traffic starts */
+		_applyFilters();
+	}
+
+	return _running;
 }
 
 int CANCommClass::write(CanMsg const & msg) {
@@ -37,11 +51,102 @@ CanMsg CANCommClass::read() {
 }
 
 void CANCommClass::end() {
+	_running = false;
 	_disable();
 
 	_can.end();
 }
 
+int CANCommClass::onReceive(uint32_t id, void (*handler)(CanMsg const & msg)) {
+	return _register(_table.addId(id), handler);
+}
+
+int CANCommClass::onReceive(uint32_t id, uint32_t mask, void (*handler)(CanMsg const & msg)) {
+	return _register(_table.addMask(id, mask), handler);
+}
+
+int CANCommClass::onReceiveRange(uint32_t first, uint32_t last, void (*handler)(CanMsg const & msg)) {
+	return _register(_table.addRange(first, last), handler);
+}
+
+void CANCommClass::onUnmatched(void (*handler)(CanMsg const & msg)) {
+	_unmatched = handler;
+}
+
+bool CANCommClass::removeHandler(int handler) {
+	if (!_table.remove(handler)) {
+		return false;
+	}
+
+	_handlers[handler] = nullptr;
+	return true;
+}
+
+void CANCommClass::setHardwareFilter(bool enable) {
+	_hw_filter = enable;
+}
+
+int CANCommClass::dispatch(int max_frames) {
+	int handled = 0;
+
+	while (handled < max_frames && _can.available()) {
+		CanMsg const msg = _can.read();
+		int rule = _table.lookup(msg.id);
+
+		if (rule >= 0 && _handlers[rule] != nullptr) {
+			_handlers[rule](msg);
+		} else {
+			_stats.unmatched++;
+			if (_unmatched != nullptr) {
+				_unmatched(msg);
+			}
+		}
+		handled++;
+	}
+
+	if (handled > 0) {
+		_stats.frames += handled;
+		_stats.batches++;
+		if ((uint32_t)handled > _stats.max_batch) {
+			_stats.max_batch = handled;
+		}
+	}
+
+	return handled;
+}
+
+CanDispatchStats CANCommClass::getDispatchStats() {
+	return _stats;
+}
+
+void CANCommClass::resetDispatchStats() {
+	int hw_filters = _stats.hw_filters;
+
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.hw_filters = _running ? hw_filters : -1;
+}
+
+int CANCommClass::_register(int rule, void (*handler)(CanMsg const & msg)) {
+	if (rule < 0) {
+		return -1;
+	}
+
+	_handlers[rule] = handler;
+	_table.compile();
+	return rule;
+}
+
+void CANCommClass::_applyFilters() {
+	// the handlers only see the frames of their identifiers unless every frame is wanted
+	if (_hw_filter && _unmatched == nullptr && (_table.count(false) + _table.count(true)) > 0) {
+		/* On failure the frames are filtered by dispatch() only */
+		_stats.hw_filters = fdcanApplyFilters(FDCAN1, &_table);
+	} else {
+		fdcanAcceptAll(FDCAN1);
+		_stats.hw_filters = -1;
+	}
+}
+
 void CANCommClass::_enable() {
 	digitalWrite(PinNameToIndex(_stb), LOW);
 }
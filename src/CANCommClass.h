@@ -15,6 +15,21 @@
 #include <mbed.h>
 #include <Arduino_CAN.h>
 #include "pins_mc.h"
+#include "utility/CAN/CanDispatchTable.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#ifndef MC_CAN_BATCH
+#define MC_CAN_BATCH            16      // Frames handled by one dispatch() by default
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t frames;        // Frames dispatched
+    uint32_t unmatched;     // Frames without a handler
+    uint32_t batches;       // Calls of dispatch() that handled at least one frame
+    uint32_t max_batch;     // Most frames handled by one call
+    int hw_filters;         // Hardware filter elements programmed by begin(), -1 if every frame is accepted
+} CanDispatchStats;
 
 /* Class ----------------------------------------------------------------------*/
 
@@ -23,6 +38,14 @@
  * @brief Class for managing the CAN Bus communication protocol of the Portenta Machine Control.
  *
  * The `CANCommClass` provides methods to work with the CAN Bus communication protocol on the Portenta Machine Control board.
+ *
+ * Handlers can be registered by identifier, identifier/mask or identifier range and called by dispatch(), which drains
+ * the received frames in batches. The identifiers are those of CanMsg::id: CanStandardId(id) or CanExtendedId(id).
+ * When handlers are registered before begin() without an unmatched handler, begin() programs the FDCAN acceptance
+ * filters so that only the frames of their identifiers are received. The filters are not changed while the bus runs:
+ * the handlers registered or removed after begin() are routed by dispatch() alone and only see the frames the filters
+ * let in, call end() and begin() again to reprogram them. The handlers are called from the thread calling dispatch(),
+ * which must also be the one registering them.
  */
 class CANCommClass {
     public:
@@ -89,11 +112,105 @@ class CANCommClass {
          */
         void end();
 
+        /**
+         * @brief Call a function for each frame with the given identifier.
+         *
+         * @param id identifier, CanStandardId(id) or CanExtendedId(id)
+         * @param handler function called by dispatch() with the frame
+         * @return int handler index, -1 if the identifier is invalid or the table is full
+         */
+        int onReceive(uint32_t id, void (*handler)(CanMsg const & msg));
+
+        /**
+         * @brief Call a function for each frame whose identifier matches id on the bits set in mask.
+         *
+         * Masks ignoring only low bits are looked up as ranges, the other ones are tried one by one after the
+         * identifiers and ranges, so they should stay few.
+         *
+         * @param id identifier, CanStandardId(id) or CanExtendedId(id)
+         * @param mask bits of the identifier that must match
+         * @param handler function called by dispatch() with the frame
+         * @return int handler index, -1 if the identifier is invalid or the table is full
+         */
+        int onReceive(uint32_t id, uint32_t mask, void (*handler)(CanMsg const & msg));
+
+        /**
+         * @brief Call a function for each frame with an identifier between first and last (included).
+         *
+         * @param first first identifier, CanStandardId(id) or CanExtendedId(id)
+         * @param last last identifier, of the same format
+         * @param handler function called by dispatch() with the frame
+         * @return int handler index, -1 if the range is invalid or the table is full
+         */
+        int onReceiveRange(uint32_t first, uint32_t last, void (*handler)(CanMsg const & msg));
+
+        /**
+         * @brief Call a function for the frames without a handler, the acceptance filters then let every frame in.
+         *
+         * The acceptance filters are opened by the next begin().
+         *
+         * @param handler function called by dispatch() with the frame, nullptr to drop these frames
+         */
+        void onUnmatched(void (*handler)(CanMsg const & msg));
+
+        /**
+         * @brief Remove a handler.
+         *
+         * @param handler handler index returned at registration
+         * @return true If the handler is removed, false otherwise
+         */
+        bool removeHandler(int handler);
+
+        /**
+         * @brief Enable the FDCAN acceptance filters derived from the handlers (enabled by default).
+         *
+         * The setting is applied by the next begin().
+         *
+         * @param enable true to filter in hardware, false to accept every frame
+         */
+        void setHardwareFilter(bool enable);
+
+        /**
+         * @brief Read the received frames and call their handlers.
+         *
+         * An identifier is looked up by binary search: an exact identifier wins, then the ranges and the masks
+         * match in the order they were registered.
+         *
+         * @param max_frames largest number of frames handled by this call
+         * @return int number of frames handled
+         */
+        int dispatch(int max_frames = MC_CAN_BATCH);
+
+        /**
+         * @brief Get the dispatch statistics.
+         *
+         * @return CanDispatchStats dispatch counters since the last reset
+         */
+        CanDispatchStats getDispatchStats();
+
+        /**
+         * @brief Reset the dispatch statistics.
+         */
+        void resetDispatchStats();
+
     private:
         Arduino_CAN _can;
         PinName _tx;
         PinName _rx;
         PinName _stb;
+        CanDispatchTable _table;
+        void (*_handlers[MC_CAN_HANDLERS])(CanMsg const & msg);
+        void (*_unmatched)(CanMsg const & msg);
+        bool _hw_filter;
+        bool _running;
+        CanDispatchStats _stats;
+
+        int _register(int rule, void (*handler)(CanMsg const & msg));
+
+        /**
+         * @brief Program the acceptance filters from the handlers, before the traffic starts.
+         */
+        void _applyFilters();
 
         /**
          * @brief Set the CAN transceiver in Normal mode.
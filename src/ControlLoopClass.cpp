@@ -0,0 +1,570 @@
+/**
+ * @file ControlLoopClass.cpp
+ * @brief Source file for the control loop module of the Portenta Machine Control library.
+ */
+
+/* Includes -----------------------------------------------------------------*/
+#include "ControlLoopClass.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define MC_CL_STACK_SIZE    2048
+#define MC_CL_DEFAULT_MS    100
+
+/* Functions -----------------------------------------------------------------*/
+ControlLoopClass::ControlLoopClass()
+                : _thread{nullptr}, _tick_ms{10}, _running{false}
+{
+    for (int i = 0; i < MC_CL_LOOPS; i++) {
+        ControlLoop& loop = _loop[i];
+
+        loop.source = CL_SOURCE_NONE;
+        loop.output = CL_OUTPUT_NONE;
+        loop.source_channel = -1;
+        loop.output_channel = -1;
+        loop.tc_type = PROBE_TC_K;
+        loop.enabled = false;
+        loop.do_state = false;
+        loop.scale = 1.0f;
+        loop.offset = 0.0f;
+        loop.source_cb = nullptr;
+        loop.output_cb = nullptr;
+        loop.last_pulses = 0;
+        loop.period_ms = MC_CL_DEFAULT_MS;
+        loop.window_ms = 0;
+        loop.next_ms = 0;
+        loop.last_ms = 0;
+        loop.window_start_ms = 0;
+        loop.measurement = NAN;
+        loop.total_us = 0;
+        memset(&loop.stats, 0, sizeof(loop.stats));
+    }
+}
+
+ControlLoopClass::~ControlLoopClass()
+{
+    end();
+}
+
+bool ControlLoopClass::begin(uint32_t tick_ms) {
+    if (_running || tick_ms == 0) {
+        return false;
+    }
+
+    _tick_ms = tick_ms;
+    _thread = new rtos::Thread(osPriorityAboveNormal, MC_CL_STACK_SIZE, nullptr, "ControlLoop");
+    if (_thread == nullptr) {
+        return false;
+    }
+
+    _running = true;
+    if (_thread->start(mbed::callback(this, &ControlLoopClass::_run)) != osOK) {
+        _running = false;
+        delete _thread;
+        _thread = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ControlLoopClass::end() {
+    if (_thread == nullptr) {
+        return;
+    }
+
+    _running = false;
+    _thread->join();
+    delete _thread;
+    _thread = nullptr;
+}
+
+bool ControlLoopClass::setPeriod(int loop, uint32_t period_ms) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || period_ms == 0) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->period_ms = period_ms;
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindAnalogIn(int loop, int channel, float scale, float offset) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || channel < 0 || channel >= MC_AI_CHANNELS) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->source = CL_SOURCE_AI;
+    l->source_channel = channel;
+    l->scale = scale;
+    l->offset = offset;
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindThermocouple(int loop, int channel, uint8_t type) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || channel < 0 || channel > 2) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->source = CL_SOURCE_TC;
+    l->source_channel = channel;
+    l->tc_type = type;
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindRTD(int loop, int channel, float rtd_nominal, float ref_resistor) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || channel < 0 || channel > 2) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->source = CL_SOURCE_RTD;
+    l->source_channel = channel;
+    l->scale = rtd_nominal;
+    l->offset = ref_resistor;
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindEncoderVelocity(int loop, int channel) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || channel < 0 || channel > 1) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->source = CL_SOURCE_ENCODER;
+    l->source_channel = channel;
+    l->last_pulses = MachineControl_Encoders.getPulses(channel);
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindSource(int loop, float (*source)(void)) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || source == nullptr) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->source = CL_SOURCE_CUSTOM;
+    l->source_cb = source;
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindAnalogOut(int loop, int channel) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || channel < 0 || channel >= MC_AO_CHANNELS) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->output = CL_OUTPUT_AO;
+    l->output_channel = channel;
+    l->pid.setOutputLimits(0, MC_AO_MAX_VOLTAGE);
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindDigitalOut(int loop, int channel, uint32_t window_ms) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || channel < 0 || channel > 7 || window_ms == 0) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->output = CL_OUTPUT_DO;
+    l->output_channel = channel;
+    l->window_ms = window_ms;
+    l->window_start_ms = millis();
+    l->do_state = false;
+    l->pid.setOutputLimits(0, 100);
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ControlLoopClass::bindOutput(int loop, void (*output)(float value)) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || output == nullptr) {
+        return false;
+    }
+
+    _mutex.lock();
+    l->output = CL_OUTPUT_CUSTOM;
+    l->output_cb = output;
+    _mutex.unlock();
+
+    return true;
+}
+
+void ControlLoopClass::setTunings(int loop, float kp, float ki, float kd) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setTunings(kp, ki, kd);
+    _mutex.unlock();
+}
+
+void ControlLoopClass::setDerivativeFilter(int loop, float tau_s) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setDerivativeFilter(tau_s);
+    _mutex.unlock();
+}
+
+void ControlLoopClass::setOutputLimits(int loop, float min, float max) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setOutputLimits(min, max);
+    _mutex.unlock();
+}
+
+void ControlLoopClass::setDirection(int loop, uint8_t direction) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setDirection(direction);
+    _mutex.unlock();
+}
+
+void ControlLoopClass::setSetpoint(int loop, float setpoint) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setSetpoint(setpoint);
+    _mutex.unlock();
+}
+
+void ControlLoopClass::setManual(int loop, float output) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setManual(output);
+    _mutex.unlock();
+}
+
+void ControlLoopClass::setAutomatic(int loop) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->pid.setAutomatic(isnan(l->measurement) ? l->pid.getSetpoint() : l->measurement);
+    _mutex.unlock();
+}
+
+bool ControlLoopClass::enable(int loop) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || l->source == CL_SOURCE_NONE || l->output == CL_OUTPUT_NONE) {
+        return false;
+    }
+
+    _mutex.lock();
+    if (!l->enabled) {
+        uint32_t now_ms = millis();
+
+        l->pid.reset();
+        /* The first step runs one period after the seeded timestamp, never with dt = 0 */
+        l->next_ms = now_ms + l->period_ms;
+        l->last_ms = now_ms;
+        l->window_start_ms = now_ms;
+        if (l->source == CL_SOURCE_ENCODER) {
+            l->last_pulses = MachineControl_Encoders.getPulses(l->source_channel);
+        }
+        l->enabled = true;
+    }
+    _mutex.unlock();
+
+    return true;
+}
+
+void ControlLoopClass::disable(int loop) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    l->enabled = false;
+    if (l->output == CL_OUTPUT_DO) {
+        MachineControl_DigitalOutputs.write(l->output_channel, LOW);
+        l->do_state = false;
+    }
+    _mutex.unlock();
+}
+
+float ControlLoopClass::getMeasurement(int loop) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return NAN;
+    }
+
+    return l->measurement;
+}
+
+float ControlLoopClass::getOutput(int loop) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return 0;
+    }
+
+    return l->pid.getOutput();
+}
+
+bool ControlLoopClass::getStats(int loop, ControlLoopStats* stats) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr || stats == nullptr) {
+        return false;
+    }
+
+    _mutex.lock();
+    *stats = l->stats;
+    _mutex.unlock();
+
+    return true;
+}
+
+void ControlLoopClass::resetStats(int loop) {
+    ControlLoop* l = _get(loop);
+
+    if (l == nullptr) {
+        return;
+    }
+
+    _mutex.lock();
+    memset(&l->stats, 0, sizeof(l->stats));
+    l->total_us = 0;
+    _mutex.unlock();
+}
+
+void ControlLoopClass::_run() {
+    auto next = rtos::Kernel::Clock::now();
+
+    while (_running) {
+        uint32_t now_ms = millis();
+
+        for (int i = 0; i < MC_CL_LOOPS; i++) {
+            _step(_loop[i], now_ms);
+        }
+
+        /* Absolute wake-up times keep the rate fixed regardless of the execution time */
+        next += std::chrono::milliseconds(_tick_ms);
+        rtos::ThisThread::sleep_until(next);
+    }
+}
+
+void ControlLoopClass::_step(ControlLoop& loop, uint32_t now_ms) {
+    ControlSource source;
+    bool due;
+
+    _mutex.lock();
+    due = loop.enabled && (int32_t)(now_ms - loop.next_ms) >= 0;
+    if (due) {
+        source.type = loop.source;
+        source.channel = loop.source_channel;
+        source.tc_type = loop.tc_type;
+        source.scale = loop.scale;
+        source.offset = loop.offset;
+        source.cb = loop.source_cb;
+    }
+    _mutex.unlock();
+
+    if (due) {
+        uint32_t start_us = micros();
+
+        /* The sensors are read without the lock, the sketch is not blocked by the bus transfers */
+        float measurement = _read(source);
+
+        _mutex.lock();
+        /* Drop the measurement if the loop was disabled or rebound during the read */
+        if (loop.enabled && loop.source == source.type && loop.source_channel == source.channel) {
+            _update(loop, measurement, now_ms, start_us);
+        }
+        _mutex.unlock();
+    }
+
+    _mutex.lock();
+    if (loop.enabled && loop.output == CL_OUTPUT_DO) {
+        _timeProportion(loop, now_ms);
+    }
+    _mutex.unlock();
+}
+
+void ControlLoopClass::_update(ControlLoop& loop, float measurement, uint32_t now_ms, uint32_t start_us) {
+    float dt_s = (now_ms - loop.last_ms) / 1000.0f;
+
+    loop.last_ms = now_ms;
+
+    /* Keep the schedule on the period grid, skip the missed deadlines */
+    loop.next_ms += loop.period_ms;
+    if ((int32_t)(now_ms - loop.next_ms) >= 0) {
+        loop.stats.overruns++;
+        loop.next_ms = now_ms + loop.period_ms;
+    }
+
+    if (loop.source == CL_SOURCE_ENCODER) {
+        /* The counter is a register read, the velocity needs the interval under the lock */
+        int32_t pulses = MachineControl_Encoders.getPulses(loop.source_channel);
+        int32_t delta = pulses - loop.last_pulses;
+
+        if (dt_s > 0) {
+            loop.last_pulses = pulses;
+            measurement = delta / dt_s;
+        } else {
+            measurement = loop.measurement;
+        }
+    }
+    loop.measurement = measurement;
+
+    if (dt_s <= 0) {
+        /* No interval for the derivative and integral terms, hold the output */
+    } else if (isnan(measurement)) {
+        /* Hold the output on an invalid measurement */
+        loop.stats.faults++;
+    } else {
+        _write(loop, loop.pid.update(measurement, dt_s));
+    }
+
+    uint32_t elapsed_us = micros() - start_us;
+
+    loop.stats.runs++;
+    loop.stats.last_us = elapsed_us;
+    if (elapsed_us > loop.stats.max_us) {
+        loop.stats.max_us = elapsed_us;
+    }
+    loop.total_us += elapsed_us;
+    loop.stats.avg_us = (uint32_t)(loop.total_us / loop.stats.runs);
+}
+
+float ControlLoopClass::_read(const ControlSource& source) {
+    float value;
+
+    switch (source.type) {
+        case CL_SOURCE_AI:
+            /* peek() does not feed the window comparators and the captures of the sketch */
+            return MachineControl_AnalogIn.peek(source.channel) * source.scale + source.offset;
+        case CL_SOURCE_TC:
+            TempProbeClass::lock();
+            MachineControl_TCTempProbe.selectChannel(source.channel);
+            value = MachineControl_TCTempProbe.readTemperature(source.tc_type);
+            TempProbeClass::unlock();
+            return value;
+        case CL_SOURCE_RTD:
+            TempProbeClass::lock();
+            MachineControl_RTDTempProbe.selectChannel(source.channel);
+            value = MachineControl_RTDTempProbe.readTemperature(source.scale, source.offset);
+            TempProbeClass::unlock();
+            return value;
+        case CL_SOURCE_ENCODER:
+            /* Read by _update() */
+            return 0;
+        case CL_SOURCE_CUSTOM:
+            return source.cb();
+        default:
+            return NAN;
+    }
+}
+
+void ControlLoopClass::_write(ControlLoop& loop, float output) {
+    switch (loop.output) {
+        case CL_OUTPUT_AO:
+            MachineControl_AnalogOut.write(loop.output_channel, output);
+            break;
+        case CL_OUTPUT_CUSTOM:
+            loop.output_cb(output);
+            break;
+        default:
+            /* CL_OUTPUT_DO is driven by _timeProportion() on every tick */
+            break;
+    }
+}
+
+void ControlLoopClass::_timeProportion(ControlLoop& loop, uint32_t now_ms) {
+    uint32_t elapsed_ms = now_ms - loop.window_start_ms;
+
+    if (elapsed_ms >= loop.window_ms) {
+        loop.window_start_ms += (elapsed_ms / loop.window_ms) * loop.window_ms;
+        elapsed_ms = now_ms - loop.window_start_ms;
+    }
+
+    /* The duty cycle spans the output limits, whatever they are set to */
+    float min = loop.pid.getOutputMin();
+    float max = loop.pid.getOutputMax();
+    float duty = (loop.pid.getOutput() - min) / (max - min);
+    uint32_t on_ms = (uint32_t)(duty * loop.window_ms + 0.5f);
+    bool state = elapsed_ms < on_ms;
+
+    if (state != loop.do_state) {
+        MachineControl_DigitalOutputs.write(loop.output_channel, state ? HIGH : LOW);
+        loop.do_state = state;
+    }
+}
+
+ControlLoopClass::ControlLoop* ControlLoopClass::_get(int loop) {
+    if (loop < 0 || loop >= MC_CL_LOOPS) {
+        return nullptr;
+    }
+    return &_loop[loop];
+}
+
+ControlLoopClass MachineControl_ControlLoop;
+/**** END OF FILE ****/
@@ -0,0 +1,336 @@
+/**
+ * @file ControlLoopClass.h
+ * @brief Header file for the control loop module of the Portenta Machine Control library.
+ *
+ * This library runs PID control loops at fixed rates on a dedicated RTOS thread, reading their
+ * measurement from the analog inputs, the temperature probes or the encoders and driving the
+ * analog outputs or time-proportioned digital outputs.
+ */
+
+#ifndef __CONTROL_LOOP_CLASS_H
+#define __CONTROL_LOOP_CLASS_H
+
+/* Includes -------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <mbed.h>
+#include "AnalogInClass.h"
+#include "AnalogOutClass.h"
+#include "DigitalOutputsClass.h"
+#include "TCTempProbeClass.h"
+#include "RTDTempProbeClass.h"
+#include "EncoderClass.h"
+#include "utility/CONTROL/PidController.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#ifndef MC_CL_LOOPS
+#define MC_CL_LOOPS             8
+#endif
+
+#define CL_SOURCE_NONE          0
+#define CL_SOURCE_AI            1
+#define CL_SOURCE_TC            2
+#define CL_SOURCE_RTD           3
+#define CL_SOURCE_ENCODER       4
+#define CL_SOURCE_CUSTOM        5
+
+#define CL_OUTPUT_NONE          0
+#define CL_OUTPUT_AO            1
+#define CL_OUTPUT_DO            2
+#define CL_OUTPUT_CUSTOM        3
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t runs;          // Number of executions
+    uint32_t overruns;      // Number of deadlines missed by more than one period
+    uint32_t faults;        // Number of executions skipped because of an invalid measurement
+    uint32_t last_us;       // Execution time of the last run (read, compute, write) in us
+    uint32_t max_us;        // Longest execution time in us
+    uint32_t avg_us;        // Average execution time in us
+} ControlLoopStats;
+
+/* Class ----------------------------------------------------------------------*/
+
+/**
+ * @class ControlLoopClass
+ * @brief Class for the PID control loops of the Portenta Machine Control.
+ *
+ * Each loop binds one measurement source to one output through a PidController. The loops are
+ * executed by a single thread waking up every tick, each loop at its own period (a multiple of the tick).
+ * The bound peripherals must be initialized by the sketch. The sensors are read without holding the loop lock;
+ * a sketch reading the temperature probes while the loops are running must hold TempProbeClass::lock()
+ * around selectChannel() and the read, since the channel selection is shared.
+ */
+class ControlLoopClass {
+    public:
+        /**
+         * @brief Construct the control loop module with all the loops unbound.
+         */
+        ControlLoopClass();
+
+        /**
+         * @brief Destruct the ControlLoopClass object, stopping the control thread.
+         */
+        ~ControlLoopClass();
+
+        /**
+         * @brief Start the control thread.
+         *
+         * @param tick_ms period of the control thread in ms (resolution of the loop periods and of the time-proportioned outputs)
+         * @return true If the thread is started, false otherwise
+         */
+        bool begin(uint32_t tick_ms = 10);
+
+        /**
+         * @brief Stop the control thread, the outputs hold their last value.
+         */
+        void end();
+
+        /**
+         * @brief Set the execution period of a loop.
+         *
+         * @param loop loop index (0 to MC_CL_LOOPS - 1)
+         * @param period_ms loop period in ms (rounded up to a multiple of the tick)
+         * @return true If the period is set, false otherwise
+         */
+        bool setPeriod(int loop, uint32_t period_ms);
+
+        /**
+         * @brief Use an analog input as measurement of a loop.
+         *
+         * measurement = raw * scale + offset, raw as returned by MachineControl_AnalogIn.peek()
+         *
+         * @param loop loop index
+         * @param channel analog input channel
+         * @param scale scale from raw counts to engineering units
+         * @param offset offset in engineering units
+         * @return true If the source is bound, false otherwise
+         */
+        bool bindAnalogIn(int loop, int channel, float scale = 1.0f, float offset = 0.0f);
+
+        /**
+         * @brief Use a thermocouple as measurement of a loop (°C).
+         *
+         * @param loop loop index
+         * @param channel thermocouple channel
+         * @param type type of the thermocouple
+         * @return true If the source is bound, false otherwise
+         */
+        bool bindThermocouple(int loop, int channel, uint8_t type = PROBE_TC_K);
+
+        /**
+         * @brief Use a RTD as measurement of a loop (°C).
+         *
+         * @param loop loop index
+         * @param channel RTD channel
+         * @param rtd_nominal nominal resistance of the RTD at 0 °C
+         * @param ref_resistor value of the reference resistor
+         * @return true If the source is bound, false otherwise
+         */
+        bool bindRTD(int loop, int channel, float rtd_nominal, float ref_resistor);
+
+        /**
+         * @brief Use the velocity of an encoder as measurement of a loop (pulses/s).
+         *
+         * @param loop loop index
+         * @param channel encoder channel
+         * @return true If the source is bound, false otherwise
+         */
+        bool bindEncoderVelocity(int loop, int channel);
+
+        /**
+         * @brief Use a user function as measurement of a loop.
+         *
+         * @param loop loop index
+         * @param source function returning the measurement, NAN if invalid (called from the control thread)
+         * @return true If the source is bound, false otherwise
+         */
+        bool bindSource(int loop, float (*source)(void));
+
+        /**
+         * @brief Drive an analog output with a loop, the output limits are set to 0-10.5V.
+         *
+         * @param loop loop index
+         * @param channel analog output channel
+         * @return true If the output is bound, false otherwise
+         */
+        bool bindAnalogOut(int loop, int channel);
+
+        /**
+         * @brief Drive a digital output with a loop through time-proportioning, the output limits are set to 0-100%.
+         *
+         * The output is on for (output - min) / (max - min) of each window, so the limits can be changed
+         * with setOutputLimits().
+         *
+         * @param loop loop index
+         * @param channel digital output channel
+         * @param window_ms length of the time-proportioning window in ms
+         * @return true If the output is bound, false otherwise
+         */
+        bool bindDigitalOut(int loop, int channel, uint32_t window_ms);
+
+        /**
+         * @brief Drive a user function with a loop.
+         *
+         * @param loop loop index
+         * @param output function receiving the output (called from the control thread)
+         * @return true If the output is bound, false otherwise
+         */
+        bool bindOutput(int loop, void (*output)(float value));
+
+        /**
+         * @brief Set the PID gains of a loop, the change is bumpless.
+         *
+         * @param loop loop index
+         * @param kp proportional gain
+         * @param ki integral gain (1/s)
+         * @param kd derivative gain (s)
+         */
+        void setTunings(int loop, float kp, float ki, float kd);
+
+        /**
+         * @brief Set the time constant of the derivative low-pass filter of a loop.
+         *
+         * @param loop loop index
+         * @param tau_s time constant in s, 0 to disable the filter
+         */
+        void setDerivativeFilter(int loop, float tau_s);
+
+        /**
+         * @brief Set the output limits of a loop (also used by the anti-windup).
+         *
+         * @param loop loop index
+         * @param min minimum output
+         * @param max maximum output
+         */
+        void setOutputLimits(int loop, float min, float max);
+
+        /**
+         * @brief Set the action of a loop.
+         *
+         * @param loop loop index
+         * @param direction PID_DIRECT (e.g. heating) or PID_REVERSE (e.g. cooling)
+         */
+        void setDirection(int loop, uint8_t direction);
+
+        /**
+         * @brief Set the setpoint of a loop.
+         *
+         * @param loop loop index
+         * @param setpoint setpoint in the units of the measurement
+         */
+        void setSetpoint(int loop, float setpoint);
+
+        /**
+         * @brief Switch a loop to manual mode with the given output.
+         *
+         * @param loop loop index
+         * @param output output applied while in manual mode
+         */
+        void setManual(int loop, float output);
+
+        /**
+         * @brief Switch a loop back to automatic mode without bumping the output.
+         *
+         * @param loop loop index
+         */
+        void setAutomatic(int loop);
+
+        /**
+         * @brief Start executing a loop.
+         *
+         * @param loop loop index
+         * @return true If the loop has a source and an output bound, false otherwise
+         */
+        bool enable(int loop);
+
+        /**
+         * @brief Stop executing a loop. Analog outputs hold their value, digital outputs are switched off.
+         *
+         * @param loop loop index
+         */
+        void disable(int loop);
+
+        /**
+         * @brief Get the last measurement of a loop.
+         *
+         * @param loop loop index
+         * @return float last measurement, NAN if none
+         */
+        float getMeasurement(int loop);
+
+        /**
+         * @brief Get the current output of a loop.
+         *
+         * @param loop loop index
+         * @return float current output
+         */
+        float getOutput(int loop);
+
+        /**
+         * @brief Get the execution statistics of a loop.
+         *
+         * @param loop loop index
+         * @param stats statistics of the loop
+         * @return true If the statistics are valid, false otherwise
+         */
+        bool getStats(int loop, ControlLoopStats* stats);
+
+        /**
+         * @brief Reset the execution statistics of a loop.
+         *
+         * @param loop loop index
+         */
+        void resetStats(int loop);
+
+    private:
+        typedef struct {
+            PidController pid;
+            uint8_t source;
+            uint8_t output;
+            int8_t source_channel;
+            int8_t output_channel;
+            uint8_t tc_type;
+            bool enabled;
+            bool do_state;
+            float scale;                // AI scale or RTD nominal resistance
+            float offset;               // AI offset or RTD reference resistor
+            float (*source_cb)(void);
+            void (*output_cb)(float value);
+            int32_t last_pulses;
+            uint32_t period_ms;
+            uint32_t window_ms;
+            uint32_t next_ms;
+            uint32_t last_ms;
+            uint32_t window_start_ms;
+            float measurement;
+            uint64_t total_us;
+            ControlLoopStats stats;
+        } ControlLoop;
+
+        typedef struct {
+            uint8_t type;
+            int8_t channel;
+            uint8_t tc_type;
+            float scale;
+            float offset;
+            float (*cb)(void);
+        } ControlSource;                  // Copy of the source of a loop, read without the lock
+
+        ControlLoop _loop[MC_CL_LOOPS];   // Control loops
+        rtos::Mutex _mutex;               // Protects the loops between the sketch and the control thread
+        rtos::Thread* _thread;            // Control thread
+        uint32_t _tick_ms;                // Control thread period in ms
+        volatile bool _running;           // Control thread state
+
+        void _run();
+        void _step(ControlLoop& loop, uint32_t now_ms);
+        void _update(ControlLoop& loop, float measurement, uint32_t now_ms, uint32_t start_us);
+        float _read(const ControlSource& source);
+        void _write(ControlLoop& loop, float output);
+        void _timeProportion(ControlLoop& loop, uint32_t now_ms);
+        ControlLoop* _get(int loop);
+};
+
+extern ControlLoopClass MachineControl_ControlLoop;
+
+#endif /* __CONTROL_LOOP_CLASS_H */
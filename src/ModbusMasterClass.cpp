@@ -0,0 +1,215 @@
+/**
+ * @file ModbusMasterClass.cpp
+ * @brief Source file for the Modbus RTU master of the Portenta Machine Control library.
+ */
+
+/* Includes -----------------------------------------------------------------*/
+#include "ModbusMasterClass.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define MC_MB_STACK_SIZE        2048
+#define MC_MB_FLAG_SUBMIT       0x01
+#define MC_MB_FLAG_STOP         0x02
+
+/* Functions -----------------------------------------------------------------*/
+ModbusMasterClass::ModbusMasterClass(RS485CommClass& rs485)
+                : _rs485{rs485}, _port{&ModbusMasterClass::_read, &ModbusMasterClass::_write, &rs485}, _thread{nullptr}, _running{false}
+{ }
+
+ModbusMasterClass::~ModbusMasterClass()
+{
+    end();
+}
+
+bool ModbusMasterClass::begin(unsigned long baudrate, uint16_t config) {
+    if (_running) {
+        return false;
+    }
+
+    if (!_rs485.beginDMA(baudrate, config)) {
+        _rs485.end();
+        return false;
+    }
+
+    _mutex.lock();
+    _master.begin(&_port, baudrate);
+    _master.resetStats();
+    _mutex.unlock();
+
+    _thread = new rtos::Thread(osPriorityAboveNormal, MC_MB_STACK_SIZE, nullptr, "ModbusMaster");
+    if (_thread == nullptr) {
+        return false;
+    }
+
+    _running = true;
+    if (_thread->start(mbed::callback(this, &ModbusMasterClass::_run)) != osOK) {
+        _running = false;
+        delete _thread;
+        _thread = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ModbusMasterClass::end() {
+    if (_thread == nullptr) {
+        return;
+    }
+
+    _running = false;
+    _thread->flags_set(MC_MB_FLAG_STOP);
+    _thread->join();
+    delete _thread;
+    _thread = nullptr;
+
+    _mutex.lock();
+    _master.abort();
+    _mutex.unlock();
+
+    _rs485.end();
+}
+
+bool ModbusMasterClass::submit(ModbusRequest* request) {
+    if (!_running) {
+        if (request != nullptr) {
+            request->result = MODBUS_RESULT_BUSY;
+        }
+        return false;
+    }
+
+    _mutex.lock();
+    bool queued = _master.submit(request);
+    _mutex.unlock();
+
+    if (queued) {
+        _thread->flags_set(MC_MB_FLAG_SUBMIT);
+    }
+    return queued;
+}
+
+uint8_t ModbusMasterClass::readCoils(uint8_t slave, uint16_t address, uint16_t quantity, uint8_t* coils) {
+    ModbusRequest request = {slave, MODBUS_FC_READ_COILS, address, quantity, nullptr, coils};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::readDiscreteInputs(uint8_t slave, uint16_t address, uint16_t quantity, uint8_t* inputs) {
+    ModbusRequest request = {slave, MODBUS_FC_READ_DISCRETE_INPUTS, address, quantity, nullptr, inputs};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::readHoldingRegisters(uint8_t slave, uint16_t address, uint16_t quantity, uint16_t* registers) {
+    ModbusRequest request = {slave, MODBUS_FC_READ_HOLDING_REGISTERS, address, quantity, registers, nullptr};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::readInputRegisters(uint8_t slave, uint16_t address, uint16_t quantity, uint16_t* registers) {
+    ModbusRequest request = {slave, MODBUS_FC_READ_INPUT_REGISTERS, address, quantity, registers, nullptr};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::writeSingleCoil(uint8_t slave, uint16_t address, bool value) {
+    uint8_t coil = value ? 1 : 0;
+    ModbusRequest request = {slave, MODBUS_FC_WRITE_SINGLE_COIL, address, 1, nullptr, &coil};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::writeSingleRegister(uint8_t slave, uint16_t address, uint16_t value) {
+    ModbusRequest request = {slave, MODBUS_FC_WRITE_SINGLE_REGISTER, address, 1, &value, nullptr};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::writeMultipleCoils(uint8_t slave, uint16_t address, uint16_t quantity, const uint8_t* coils) {
+    /* The engine only reads the buffer of a write request */
+    ModbusRequest request = {slave, MODBUS_FC_WRITE_MULTIPLE_COILS, address, quantity, nullptr, const_cast<uint8_t*>(coils)};
+    return _transact(&request);
+}
+
+uint8_t ModbusMasterClass::writeMultipleRegisters(uint8_t slave, uint16_t address, uint16_t quantity, const uint16_t* registers) {
+    ModbusRequest request = {slave, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, address, quantity, const_cast<uint16_t*>(registers), nullptr};
+    return _transact(&request);
+}
+
+void ModbusMasterClass::setDefaultPolicy(uint16_t timeout_ms, uint8_t retries) {
+    _mutex.lock();
+    _master.setDefaultPolicy(timeout_ms, retries);
+    _mutex.unlock();
+}
+
+bool ModbusMasterClass::setSlavePolicy(uint8_t slave, uint16_t timeout_ms, uint8_t retries) {
+    _mutex.lock();
+    bool set = _master.setSlavePolicy(slave, timeout_ms, retries);
+    _mutex.unlock();
+
+    return set;
+}
+
+ModbusMasterStats ModbusMasterClass::getStats() {
+    _mutex.lock();
+    ModbusMasterStats stats = _master.getStats();
+    _mutex.unlock();
+
+    return stats;
+}
+
+void ModbusMasterClass::resetStats() {
+    _mutex.lock();
+    _master.resetStats();
+    _mutex.unlock();
+}
+
+void ModbusMasterClass::_run() {
+    while (_running) {
+        uint32_t now = (uint32_t)ticker_read_us(get_us_ticker_data());
+
+        _mutex.lock();
+        bool busy = _master.poll(now);
+        bool receiving = _master.isReceiving();
+        uint32_t delay_us = _master.pollDelayUs(now);
+        _mutex.unlock();
+
+        if (!busy) {
+            /* Nothing queued: sleep until the next submit() */
+            rtos::ThisThread::flags_wait_any(MC_MB_FLAG_SUBMIT | MC_MB_FLAG_STOP);
+            continue;
+        }
+
+        uint32_t delay_ms = (delay_us + 999) / 1000;
+        if (receiving) {
+            /* Sleep until the next frame or the end of the response timeout */
+            _rs485.waitFrame(delay_ms);
+        } else if (delay_ms > 0) {
+            /* Inter-frame silence before the next request */
+            rtos::ThisThread::sleep_for(std::chrono::milliseconds(delay_ms));
+        }
+    }
+}
+
+uint8_t ModbusMasterClass::_transact(ModbusRequest* request) {
+    rtos::Semaphore done(0);
+
+    request->callback = _onComplete;
+    request->user = &done;
+    if (!submit(request)) {
+        return request->result;
+    }
+
+    done.acquire();
+    return request->result;
+}
+
+void ModbusMasterClass::_onComplete(ModbusRequest* request) {
+    static_cast<rtos::Semaphore*>(request->user)->release();
+}
+
+bool ModbusMasterClass::_read(void* context, SerialFrame* frame) {
+    return static_cast<RS485CommClass*>(context)->readFrame(frame, 0);
+}
+
+bool ModbusMasterClass::_write(void* context, const uint8_t* frame, size_t len) {
+    /* The frame is the request buffer of the engine, unchanged until the next request */
+    return static_cast<RS485CommClass*>(context)->writeFrame(frame, len);
+}
+
+ModbusMasterClass MachineControl_ModbusMaster(MachineControl_RS485Comm);
+/**** END OF FILE ****/
@@ -0,0 +1,207 @@
+/**
+ * @file ModbusMasterClass.h
+ * @brief Header file for the Modbus RTU master of the Portenta Machine Control library.
+ *
+ * This library polls Modbus RTU slaves on the RS485 port from a dedicated RTOS thread, with
+ * queued requests, per-slave timeouts and retries, and response statistics.
+ */
+
+#ifndef __MODBUS_MASTER_CLASS_H
+#define __MODBUS_MASTER_CLASS_H
+
+/* Includes -------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <mbed.h>
+#include "RS485CommClass.h"
+#include "utility/MODBUS/ModbusMaster.h"
+#include "utility/MODBUS/ModbusFramePort.h"
+
+/* Class ----------------------------------------------------------------------*/
+
+/**
+ * @class ModbusMasterClass
+ * @brief Class for the Modbus RTU master of the Portenta Machine Control.
+ *
+ * Requests are queued (up to MC_MB_QUEUE) and sent one after the other by the master thread, each
+ * frame leaving t3.5 after the end of the previous transaction, so many slaves can be polled without
+ * the sketch waiting on each of them. submit() returns immediately and calls the request callback
+ * from the master thread; the read/write methods wait for the result.
+ * The master owns MachineControl_RS485Comm while it is running, in frame mode (half duplex): the master
+ * thread sleeps until a response frame is received or a timeout expires, and the silences inside the
+ * responses are checked against t1.5 with the timestamps of the receiver.
+ */
+class ModbusMasterClass {
+    public:
+        /**
+         * @brief Construct the Modbus master on a RS485 port.
+         *
+         * @param rs485 RS485 port of the bus
+         */
+        ModbusMasterClass(RS485CommClass& rs485);
+
+        /**
+         * @brief Destruct the ModbusMasterClass object, stopping the master thread.
+         */
+        ~ModbusMasterClass();
+
+        /**
+         * @brief Initialize the RS485 port and start the master thread.
+         *
+         * @param baudrate baud rate of the bus
+         * @param config frame format, SERIAL_8E1 by default as required by Modbus RTU (SERIAL_8N2 without parity)
+         * @return true If the thread is started, false otherwise
+         */
+        bool begin(unsigned long baudrate = 19200, uint16_t config = SERIAL_8E1);
+
+        /**
+         * @brief Stop the master thread and release the RS485 port, pending requests complete with MODBUS_RESULT_BUSY.
+         */
+        void end();
+
+        /**
+         * @brief Queue a request without waiting for its result.
+         *
+         * The request must stay valid until its result is not MODBUS_RESULT_PENDING anymore; the callback,
+         * if any, is called from the master thread once the request is complete.
+         *
+         * @param request request to send
+         * @return true If the request is queued, false otherwise (result set to MODBUS_RESULT_INVALID or MODBUS_RESULT_BUSY)
+         */
+        bool submit(ModbusRequest* request);
+
+        /**
+         * @brief Read coils (function 0x01).
+         *
+         * @param slave slave address
+         * @param address first coil
+         * @param quantity number of coils (1 to 2000)
+         * @param coils destination, packed bits (LSB first)
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t readCoils(uint8_t slave, uint16_t address, uint16_t quantity, uint8_t* coils);
+
+        /**
+         * @brief Read discrete inputs (function 0x02).
+         *
+         * @param slave slave address
+         * @param address first input
+         * @param quantity number of inputs (1 to 2000)
+         * @param inputs destination, packed bits (LSB first)
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t readDiscreteInputs(uint8_t slave, uint16_t address, uint16_t quantity, uint8_t* inputs);
+
+        /**
+         * @brief Read holding registers (function 0x03).
+         *
+         * @param slave slave address
+         * @param address first register
+         * @param quantity number of registers (1 to 125)
+         * @param registers destination
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t readHoldingRegisters(uint8_t slave, uint16_t address, uint16_t quantity, uint16_t* registers);
+
+        /**
+         * @brief Read input registers (function 0x04).
+         *
+         * @param slave slave address
+         * @param address first register
+         * @param quantity number of registers (1 to 125)
+         * @param registers destination
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t readInputRegisters(uint8_t slave, uint16_t address, uint16_t quantity, uint16_t* registers);
+
+        /**
+         * @brief Write a single coil (function 0x05).
+         *
+         * @param slave slave address, MODBUS_BROADCAST for all the slaves
+         * @param address coil
+         * @param value coil state
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t writeSingleCoil(uint8_t slave, uint16_t address, bool value);
+
+        /**
+         * @brief Write a single register (function 0x06).
+         *
+         * @param slave slave address, MODBUS_BROADCAST for all the slaves
+         * @param address register
+         * @param value register value
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t writeSingleRegister(uint8_t slave, uint16_t address, uint16_t value);
+
+        /**
+         * @brief Write multiple coils (function 0x0F).
+         *
+         * @param slave slave address, MODBUS_BROADCAST for all the slaves
+         * @param address first coil
+         * @param quantity number of coils (1 to 1968)
+         * @param coils source, packed bits (LSB first)
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t writeMultipleCoils(uint8_t slave, uint16_t address, uint16_t quantity, const uint8_t* coils);
+
+        /**
+         * @brief Write multiple registers (function 0x10).
+         *
+         * @param slave slave address, MODBUS_BROADCAST for all the slaves
+         * @param address first register
+         * @param quantity number of registers (1 to 123)
+         * @param registers source
+         * @return uint8_t MODBUS_RESULT_x
+         */
+        uint8_t writeMultipleRegisters(uint8_t slave, uint16_t address, uint16_t quantity, const uint16_t* registers);
+
+        /**
+         * @brief Set the response timeout and the retries of the slaves without their own policy.
+         *
+         * @param timeout_ms response timeout in ms, from the end of the request
+         * @param retries number of retransmissions after a timeout or an invalid response
+         */
+        void setDefaultPolicy(uint16_t timeout_ms, uint8_t retries);
+
+        /**
+         * @brief Set the response timeout and the retries of a slave.
+         *
+         * @param slave slave address
+         * @param timeout_ms response timeout in ms, from the end of the request
+         * @param retries number of retransmissions after a timeout or an invalid response
+         * @return true If the policy is set, false if MC_MB_POLICIES slaves already have one
+         */
+        bool setSlavePolicy(uint8_t slave, uint16_t timeout_ms, uint8_t retries);
+
+        /**
+         * @brief Get the statistics of the master.
+         *
+         * The response time histogram counts the responses in bins of powers of 2 ms: <1, <2, <4 ... <64, >=64 ms.
+         *
+         * @return ModbusMasterStats statistics since begin() or resetStats()
+         */
+        ModbusMasterStats getStats();
+
+        /**
+         * @brief Reset the statistics of the master.
+         */
+        void resetStats();
+
+    private:
+        RS485CommClass& _rs485;           // RS485 port of the bus
+        ModbusFramePort _port;            // Byte transport of the engine on the frame mode of the port
+        ModbusMaster _master;             // Request queue and RTU state machine
+        rtos::Mutex _mutex;               // Protects the engine between the sketch and the master thread
+        rtos::Thread* _thread;            // Master thread
+        volatile bool _running;           // Master thread state
+
+        void _run();
+        uint8_t _transact(ModbusRequest* request);
+        static void _onComplete(ModbusRequest* request);
+        static bool _read(void* context, SerialFrame* frame);
+        static bool _write(void* context, const uint8_t* frame, size_t len);
+};
+
+extern ModbusMasterClass MachineControl_ModbusMaster;
+
+#endif /* __MODBUS_MASTER_CLASS_H */
@@ -0,0 +1,561 @@
+/**
+ * @file ModbusSlaveClass.cpp
+ * @brief Source file for the Modbus slave of the Portenta Machine Control library.
+ */
+
+/* Includes -----------------------------------------------------------------*/
+#include "ModbusSlaveClass.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define MC_MBS_STACK_SIZE       2048
+#define MC_MBS_FLAG_WRITE       0x01
+#define MC_MBS_FLAG_STOP        0x02
+#define MC_MBS_POLL_MS          1       // Polling interval of the service thread
+#define MC_MBS_TEMP_PERIOD_MS   250     // Interval between two temperature reads (one channel each)
+
+#define MC_MBS_PENDING_DO       0x01
+#define MC_MBS_PENDING_DIO      0x02
+#define MC_MBS_PENDING_AO       0x10    // Shifted by the analog output channel
+
+#define MC_MBS_COILS            20
+#define MC_MBS_INPUTS           20
+#define MC_MBS_REGS             (MODBUS_USER_REGISTER + MC_MBS_USER_REGS)
+#define MC_MBS_AO_MAX_MV        10500
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t MC_MBS_DIN_PIN[8] = {
+    DIN_READ_CH_PIN_00, DIN_READ_CH_PIN_01, DIN_READ_CH_PIN_02, DIN_READ_CH_PIN_03,
+    DIN_READ_CH_PIN_04, DIN_READ_CH_PIN_05, DIN_READ_CH_PIN_06, DIN_READ_CH_PIN_07
+};
+
+static const uint8_t MC_MBS_DIO_IN_PIN[12] = {
+    IO_READ_CH_PIN_00, IO_READ_CH_PIN_01, IO_READ_CH_PIN_02, IO_READ_CH_PIN_03,
+    IO_READ_CH_PIN_04, IO_READ_CH_PIN_05, IO_READ_CH_PIN_06, IO_READ_CH_PIN_07,
+    IO_READ_CH_PIN_08, IO_READ_CH_PIN_09, IO_READ_CH_PIN_10, IO_READ_CH_PIN_11
+};
+
+static const uint8_t MC_MBS_DIO_OUT_PIN[12] = {
+    IO_WRITE_CH_PIN_00, IO_WRITE_CH_PIN_01, IO_WRITE_CH_PIN_02, IO_WRITE_CH_PIN_03,
+    IO_WRITE_CH_PIN_04, IO_WRITE_CH_PIN_05, IO_WRITE_CH_PIN_06, IO_WRITE_CH_PIN_07,
+    IO_WRITE_CH_PIN_08, IO_WRITE_CH_PIN_09, IO_WRITE_CH_PIN_10, IO_WRITE_CH_PIN_11
+};
+
+/* Private functions ---------------------------------------------------------*/
+static inline bool getBit(const uint8_t* bits, int bit) {
+    return (bits[bit / 8] >> (bit % 8)) & 0x01;
+}
+
+static inline void setBit(uint8_t* bits, int bit, bool value) {
+    if (value) {
+        bits[bit / 8] |= 1 << (bit % 8);
+    } else {
+        bits[bit / 8] &= ~(1 << (bit % 8));
+    }
+}
+
+/* Functions -----------------------------------------------------------------*/
+ModbusSlaveClass::ModbusSlaveClass(RS485CommClass& rs485)
+                : _rs485{rs485}, _port{rs485}, _temp_channel{0}, _temp_last_ms{0}, _server{nullptr},
+                  _service_thread{nullptr}, _refresh_thread{nullptr}, _groups{MODBUS_GROUP_ALL}, _refresh_ms{10},
+                  _pending{0}, _rtu_enabled{false}, _tcp_enabled{false}, _running{false}
+{
+    memset(_coils, 0, sizeof(_coils));
+    memset(_inputs, 0, sizeof(_inputs));
+    memset(_input_regs, 0, sizeof(_input_regs));
+    memset(_holding_regs, 0, sizeof(_holding_regs));
+
+    _map.coils = _coils;
+    _map.num_coils = MC_MBS_COILS;
+    _map.discrete_inputs = _inputs;
+    _map.num_discrete_inputs = MC_MBS_INPUTS;
+    _map.input_registers = _input_regs;
+    _map.num_input_registers = MC_MBS_REGS;
+    _map.holding_registers = _holding_regs;
+    _map.num_holding_registers = MC_MBS_REGS;
+
+    for (int i = 0; i < 3; i++) {
+        _temp[i].probe = PROBE_NONE;
+        _temp_value[i] = MODBUS_TEMP_INVALID;
+        _input_regs[MODBUS_IR_TEMP + i] = MODBUS_TEMP_INVALID;
+    }
+    for (int i = 0; i < MC_MBS_TCP_CLIENTS; i++) {
+        _conn[i].rx_len = 0;
+    }
+
+    _rtu.setWriteCallback(_onWrite, this);
+    _tcp.setWriteCallback(_onWrite, this);
+}
+
+ModbusSlaveClass::~ModbusSlaveClass()
+{
+    end();
+}
+
+bool ModbusSlaveClass::beginRTU(uint8_t slave_id, unsigned long baudrate, uint16_t config) {
+    if (_rtu_enabled || slave_id == MODBUS_BROADCAST || slave_id > 247) {
+        return false;
+    }
+
+    _rs485.begin(baudrate, config, RS485_AUTO_DELAY, RS485_AUTO_DELAY);
+    _rs485.receive();
+
+    _mutex.lock();
+    _rtu.begin(slave_id, &_map, &_port, baudrate);
+    _rtu.resetStats();
+    _mutex.unlock();
+
+    _rtu_enabled = true;
+    return _start();
+}
+
+bool ModbusSlaveClass::beginTCP(uint16_t port, uint8_t unit_id) {
+    if (_tcp_enabled) {
+        return false;
+    }
+
+    if (_server == nullptr) {
+        _server = new EthernetServer(port);
+        if (_server == nullptr) {
+            return false;
+        }
+        _server->begin();
+    }
+
+    _mutex.lock();
+    _tcp.begin(unit_id, &_map);
+    _tcp.resetStats();
+    _mutex.unlock();
+
+    _tcp_enabled = true;
+    return _start();
+}
+
+void ModbusSlaveClass::end() {
+    if (_running) {
+        _running = false;
+        _refresh_thread->flags_set(MC_MBS_FLAG_STOP);
+        _service_thread->join();
+        _refresh_thread->join();
+        delete _service_thread;
+        delete _refresh_thread;
+        _service_thread = nullptr;
+        _refresh_thread = nullptr;
+    }
+
+    if (_tcp_enabled) {
+        for (int i = 0; i < MC_MBS_TCP_CLIENTS; i++) {
+            if (_conn[i].client) {
+                _conn[i].client.stop();
+            }
+            _conn[i].rx_len = 0;
+        }
+        _tcp_enabled = false;
+    }
+
+    if (_rtu_enabled) {
+        _rs485.noReceive();
+        _rs485.end();
+        _rtu_enabled = false;
+    }
+}
+
+void ModbusSlaveClass::setGroups(uint8_t groups) {
+    _mutex.lock();
+    _groups = groups & MODBUS_GROUP_ALL;
+    _mutex.unlock();
+}
+
+void ModbusSlaveClass::setRefreshPeriod(uint32_t period_ms) {
+    _refresh_ms = (period_ms == 0) ? 1 : period_ms;
+}
+
+bool ModbusSlaveClass::mapThermocouple(int channel, uint8_t type) {
+    if (channel < 0 || channel > 2) {
+        return false;
+    }
+
+    _mutex.lock();
+    _temp[channel].probe = PROBE_TC_K;
+    _temp[channel].tc_type = type;
+    _mutex.unlock();
+
+    return true;
+}
+
+bool ModbusSlaveClass::mapRTD(int channel, float rtd_nominal, float ref_resistor) {
+    if (channel < 0 || channel > 2) {
+        return false;
+    }
+
+    _mutex.lock();
+    _temp[channel].probe = PROBE_RTD_3W;
+    _temp[channel].rtd_nominal = rtd_nominal;
+    _temp[channel].ref_resistor = ref_resistor;
+    _mutex.unlock();
+
+    return true;
+}
+
+void ModbusSlaveClass::unmapTemperature(int channel) {
+    if (channel < 0 || channel > 2) {
+        return;
+    }
+
+    _mutex.lock();
+    _temp[channel].probe = PROBE_NONE;
+    _input_regs[MODBUS_IR_TEMP + channel] = MODBUS_TEMP_INVALID;
+    _mutex.unlock();
+}
+
+bool ModbusSlaveClass::setInputRegister(uint16_t address, uint16_t value) {
+    if (address < MODBUS_USER_REGISTER || address >= MC_MBS_REGS) {
+        return false;
+    }
+
+    _mutex.lock();
+    _input_regs[address] = value;
+    _mutex.unlock();
+
+    return true;
+}
+
+uint16_t ModbusSlaveClass::getHoldingRegister(uint16_t address) {
+    if (address >= MC_MBS_REGS) {
+        return 0;
+    }
+
+    _mutex.lock();
+    uint16_t value = _holding_regs[address];
+    _mutex.unlock();
+
+    return value;
+}
+
+ModbusSlaveStats ModbusSlaveClass::getRTUStats() {
+    _mutex.lock();
+    ModbusSlaveStats stats = _rtu.getStats();
+    _mutex.unlock();
+
+    return stats;
+}
+
+ModbusSlaveStats ModbusSlaveClass::getTCPStats() {
+    _mutex.lock();
+    ModbusSlaveStats stats = _tcp.getStats();
+    _mutex.unlock();
+
+    return stats;
+}
+
+void ModbusSlaveClass::resetStats() {
+    _mutex.lock();
+    _rtu.resetStats();
+    _tcp.resetStats();
+    _mutex.unlock();
+}
+
+bool ModbusSlaveClass::_start() {
+    if (_running) {
+        return true;
+    }
+
+    _service_thread = new rtos::Thread(osPriorityAboveNormal, MC_MBS_STACK_SIZE, nullptr, "ModbusSlave");
+    _refresh_thread = new rtos::Thread(osPriorityNormal, MC_MBS_STACK_SIZE, nullptr, "ModbusRefresh");
+    if (_service_thread == nullptr || _refresh_thread == nullptr) {
+        delete _service_thread;
+        delete _refresh_thread;
+        _service_thread = nullptr;
+        _refresh_thread = nullptr;
+        return false;
+    }
+
+    _running = true;
+    if (_refresh_thread->start(mbed::callback(this, &ModbusSlaveClass::_refresh)) != osOK) {
+        _running = false;
+        delete _service_thread;
+        delete _refresh_thread;
+        _service_thread = nullptr;
+        _refresh_thread = nullptr;
+        return false;
+    }
+    if (_service_thread->start(mbed::callback(this, &ModbusSlaveClass::_service)) != osOK) {
+        _running = false;
+        _refresh_thread->flags_set(MC_MBS_FLAG_STOP);
+        _refresh_thread->join();
+        delete _service_thread;
+        delete _refresh_thread;
+        _service_thread = nullptr;
+        _refresh_thread = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ModbusSlaveClass::_service() {
+    while (_running) {
+        if (_rtu_enabled) {
+            uint32_t start = _now();
+
+            _mutex.lock();
+            size_t len = _rtu.pollRtu(start, _rtu_tx);
+            _mutex.unlock();
+
+            /* The snapshot is not locked while the response is on the bus */
+            if (len > 0) {
+                _port.send(_rtu_tx, len);
+                uint32_t latency = _now() - start;
+
+                _mutex.lock();
+                _rtu.recordLatency(latency);
+                _mutex.unlock();
+            }
+        }
+
+        if (_tcp_enabled) {
+            _serveTcp();
+        }
+
+        rtos::ThisThread::sleep_for(std::chrono::milliseconds(MC_MBS_POLL_MS));
+    }
+}
+
+void ModbusSlaveClass::_serveTcp() {
+    EthernetClient client = _server->available();
+
+    if (client) {
+        int slot = -1;
+        for (int i = 0; i < MC_MBS_TCP_CLIENTS; i++) {
+            if (!_conn[i].client || !_conn[i].client.connected()) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) {
+            client.stop();
+        } else {
+            if (_conn[slot].client) {
+                _conn[slot].client.stop();
+            }
+            _conn[slot].client = client;
+            _conn[slot].rx_len = 0;
+        }
+    }
+
+    for (int i = 0; i < MC_MBS_TCP_CLIENTS; i++) {
+        TcpConnection& conn = _conn[i];
+
+        if (!conn.client) {
+            continue;
+        }
+        if (!conn.client.connected()) {
+            conn.client.stop();
+            conn.rx_len = 0;
+            continue;
+        }
+
+        int available = conn.client.available();
+        if (available > 0) {
+            size_t room = sizeof(conn.rx) - conn.rx_len;
+            int n = conn.client.read(&conn.rx[conn.rx_len], ((size_t)available < room) ? available : room);
+            if (n > 0) {
+                conn.rx_len += n;
+            }
+        }
+
+        /* Requests may be pipelined or split across segments */
+        for (;;) {
+            uint32_t start = _now();
+            _mutex.lock();
+            int out = _tcp.pollTcp(conn.rx, &conn.rx_len, _tcp_tx);
+            _mutex.unlock();
+
+            if (out < 0) {
+                conn.client.stop();
+                break;
+            }
+            if (out == 0) {
+                break;
+            }
+
+            conn.client.write(_tcp_tx, out);
+            uint32_t latency = _now() - start;
+
+            _mutex.lock();
+            _tcp.recordLatency(latency);
+            _mutex.unlock();
+        }
+    }
+}
+
+void ModbusSlaveClass::_refresh() {
+    bool first = true;
+
+    while (_running) {
+        _applyOutputs();
+        _readInputs(first);
+        first = false;
+
+        rtos::ThisThread::flags_wait_any_for(MC_MBS_FLAG_WRITE | MC_MBS_FLAG_STOP, std::chrono::milliseconds(_refresh_ms));
+    }
+}
+
+void ModbusSlaveClass::_applyOutputs() {
+    uint8_t coils[sizeof(_coils)];
+    uint16_t ao[MC_AO_CHANNELS];
+
+    _mutex.lock();
+    uint8_t pending = _pending;
+    uint8_t groups = _groups;
+    _pending = 0;
+    memcpy(coils, _coils, sizeof(coils));
+    memcpy(ao, &_holding_regs[MODBUS_HR_AO], sizeof(ao));
+    _mutex.unlock();
+
+    if ((pending & MC_MBS_PENDING_DO) && (groups & MODBUS_GROUP_DO)) {
+        MachineControl_DigitalOutputs.writeAll(coils[0]);
+    }
+
+    if ((pending & MC_MBS_PENDING_DIO) && (groups & MODBUS_GROUP_DIO)) {
+        uint32_t banks = 0;
+        for (int ch = 0; ch < 12; ch++) {
+            if (getBit(coils, MODBUS_COIL_DIO + ch)) {
+                banks |= 1UL << MC_MBS_DIO_OUT_PIN[ch];
+            }
+        }
+        MachineControl_DigitalProgrammables.writeAll(banks);
+    }
+
+    if (groups & MODBUS_GROUP_AO) {
+        for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+            if (pending & (MC_MBS_PENDING_AO << ch)) {
+                uint16_t mv = (ao[ch] > MC_MBS_AO_MAX_MV) ? MC_MBS_AO_MAX_MV : ao[ch];
+                MachineControl_AnalogOut.write(ch, mv / 1000.0f);
+            }
+        }
+    }
+}
+
+void ModbusSlaveClass::_readInputs(bool first) {
+    uint8_t inputs[sizeof(_inputs)] = {0};
+    uint16_t regs[MODBUS_IR_TEMP] = {0};
+
+    /* The peripherals are read without holding the lock, one I2C burst per expander */
+    _mutex.lock();
+    uint8_t groups = _groups;
+    _mutex.unlock();
+
+    if (groups & MODBUS_GROUP_DIN) {
+        uint32_t all = MachineControl_DigitalInputs.readAll();
+        for (int ch = 0; ch < 8; ch++) {
+            setBit(inputs, MODBUS_DI_DIN + ch, (all >> MC_MBS_DIN_PIN[ch]) & 0x01);
+        }
+    }
+
+    if (groups & MODBUS_GROUP_DIO) {
+        uint32_t all = MachineControl_DigitalProgrammables.readAll();
+        for (int ch = 0; ch < 12; ch++) {
+            setBit(inputs, MODBUS_DI_DIO + ch, (all >> MC_MBS_DIO_IN_PIN[ch]) & 0x01);
+        }
+    }
+
+    if (groups & MODBUS_GROUP_AI) {
+        /* peek() does not feed the window comparators and the captures of the sketch */
+        for (int ch = 0; ch < 3; ch++) {
+            regs[MODBUS_IR_AI + ch] = MachineControl_AnalogIn.peek(ch);
+        }
+    }
+
+    if (groups & MODBUS_GROUP_ENCODERS) {
+        for (int ch = 0; ch < 2; ch++) {
+            uint32_t pulses = (uint32_t)MachineControl_Encoders.getPulses(ch);
+            regs[MODBUS_IR_ENC_PULSES + 2 * ch] = pulses >> 16;
+            regs[MODBUS_IR_ENC_PULSES + 2 * ch + 1] = pulses & 0xFFFF;
+            regs[MODBUS_IR_ENC_REVS + ch] = (uint16_t)MachineControl_Encoders.getRevolutions(ch);
+        }
+    }
+
+    /* One temperature channel per period: a conversion takes tens of ms */
+    if (millis() - _temp_last_ms >= MC_MBS_TEMP_PERIOD_MS) {
+        _temp_last_ms = millis();
+        _temp_value[_temp_channel] = _readTemperature(_temp_channel);
+        _temp_channel = (_temp_channel + 1) % 3;
+    }
+
+    _mutex.lock();
+    memcpy(_inputs, inputs, sizeof(_inputs));
+    memcpy(_input_regs, regs, sizeof(regs));
+    for (int ch = 0; ch < 3; ch++) {
+        _input_regs[MODBUS_IR_TEMP + ch] = (_temp[ch].probe == PROBE_NONE) ? MODBUS_TEMP_INVALID : _temp_value[ch];
+    }
+    if (first) {
+        /* The programmable IO outputs start from their current state */
+        for (int ch = 0; ch < 12; ch++) {
+            setBit(_coils, MODBUS_COIL_DIO + ch, getBit(inputs, MODBUS_DI_DIO + ch));
+        }
+    }
+    _mutex.unlock();
+}
+
+uint16_t ModbusSlaveClass::_readTemperature(int channel) {
+    _mutex.lock();
+    TempMap map = _temp[channel];
+    _mutex.unlock();
+
+    float temperature;
+    switch (map.probe) {
+        case PROBE_TC_K:
+            TempProbeClass::lock();
+            MachineControl_TCTempProbe.selectChannel(channel);
+            temperature = MachineControl_TCTempProbe.readTemperature(map.tc_type);
+            TempProbeClass::unlock();
+            break;
+        case PROBE_RTD_3W:
+            TempProbeClass::lock();
+            MachineControl_RTDTempProbe.selectChannel(channel);
+            temperature = MachineControl_RTDTempProbe.readTemperature(map.rtd_nominal, map.ref_resistor);
+            TempProbeClass::unlock();
+            break;
+        default:
+            return MODBUS_TEMP_INVALID;
+    }
+
+    if (isnan(temperature) || temperature <= -3276.7f || temperature >= 3276.7f) {
+        return MODBUS_TEMP_INVALID;
+    }
+    return (uint16_t)(int16_t)lroundf(temperature * 10.0f);
+}
+
+uint32_t ModbusSlaveClass::_now() {
+    return (uint32_t)ticker_read_us(get_us_ticker_data());
+}
+
+void ModbusSlaveClass::_onWrite(void* context, uint8_t table, uint16_t address, uint16_t quantity) {
+    ModbusSlaveClass* slave = static_cast<ModbusSlaveClass*>(context);
+    uint32_t end = (uint32_t)address + quantity;
+    uint8_t pending = 0;
+
+    /* Called from the service thread with the lock held */
+    if (table == MODBUS_TABLE_COILS) {
+        if (address < MODBUS_COIL_DIO) {
+            pending |= MC_MBS_PENDING_DO;
+        }
+        if (end > MODBUS_COIL_DIO) {
+            pending |= MC_MBS_PENDING_DIO;
+        }
+    } else if (table == MODBUS_TABLE_HOLDING_REGISTERS) {
+        for (int ch = 0; ch < MC_AO_CHANNELS; ch++) {
+            if (MODBUS_HR_AO + ch >= address && (uint32_t)(MODBUS_HR_AO + ch) < end) {
+                pending |= MC_MBS_PENDING_AO << ch;
+            }
+        }
+    }
+
+    if (pending) {
+        slave->_pending |= pending;
+        slave->_refresh_thread->flags_set(MC_MBS_FLAG_WRITE);
+    }
+}
+
+ModbusSlaveClass MachineControl_ModbusSlave(MachineControl_RS485Comm);
+/**** END OF FILE ****/
@@ -0,0 +1,257 @@
+/**
+ * @file ModbusSlaveClass.h
+ * @brief Header file for the Modbus slave of the Portenta Machine Control library.
+ *
+ * This library exposes the inputs and outputs of the Portenta Machine Control to a Modbus master,
+ * over RTU on the RS485 port and over TCP on the Ethernet port, from a snapshot refreshed by a
+ * dedicated RTOS thread.
+ */
+
+#ifndef __MODBUS_SLAVE_CLASS_H
+#define __MODBUS_SLAVE_CLASS_H
+
+/* Includes -------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <mbed.h>
+#include <PortentaEthernet.h>
+#include <Ethernet.h>
+#include "RS485CommClass.h"
+#include "DigitalOutputsClass.h"
+#include "ProgrammableDINClass.h"
+#include "ProgrammableDIOClass.h"
+#include "AnalogInClass.h"
+#include "AnalogOutClass.h"
+#include "EncoderClass.h"
+#include "TCTempProbeClass.h"
+#include "RTDTempProbeClass.h"
+#include "utility/MODBUS/ModbusSlave.h"
+#include "utility/MODBUS/ModbusRS485Port.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#ifndef MC_MBS_USER_REGS
+#define MC_MBS_USER_REGS        16
+#endif
+#ifndef MC_MBS_TCP_CLIENTS
+#define MC_MBS_TCP_CLIENTS      2
+#endif
+
+// Coils
+#define MODBUS_COIL_DO          0       // 8 coils: digital outputs 0-7
+#define MODBUS_COIL_DIO         8       // 12 coils: programmable digital IO outputs 0-11
+// Discrete inputs
+#define MODBUS_DI_DIN           0       // 8 inputs: digital inputs 0-7
+#define MODBUS_DI_DIO           8       // 12 inputs: programmable digital IO 0-11
+// Input registers
+#define MODBUS_IR_AI            0       // 3 registers: analog inputs 0-2, raw value
+#define MODBUS_IR_ENC_PULSES    3       // 2 x 2 registers: encoder 0-1 pulses, int32 high word first
+#define MODBUS_IR_ENC_REVS      7       // 2 registers: encoder 0-1 revolutions, int16
+#define MODBUS_IR_TEMP          9       // 3 registers: temperature channel 0-2 in 0.1 °C, int16
+// Holding registers
+#define MODBUS_HR_AO            0       // 4 registers: analog outputs 0-3 in mV (0-10500)
+// Input and holding registers set and read by the sketch
+#define MODBUS_USER_REGISTER    32      // MC_MBS_USER_REGS registers
+
+#define MODBUS_TEMP_INVALID     0x8000  // Temperature not mapped or not readable
+
+#define MODBUS_GROUP_DO         0x01
+#define MODBUS_GROUP_DIN        0x02
+#define MODBUS_GROUP_DIO        0x04
+#define MODBUS_GROUP_AI         0x08
+#define MODBUS_GROUP_AO         0x10
+#define MODBUS_GROUP_ENCODERS   0x20
+#define MODBUS_GROUP_ALL        0x3F
+
+/* Class ----------------------------------------------------------------------*/
+
+/**
+ * @class ModbusSlaveClass
+ * @brief Class for the Modbus slave of the Portenta Machine Control.
+ *
+ * A refresh thread reads the inputs into a snapshot every refresh period and applies the coils and holding
+ * registers written by the masters to the outputs, so the requests are answered from memory and never wait for
+ * the I2C or SPI peripherals: the latency is bounded by the 1 ms polling of the service thread plus the copy of
+ * the requested values. The latency of every response is measured, see getRTUStats() and getTCPStats().
+ *
+ * The peripherals of the selected groups must be initialized by the sketch. The slave owns the outputs of the
+ * groups it serves: a write from a master sets all the outputs of the group from the snapshot, the digital outputs
+ * start off and the programmable IO outputs start from their state read back when the slave starts.
+ * The temperature channels are read one at a time under TempProbeClass::lock(), a sketch reading the probes while
+ * the slave is running must hold the lock around the channel selection and the read. The analog inputs are read with
+ * peek() and do not feed the alarms and the transient capture of the sketch.
+ */
+class ModbusSlaveClass {
+    public:
+        /**
+         * @brief Construct the Modbus slave on a RS485 port.
+         *
+         * @param rs485 RS485 port used by the RTU slave
+         */
+        ModbusSlaveClass(RS485CommClass& rs485);
+
+        /**
+         * @brief Destruct the ModbusSlaveClass object, stopping the slave threads.
+         */
+        ~ModbusSlaveClass();
+
+        /**
+         * @brief Initialize the RS485 port and serve the RTU requests.
+         *
+         * @param slave_id slave address (1 to 247)
+         * @param baudrate baud rate of the bus
+         * @param config frame format, SERIAL_8E1 by default as required by Modbus RTU (SERIAL_8N2 without parity)
+         * @return true If the slave is started, false otherwise
+         */
+        bool beginRTU(uint8_t slave_id, unsigned long baudrate = 19200, uint16_t config = SERIAL_8E1);
+
+        /**
+         * @brief Serve the TCP requests, Ethernet must be initialized by the sketch.
+         *
+         * @param port TCP port, fixed by the first call
+         * @param unit_id unit identifier answered besides 0 and 255
+         * @return true If the slave is started, false otherwise
+         */
+        bool beginTCP(uint16_t port = MODBUS_TCP_PORT, uint8_t unit_id = 1);
+
+        /**
+         * @brief Stop serving the requests and refreshing the snapshot, the outputs hold their value.
+         */
+        void end();
+
+        /**
+         * @brief Select the groups of inputs and outputs mapped to the registers.
+         *
+         * The registers of the other groups read 0 and their writes are not applied.
+         *
+         * @param groups MODBUS_GROUP_x mask, MODBUS_GROUP_ALL by default
+         */
+        void setGroups(uint8_t groups);
+
+        /**
+         * @brief Set the refresh period of the snapshot.
+         *
+         * @param period_ms refresh period in ms
+         */
+        void setRefreshPeriod(uint32_t period_ms);
+
+        /**
+         * @brief Map a thermocouple to the temperature register of a channel.
+         *
+         * @param channel temperature channel (0 to 2)
+         * @param type type of the thermocouple
+         * @return true If the channel is mapped, false otherwise
+         */
+        bool mapThermocouple(int channel, uint8_t type = PROBE_TC_K);
+
+        /**
+         * @brief Map a RTD to the temperature register of a channel.
+         *
+         * @param channel temperature channel (0 to 2)
+         * @param rtd_nominal nominal resistance of the RTD at 0 °C
+         * @param ref_resistor value of the reference resistor
+         * @return true If the channel is mapped, false otherwise
+         */
+        bool mapRTD(int channel, float rtd_nominal, float ref_resistor);
+
+        /**
+         * @brief Stop reading the temperature of a channel, its register reads MODBUS_TEMP_INVALID.
+         *
+         * @param channel temperature channel (0 to 2)
+         */
+        void unmapTemperature(int channel);
+
+        /**
+         * @brief Set a user input register.
+         *
+         * @param address register address (MODBUS_USER_REGISTER to MODBUS_USER_REGISTER + MC_MBS_USER_REGS - 1)
+         * @param value register value
+         * @return true If the register is set, false otherwise
+         */
+        bool setInputRegister(uint16_t address, uint16_t value);
+
+        /**
+         * @brief Get a holding register, as last written by a master.
+         *
+         * @param address register address
+         * @return uint16_t register value, 0 if the address is not mapped
+         */
+        uint16_t getHoldingRegister(uint16_t address);
+
+        /**
+         * @brief Get the statistics of the RTU slave.
+         *
+         * The latency runs from the detection of the complete request to the end of the response transmission, the
+         * histogram counts the responses in bins of powers of 2 from 128 us: <128, <256 ... <8192, >=8192 us.
+         *
+         * @return ModbusSlaveStats statistics since beginRTU() or resetStats()
+         */
+        ModbusSlaveStats getRTUStats();
+
+        /**
+         * @brief Get the statistics of the TCP slave.
+         *
+         * The latency runs from the reception of the complete request to the response handed to the network stack.
+         *
+         * @return ModbusSlaveStats statistics since beginTCP() or resetStats()
+         */
+        ModbusSlaveStats getTCPStats();
+
+        /**
+         * @brief Reset the statistics of the RTU and TCP slaves.
+         */
+        void resetStats();
+
+    private:
+        typedef struct {
+            uint8_t probe;          // PROBE_NONE, PROBE_TC_K (any thermocouple) or PROBE_RTD_3W (any RTD)
+            uint8_t tc_type;
+            float rtd_nominal;
+            float ref_resistor;
+        } TempMap;
+
+        typedef struct {
+            EthernetClient client;
+            uint8_t rx[MODBUS_TCP_MAX_ADU];
+            size_t rx_len;
+        } TcpConnection;
+
+        RS485CommClass& _rs485;                                    // RS485 port of the RTU slave
+        ModbusRS485Port _port;                                     // Byte transport of the RTU slave
+        ModbusSlave _rtu;                                          // RTU slave engine
+        ModbusSlave _tcp;                                          // TCP slave engine
+        ModbusDataMap _map;                                        // Snapshot seen by the masters
+        uint8_t _coils[3];
+        uint8_t _inputs[3];
+        uint16_t _input_regs[MODBUS_USER_REGISTER + MC_MBS_USER_REGS];
+        uint16_t _holding_regs[MODBUS_USER_REGISTER + MC_MBS_USER_REGS];
+        uint8_t _rtu_tx[MODBUS_MAX_ADU];
+        uint8_t _tcp_tx[MODBUS_TCP_MAX_ADU];
+        TempMap _temp[3];
+        uint16_t _temp_value[3];                                   // Last temperature of each channel (refresh thread)
+        int _temp_channel;                                         // Next temperature channel to read
+        uint32_t _temp_last_ms;                                    // Time of the last temperature read
+        EthernetServer* _server;
+        TcpConnection _conn[MC_MBS_TCP_CLIENTS];
+        rtos::Mutex _mutex;                                        // Protects the snapshot and the engines
+        rtos::Thread* _service_thread;                             // Answers the requests
+        rtos::Thread* _refresh_thread;                             // Refreshes the snapshot
+        uint8_t _groups;
+        uint32_t _refresh_ms;
+        volatile uint8_t _pending;                                 // Output groups written by a master
+        volatile bool _rtu_enabled;
+        volatile bool _tcp_enabled;
+        volatile bool _running;
+
+        bool _start();
+        void _service();
+        void _serveTcp();
+        void _refresh();
+        void _applyOutputs();
+        void _readInputs(bool first);
+        uint16_t _readTemperature(int channel);
+        static uint32_t _now();
+        static void _onWrite(void* context, uint8_t table, uint16_t address, uint16_t quantity);
+};
+
+extern ModbusSlaveClass MachineControl_ModbusSlave;
+
+#endif /* __MODBUS_SLAVE_CLASS_H */
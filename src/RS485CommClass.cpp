@@ -7,17 +7,32 @@
 /* Includes -----------------------------------------------------------------*/
 #include "RS485CommClass.h"
 #include <pinDefinitions.h>
+#include <stdio.h>
+#include "utility/MODBUS/ModbusRtu.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define RS485_FLAG_FRAME        0x01
 
 /* Functions -----------------------------------------------------------------*/
 
 RS485CommClass::RS485CommClass(arduino::UART& uart_itf, PinName rs_tx_pin, PinName rs_de_pin, PinName rs_re_pin)
-                    : RS485Class(uart_itf, PinNameToIndex(rs_tx_pin), PinNameToIndex(rs_de_pin), PinNameToIndex(rs_re_pin)) 
+                    : RS485Class(uart_itf, PinNameToIndex(rs_tx_pin), PinNameToIndex(rs_de_pin), PinNameToIndex(rs_re_pin)),
+                    _framer{nullptr},
+                    _dma{nullptr},
+                    _capture{nullptr},
+                    _record{nullptr},
+                    _capture_header{false},
+                    _full_duplex{false}
 { }
 
 RS485CommClass::~RS485CommClass() 
 { }
 
 void RS485CommClass::begin(unsigned long baudrate, int predelay, int postdelay) {
+    begin(baudrate, SERIAL_8N1, predelay, postdelay);
+}
+
+void RS485CommClass::begin(unsigned long baudrate, uint16_t config, int predelay, int postdelay) {
     /* Pinout configuration */
     pinMode(PinNameToIndex(MC_RS485_TX_PIN), OUTPUT);
     pinMode(PinNameToIndex(MC_RS485_RX_PIN), OUTPUT);
@@ -44,19 +59,237 @@ void RS485CommClass::begin(unsigned long baudrate, int predelay, int postdelay)
     /* Enable RS485 communication */
     _enable();
 
+    /* Derive the driver turnaround from the character time */
+    SerialTiming timing;
+    if (serialTiming(baudrate, config, &timing)) {
+        if (predelay == RS485_AUTO_DELAY) {
+            predelay = timing.predelay_us;
+        }
+        if (postdelay == RS485_AUTO_DELAY) {
+            postdelay = timing.postdelay_us;
+        }
+        if (_dma != nullptr) {
+            _dma->setTiming(timing);
+        }
+    }
+    if (predelay < 0) {
+        predelay = RS485_DEFAULT_PRE_DELAY;
+    }
+    if (postdelay < 0) {
+        postdelay = RS485_DEFAULT_POST_DELAY;
+    }
+
     /* Call begin() base class to initialize RS485 communication */
-    RS485Class::begin(baudrate, predelay, postdelay);
+    RS485Class::begin(baudrate, config, predelay, postdelay);
 
 	return;
 }
 
 void RS485CommClass::end() {
+    _stopDMA();
+
     _disable();
 
     /* Call end() base class to de-initialize RS485 communication */
     RS485Class::end();
 }
 
+bool RS485CommClass::beginDMA(unsigned long baudrate, uint16_t config) {
+    if (_dma == nullptr) {
+        _dma = new Stm32DmaSerial(MC_RS485_DE_PIN, MC_RS485_RE_PIN);
+    }
+    if (_framer == nullptr) {
+        _framer = new SerialFramer();
+        _framer->setFrameCallback(&RS485CommClass::_onFrame, this);
+    }
+
+    _stopDMA();
+    begin(baudrate, config, RS485_AUTO_DELAY, RS485_AUTO_DELAY);
+
+    _dma->setFullDuplex(_full_duplex);
+    _frame_flags.clear(RS485_FLAG_FRAME);
+
+    return _framer->begin(_dma);
+}
+
+bool RS485CommClass::readFrame(SerialFrame* frame, uint32_t timeout_ms) {
+    if (_framer == nullptr || frame == nullptr) {
+        return false;
+    }
+
+    uint32_t start = millis();
+    while (!_framer->pop(frame)) {
+        uint32_t elapsed = millis() - start;
+        if (elapsed >= timeout_ms) {
+            return false;
+        }
+        _frame_flags.wait_any_for(RS485_FLAG_FRAME, std::chrono::milliseconds(timeout_ms - elapsed));
+    }
+
+    return true;
+}
+
+bool RS485CommClass::waitFrame(uint32_t timeout_ms) {
+    if (_framer == nullptr) {
+        return false;
+    }
+
+    uint32_t start = millis();
+    while (_framer->available() == 0) {
+        uint32_t elapsed = millis() - start;
+        if (elapsed >= timeout_ms) {
+            return false;
+        }
+        _frame_flags.wait_any_for(RS485_FLAG_FRAME, std::chrono::milliseconds(timeout_ms - elapsed));
+    }
+
+    return true;
+}
+
+bool RS485CommClass::writeFrame(const uint8_t* data, size_t len, void (*callback)(void* context), void* context) {
+    if (_framer == nullptr) {
+        return false;
+    }
+
+    return _framer->write(data, len, callback, context);
+}
+
+bool RS485CommClass::isWriting() {
+    return _framer != nullptr && _framer->isWriting();
+}
+
+SerialFramerStats RS485CommClass::getFrameStats() {
+    if (_framer == nullptr) {
+        SerialFramerStats stats = {};
+        return stats;
+    }
+
+    return _framer->getStats();
+}
+
+SerialTurnaroundStats RS485CommClass::getTurnaroundStats() {
+    if (_dma == nullptr) {
+        SerialTurnaroundStats stats = {};
+        return stats;
+    }
+
+    return _dma->getTurnaroundStats();
+}
+
+void RS485CommClass::resetFrameStats() {
+    if (_framer != nullptr) {
+        _framer->resetStats();
+        _dma->resetTurnaroundStats();
+    }
+}
+
+bool RS485CommClass::beginCapture(unsigned long baudrate, uint16_t config, uint32_t gap_us) {
+    if (_dma == nullptr) {
+        _dma = new Stm32DmaSerial(MC_RS485_DE_PIN, MC_RS485_RE_PIN);
+    }
+    if (_capture == nullptr) {
+        _capture = new SerialCapture(new uint8_t[MC_CAPTURE_LOG_SIZE], MC_CAPTURE_LOG_SIZE);
+        _record = new SerialCaptureRecord;
+    }
+
+    _stopDMA();
+    begin(baudrate, config, RS485_AUTO_DELAY, RS485_AUTO_DELAY);
+
+    if (gap_us == 0) {
+        gap_us = (7 * _dma->charTimeNs() / 2 + 999) / 1000;
+    }
+    _capture_header = true;
+    _capture->resetStats();
+
+    return _capture->begin(_dma, gap_us, ticker_read_us(get_us_ticker_data()));
+}
+
+size_t RS485CommClass::dumpCapture(Print& out) {
+    uint8_t buffer[64];
+    size_t written = 0;
+    size_t len;
+
+    if (_capture == nullptr) {
+        return 0;
+    }
+
+    if (_capture_header) {
+        _capture_header = false;
+        written += out.write(buffer, _capture->header(buffer));
+    }
+
+    core_util_critical_section_enter();
+    _capture->flush(ticker_read_us(get_us_ticker_data()));
+    core_util_critical_section_exit();
+
+    while ((len = _capture->read(buffer, sizeof(buffer))) > 0) {
+        written += out.write(buffer, len);
+    }
+
+    return written;
+}
+
+int RS485CommClass::printCapture(Print& out, bool modbus) {
+    char line[96];
+    int records = 0;
+
+    if (_capture == nullptr) {
+        return 0;
+    }
+
+    core_util_critical_section_enter();
+    _capture->flush(ticker_read_us(get_us_ticker_data()));
+    core_util_critical_section_exit();
+
+    while (_capture->readRecord(_record)) {
+        uint64_t t = _record->start_us - _capture->getBaseUs();
+
+        // time from the start of the capture, length and flags
+        snprintf(line, sizeof(line), "%lu.%06lu %3u%s%s%s%s:", (unsigned long)(t / 1000000), (unsigned long)(t % 1000000), _record->length,
+                 (_record->flags & SERIAL_RECORD_CONTINUED) ? " C" : "",
+                 (_record->flags & SERIAL_RECORD_LOST) ? " L" : "",
+                 (_record->flags & SERIAL_RECORD_OVERRUN) ? " O" : "",
+                 (_record->flags & SERIAL_RECORD_ERROR) ? " E" : "");
+        out.print(line);
+        for (int i = 0; i < _record->length; i++) {
+            snprintf(line, sizeof(line), " %02X", _record->data[i]);
+            out.print(line);
+        }
+        if (modbus && !(_record->flags & SERIAL_RECORD_CONTINUED)) {
+            modbusDescribeRtu(_record->data, _record->length, line, sizeof(line));
+            out.print(" | ");
+            out.print(line);
+        }
+        out.println();
+        records++;
+    }
+
+    return records;
+}
+
+SerialCaptureStats RS485CommClass::getCaptureStats() {
+    if (_capture == nullptr) {
+        SerialCaptureStats stats = {};
+        return stats;
+    }
+
+    return _capture->getStats();
+}
+
+void RS485CommClass::_stopDMA() {
+    if (_framer != nullptr) {
+        _framer->end();
+    }
+    if (_capture != nullptr) {
+        _capture->end();
+    }
+}
+
+void RS485CommClass::_onFrame(void* context) {
+    RS485CommClass* self = (RS485CommClass*)context;
+    self->_frame_flags.set(RS485_FLAG_FRAME);
+}
+
 void RS485CommClass::setModeRS232(bool enable) 	{ 
 	digitalWrite(PinNameToIndex(MC_RS485_RS232_PIN), enable ? LOW : HIGH);
 }
@@ -74,6 +307,10 @@ void RS485CommClass::setSlew(bool enable) {
 }
 
 void RS485CommClass::setFullDuplex(bool enable) 	{
+	_full_duplex = enable;
+	if (_dma != nullptr) {
+		_dma->setFullDuplex(enable);
+	}
 	digitalWrite(PinNameToIndex(MC_RS485_HF_PIN), enable ? LOW : HIGH);
 	if (enable) {
 		// RS485 Full Duplex require YZ and AB 120 Ohm termination enabled
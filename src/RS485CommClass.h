@@ -15,6 +15,13 @@
 #include <Arduino.h>      
 #include <mbed.h>
 #include "pins_mc.h"
+#include "utility/SERIAL/SerialFramer.h"
+#include "utility/SERIAL/Stm32DmaSerial.h"
+#include "utility/SERIAL/SerialTiming.h"
+#include "utility/SERIAL/SerialCapture.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#define RS485_AUTO_DELAY        -1      // Delay derived from the baud rate and the frame format
 
 /* Class ----------------------------------------------------------------------*/
 
@@ -24,6 +31,13 @@
  *
  * The `RS485CommClass` is a subclass of `RS485Class` and provides methods to work with the RS485 and RS232 communication protocols on the Portenta Machine Control board.
  * It includes features to initialize, configure, and interact with the serial protocols. The library also initializes the corresponding LED for RS485.
+ *
+ * beginDMA() switches the port to frame mode: the bytes are received by DMA and cut into frames at each idle line,
+ * the frames are sent by DMA from the caller buffer. The byte API (read(), write(), beginTransmission()...) must not be
+ * used while the frame mode is active.
+ *
+ * beginCapture() switches the port to capture mode: the driver stays disabled and every byte received is recorded
+ * with its timestamp, for dumping over USB with dumpCapture() or printCapture().
  */
 class RS485CommClass : public RS485Class {
     public:
@@ -52,13 +66,27 @@ class RS485CommClass : public RS485Class {
          * @brief Begin the RS485 communication protocol.
          *
          * This method initializes the RS485 communication protocol with the specified baud rate and pre/post delays.
+         * With RS485_AUTO_DELAY the driver is enabled one bit before the first start bit and held until the
+         * last stop bit is sent, see serialTiming().
          *
          * @param baudrate The desired baud rate for the RS485 communication.
-         * @param predelay The delay before sending data in the RS485 communication (default: RS485_DEFAULT_PRE_DELAY).
-         * @param postdelay The delay after sending data in the RS485 communication (default: RS485_DEFAULT_POST_DELAY).
+         * @param predelay The delay before sending data in the RS485 communication in us, or RS485_AUTO_DELAY (default: RS485_DEFAULT_PRE_DELAY).
+         * @param postdelay The delay after sending data in the RS485 communication in us, or RS485_AUTO_DELAY (default: RS485_DEFAULT_POST_DELAY).
          */
         void begin(unsigned long baudrate = 115200, int predelay = RS485_DEFAULT_PRE_DELAY, int postdelay = RS485_DEFAULT_POST_DELAY);
 
+        /**
+         * @brief Begin the RS485 communication protocol with a specific frame format.
+         *
+         * This method initializes the RS485 communication protocol with the specified baud rate, frame format and pre/post delays.
+         *
+         * @param baudrate The desired baud rate for the RS485 communication.
+         * @param config The frame format (data bits, parity and stop bits), e.g. SERIAL_8E1.
+         * @param predelay The delay before sending data in the RS485 communication in us, or RS485_AUTO_DELAY.
+         * @param postdelay The delay after sending data in the RS485 communication in us, or RS485_AUTO_DELAY.
+         */
+        void begin(unsigned long baudrate, uint16_t config, int predelay, int postdelay);
+
         /**
          * @brief Close the RS485 communication protocol.
          *
@@ -66,6 +94,117 @@ class RS485CommClass : public RS485Class {
          */
         void end();
 
+        /**
+         * @brief Begin the RS485 communication protocol in frame mode.
+         *
+         * The port is initialized as by begin(), then the receiver and the transmitter are driven by DMA.
+         *
+         * @param baudrate The desired baud rate for the RS485 communication.
+         * @param config The frame format (data bits, parity and stop bits), e.g. SERIAL_8E1.
+         * @return true If the frame mode is started, false otherwise
+         */
+        bool beginDMA(unsigned long baudrate = 115200, uint16_t config = SERIAL_8N1);
+
+        /**
+         * @brief Get the next frame received in frame mode.
+         *
+         * A frame ends when the line stays idle for one character, longer frames are split (SERIAL_FRAME_TRUNCATED).
+         *
+         * @param frame frame with its timestamps (us, time base of the us ticker)
+         * @param timeout_ms time to wait for a frame in ms, 0 to return immediately
+         * @return true If a frame was received, false otherwise
+         */
+        bool readFrame(SerialFrame* frame, uint32_t timeout_ms = 0);
+
+        /**
+         * @brief Wait for a frame in frame mode, without taking it.
+         *
+         * @param timeout_ms time to wait for a frame in ms, 0 to return immediately
+         * @return true If a frame is available for readFrame(), false otherwise
+         */
+        bool waitFrame(uint32_t timeout_ms);
+
+        /**
+         * @brief Send a frame in frame mode, without copying it.
+         *
+         * The driver is enabled one bit before the first start bit and released by the transmission-complete
+         * interrupt once the last stop bit is sent.
+         *
+         * @param data frame to send, must stay valid until the end of the transmission (not in DTCM)
+         * @param len length of the frame
+         * @param callback function called from interrupt context at the end of the transmission
+         * @param context argument of the callback
+         * @return true If the transmission is started, false if one is already in progress
+         */
+        bool writeFrame(const uint8_t* data, size_t len, void (*callback)(void* context) = nullptr, void* context = nullptr);
+
+        /**
+         * @brief Check if a frame is being sent.
+         *
+         * @return true If a transmission is in progress, false otherwise
+         */
+        bool isWriting();
+
+        /**
+         * @brief Get the statistics of the frame mode.
+         *
+         * @return SerialFramerStats frame counters since the last reset
+         */
+        SerialFramerStats getFrameStats();
+
+        /**
+         * @brief Get the driver turnaround measured in frame mode.
+         *
+         * @return SerialTurnaroundStats driver hold time after the last stop bit and line idle time before each transmission
+         */
+        SerialTurnaroundStats getTurnaroundStats();
+
+        /**
+         * @brief Reset the statistics of the frame mode and of the driver turnaround.
+         */
+        void resetFrameStats();
+
+        /**
+         * @brief Begin the RS485 communication protocol in capture mode, as a passive bus analyzer.
+         *
+         * The bytes are received by DMA and recorded in a log of MC_CAPTURE_LOG_SIZE bytes, in records separated
+         * by line gaps of at least gap_us. The driver is never enabled.
+         *
+         * @param baudrate The baud rate of the bus.
+         * @param config The frame format of the bus (data bits, parity and stop bits), e.g. SERIAL_8E1.
+         * @param gap_us shortest gap between two records in us, 0 for 3.5 characters (Modbus RTU frames)
+         * @return true If the capture is started, false otherwise
+         */
+        bool beginCapture(unsigned long baudrate = 115200, uint16_t config = SERIAL_8N1, uint32_t gap_us = 0);
+
+        /**
+         * @brief Write the records captured so far as a binary stream and remove them from the log.
+         *
+         * The first dump after beginCapture() starts with a SERIAL_CAPTURE_HEADER-byte header ("MCAP", version,
+         * character time in ns, gap in us, start time in us), then each record is a 7-byte header (flags, length,
+         * start time in us from the previous record, little-endian) followed by its bytes.
+         *
+         * @param out destination, e.g. Serial
+         * @return size_t number of bytes written
+         */
+        size_t dumpCapture(Print& out);
+
+        /**
+         * @brief Print the records captured so far as text, one line per record, and remove them from the log.
+         *
+         * @param out destination, e.g. Serial
+         * @param modbus true to decode the records as Modbus RTU frames
+         * @return int number of records printed
+         */
+        int printCapture(Print& out, bool modbus = false);
+
+        /**
+         * @brief Get the statistics of the capture mode.
+         *
+         * @return SerialCaptureStats capture counters since beginCapture()
+         */
+        SerialCaptureStats getCaptureStats();
+
         /**
          * @brief Set RS485 mode to RS232.
          *
@@ -112,6 +251,17 @@ class RS485CommClass : public RS485Class {
         void setFullDuplex(bool enable);
 
     private:
+        SerialFramer* _framer;              // Frame mode, allocated on the first beginDMA()
+        Stm32DmaSerial* _dma;
+        SerialCapture* _capture;            // Capture mode, allocated on the first beginCapture()
+        SerialCaptureRecord* _record;
+        bool _capture_header;
+        rtos::EventFlags _frame_flags;      // Set from interrupt context when a frame is queued
+        bool _full_duplex;
+
+        static void _onFrame(void* context);
+        void _stopDMA();
+
         /**
          * @brief Enable RS485 communication.
          *
@@ -33,10 +33,37 @@ void RTDTempProbeClass::end() {
 
 void RTDTempProbeClass::selectChannel(int channel) {
     TempProbeClass::selectChannel(channel, _current_probe_type);
+    _channel = channel;
 }
 
 float RTDTempProbeClass::readTemperature(float RTDnominal, float refResistor) {
-    return TempProbeClass::convertRTDTemperature(RTDnominal, refResistor);
+    float temperature = TempProbeClass::convertRTDTemperature(RTDnominal, refResistor);
+
+    if (_channel < 0 || _channel >= MC_TP_CHANNELS) {
+        return temperature;
+    }
+    return _filter[_channel].update(temperature, millis());
+}
+
+bool RTDTempProbeClass::setFilter(int channel, uint8_t median, float max_rate, float alpha, uint8_t max_hold) {
+    if (channel < 0 || channel >= MC_TP_CHANNELS) {
+        return false;
+    }
+
+    if (!_filter[channel].configure(median, max_rate, alpha, max_hold)) {
+        return false;
+    }
+    _filter[channel].enable(true);
+
+    return true;
+}
+
+void RTDTempProbeClass::disableFilter(int channel) {
+    if (channel < 0 || channel >= MC_TP_CHANNELS) {
+        return;
+    }
+
+    _filter[channel].enable(false);
 }
 
 RTDTempProbeClass MachineControl_RTDTempProbe;
@@ -74,12 +74,38 @@ public:
     /**
      * @brief Read temperature value of the connected RTD
      *
+     * The temperature is computed with the Callendar-Van Dusen equation (IEC 60751, -200 to 850 °C),
+     * NAN is returned outside this range.
+     *
      * @param RTDnominal The 'nominal' resistance of the RTD sensor at 0 °C
      * @param refResistor The value of the reference sensor
      */
     float readTemperature(float RTDnominal, float refResistor);
 
+    /**
+     * @brief Enable the robust filter of a channel: median, rate-of-change limiter and exponential smoother
+     *
+     * Invalid readings (NAN, out of range) are bridged with the last good value for up to max_hold readings.
+     *
+     * @param channel The channel number (0-2)
+     * @param median Number of samples of the median (1, 3 or 5)
+     * @param max_rate Maximum rate of change in °C/s, 0 to disable the limiter
+     * @param alpha Smoothing factor (0-1], 1 to disable the smoother
+     * @param max_hold Maximum number of consecutive invalid readings replaced by the last good value
+     * @return true If the filter is configured, false otherwise
+     */
+    bool setFilter(int channel, uint8_t median = 3, float max_rate = 0, float alpha = 1.0f, uint8_t max_hold = 3);
+
+    /**
+     * @brief Disable the robust filter of a channel
+     *
+     * @param channel The channel number (0-2)
+     */
+    void disableFilter(int channel);
+
 private:
+    RobustFilter _filter[MC_TP_CHANNELS]; // Robust filter of each channel
+    int _channel = -1;                    // Selected channel
     uint8_t _current_probe_type;
 };
 
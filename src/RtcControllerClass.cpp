@@ -7,15 +7,207 @@
 /* Includes -----------------------------------------------------------------*/
 #include "RtcControllerClass.h"
 
+/* Private defines -----------------------------------------------------------*/
+#define MC_RTC_STACK_SIZE       1024
+#define MC_RTC_QUEUE_EVENTS     4
+#define MC_RTC_SERVICE_RETRIES  4
+#define MC_RTC_EDGE_FLAG        0x01
+
 /* Functions -----------------------------------------------------------------*/
 RtcControllerClass::RtcControllerClass(PinName int_pin)
-                                        : _int{int_pin}                   
+                                        : _int{int_pin}, _irq{nullptr}, _queue{MC_RTC_QUEUE_EVENTS * EVENTS_EVENT_SIZE},
+                                          _event_thread{nullptr}, _alarm_cb{nullptr}, _timer_cb{nullptr},
+                                          _second_wait{false}, _edge_us{0}
 {
     pinMode(_int, INPUT_PULLUP);
 }
 
 RtcControllerClass::~RtcControllerClass() 
-{ }
+{
+    if (_irq != nullptr) {
+        _irq->disable_irq();
+        delete _irq;
+        _irq = nullptr;
+    }
+    if (_event_thread != nullptr) {
+        _queue.break_dispatch();
+        _event_thread->join();
+        delete _event_thread;
+        _event_thread = nullptr;
+    }
+}
+
+bool RtcControllerClass::attachAlarm(void (*callback)(void)) {
+    if (callback == nullptr || !_startEvents()) {
+        return false;
+    }
+
+    _alarm_cb = callback;
+    /* A flag already pending keeps INT low: no edge would ever come */
+    _queue.call(this, &RtcControllerClass::_service);
+
+    return true;
+}
+
+void RtcControllerClass::detachAlarm() {
+    _alarm_cb = nullptr;
+}
+
+bool RtcControllerClass::attachTimer(void (*callback)(void), uint8_t source, uint8_t count) {
+    if (callback == nullptr || count == 0 || !_startEvents()) {
+        return false;
+    }
+
+    lock();
+    if (_second_wait) {
+        unlock();
+        return false;
+    }
+    disableTimer();
+    clearInterruptFlags(RTC_FLAG_TIMER);
+    _timer_cb = callback;
+    setTimer(source, count);
+    enableTimer();
+    unlock();
+
+    return true;
+}
+
+void RtcControllerClass::detachTimer() {
+    lock();
+    if (!_second_wait) {
+        disableTimer();
+        _timer_cb = nullptr;
+        clearInterruptFlags(RTC_FLAG_TIMER);
+    }
+    unlock();
+}
+
+bool RtcControllerClass::waitSecond(uint64_t* edge_us, PCF8563TTime* time, uint32_t timeout_ms) {
+    if (!_startEvents()) {
+        return false;
+    }
+
+    lock();
+    if (_timer_cb != nullptr || _second_wait) {
+        unlock();
+        return false;
+    }
+    _second_wait = true;
+    disableTimer();
+    clearInterruptFlags(RTC_FLAG_TIMER);
+    /* A pending alarm nobody handles holds INT low: the timer would raise no edge */
+    if (_alarm_cb == nullptr) {
+        uint8_t stale = getActiveInterrupts() & RTC_FLAG_ALARM;
+        if (stale != 0) {
+            clearInterruptFlags(stale);
+        }
+    }
+    _edge_flags.clear(MC_RTC_EDGE_FLAG);
+    /* The countdown ticks on the clock of the seconds counter: the first expiry,
+       however early after loading the timer, is a second transition */
+    setTimer(RTC_TIMER_1HZ, 1);
+    enableTimer();
+    unlock();
+
+    bool seen = false;
+    bool read = false;
+    auto deadline = rtos::Kernel::Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (!seen) {
+        auto now = rtos::Kernel::Clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        uint32_t flags = _edge_flags.wait_any_for(MC_RTC_EDGE_FLAG, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now));
+        if ((flags & osFlagsError) || !(flags & MC_RTC_EDGE_FLAG)) {
+            break;
+        }
+
+        /* The edge may also be an alarm: only the timer flag marks the transition */
+        lock();
+        if (getInterruptFlags() & RTC_FLAG_TIMER) {
+            seen = true;
+            core_util_critical_section_enter();
+            *edge_us = _edge_us;
+            core_util_critical_section_exit();
+            read = readTime(time);
+        }
+        unlock();
+    }
+
+    lock();
+    disableTimer();
+    clearInterruptFlags(RTC_FLAG_TIMER);
+    _second_wait = false;
+    unlock();
+
+    return seen && read;
+}
+
+bool RtcControllerClass::_startEvents() {
+    if (_event_thread != nullptr) {
+        return true;
+    }
+
+    _event_thread = new rtos::Thread(osPriorityAboveNormal, MC_RTC_STACK_SIZE, nullptr, "RtcEvents");
+    if (_event_thread == nullptr) {
+        return false;
+    }
+    if (_event_thread->start(mbed::callback(&_queue, &events::EventQueue::dispatch_forever)) != osOK) {
+        delete _event_thread;
+        _event_thread = nullptr;
+        return false;
+    }
+
+    _irq = new mbed::InterruptIn(_int, PullUp);
+    _irq->fall(mbed::callback(this, &RtcControllerClass::_isr));
+
+    return true;
+}
+
+void RtcControllerClass::_isr() {
+    _edge_us = ticker_read_us(get_us_ticker_data());
+    _edge_flags.set(MC_RTC_EDGE_FLAG);
+    /* No I2C in interrupt context: the flags are read and cleared by the event thread */
+    _queue.call(this, &RtcControllerClass::_service);
+}
+
+void RtcControllerClass::_service() {
+    for (int i = 0; i < MC_RTC_SERVICE_RETRIES; i++) {
+        uint8_t handled = (_alarm_cb != nullptr ? RTC_FLAG_ALARM : 0) | (_timer_cb != nullptr ? RTC_FLAG_TIMER : 0);
+        /* waitSecond() reads and clears the timer flag itself */
+        uint8_t owned = handled | (_second_wait ? RTC_FLAG_TIMER : 0);
+
+        /* The bus is shared with the sketch and the time service: read and clear under the lock */
+        lock();
+        uint8_t pending = getInterruptFlags();
+        uint8_t flags = pending & handled;
+        uint8_t stale = 0;
+        if ((pending & ~owned) != 0) {
+            /* An enabled interrupt without callback would hold INT low and hide every later edge */
+            stale = getActiveInterrupts() & ~owned;
+        }
+        if ((flags | stale) != 0) {
+            /* Clear first, so that a new event during the callbacks raises a new edge */
+            clearInterruptFlags(flags | stale);
+        }
+        unlock();
+
+        if (flags == 0) {
+            return;
+        }
+
+        void (*alarm_cb)(void) = _alarm_cb;
+        void (*timer_cb)(void) = _timer_cb;
+        if ((flags & RTC_FLAG_ALARM) && alarm_cb != nullptr) {
+            alarm_cb();
+        }
+        if ((flags & RTC_FLAG_TIMER) && timer_cb != nullptr) {
+            timer_cb();
+        }
+    }
+}
 
 RtcControllerClass MachineControl_RTCController;
 /**** END OF FILE ****/
\ No newline at end of file
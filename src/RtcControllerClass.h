@@ -43,8 +43,73 @@ class RtcControllerClass : public PCF8563TClass {
 		 */
 		~RtcControllerClass();
 
+		/**
+		 * @brief Call a function on each RTC alarm.
+		 *
+		 * The INT pin is handled by an interrupt: the alarm flag is cleared and the callback is
+		 * called from the RTC event thread, so the callback may use the I2C bus and block briefly.
+		 * The alarm itself is configured with enableAlarm() and setMinuteAlarm()/setHourAlarm()/setDayAlarm().
+		 *
+		 * @param callback function called on each alarm
+		 * @return true If the interrupt handling is running, false otherwise
+		 */
+		bool attachAlarm(void (*callback)(void));
+
+		/**
+		 * @brief Stop calling the alarm callback.
+		 *
+		 * Once the interrupt handling runs (a callback has been attached or waitSecond() called), an
+		 * alarm or timer flag whose interrupt is enabled but has no callback is cleared and ignored,
+		 * so that it cannot hold the INT pin low. Disable the alarm to poll its flag instead.
+		 */
+		void detachAlarm();
+
+		/**
+		 * @brief Run the countdown timer as a periodic tick and call a function on each expiry.
+		 *
+		 * The callback is called from the RTC event thread, e.g. RTC_TIMER_1HZ with count 10 calls it every 10 s.
+		 *
+		 * @param callback function called on each timer expiry
+		 * @param source timer clock (RTC_TIMER_4096HZ, RTC_TIMER_64HZ, RTC_TIMER_1HZ or RTC_TIMER_1_60HZ)
+		 * @param count number of timer clock periods between two calls (1 to 255)
+		 * @return true If the timer is running, false otherwise
+		 */
+		bool attachTimer(void (*callback)(void), uint8_t source, uint8_t count);
+
+		/**
+		 * @brief Stop the countdown timer and its callback.
+		 */
+		void detachTimer();
+
+		/**
+		 * @brief Wait for the next transition of the RTC seconds counter.
+		 *
+		 * The countdown timer is run from its 1 Hz source, the clock of the seconds counter, and the
+		 * falling edge of the INT pin is timestamped in the interrupt: the thread sleeps until the
+		 * transition instead of polling the RTC. The countdown timer is not available while a timer
+		 * callback is attached.
+		 *
+		 * @param edge_us microsecond ticker value (ticker_read_us()) at the transition
+		 * @param time RTC time of the second that started at the transition
+		 * @param timeout_ms longest wait in ms
+		 * @return true If the transition was seen and the time read, false otherwise
+		 */
+		bool waitSecond(uint64_t* edge_us, PCF8563TTime* time, uint32_t timeout_ms = 1100);
+
 	private:
 		PinName _int; // Pin for the interrupt
+		mbed::InterruptIn* _irq;                 // Interrupt on the falling edge of the INT pin
+		events::EventQueue _queue;               // Defers the interrupt handling to the event thread
+		rtos::Thread* _event_thread;             // Thread dispatching _queue
+		void (* volatile _alarm_cb)(void);       // Alarm callback
+		void (* volatile _timer_cb)(void);       // Timer callback
+		bool _second_wait;                       // The countdown timer is used by waitSecond()
+		rtos::EventFlags _edge_flags;            // Set by the interrupt on each falling edge of the INT pin
+		volatile uint64_t _edge_us;              // Ticker value of the last falling edge
+
+		bool _startEvents();
+		void _isr();
+		void _service();
 };
 
 extern RtcControllerClass MachineControl_RTCController;
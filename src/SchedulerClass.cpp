@@ -0,0 +1,185 @@
+/**
+ * @file SchedulerClass.cpp
+ * @brief Source file for the RTC scheduler of the Portenta Machine Control library.
+ */
+
+/* Includes -----------------------------------------------------------------*/
+#include "SchedulerClass.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define MC_SCHED_FLAG_ALARM     0x01
+#define MC_SCHED_FLAG_CHANGED   0x02
+
+/* Functions -----------------------------------------------------------------*/
+SchedulerClass::SchedulerClass()
+                : _alarm_time{CRON_NEVER}
+{
+    for (int i = 0; i < MC_SCHED_RULES; i++) {
+        _callback[i] = nullptr;
+    }
+}
+
+SchedulerClass::~SchedulerClass()
+{ }
+
+bool SchedulerClass::begin() {
+    if (!MachineControl_RTCController.begin()) {
+        return false;
+    }
+
+    _alarm_time = CRON_NEVER;
+    MachineControl_RTCController.lock();
+    MachineControl_RTCController.clearInterruptFlags(RTC_FLAG_ALARM);
+    MachineControl_RTCController.enableAlarm();
+    MachineControl_RTCController.unlock();
+    if (!MachineControl_RTCController.attachAlarm(_onAlarm)) {
+        return false;
+    }
+
+    _mutex.lock();
+    time_t now = MachineControl_RTCController.getEpoch();
+    if (now != (time_t)-1) {
+        _schedule.reschedule(now);
+    }
+    _mutex.unlock();
+
+    _flags.set(MC_SCHED_FLAG_CHANGED);
+    return true;
+}
+
+void SchedulerClass::end() {
+    MachineControl_RTCController.lock();
+    MachineControl_RTCController.detachAlarm();
+    MachineControl_RTCController.disableAlarm();
+    MachineControl_RTCController.unlock();
+    _alarm_time = CRON_NEVER;
+}
+
+int SchedulerClass::addRule(const char* spec, void (*callback)(int rule)) {
+    CronRule rule;
+
+    if (callback == nullptr || !rule.parse(spec)) {
+        return -1;
+    }
+
+    time_t now = MachineControl_RTCController.getEpoch();
+    if (now == (time_t)-1) {
+        return -1;
+    }
+
+    _mutex.lock();
+    int id = _schedule.add(rule, now);
+    if (id >= 0) {
+        _callback[id] = callback;
+    }
+    _mutex.unlock();
+
+    if (id >= 0) {
+        _flags.set(MC_SCHED_FLAG_CHANGED);
+    }
+    return id;
+}
+
+bool SchedulerClass::removeRule(int rule) {
+    _mutex.lock();
+    bool removed = _schedule.remove(rule);
+    if (removed) {
+        _callback[rule] = nullptr;
+    }
+    _mutex.unlock();
+
+    if (removed) {
+        _flags.set(MC_SCHED_FLAG_CHANGED);
+    }
+    return removed;
+}
+
+time_t SchedulerClass::getNextTime() {
+    _mutex.lock();
+    time_t next = _schedule.nextTime();
+    _mutex.unlock();
+
+    return next;
+}
+
+int SchedulerClass::run(uint32_t timeout_ms) {
+    auto deadline = rtos::Kernel::Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    for (;;) {
+        time_t now = MachineControl_RTCController.getEpoch();
+        if (now == (time_t)-1) {
+            return -1;
+        }
+
+        int ran = 0;
+        int id;
+        _mutex.lock();
+        while ((id = _schedule.popDue(now)) >= 0) {
+            void (*callback)(int rule) = _callback[id];
+            /* The callbacks may add or remove rules */
+            _mutex.unlock();
+            if (callback != nullptr) {
+                callback(id);
+            }
+            ran++;
+            _mutex.lock();
+        }
+        time_t next = _schedule.nextTime();
+        _mutex.unlock();
+
+        if (ran > 0) {
+            return ran;
+        }
+
+        if (next != CRON_NEVER && next != _alarm_time) {
+            /* run() is on its own thread: the alarm and the time check must not
+               interleave with the RTC accesses of the sketch or the time service */
+            MachineControl_RTCController.lock();
+            bool programmed = _programAlarm(next);
+            /* The occurrence may have been reached while the alarm was programmed */
+            now = programmed ? MachineControl_RTCController.getEpoch() : (time_t)-1;
+            MachineControl_RTCController.unlock();
+            if (!programmed) {
+                return -1;
+            }
+            if (now != (time_t)-1 && now >= next) {
+                continue;
+            }
+        }
+
+        uint32_t flags;
+        if (timeout_ms == osWaitForever) {
+            flags = _flags.wait_any(MC_SCHED_FLAG_ALARM | MC_SCHED_FLAG_CHANGED);
+        } else {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - rtos::Kernel::Clock::now());
+            if (remaining.count() <= 0) {
+                return 0;
+            }
+            flags = _flags.wait_any_for(MC_SCHED_FLAG_ALARM | MC_SCHED_FLAG_CHANGED, remaining);
+        }
+        if (flags & osFlagsError) {
+            return 0;
+        }
+    }
+}
+
+bool SchedulerClass::_programAlarm(time_t next) {
+    struct tm time;
+
+    /* The alarm matches minute, hour and day of the month: an occurrence more than
+       a month away wakes run() up early, which then programs the same alarm again */
+    _rtc_localtime(next, &time, RTC_FULL_LEAP_YEAR_SUPPORT);
+    if (!MachineControl_RTCController.setAlarm(time.tm_min, time.tm_hour, time.tm_mday)) {
+        return false;
+    }
+
+    _alarm_time = next;
+    return true;
+}
+
+void SchedulerClass::_onAlarm() {
+    MachineControl_Scheduler._flags.set(MC_SCHED_FLAG_ALARM);
+}
+
+SchedulerClass MachineControl_Scheduler;
+/**** END OF FILE ****/
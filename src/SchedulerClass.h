@@ -0,0 +1,106 @@
+/**
+ * @file SchedulerClass.h
+ * @brief Header file for the RTC scheduler of the Portenta Machine Control library.
+ *
+ * This library runs user functions on calendar rules (cron-like), waking up the calling thread
+ * with the PCF8563T RTC alarm programmed for the nearest next occurrence.
+ */
+
+#ifndef __SCHEDULER_CLASS_H
+#define __SCHEDULER_CLASS_H
+
+/* Includes -------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <mbed.h>
+#include "RtcControllerClass.h"
+#include "utility/SCHEDULER/CronSchedule.h"
+
+/* Class ----------------------------------------------------------------------*/
+
+/**
+ * @class SchedulerClass
+ * @brief Class for the calendar scheduler of the Portenta Machine Control.
+ *
+ * The rules use the fields of a cron line, "minute hour day month weekday", and apply to the
+ * time of the RTC. The rules are kept ordered by their next occurrence and the RTC alarm is
+ * always programmed for the nearest one, so run() sleeps until then without polling the RTC.
+ * The scheduler owns the RTC alarm: setMinuteAlarm()/setHourAlarm()/setDayAlarm() must not be used
+ * while it is running.
+ */
+class SchedulerClass {
+    public:
+        /**
+         * @brief Construct the scheduler without rules.
+         */
+        SchedulerClass();
+
+        /**
+         * @brief Destruct the SchedulerClass object.
+         */
+        ~SchedulerClass();
+
+        /**
+         * @brief Initialize the RTC and take over its alarm.
+         *
+         * @return true If the RTC responds, false otherwise
+         */
+        bool begin();
+
+        /**
+         * @brief Release the RTC alarm, the rules are kept.
+         */
+        void end();
+
+        /**
+         * @brief Add a rule.
+         *
+         * Each field is "*", a value, a range "a-b", a step "* /n" or "a-b/n" (without the space), or a comma
+         * separated list, e.g. "0 6,14,22 * * 1-5" runs at every shift change from Monday to Friday.
+         * Weekdays are 0-6 (0 or 7 is Sunday).
+         *
+         * @param spec rule "minute hour day month weekday"
+         * @param callback function called by run() on each occurrence, with the rule index
+         * @return int rule index, -1 if the rule is not valid or the table is full (MC_SCHED_RULES)
+         */
+        int addRule(const char* spec, void (*callback)(int rule));
+
+        /**
+         * @brief Remove a rule.
+         *
+         * @param rule rule index returned by addRule()
+         * @return true If the rule is removed, false otherwise
+         */
+        bool removeRule(int rule);
+
+        /**
+         * @brief Get the time of the nearest next occurrence.
+         *
+         * @return time_t RTC time of the next occurrence, -1 if no rule will run
+         */
+        time_t getNextTime();
+
+        /**
+         * @brief Sleep until the next occurrence and call the callbacks of the rules that are due.
+         *
+         * The calling thread waits for the RTC alarm interrupt, the RTC is only read when it wakes up.
+         * Occurrences missed while the callbacks were running are run once.
+         *
+         * @param timeout_ms longest wait in ms, osWaitForever to wait for the next occurrence
+         * @return int number of callbacks called, 0 on timeout, -1 if the RTC could not be read
+         */
+        int run(uint32_t timeout_ms = osWaitForever);
+
+    private:
+        CronSchedule _schedule;                          // Rules ordered by next occurrence
+        void (*_callback[MC_SCHED_RULES])(int rule);     // Callback of each rule
+        rtos::Mutex _mutex;                              // Protects the rules between the sketch and run()
+        rtos::EventFlags _flags;                         // Wakes run() up on alarm or rule change
+        time_t _alarm_time;                              // Occurrence the RTC alarm is programmed for
+
+        bool _programAlarm(time_t next);
+        static void _onAlarm();
+};
+
+extern SchedulerClass MachineControl_Scheduler;
+
+#endif /* __SCHEDULER_CLASS_H */
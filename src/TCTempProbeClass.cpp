@@ -30,11 +30,43 @@ void TCTempProbeClass::end() {
 
 void TCTempProbeClass::selectChannel(int channel) {
     TempProbeClass::selectChannel(channel, PROBE_TC_K);
+    _channel = channel;
 }
 
 float TCTempProbeClass::readTemperature(uint8_t type) {
     TempProbeClass::setTCType(type);
-    return TempProbeClass::readTCTemperature();
+    float temperature = TempProbeClass::readTCTemperature();
+
+    if (_channel < 0 || _channel >= MC_TP_CHANNELS) {
+        return temperature;
+    }
+    return _filter[_channel].update(temperature, millis());
+}
+
+TCSample TCTempProbeClass::readSample(uint8_t type) {
+    TempProbeClass::setTCType(type);
+    return TempProbeClass::readTCSample();
+}
+
+bool TCTempProbeClass::setFilter(int channel, uint8_t median, float max_rate, float alpha, uint8_t max_hold) {
+    if (channel < 0 || channel >= MC_TP_CHANNELS) {
+        return false;
+    }
+
+    if (!_filter[channel].configure(median, max_rate, alpha, max_hold)) {
+        return false;
+    }
+    _filter[channel].enable(true);
+
+    return true;
+}
+
+void TCTempProbeClass::disableFilter(int channel) {
+    if (channel < 0 || channel >= MC_TP_CHANNELS) {
+        return;
+    }
+
+    _filter[channel].enable(false);
 }
 
 TCTempProbeClass MachineControl_TCTempProbe;
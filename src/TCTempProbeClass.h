@@ -71,9 +71,43 @@ public:
     /**
      * @brief Read temperature value of the connected thermocouple
      *
-     * @param type The type of the connected thermocouple
+     * @param type The type of the connected thermocouple (PROBE_TC_K, PROBE_TC_J, PROBE_TC_T, PROBE_TC_E, PROBE_TC_N,
+     *             PROBE_TC_R, PROBE_TC_S or PROBE_TC_B), the types E to B can be removed with MC_TC_TYPE_x=0
      */
     float readTemperature(uint8_t type = PROBE_TC_K);
+
+    /**
+     * @brief Read the temperature, cold junction temperature, voltage and faults of the connected thermocouple from a single conversion
+     *
+     * @param type The type of the connected thermocouple
+     * @return TCSample the decoded sample, voltage and temperature are NAN on fault
+     */
+    TCSample readSample(uint8_t type = PROBE_TC_K);
+
+    /**
+     * @brief Enable the robust filter of a channel: median, rate-of-change limiter and exponential smoother
+     *
+     * Invalid readings (NAN, thermocouple faults) are bridged with the last good value for up to max_hold readings.
+     *
+     * @param channel The channel number (0-2)
+     * @param median Number of samples of the median (1, 3 or 5)
+     * @param max_rate Maximum rate of change in °C/s, 0 to disable the limiter
+     * @param alpha Smoothing factor (0-1], 1 to disable the smoother
+     * @param max_hold Maximum number of consecutive invalid readings replaced by the last good value
+     * @return true If the filter is configured, false otherwise
+     */
+    bool setFilter(int channel, uint8_t median = 3, float max_rate = 0, float alpha = 1.0f, uint8_t max_hold = 3);
+
+    /**
+     * @brief Disable the robust filter of a channel
+     *
+     * @param channel The channel number (0-2)
+     */
+    void disableFilter(int channel);
+
+private:
+    RobustFilter _filter[MC_TP_CHANNELS]; // Robust filter of each channel
+    int _channel = -1;                    // Selected channel
 };
 
 extern TCTempProbeClass MachineControl_TCTempProbe;
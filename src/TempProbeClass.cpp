@@ -14,6 +14,11 @@ uint8_t* boardInfo();
 #define PMC_R2_SKU  (24 << 8 | 3)
 #endif
 
+/* Private variables ---------------------------------------------------------*/
+uint8_t TempProbeClass::_current_channel = 0xFF;
+uint8_t TempProbeClass::_current_probe_type = PROBE_NONE;
+rtos::Mutex TempProbeClass::_mux_mutex;
+
 /* Functions -----------------------------------------------------------------*/
 TempProbeClass::TempProbeClass(PinName ch_sel0_pin,
                                 PinName ch_sel1_pin,
@@ -130,7 +135,8 @@ void TempProbeClass::selectChannel(uint8_t channel, uint8_t probeType) {
     }
 #endif
 #undef TRY_REV2_RECOGNITION
-    if (_current_channel != channel) {
+    lock();
+    if (_current_channel != channel || _current_probe_type != probeType) {
         switch(channel) {
             case 0:
                 digitalWrite(_ch_sel0, HIGH);
@@ -158,19 +164,19 @@ void TempProbeClass::selectChannel(uint8_t channel, uint8_t probeType) {
             case PROBE_TC_K:
             case PROBE_TC_J:
             case PROBE_TC_T:
+            case PROBE_TC_E:
+            case PROBE_TC_N:
+            case PROBE_TC_R:
+            case PROBE_TC_S:
+            case PROBE_TC_B:
+            case PROBE_TC_UNKNOWN:
                 digitalWrite(_rtd_th, LOW);
-                if (_current_probe_type != probeType) {
-                    MAX31855Class::setTCType(probeType);
-                }
                 switch_delay = 150;
                 break;
 
             case PROBE_RTD_2W:
             case PROBE_RTD_3W:
                 digitalWrite(_rtd_th, HIGH);
-                if (_current_probe_type != probeType) {
-                    MAX31865Class::setRTDType(probeType);
-                }
                 switch_delay = 75;
                 break;
 
@@ -182,6 +188,87 @@ void TempProbeClass::selectChannel(uint8_t channel, uint8_t probeType) {
         _current_channel = channel;
         _current_probe_type = probeType;
     }
+    // the wiring is kept by the converter, another object may have changed it
+    // without moving the multiplexer
+    if ((probeType == PROBE_RTD_2W || probeType == PROBE_RTD_3W) && MAX31865Class::getRTDType() != probeType) {
+        MAX31865Class::setRTDType(probeType);
+    }
+    // the multiplexer state is shared, the thermocouple type is kept by each object
+    if (probeType != PROBE_RTD_2W && probeType != PROBE_RTD_3W && probeType != PROBE_NONE && probeType != PROBE_TC_UNKNOWN) {
+        MAX31855Class::setTCType(probeType);
+    }
+    unlock();
+}
+
+void TempProbeClass::lock() {
+    _mux_mutex.lock();
+}
+
+void TempProbeClass::unlock() {
+    _mux_mutex.unlock();
+}
+
+ProbeMap TempProbeClass::discoverProbes(float RTDnominal, float refResistor) {
+    ProbeMap map;
+    bool tc_init = _tc_init;
+    bool rtd_init = _rtd_init;
+    uint8_t tc_type = MAX31855Class::getTCType();
+    uint8_t rtd_type = rtd_init ? MAX31865Class::getRTDType() : PROBE_NONE;
+
+    beginTC();
+    beginRTD();
+
+    lock();
+    for (uint8_t ch = 0; ch < MC_TP_CHANNELS; ch++) {
+        map.type[ch] = PROBE_NONE;
+        map.tc_fault[ch] = TC_FAULT_NONE;
+        map.rtd_fault[ch] = 0;
+
+        // a 2-wire probe without the RTD-TP jumper leaves the 3-wire compensation input open
+        if (_probeRTD(ch, PROBE_RTD_3W, RTDnominal, refResistor, &map.rtd_fault[ch])) {
+            map.type[ch] = PROBE_RTD_3W;
+            continue;
+        }
+        if (_probeRTD(ch, PROBE_RTD_2W, RTDnominal, refResistor, &map.rtd_fault[ch])) {
+            map.type[ch] = PROBE_RTD_2W;
+            continue;
+        }
+
+        // the hot junction linearized by the chip is only used for plausibility, whatever the type
+        selectChannel(ch, PROBE_TC_UNKNOWN);
+        TCSample sample = MAX31855Class::readTCSample();
+        map.tc_fault[ch] = sample.fault;
+        if (sample.fault == TC_FAULT_NONE && sample.hot_junction >= -270.0f && sample.hot_junction <= 1800.0f) {
+            map.type[ch] = PROBE_TC_UNKNOWN;
+        }
+    }
+    unlock();
+
+    // leave the converters as they were found
+    MAX31855Class::setTCType(tc_type);
+    if (rtd_init) {
+        MAX31865Class::setRTDType(rtd_type);
+    } else {
+        endRTD();
+    }
+    if (!tc_init) {
+        endTC();
+    }
+
+    return map;
+}
+
+bool TempProbeClass::_probeRTD(uint8_t channel, uint8_t probeType, float RTDnominal, float refResistor, uint8_t* fault) {
+    selectChannel(channel, probeType);
+
+    *fault = MAX31865Class::runRTDFaultDetection();
+    if (*fault & (MAX31865_FAULT_HIGH_REFIN | MAX31865_FAULT_LOW_REFIN | MAX31865_FAULT_LOW_RTDIN | MAX31865_FAULT_OVER_UNDER_VOLTAGE)) {
+        return false;
+    }
+
+    // open inputs read close to the reference resistor, a thermocouple close to 0 ohm
+    double resistance = MAX31865Class::readRTD() * (double)refResistor / RTD_CODE_FULL_SCALE;
+    return !isnan(RtdLinearizer::temperature(resistance, RTDnominal));
 }
 
 TempProbeClass MachineControl_TempProbe;
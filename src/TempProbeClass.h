@@ -16,6 +16,20 @@
 #include <Arduino.h>
 #include <mbed.h>
 #include "pins_mc.h"
+#include "utility/FILTER/RobustFilter.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#define MC_TP_CHANNELS  3
+
+#define PROBE_NONE          0xFF
+#define PROBE_TC_UNKNOWN    0xFE // Thermocouple of unknown type, selectChannel() keeps the current type
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint8_t type[MC_TP_CHANNELS];      // Probe found on each channel: PROBE_TC_UNKNOWN, PROBE_RTD_2W, PROBE_RTD_3W or PROBE_NONE
+    uint8_t tc_fault[MC_TP_CHANNELS];  // Thermocouple faults seen on each channel (TC_FAULT_*)
+    uint8_t rtd_fault[MC_TP_CHANNELS]; // RTD fault status seen on each channel in the last RTD mode tried
+} ProbeMap;
 
 /* Class ----------------------------------------------------------------------*/
 
@@ -80,17 +94,50 @@ public:
      * @brief Select the input channel and probe type to be read (3 channels available).
      *
      * @param channel The channel number (0-2) to be selected for temperature reading.
-     * @param probeType The probe type(PROBE_TC_K, PROBE_TC_J, PROBE_TC_T, PROBE_RTD_2W, PROBE_RTD_3W) to be selected for temperature reading.
+     * @param probeType The probe type(PROBE_TC_K, PROBE_TC_J, PROBE_TC_T, PROBE_TC_E, PROBE_TC_N, PROBE_TC_R, PROBE_TC_S, PROBE_TC_B, PROBE_TC_UNKNOWN, PROBE_RTD_2W, PROBE_RTD_3W) to be selected for temperature reading.
      */
     void selectChannel(uint8_t channel, uint8_t probeType);
 
+    /**
+     * @brief Detect the probe connected to each channel.
+     *
+     * Each channel is tried as 3-wire RTD, 2-wire RTD (MAX31865 fault detection cycle and plausible resistance)
+     * and then as thermocouple (MAX31855 faults and plausible temperature). RTDs are tried first since they
+     * read as a shorted thermocouple. The type of a thermocouple cannot be told from its reading, it is
+     * reported as PROBE_TC_UNKNOWN. The TC and RTD converters are initialized for the scan and left as they
+     * were found, with their RTD wiring and thermocouple type. The returned types can be passed directly
+     * to selectChannel().
+     *
+     * @param RTDnominal The 'nominal' resistance of the RTD sensors at 0 °C
+     * @param refResistor The value of the reference resistor
+     * @return ProbeMap the probe type and faults of each channel
+     */
+    ProbeMap discoverProbes(float RTDnominal = 100.0f, float refResistor = 400.0f);
+
+    /**
+     * @brief Take exclusive use of the channel multiplexer.
+     *
+     * The multiplexer and the converters are shared by all the temperature probe objects (and by the control
+     * loops and the Modbus slave). A thread calling selectChannel() followed by a read must hold the lock around
+     * both so that another thread cannot switch the channel in between. The lock is recursive.
+     */
+    static void lock();
+
+    /**
+     * @brief Release the channel multiplexer taken with lock().
+     */
+    static void unlock();
+
 private:
     PinName _ch_sel0; // Pin for the first channel selection bit
     PinName _ch_sel1; // Pin for the second channel selection bit
     PinName _ch_sel2; // Pin for the third channel selection bit
     PinName _rtd_th;  // Pin for the RTD connection
-    uint8_t _current_channel;
-    uint8_t _current_probe_type;
+    static uint8_t _current_channel;      // Channel selected on the multiplexer, shared by all the objects
+    static uint8_t _current_probe_type;   // Probe type selected on the multiplexer, shared by all the objects
+    static rtos::Mutex _mux_mutex;        // Serializes the channel selection and the following read
+
+    bool _probeRTD(uint8_t channel, uint8_t probeType, float RTDnominal, float refResistor, uint8_t* fault);
     bool _tc_init = false;
     bool _rtd_init = false;
 };
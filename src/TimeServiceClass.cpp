@@ -0,0 +1,148 @@
+/**
+ * @file TimeServiceClass.cpp
+ * @brief Source file for the time service of the Portenta Machine Control library.
+ */
+
+/* Includes -----------------------------------------------------------------*/
+#include "TimeServiceClass.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define MC_TS_STACK_SIZE        1024
+#define MC_TS_STOP_FLAG         0x01
+#define MC_TS_EDGE_TIMEOUT_MS   1100    // Longest wait for the RTC second transition in ms
+
+/* Functions -----------------------------------------------------------------*/
+TimeServiceClass::TimeServiceClass()
+                : _thread{nullptr}, _resync_s{0}, _running{false}
+{
+    memset(&_status, 0, sizeof(_status));
+}
+
+TimeServiceClass::~TimeServiceClass()
+{
+    end();
+}
+
+bool TimeServiceClass::begin(uint32_t resync_s) {
+    if (_running) {
+        return false;
+    }
+
+    MachineControl_RTCController.begin();
+    bool synced = sync();
+
+    if (resync_s == 0) {
+        return synced;
+    }
+
+    _resync_s = resync_s;
+    _thread = new rtos::Thread(osPriorityBelowNormal, MC_TS_STACK_SIZE, nullptr, "TimeService");
+    if (_thread == nullptr) {
+        return false;
+    }
+
+    _running = true;
+    if (_thread->start(mbed::callback(this, &TimeServiceClass::_run)) != osOK) {
+        _running = false;
+        delete _thread;
+        _thread = nullptr;
+    }
+
+    return synced;
+}
+
+void TimeServiceClass::end() {
+    if (_thread == nullptr) {
+        return;
+    }
+
+    _running = false;
+    _thread->flags_set(MC_TS_STOP_FLAG);
+    _thread->join();
+    delete _thread;
+    _thread = nullptr;
+}
+
+bool TimeServiceClass::sync() {
+    PCF8563TTime first, time;
+    uint64_t edge;
+    time_t seconds;
+    bool synced = false;
+
+    _mutex.lock();
+
+    /* The RTC only counts whole seconds: sleep until the next transition, timestamped by the INT interrupt */
+    if (MachineControl_RTCController.readTime(&first) && !first.voltageLow
+        && MachineControl_RTCController.waitSecond(&edge, &time, MC_TS_EDGE_TIMEOUT_MS)
+        && time.seconds != first.seconds && MachineControl_RTCController.timeToEpoch(&time, &seconds)) {
+        core_util_critical_section_enter();
+        _clock.discipline(edge, (uint64_t)seconds * 1000000);
+        core_util_critical_section_exit();
+        synced = true;
+    }
+
+    _status.rtc_valid = synced;
+    if (synced) {
+        _status.syncs++;
+        _status.last_offset_us = _clock.getOffset();
+        _status.freq_ppb = _clock.getFrequency();
+    } else {
+        _status.failures++;
+    }
+
+    _mutex.unlock();
+
+    return synced;
+}
+
+void TimeServiceClass::setSlew(uint32_t max_ppb, uint32_t window_us) {
+    core_util_critical_section_enter();
+    _clock.setSlew(max_ppb, window_us);
+    core_util_critical_section_exit();
+}
+
+uint64_t TimeServiceClass::now() {
+    core_util_critical_section_enter();
+    uint64_t time = _clock.toTime(_raw());
+    core_util_critical_section_exit();
+
+    return time;
+}
+
+uint64_t TimeServiceClass::fromMicros(uint32_t micros_us) {
+    core_util_critical_section_enter();
+    uint64_t raw = _raw();
+    /* micros() is the low word of the ticker: go back by the elapsed time */
+    uint64_t time = _clock.toTime(raw - (uint32_t)((uint32_t)raw - micros_us));
+    core_util_critical_section_exit();
+
+    return time;
+}
+
+time_t TimeServiceClass::getEpoch() {
+    return (time_t)(now() / 1000000);
+}
+
+TimeServiceStatus TimeServiceClass::getStatus() {
+    _mutex.lock();
+    TimeServiceStatus status = _status;
+    _mutex.unlock();
+
+    return status;
+}
+
+void TimeServiceClass::_run() {
+    while (_running) {
+        rtos::ThisThread::flags_wait_any_for(MC_TS_STOP_FLAG, std::chrono::seconds(_resync_s));
+        if (_running) {
+            sync();
+        }
+    }
+}
+
+uint64_t TimeServiceClass::_raw() {
+    return ticker_read_us(get_us_ticker_data());
+}
+
+TimeServiceClass MachineControl_TimeService;
+/**** END OF FILE ****/
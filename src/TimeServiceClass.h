@@ -0,0 +1,123 @@
+/**
+ * @file TimeServiceClass.h
+ * @brief Header file for the time service of the Portenta Machine Control library.
+ *
+ * This library provides a monotonic 64-bit microsecond timestamp: the microsecond ticker of the
+ * Portenta H7, disciplined to the PCF8563T RTC at startup and on periodic resynchronizations.
+ */
+
+#ifndef __TIME_SERVICE_CLASS_H
+#define __TIME_SERVICE_CLASS_H
+
+/* Includes -------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <mbed.h>
+#include "RtcControllerClass.h"
+#include "utility/TIME/MonotonicClock.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    bool rtc_valid;         // The last resynchronization succeeded (RTC readable, VL bit clear)
+    uint32_t syncs;         // Number of successful resynchronizations
+    uint32_t failures;      // Number of failed resynchronizations
+    int64_t last_offset_us; // RTC time minus service time at the last resynchronization (us)
+    int32_t freq_ppb;       // Frequency correction applied to the microsecond ticker (ppb)
+} TimeServiceStatus;
+
+/* Class ----------------------------------------------------------------------*/
+
+/**
+ * @class TimeServiceClass
+ * @brief Class for the monotonic timestamps of the Portenta Machine Control.
+ *
+ * The timestamps are Unix time in microseconds once the service is synchronized to the RTC,
+ * time since boot before. They never go backward: a late service is stepped forward, an early one
+ * is slowed down until it meets the RTC again. now() is interrupt safe.
+ */
+class TimeServiceClass {
+    public:
+        /**
+         * @brief Construct the time service, counting from boot until it is synchronized.
+         */
+        TimeServiceClass();
+
+        /**
+         * @brief Destruct the TimeServiceClass object, stopping the resynchronization thread.
+         */
+        ~TimeServiceClass();
+
+        /**
+         * @brief Synchronize the service to the RTC and start the periodic resynchronization.
+         *
+         * @param resync_s resynchronization period in s, 0 to resynchronize only on sync() calls
+         * @return true If the first synchronization succeeded, false otherwise (the service keeps counting from boot)
+         */
+        bool begin(uint32_t resync_s = 600);
+
+        /**
+         * @brief Stop the periodic resynchronization, the timestamps keep running.
+         */
+        void end();
+
+        /**
+         * @brief Synchronize the service to the next second transition of the RTC.
+         *
+         * Blocks for up to a second, sleeping until the RTC countdown timer interrupt marks the transition.
+         * Fails while a timer callback is attached with MachineControl_RTCController.attachTimer().
+         *
+         * @return true If the service is synchronized, false if the RTC could not be read or its time is not valid
+         */
+        bool sync();
+
+        /**
+         * @brief Set the largest phase correction rate and the time over which a phase error is absorbed.
+         *
+         * @param max_ppb largest slew rate in ppb (default 500000)
+         * @param window_us time over which a phase error is absorbed in us (default 60 s)
+         */
+        void setSlew(uint32_t max_ppb, uint32_t window_us);
+
+        /**
+         * @brief Get the current timestamp, interrupt safe.
+         *
+         * @return uint64_t timestamp in us
+         */
+        uint64_t now();
+
+        /**
+         * @brief Convert a micros() value taken in the last 71 minutes to a timestamp.
+         *
+         * @param micros_us value returned by micros()
+         * @return uint64_t timestamp in us
+         */
+        uint64_t fromMicros(uint32_t micros_us);
+
+        /**
+         * @brief Get the current time in seconds.
+         *
+         * @return time_t seconds since the Unix epoch (since boot if not synchronized)
+         */
+        time_t getEpoch();
+
+        /**
+         * @brief Get the synchronization state of the service.
+         *
+         * @return TimeServiceStatus state of the service
+         */
+        TimeServiceStatus getStatus();
+
+    private:
+        MonotonicClock _clock;            // Ticker to timestamp mapping, accessed in critical sections
+        rtos::Mutex _mutex;               // Serializes the resynchronizations
+        rtos::Thread* _thread;            // Resynchronization thread
+        uint32_t _resync_s;               // Resynchronization period in s
+        volatile bool _running;           // Resynchronization thread state
+        TimeServiceStatus _status;        // Synchronization state
+
+        void _run();
+        uint64_t _raw();
+};
+
+extern TimeServiceClass MachineControl_TimeService;
+
+#endif /* __TIME_SERVICE_CLASS_H */
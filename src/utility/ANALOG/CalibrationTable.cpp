@@ -0,0 +1,291 @@
+#include "CalibrationTable.h"
+
+#define CAL_BLOB_MAGIC0 'P'
+#define CAL_BLOB_MAGIC1 'M'
+#define CAL_BLOB_MAGIC2 'C'
+#define CAL_BLOB_MAGIC3 'A'
+
+#define CAL_BLOB_HEADER_SIZE 6
+#define CAL_BLOB_CRC_SIZE    2
+
+static inline void putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline void putU32(uint8_t* out, uint32_t value) {
+    putU16(out, value & 0xFFFF);
+    putU16(out + 2, value >> 16);
+}
+
+static inline uint16_t getU16(const uint8_t* in) {
+    return (uint16_t)in[0] | ((uint16_t)in[1] << 8);
+}
+
+static inline uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)getU16(in) | ((uint32_t)getU16(in + 2) << 16);
+}
+
+CalibrationTable::CalibrationTable() {
+    reset();
+}
+
+void CalibrationTable::reset() {
+    for (uint8_t slot = 0; slot < CAL_SLOTS; slot++) {
+        clear(slot);
+    }
+}
+
+void CalibrationTable::clear(uint8_t slot) {
+    if (slot >= CAL_SLOTS) {
+        return;
+    }
+
+    CalibrationEntry& entry = _entries[slot];
+    entry.mode = CAL_MODE_NONE;
+    entry.points = 0;
+    entry.gain = 1L << 16;
+    entry.offset = 0;
+}
+
+bool CalibrationTable::setLinear(uint8_t slot, int32_t gain_q16, int32_t offset) {
+    if (slot >= CAL_SLOTS) {
+        return false;
+    }
+
+    CalibrationEntry& entry = _entries[slot];
+    entry.mode = CAL_MODE_NONE;
+    entry.gain = gain_q16;
+    entry.offset = offset;
+    entry.points = 0;
+    entry.mode = CAL_MODE_LINEAR;
+
+    return true;
+}
+
+bool CalibrationTable::setTable(uint8_t slot, const uint16_t* raw, const uint16_t* ref, uint8_t points) {
+    if (slot >= CAL_SLOTS || points < 2 || points > CAL_MAX_POINTS) {
+        return false;
+    }
+
+    // the slopes are Q16.16: a segment steeper than 32767 counts per count does not fit
+    for (uint8_t i = 1; i < points; i++) {
+        if (raw[i] <= raw[i - 1]) {
+            return false;
+        }
+        int64_t rise = ((int64_t)ref[i] - ref[i - 1]) * 65536;
+        int64_t slope = rise / ((int32_t)raw[i] - raw[i - 1]);
+        if (slope > INT32_MAX || slope < INT32_MIN) {
+            return false;
+        }
+    }
+
+    CalibrationEntry& entry = _entries[slot];
+    entry.mode = CAL_MODE_NONE;
+    for (uint8_t i = 0; i < points; i++) {
+        entry.raw[i] = raw[i];
+        entry.ref[i] = ref[i];
+    }
+    // precompute the slopes so that apply() never divides
+    for (uint8_t i = 0; i < points - 1; i++) {
+        int64_t rise = ((int64_t)ref[i + 1] - ref[i]) * 65536;
+        entry.slope[i] = (int32_t)(rise / ((int32_t)raw[i + 1] - raw[i]));
+    }
+    entry.points = points;
+    entry.mode = CAL_MODE_TABLE;
+
+    return true;
+}
+
+bool CalibrationTable::getEntry(uint8_t slot, CalibrationEntry& entry) {
+    if (slot >= CAL_SLOTS) {
+        return false;
+    }
+
+    entry = _entries[slot];
+    return true;
+}
+
+bool CalibrationTable::isActive(uint8_t slot) {
+    return (slot < CAL_SLOTS) && (_entries[slot].mode != CAL_MODE_NONE);
+}
+
+uint16_t CalibrationTable::clamp(int64_t value) {
+    if (value < 0) {
+        return 0;
+    }
+    if (value > 0xFFFF) {
+        return 0xFFFF;
+    }
+    return (uint16_t)value;
+}
+
+uint16_t CalibrationTable::apply(uint8_t slot, uint16_t value) {
+    if (slot >= CAL_SLOTS) {
+        return value;
+    }
+
+    const CalibrationEntry& entry = _entries[slot];
+
+    switch (entry.mode) {
+        case CAL_MODE_LINEAR:
+            return clamp((((int64_t)value * entry.gain + 0x8000) >> 16) + entry.offset);
+        case CAL_MODE_TABLE: {
+            // segment search, values outside the table extrapolate the end segments
+            uint8_t seg = 0;
+            while (seg < entry.points - 2 && value >= entry.raw[seg + 1]) {
+                seg++;
+            }
+            int64_t delta = (int64_t)value - entry.raw[seg];
+            return clamp(entry.ref[seg] + ((delta * entry.slope[seg] + 0x8000) >> 16));
+        }
+        default:
+            return value;
+    }
+}
+
+size_t CalibrationTable::serializedSize() {
+    size_t len = CAL_BLOB_HEADER_SIZE + CAL_BLOB_CRC_SIZE;
+
+    for (uint8_t slot = 0; slot < CAL_SLOTS; slot++) {
+        switch (_entries[slot].mode) {
+            case CAL_MODE_LINEAR:
+                len += 2 + 8;
+                break;
+            case CAL_MODE_TABLE:
+                len += 2 + 1 + 4 * _entries[slot].points;
+                break;
+            default:
+                break;
+        }
+    }
+    return len;
+}
+
+size_t CalibrationTable::serialize(uint8_t* out, size_t max_len) {
+    size_t len = serializedSize();
+    if (len > max_len) {
+        return 0;
+    }
+
+    size_t pos = CAL_BLOB_HEADER_SIZE;
+    uint8_t count = 0;
+
+    for (uint8_t slot = 0; slot < CAL_SLOTS; slot++) {
+        const CalibrationEntry& entry = _entries[slot];
+        if (entry.mode == CAL_MODE_NONE) {
+            continue;
+        }
+
+        out[pos++] = slot;
+        out[pos++] = entry.mode;
+        if (entry.mode == CAL_MODE_LINEAR) {
+            putU32(&out[pos], (uint32_t)entry.gain);
+            putU32(&out[pos + 4], (uint32_t)entry.offset);
+            pos += 8;
+        } else {
+            out[pos++] = entry.points;
+            for (uint8_t i = 0; i < entry.points; i++) {
+                putU16(&out[pos], entry.raw[i]);
+                putU16(&out[pos + 2], entry.ref[i]);
+                pos += 4;
+            }
+        }
+        count++;
+    }
+
+    out[0] = CAL_BLOB_MAGIC0;
+    out[1] = CAL_BLOB_MAGIC1;
+    out[2] = CAL_BLOB_MAGIC2;
+    out[3] = CAL_BLOB_MAGIC3;
+    out[4] = CAL_BLOB_VERSION;
+    out[5] = count;
+
+    putU16(&out[pos], crc16(out, pos));
+    pos += CAL_BLOB_CRC_SIZE;
+
+    return pos;
+}
+
+bool CalibrationTable::deserialize(const uint8_t* in, size_t len) {
+    if (len < CAL_BLOB_HEADER_SIZE + CAL_BLOB_CRC_SIZE) {
+        return false;
+    }
+    if (in[0] != CAL_BLOB_MAGIC0 || in[1] != CAL_BLOB_MAGIC1 || in[2] != CAL_BLOB_MAGIC2 || in[3] != CAL_BLOB_MAGIC3) {
+        return false;
+    }
+    if (in[4] != CAL_BLOB_VERSION) {
+        return false;
+    }
+
+    size_t end = len - CAL_BLOB_CRC_SIZE;
+    if (crc16(in, end) != getU16(&in[end])) {
+        return false;
+    }
+
+    // first pass: validate the layout without touching the current entries
+    size_t pos = CAL_BLOB_HEADER_SIZE;
+    for (uint8_t n = 0; n < in[5]; n++) {
+        if (pos + 2 > end || in[pos] >= CAL_SLOTS) {
+            return false;
+        }
+        uint8_t mode = in[pos + 1];
+        pos += 2;
+        if (mode == CAL_MODE_LINEAR) {
+            pos += 8;
+        } else if (mode == CAL_MODE_TABLE) {
+            if (pos + 1 > end || in[pos] < 2 || in[pos] > CAL_MAX_POINTS) {
+                return false;
+            }
+            pos += 1 + 4 * in[pos];
+        } else {
+            return false;
+        }
+        if (pos > end) {
+            return false;
+        }
+    }
+    if (pos != end) {
+        return false;
+    }
+
+    // second pass: load
+    reset();
+    pos = CAL_BLOB_HEADER_SIZE;
+    for (uint8_t n = 0; n < in[5]; n++) {
+        uint8_t slot = in[pos];
+        uint8_t mode = in[pos + 1];
+        pos += 2;
+        if (mode == CAL_MODE_LINEAR) {
+            setLinear(slot, (int32_t)getU32(&in[pos]), (int32_t)getU32(&in[pos + 4]));
+            pos += 8;
+        } else {
+            uint8_t points = in[pos++];
+            uint16_t raw[CAL_MAX_POINTS];
+            uint16_t ref[CAL_MAX_POINTS];
+            for (uint8_t i = 0; i < points; i++) {
+                raw[i] = getU16(&in[pos]);
+                ref[i] = getU16(&in[pos + 2]);
+                pos += 4;
+            }
+            if (!setTable(slot, raw, ref, points)) {
+                reset();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+uint16_t CalibrationTable::crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
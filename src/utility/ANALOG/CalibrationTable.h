@@ -0,0 +1,62 @@
+#ifndef _CALIBRATION_TABLE_H_
+#define _CALIBRATION_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CAL_SLOTS        16 // Number of calibration entries
+#define CAL_MAX_POINTS   8  // Maximum number of points of a multi-point table
+
+#define CAL_MODE_NONE    0  // Identity (nominal constants only)
+#define CAL_MODE_LINEAR  1  // Gain/offset correction
+#define CAL_MODE_TABLE   2  // Piecewise linear multi-point correction
+
+#define CAL_BLOB_VERSION 1
+#define CAL_BLOB_MAX_SIZE (6 + 2 + CAL_SLOTS * (3 + 4 * CAL_MAX_POINTS))
+
+typedef struct {
+    uint8_t mode;                     // CAL_MODE_NONE, CAL_MODE_LINEAR or CAL_MODE_TABLE
+    uint8_t points;                   // Number of points of the table (CAL_MODE_TABLE)
+    int32_t gain;                     // Gain in Q16.16 (CAL_MODE_LINEAR)
+    int32_t offset;                   // Offset in counts (CAL_MODE_LINEAR)
+    uint16_t raw[CAL_MAX_POINTS];     // Measured values, strictly increasing (CAL_MODE_TABLE)
+    uint16_t ref[CAL_MAX_POINTS];     // Reference values (CAL_MODE_TABLE)
+    int32_t slope[CAL_MAX_POINTS];    // Precomputed segment slopes in Q16.16, not persisted (CAL_MODE_TABLE)
+} CalibrationEntry;
+
+/*
+ * Per-slot gain/offset or multi-point correction of 16-bit counts.
+ * apply() uses integer math only and no division, so it can run on
+ * every sample in the acquisition path.
+ *
+ * Blob layout (little endian):
+ *   'P' 'M' 'C' 'A' | version u8 | entries u8 | entry... | crc16 (CCITT) u16
+ *   entry: slot u8 | mode u8 | linear: gain i32, offset i32
+ *                            | table: points u8, points x (raw u16, ref u16)
+ */
+class CalibrationTable {
+public:
+    CalibrationTable();
+
+    void reset();
+    void clear(uint8_t slot);
+    bool setLinear(uint8_t slot, int32_t gain_q16, int32_t offset);
+    bool setTable(uint8_t slot, const uint16_t* raw, const uint16_t* ref, uint8_t points);
+    bool getEntry(uint8_t slot, CalibrationEntry& entry);
+    bool isActive(uint8_t slot);
+
+    uint16_t apply(uint8_t slot, uint16_t value);
+
+    size_t serializedSize();
+    size_t serialize(uint8_t* out, size_t max_len);
+    bool deserialize(const uint8_t* in, size_t len);
+
+    static uint16_t crc16(const uint8_t* data, size_t len);
+
+private:
+    CalibrationEntry _entries[CAL_SLOTS];
+
+    static uint16_t clamp(int64_t value);
+};
+
+#endif
@@ -0,0 +1,334 @@
+#include "HighResPwmOut.h"
+
+#define HRPWM_MAX_PERIOD_COUNTS 0xFFFF
+#define HRPWM_NO_IRQ            ((IRQn_Type)-128)
+
+HighResPwmOut* HighResPwmOut::_outputs[MC_PWM_OUTPUTS];
+
+// general purpose timer of the pin in the mbed pinmap, nullptr for the other PWM sources (e.g. the HRTIM)
+static TIM_TypeDef* pwmTimer(PinName pin) {
+    TIM_TypeDef* tim = (TIM_TypeDef*)pinmap_find_peripheral(pin, PinMap_PWM);
+
+    if (tim == TIM1 || tim == TIM3 || tim == TIM8) {
+        return tim;
+    }
+    return nullptr;
+}
+
+static IRQn_Type updateIrqn(TIM_TypeDef* tim) {
+#if defined(TIM1)
+    if (tim == TIM1) {
+        return TIM1_UP_IRQn;
+    }
+#endif
+#if defined(TIM2)
+    if (tim == TIM2) {
+        return TIM2_IRQn;
+    }
+#endif
+#if defined(TIM3)
+    if (tim == TIM3) {
+        return TIM3_IRQn;
+    }
+#endif
+#if defined(TIM4)
+    if (tim == TIM4) {
+        return TIM4_IRQn;
+    }
+#endif
+#if defined(TIM5)
+    if (tim == TIM5) {
+        return TIM5_IRQn;
+    }
+#endif
+#if defined(TIM8)
+    if (tim == TIM8) {
+        return TIM8_UP_TIM13_IRQn;
+    }
+#endif
+#if defined(TIM12)
+    if (tim == TIM12) {
+        return TIM8_BRK_TIM12_IRQn;
+    }
+#endif
+#if defined(TIM13)
+    if (tim == TIM13) {
+        return TIM8_UP_TIM13_IRQn;
+    }
+#endif
+#if defined(TIM14)
+    if (tim == TIM14) {
+        return TIM8_TRG_COM_TIM14_IRQn;
+    }
+#endif
+#if defined(TIM15)
+    if (tim == TIM15) {
+        return TIM15_IRQn;
+    }
+#endif
+#if defined(TIM16)
+    if (tim == TIM16) {
+        return TIM16_IRQn;
+    }
+#endif
+#if defined(TIM17)
+    if (tim == TIM17) {
+        return TIM17_IRQn;
+    }
+#endif
+    return HRPWM_NO_IRQ;
+}
+
+HighResPwmOut::HighResPwmOut(PinName pin) : mbed::PwmOut(pin), _tim(pwmTimer(pin)), _tim_clk(0), _period_us(0), _target_q16(0), _dither_acc(0), _duty(0), _dither(false), _latch_pending(false) {
+    if (_tim == nullptr) {
+        return;
+    }
+
+    // before another output of the same timer changes its prescaler
+    timerClock();
+
+    for (int i = 0; i < MC_PWM_OUTPUTS; i++) {
+        if (_outputs[i] == nullptr) {
+            _outputs[i] = this;
+            break;
+        }
+    }
+}
+
+HighResPwmOut::~HighResPwmOut() {
+    setDither(false);
+    for (int i = 0; i < MC_PWM_OUTPUTS; i++) {
+        if (_outputs[i] == this) {
+            _outputs[i] = nullptr;
+        }
+    }
+}
+
+TIM_TypeDef* HighResPwmOut::timer() {
+    return _tim;
+}
+
+uint32_t HighResPwmOut::timerClock() {
+    if (_tim_clk == 0) {
+        // mbed programs the prescaler for a tick of (_pwm.prescaler) us:
+        // recover the timer input clock before the timebase is changed
+        TIM_TypeDef* tim = timer();
+        _tim_clk = (uint32_t)(((uint64_t)(tim->PSC + 1) * 1000000) / _pwm.prescaler);
+    }
+    return _tim_clk;
+}
+
+bool HighResPwmOut::setPeriodUs(uint32_t period_us) {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        if (period_us == 0 || period_us > INT32_MAX) {
+            return false;
+        }
+        mbed::PwmOut::period_us((int)period_us);
+        _period_us = period_us;
+        writeDuty(_duty);
+        return true;
+    }
+
+    uint64_t ticks = ((uint64_t)timerClock() * period_us) / 1000000;
+
+    if (ticks < 2) {
+        return false;
+    }
+
+    uint32_t psc = (uint32_t)((ticks - 1) / HRPWM_MAX_PERIOD_COUNTS);
+    if (psc > 0xFFFF) {
+        return false;
+    }
+    uint32_t arr = (uint32_t)(ticks / (psc + 1)) - 1;
+
+    core_util_critical_section_enter();
+    tim->PSC = psc;
+    tim->ARR = arr;
+    // force the update event so that the new prescaler is loaded now
+    tim->EGR = TIM_EGR_UG;
+    _period_us = period_us;
+    core_util_critical_section_exit();
+
+    writeDuty(_duty);
+
+    return true;
+}
+
+uint32_t HighResPwmOut::getPeriodUs() {
+    return _period_us;
+}
+
+uint32_t HighResPwmOut::getPeriodCounts() {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        // the 1 us tick of mbed
+        return _period_us;
+    }
+    return tim->ARR + 1;
+}
+
+void HighResPwmOut::writeCounts(uint32_t counts) {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        uint32_t period = getPeriodCounts();
+        mbed::PwmOut::write((period == 0) ? 0.0f : (counts >= period) ? 1.0f : (float)counts / period);
+        return;
+    }
+
+    volatile uint32_t* ccr = &tim->CCR1 + (_pwm.channel - 1);
+    uint32_t period = tim->ARR + 1;
+
+    *ccr = (counts > period) ? period : counts;
+}
+
+void HighResPwmOut::writeDuty(uint16_t duty) {
+    if (timer() == nullptr) {
+        _duty = duty;
+        mbed::PwmOut::write(duty / 65535.0f);
+        return;
+    }
+
+    uint64_t product = (uint64_t)duty * getPeriodCounts();
+    // counts in Q16: duty * period / 65535 without division
+    uint32_t target_q16 = (uint32_t)(product + (product >> 16));
+
+    _duty = duty;
+    _target_q16 = target_q16;
+
+    if (!_dither) {
+        writeCounts((target_q16 + 0x8000) >> 16);
+    }
+}
+
+uint16_t HighResPwmOut::getDuty() {
+    return _duty;
+}
+
+void HighResPwmOut::holdUpdate() {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        return;
+    }
+    // with UDIS set the update event does not transfer the preload registers
+    tim->CR1 |= TIM_CR1_UDIS;
+}
+
+void HighResPwmOut::releaseUpdate() {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        return;
+    }
+    tim->SR = ~TIM_SR_UIF;
+    _latch_pending = true;
+    tim->CR1 &= ~TIM_CR1_UDIS;
+}
+
+bool HighResPwmOut::updateLatched() {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        return true;
+    }
+
+    // updateIrq() clears the flag first while the update interrupt is enabled
+    if (_latch_pending && (tim->SR & TIM_SR_UIF)) {
+        _latch_pending = false;
+    }
+    return !_latch_pending;
+}
+
+void HighResPwmOut::restartPeriod() {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        return;
+    }
+    // the update generation resets the counter and latches the preloaded registers
+    tim->EGR = TIM_EGR_UG;
+}
+
+bool HighResPwmOut::setDither(bool enable) {
+    TIM_TypeDef* tim = timer();
+
+    if (tim == nullptr) {
+        return !enable;
+    }
+
+    IRQn_Type irq = updateIrqn(tim);
+
+    if (enable && irq == HRPWM_NO_IRQ) {
+        return false;
+    }
+
+    core_util_critical_section_enter();
+    _dither_acc = 0;
+    _dither = enable;
+    if (enable) {
+        NVIC_SetVector(irq, (uintptr_t)&HighResPwmOut::updateIrq);
+        NVIC_EnableIRQ(irq);
+        tim->DIER |= TIM_DIER_UIE;
+    } else if (!timerDithers(tim)) {
+        // the vector stays installed, the other outputs of the timer may still dither
+        tim->DIER &= ~TIM_DIER_UIE;
+    }
+    core_util_critical_section_exit();
+
+    if (!enable) {
+        writeDuty(_duty);
+    }
+    return true;
+}
+
+bool HighResPwmOut::getDither() {
+    return _dither;
+}
+
+bool HighResPwmOut::timerDithers(TIM_TypeDef* tim) {
+    for (int i = 0; i < MC_PWM_OUTPUTS; i++) {
+        if (_outputs[i] != nullptr && _outputs[i]->timer() == tim && _outputs[i]->_dither) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HighResPwmOut::updateIrq() {
+    // several outputs can share a timer: serve all of them before clearing the flag
+    for (int i = 0; i < MC_PWM_OUTPUTS; i++) {
+        HighResPwmOut* out = _outputs[i];
+        if (out != nullptr && (out->timer()->SR & TIM_SR_UIF)) {
+            out->_latch_pending = false;
+            out->ditherTick();
+        }
+    }
+    for (int i = 0; i < MC_PWM_OUTPUTS; i++) {
+        HighResPwmOut* out = _outputs[i];
+        if (out != nullptr && (out->timer()->SR & TIM_SR_UIF)) {
+            out->timer()->SR = ~TIM_SR_UIF;
+        }
+    }
+}
+
+void HighResPwmOut::ditherTick() {
+    if (!_dither) {
+        return;
+    }
+
+    uint32_t target_q16 = _target_q16;
+    uint32_t counts = target_q16 >> 16;
+
+    // first order sigma-delta: carry the fractional count until it overflows
+    _dither_acc += target_q16 & 0xFFFF;
+    if (_dither_acc >= 0x10000) {
+        _dither_acc -= 0x10000;
+        counts++;
+    }
+
+    writeCounts(counts);
+}
@@ -0,0 +1,77 @@
+#ifndef _HIGH_RES_PWM_OUT_H_
+#define _HIGH_RES_PWM_OUT_H_
+
+#include <Arduino.h>
+#include <mbed.h>
+
+#ifndef MC_PWM_OUTPUTS
+#define MC_PWM_OUTPUTS 8 // HighResPwmOut objects served by the timer update interrupt
+#endif
+
+/*
+ * PwmOut driving the STM32 timer registers directly: the period is set
+ * with the timer input clock as resolution (instead of the 1us tick used
+ * by mbed) and the duty cycle is written in timer counts, without float
+ * math. An optional first-order sigma-delta dither spreads the fractional
+ * part of the duty cycle over consecutive PWM periods: ditherTick() is run
+ * from the timer update interrupt, enabled while an output of the timer
+ * dithers, so the correction is applied once per period.
+ *
+ * holdUpdate()/releaseUpdate() bracket a group of writes so that the
+ * preloaded compare value is latched on the first update event after the
+ * release, updateLatched() reports when that happened. Each timer latches
+ * on its own update event: outputs on different timers change in the same
+ * PWM period only when their periods are equal and their timers have been
+ * restarted together with restartPeriod().
+ *
+ * Only the pins of TIM1, TIM3 and TIM8 in the mbed pinmap are driven
+ * through the timer registers. Any other pin, e.g. PG_7 which the core
+ * drives from the HRTIM, keeps the mbed::PwmOut driver: 1 us period
+ * counts, no dither, and the writes are applied at once.
+ *
+ * Once setPeriodUs() has been called, PwmOut::write()/period*() must not be
+ * used anymore on the object since mbed is not aware of the new timebase.
+ */
+class HighResPwmOut : public mbed::PwmOut {
+public:
+    HighResPwmOut(PinName pin);
+    ~HighResPwmOut();
+
+    bool setPeriodUs(uint32_t period_us);
+    uint32_t getPeriodUs();
+    uint32_t getPeriodCounts();
+
+    void writeCounts(uint32_t counts);
+    void writeDuty(uint16_t duty);
+    uint16_t getDuty();
+
+    void holdUpdate();
+    void releaseUpdate();
+    bool updateLatched();
+    void restartPeriod();
+
+    // Return false if the timer has no update interrupt to run the dither
+    bool setDither(bool enable);
+    bool getDither();
+    void ditherTick();
+
+private:
+    TIM_TypeDef* _tim;             // Timer driven through its registers, nullptr on the mbed driver
+    uint32_t _tim_clk;
+    uint32_t _period_us;
+    volatile uint32_t _target_q16;
+    uint32_t _dither_acc;
+    uint16_t _duty;
+    volatile bool _dither;
+    volatile bool _latch_pending;
+
+    static HighResPwmOut* _outputs[MC_PWM_OUTPUTS];
+
+    uint32_t timerClock();
+    TIM_TypeDef* timer();
+    bool timerDithers(TIM_TypeDef* tim);
+
+    static void updateIrq();
+};
+
+#endif
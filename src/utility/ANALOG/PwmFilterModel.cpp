@@ -0,0 +1,52 @@
+#include "PwmFilterModel.h"
+#include <math.h>
+
+float PwmFilterModel::ripple(float full_scale_v, float period_us, float duty, float rc_us) {
+    if (period_us <= 0 || rc_us <= 0 || duty <= 0 || duty >= 1) {
+        return 0;
+    }
+
+    // steady state of a square wave through a single pole:
+    // Vpp = V * (1 - e^(-D*T/RC)) * (1 - e^(-(1-D)*T/RC)) / (1 - e^(-T/RC))
+    float on = expf(-duty * period_us / rc_us);
+    float off = expf(-(1 - duty) * period_us / rc_us);
+    float full = expf(-period_us / rc_us);
+
+    return full_scale_v * (1 - on) * (1 - off) / (1 - full);
+}
+
+float PwmFilterModel::settlingTime(float period_us, float rc_us, float tolerance) {
+    if (rc_us <= 0 || tolerance <= 0 || tolerance >= 1) {
+        return 0;
+    }
+
+    // exponential settling plus the worst case latency of one PWM period before the new duty is applied
+    return rc_us * logf(1 / tolerance) + period_us;
+}
+
+PwmFilterReport PwmFilterModel::evaluate(float full_scale_v, float period_us, uint32_t period_counts, float rc_us,
+                                         bool dither, float tolerance) {
+    PwmFilterReport report = {};
+
+    if (period_counts == 0) {
+        return report;
+    }
+
+    // the ripple is maximal at 50% duty cycle
+    report.ripple_v = ripple(full_scale_v, period_us, 0.5f, rc_us);
+    report.settling_us = settlingTime(period_us, rc_us, tolerance);
+    report.lsb_v = full_scale_v / period_counts;
+    report.effective_bits = log2f((float)period_counts);
+
+    if (dither && period_us > 0 && rc_us > period_us) {
+        // the dither runs once per PWM period: the filter averages about RC / T dithered periods,
+        // up to the 16 fractional bits of the dither accumulator
+        float gain = log2f(rc_us / period_us);
+        report.effective_bits += (gain > 16) ? 16 : gain;
+        if (report.effective_bits > 32) {
+            report.effective_bits = 32;
+        }
+    }
+
+    return report;
+}
@@ -0,0 +1,36 @@
+#ifndef _PWM_FILTER_MODEL_H_
+#define _PWM_FILTER_MODEL_H_
+
+#include <stdint.h>
+
+typedef struct {
+    float ripple_v;       // Steady state peak-to-peak ripple at the filter output (V)
+    float settling_us;    // Time to settle within the tolerance after a full scale step (us)
+    float lsb_v;          // Output step of one timer count (V)
+    float effective_bits; // Effective resolution, including the dither gain
+} PwmFilterReport;
+
+/*
+ * Analytic model of a PWM output followed by a first order RC filter.
+ * It has no hardware dependency and can be used to compare carrier
+ * periods, timer resolutions and dither settings before committing to one.
+ *
+ * ripple() is the steady state peak-to-peak ripple of a square wave
+ * through a single pole, maximal at 50% duty cycle where it is
+ * V * tanh(T / 4RC), about V * T / 4RC when the period is short.
+ * settlingTime() is the exponential settling RC * ln(1 / tolerance)
+ * plus one PWM period, the worst case before a new duty cycle is
+ * latched. With the dither, run once per PWM period by HighResPwmOut,
+ * the filter averages about RC / T periods: evaluate() adds log2(RC / T)
+ * bits to the timer resolution, up to the 16 fractional bits of the
+ * dither accumulator.
+ */
+class PwmFilterModel {
+public:
+    static float ripple(float full_scale_v, float period_us, float duty, float rc_us);
+    static float settlingTime(float period_us, float rc_us, float tolerance);
+    static PwmFilterReport evaluate(float full_scale_v, float period_us, uint32_t period_counts, float rc_us,
+                                    bool dither = false, float tolerance = 0.001f);
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "TransientCapture.h"
+
+#define CAPTURE_EXPORT_MAGIC0  'P'
+#define CAPTURE_EXPORT_MAGIC1  'C'
+#define CAPTURE_EXPORT_VERSION 2
+
+static size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        if (out) {
+            out[len] = (uint8_t)(value | 0x80);
+        }
+        value >>= 7;
+        len++;
+    }
+    if (out) {
+        out[len] = (uint8_t)value;
+    }
+    return len + 1;
+}
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline void putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static inline void putU32(uint8_t* out, uint32_t value) {
+    putU16(out, value & 0xFFFF);
+    putU16(out + 2, value >> 16);
+}
+
+static inline void putU64(uint8_t* out, uint64_t value) {
+    putU32(out, (uint32_t)value);
+    putU32(out + 4, (uint32_t)(value >> 32));
+}
+
+TransientCapture::TransientCapture() : _head(0), _filled(0), _remaining(0), _level(0), _pre(0), _post(0), _previous(0), _has_previous(false), _state(CAPTURE_IDLE) {
+    _info = {};
+}
+
+bool TransientCapture::arm(uint8_t channel, uint8_t trigger, uint16_t level, uint16_t pre_samples, uint16_t post_samples) {
+    if (post_samples == 0 || ((size_t)pre_samples + post_samples) > MC_AI_CAPTURE_DEPTH) {
+        return false;
+    }
+    if (!(trigger & (CAPTURE_TRIGGER_RISING | CAPTURE_TRIGGER_FALLING))) {
+        return false;
+    }
+
+    _state = CAPTURE_IDLE;
+
+    _head = 0;
+    _filled = 0;
+    _remaining = 0;
+    _level = level;
+    _pre = pre_samples;
+    _post = post_samples;
+    _has_previous = false;
+
+    _info = {};
+    _info.channel = channel;
+    _info.trigger = trigger;
+
+    _state = CAPTURE_ARMED;
+    return true;
+}
+
+void TransientCapture::disarm() {
+    _state = CAPTURE_IDLE;
+}
+
+uint8_t TransientCapture::getState() {
+    return _state;
+}
+
+bool TransientCapture::isRunning() {
+    return _state == CAPTURE_ARMED || _state == CAPTURE_TRIGGERED;
+}
+
+uint8_t TransientCapture::getChannel() {
+    return _info.channel;
+}
+
+bool TransientCapture::triggered(uint16_t sample) {
+    if (!_has_previous) {
+        return false;
+    }
+
+    if (_info.trigger & CAPTURE_TRIGGER_SLOPE) {
+        int32_t delta = (int32_t)sample - (int32_t)_previous;
+        if ((_info.trigger & CAPTURE_TRIGGER_RISING) && delta >= (int32_t)_level) {
+            return true;
+        }
+        if ((_info.trigger & CAPTURE_TRIGGER_FALLING) && -delta >= (int32_t)_level) {
+            return true;
+        }
+    } else {
+        if ((_info.trigger & CAPTURE_TRIGGER_RISING) && _previous < _level && sample >= _level) {
+            return true;
+        }
+        if ((_info.trigger & CAPTURE_TRIGGER_FALLING) && _previous > _level && sample <= _level) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TransientCapture::update(uint16_t sample, uint32_t sample_index, uint64_t timestamp_us) {
+    uint8_t state = _state;
+    bool frozen = false;
+
+    if (state != CAPTURE_ARMED && state != CAPTURE_TRIGGERED) {
+        return false;
+    }
+
+    _buffer[_head] = sample;
+    _head = (_head + 1 == MC_AI_CAPTURE_DEPTH) ? 0 : _head + 1;
+    if (_filled < MC_AI_CAPTURE_DEPTH) {
+        _filled++;
+    }
+
+    if (state == CAPTURE_ARMED) {
+        if (triggered(sample)) {
+            // samples already in the history, trigger sample excluded
+            size_t history = _filled - 1;
+            _info.pre_samples = (history < _pre) ? history : _pre;
+            _info.post_samples = 1;
+            _info.trigger_sample = sample_index;
+            _info.trigger_us = timestamp_us;
+            _remaining = _post - 1;
+            state = CAPTURE_TRIGGERED;
+        }
+    } else {
+        _info.post_samples++;
+        _remaining--;
+    }
+
+    if (state == CAPTURE_TRIGGERED && _remaining == 0) {
+        state = CAPTURE_READY;
+        frozen = true;
+    }
+
+    _previous = sample;
+    _has_previous = true;
+    _state = state;
+
+    return frozen;
+}
+
+CaptureInfo TransientCapture::getInfo() {
+    return _info;
+}
+
+size_t TransientCapture::getCount() {
+    if (_state != CAPTURE_READY) {
+        return 0;
+    }
+    return (size_t)_info.pre_samples + _info.post_samples;
+}
+
+uint16_t TransientCapture::getSample(size_t index) {
+    size_t count = getCount();
+    if (index >= count) {
+        return 0;
+    }
+
+    size_t start = (_head + MC_AI_CAPTURE_DEPTH - count) % MC_AI_CAPTURE_DEPTH;
+    return _buffer[(start + index) % MC_AI_CAPTURE_DEPTH];
+}
+
+size_t TransientCapture::exportSize(uint8_t format) {
+    size_t count = getCount();
+    if (count == 0) {
+        return 0;
+    }
+
+    if (format == CAPTURE_EXPORT_RAW) {
+        return CAPTURE_EXPORT_HEADER_SIZE + count * 2;
+    }
+
+    size_t len = CAPTURE_EXPORT_HEADER_SIZE + 2;
+    uint16_t previous = getSample(0);
+    for (size_t i = 1; i < count; i++) {
+        uint16_t sample = getSample(i);
+        len += putVarint(nullptr, zigzag((int32_t)sample - (int32_t)previous));
+        previous = sample;
+    }
+    return len;
+}
+
+size_t TransientCapture::exportRecord(uint8_t* out, size_t max_len, uint8_t format) {
+    if (format != CAPTURE_EXPORT_RAW && format != CAPTURE_EXPORT_DELTA) {
+        return 0;
+    }
+
+    size_t len = exportSize(format);
+    if (len == 0 || len > max_len) {
+        return 0;
+    }
+
+    size_t count = getCount();
+
+    out[0] = CAPTURE_EXPORT_MAGIC0;
+    out[1] = CAPTURE_EXPORT_MAGIC1;
+    out[2] = CAPTURE_EXPORT_VERSION;
+    out[3] = format;
+    out[4] = _info.channel;
+    out[5] = _info.trigger;
+    putU16(&out[6], _info.pre_samples);
+    putU16(&out[8], _info.post_samples);
+    putU32(&out[10], _info.trigger_sample);
+    putU64(&out[14], _info.trigger_us);
+    putU16(&out[22], (uint16_t)count);
+
+    size_t pos = CAPTURE_EXPORT_HEADER_SIZE;
+    if (format == CAPTURE_EXPORT_RAW) {
+        for (size_t i = 0; i < count; i++) {
+            putU16(&out[pos], getSample(i));
+            pos += 2;
+        }
+    } else {
+        uint16_t previous = getSample(0);
+        putU16(&out[pos], previous);
+        pos += 2;
+        for (size_t i = 1; i < count; i++) {
+            uint16_t sample = getSample(i);
+            pos += putVarint(&out[pos], zigzag((int32_t)sample - (int32_t)previous));
+            previous = sample;
+        }
+    }
+
+    return pos;
+}
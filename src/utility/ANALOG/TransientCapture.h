@@ -0,0 +1,81 @@
+#ifndef _TRANSIENT_CAPTURE_H_
+#define _TRANSIENT_CAPTURE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Memory budget of the capture buffer in samples (2 bytes each).
+// Override it with a compiler flag, e.g. -DMC_AI_CAPTURE_DEPTH=2048
+#ifndef MC_AI_CAPTURE_DEPTH
+#define MC_AI_CAPTURE_DEPTH 512
+#endif
+
+// trigger flags
+#define CAPTURE_TRIGGER_RISING  0x01 // Trigger on a rising level crossing (or rising slope)
+#define CAPTURE_TRIGGER_FALLING 0x02 // Trigger on a falling level crossing (or falling slope)
+#define CAPTURE_TRIGGER_SLOPE   0x04 // Compare the sample-to-sample difference instead of the level
+
+// capture state
+#define CAPTURE_IDLE      0 // Not armed
+#define CAPTURE_ARMED     1 // Filling the history, waiting for the trigger
+#define CAPTURE_TRIGGERED 2 // Trigger seen, collecting the post-trigger samples
+#define CAPTURE_READY     3 // Record frozen and ready to be exported
+
+// export format
+#define CAPTURE_EXPORT_RAW   0 // 16-bit little endian samples
+#define CAPTURE_EXPORT_DELTA 1 // First sample raw, then zigzag varint encoded differences
+
+#define CAPTURE_EXPORT_HEADER_SIZE 24
+
+typedef struct {
+    uint8_t channel;         // Analog input channel of the record
+    uint8_t trigger;         // Trigger flags used for the record
+    uint16_t pre_samples;    // Number of samples stored before the trigger
+    uint16_t post_samples;   // Number of samples stored after the trigger (trigger sample included)
+    uint32_t trigger_sample; // Sample index of the trigger sample
+    uint64_t trigger_us;     // Timestamp (us, time service) of the block containing the trigger sample
+} CaptureInfo;
+
+/*
+ * Oscilloscope-like capture of a single channel.
+ * A circular history holds the pre-trigger samples; after the trigger the
+ * post-trigger samples are appended and the buffer is frozen in place, so the
+ * whole record never costs more than MC_AI_CAPTURE_DEPTH samples.
+ */
+class TransientCapture {
+public:
+    TransientCapture();
+
+    bool arm(uint8_t channel, uint8_t trigger, uint16_t level, uint16_t pre_samples, uint16_t post_samples);
+    void disarm();
+    uint8_t getState();
+    bool isRunning();
+    uint8_t getChannel();
+
+    // Feed one sample; return true when the record has just been frozen
+    bool update(uint16_t sample, uint32_t sample_index, uint64_t timestamp_us);
+
+    CaptureInfo getInfo();
+    size_t getCount();
+    uint16_t getSample(size_t index);
+
+    size_t exportSize(uint8_t format);
+    size_t exportRecord(uint8_t* out, size_t max_len, uint8_t format);
+
+private:
+    uint16_t _buffer[MC_AI_CAPTURE_DEPTH];
+    size_t _head;
+    size_t _filled;
+    size_t _remaining;
+    uint16_t _level;
+    uint16_t _pre;
+    uint16_t _post;
+    uint16_t _previous;
+    bool _has_previous;
+    volatile uint8_t _state;
+    CaptureInfo _info;
+
+    bool triggered(uint16_t sample);
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "WaveformGenerator.h"
+#include <math.h>
+
+WaveformGenerator::WaveformGenerator() : _table(nullptr), _length(0), _index(0), _divider(1), _count(0), _mode(WAVEFORM_LOOP), _max_step(0), _output(0), _running(false), _playing(false) {
+}
+
+bool WaveformGenerator::start(const uint16_t* table, size_t length, uint32_t divider, uint8_t mode) {
+    if (table == nullptr || length == 0) {
+        return false;
+    }
+
+    _running = false;
+
+    _table = table;
+    _length = length;
+    _index = 0;
+    _divider = (divider == 0) ? 1 : divider;
+    // the first entry is applied on the very next tick
+    _count = _divider - 1;
+    _mode = mode;
+    _playing = false;
+
+    _running = true;
+    return true;
+}
+
+void WaveformGenerator::stop() {
+    _running = false;
+}
+
+bool WaveformGenerator::isRunning() {
+    return _running;
+}
+
+void WaveformGenerator::setSlewLimit(uint16_t max_step) {
+    _max_step = max_step;
+}
+
+void WaveformGenerator::setOutput(uint16_t duty) {
+    _output = duty;
+}
+
+uint16_t WaveformGenerator::getOutput() {
+    return _output;
+}
+
+bool WaveformGenerator::tick() {
+    if (!_running) {
+        return false;
+    }
+
+    if (++_count >= _divider) {
+        _count = 0;
+        if (!_playing) {
+            _playing = true;
+        } else if (_index + 1 < _length) {
+            _index++;
+        } else if (_mode == WAVEFORM_LOOP) {
+            _index = 0;
+        }
+    }
+
+    uint16_t target = _table[_index];
+    uint16_t output = _output;
+
+    if (_max_step == 0 || (target > output ? target - output : output - target) <= _max_step) {
+        output = target;
+    } else if (target > output) {
+        output += _max_step;
+    } else {
+        output -= _max_step;
+    }
+
+    // a one-shot waveform stops once the last entry has been reached by the output
+    if (_mode == WAVEFORM_ONESHOT && _index + 1 == _length && output == target) {
+        _running = false;
+    }
+
+    if (output == _output) {
+        return false;
+    }
+
+    _output = output;
+    return true;
+}
+
+void WaveformGenerator::fillRamp(uint16_t* table, size_t length, uint16_t from, uint16_t to) {
+    if (length == 0) {
+        return;
+    }
+    if (length == 1) {
+        table[0] = to;
+        return;
+    }
+
+    int64_t span = (int32_t)to - (int32_t)from;
+    for (size_t i = 0; i < length; i++) {
+        table[i] = (uint16_t)(from + (span * (int64_t)i) / (int64_t)(length - 1));
+    }
+}
+
+void WaveformGenerator::fillSine(uint16_t* table, size_t length, uint16_t offset, uint16_t amplitude) {
+    for (size_t i = 0; i < length; i++) {
+        float value = offset + amplitude * sinf(2.0f * (float)M_PI * i / length);
+        if (value < 0) {
+            value = 0;
+        } else if (value > 65535) {
+            value = 65535;
+        }
+        table[i] = (uint16_t)(value + 0.5f);
+    }
+}
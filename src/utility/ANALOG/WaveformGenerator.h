@@ -0,0 +1,47 @@
+#ifndef _WAVEFORM_GENERATOR_H_
+#define _WAVEFORM_GENERATOR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WAVEFORM_LOOP    0 // Restart from the first table entry after the last one
+#define WAVEFORM_ONESHOT 1 // Hold the last table entry and stop
+
+/*
+ * Plays a precomputed table of 16-bit duty values, one entry every
+ * `divider` ticks, with an optional slew-rate limit (maximum change of
+ * the output per tick). tick() is constant time and meant to be called
+ * from a timer interrupt.
+ */
+class WaveformGenerator {
+public:
+    WaveformGenerator();
+
+    bool start(const uint16_t* table, size_t length, uint32_t divider, uint8_t mode = WAVEFORM_LOOP);
+    void stop();
+    bool isRunning();
+
+    void setSlewLimit(uint16_t max_step);
+    void setOutput(uint16_t duty);
+    uint16_t getOutput();
+
+    // Advance by one tick; return true if the output changed
+    bool tick();
+
+    static void fillRamp(uint16_t* table, size_t length, uint16_t from, uint16_t to);
+    static void fillSine(uint16_t* table, size_t length, uint16_t offset, uint16_t amplitude);
+
+private:
+    const uint16_t* _table;
+    size_t _length;
+    size_t _index;
+    uint32_t _divider;
+    uint32_t _count;
+    uint8_t _mode;
+    uint16_t _max_step;
+    uint16_t _output;
+    volatile bool _running;
+    bool _playing;
+};
+
+#endif
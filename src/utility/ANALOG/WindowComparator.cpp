@@ -0,0 +1,103 @@
+#include "WindowComparator.h"
+
+WindowComparator::WindowComparator() : _enabled(false), _low(0), _high(0xFFFF), _low_release(0), _high_release(0xFFFF) {
+    _status.state = WINDOW_ALARM_NONE;
+    clearCounters();
+}
+
+void WindowComparator::setWindow(uint16_t low, uint16_t high, uint16_t hysteresis) {
+    if (low > high) {
+        uint16_t tmp = low;
+        low = high;
+        high = tmp;
+    }
+
+    _low = low;
+    _high = high;
+
+    // The release points are moved inside the window by the hysteresis,
+    // saturating so that they never cross each other
+    uint32_t low_release = (uint32_t)low + hysteresis;
+    int32_t high_release = (int32_t)high - hysteresis;
+    _low_release = (low_release > high) ? high : (uint16_t)low_release;
+    _high_release = (high_release < (int32_t)low) ? low : (uint16_t)high_release;
+
+    _status.state = WINDOW_ALARM_NONE;
+    _enabled = true;
+}
+
+void WindowComparator::disable() {
+    _enabled = false;
+    _status.state = WINDOW_ALARM_NONE;
+}
+
+bool WindowComparator::isEnabled() {
+    return _enabled;
+}
+
+void WindowComparator::clearCounters() {
+    _status.low_count = 0;
+    _status.high_count = 0;
+    _status.last_trip_sample = 0;
+    _status.last_trip_us = 0;
+    _status.last_clear_us = 0;
+}
+
+WindowAlarmStatus WindowComparator::getStatus() {
+    return _status;
+}
+
+uint8_t WindowComparator::getState() {
+    return _status.state;
+}
+
+bool WindowComparator::update(uint16_t sample, uint32_t sample_index, uint64_t timestamp_us) {
+    if (!_enabled) {
+        return false;
+    }
+
+    uint8_t state = _status.state;
+
+    switch (state) {
+        case WINDOW_ALARM_NONE:
+            if (sample > _high) {
+                state = WINDOW_ALARM_HIGH;
+            } else if (sample < _low) {
+                state = WINDOW_ALARM_LOW;
+            }
+            break;
+        case WINDOW_ALARM_HIGH:
+            if (sample < _low) {
+                state = WINDOW_ALARM_LOW;
+            } else if (sample <= _high_release) {
+                state = WINDOW_ALARM_NONE;
+            }
+            break;
+        case WINDOW_ALARM_LOW:
+            if (sample > _high) {
+                state = WINDOW_ALARM_HIGH;
+            } else if (sample >= _low_release) {
+                state = WINDOW_ALARM_NONE;
+            }
+            break;
+    }
+
+    if (state == _status.state) {
+        return false;
+    }
+
+    _status.state = state;
+    if (state == WINDOW_ALARM_NONE) {
+        _status.last_clear_us = timestamp_us;
+    } else {
+        if (state == WINDOW_ALARM_HIGH) {
+            _status.high_count++;
+        } else {
+            _status.low_count++;
+        }
+        _status.last_trip_sample = sample_index;
+        _status.last_trip_us = timestamp_us;
+    }
+
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef _WINDOW_COMPARATOR_H_
+#define _WINDOW_COMPARATOR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WINDOW_ALARM_NONE 0x00 // Signal inside the window
+#define WINDOW_ALARM_LOW  0x01 // Signal below the low threshold
+#define WINDOW_ALARM_HIGH 0x02 // Signal above the high threshold
+
+typedef struct {
+    uint8_t state;             // Current alarm state (WINDOW_ALARM_NONE, WINDOW_ALARM_LOW or WINDOW_ALARM_HIGH)
+    uint32_t low_count;        // Number of transitions into WINDOW_ALARM_LOW
+    uint32_t high_count;       // Number of transitions into WINDOW_ALARM_HIGH
+    uint32_t last_trip_sample; // Sample index of the last transition into an alarm state
+    uint64_t last_trip_us;     // Timestamp (us, time service) of the block containing the last transition into an alarm state
+    uint64_t last_clear_us;    // Timestamp (us, time service) of the block containing the last return inside the window
+} WindowAlarmStatus;
+
+/*
+ * Window comparator with hysteresis working on raw ADC counts.
+ * update() is constant time and allocation free, so it can be run
+ * for every sample from the ADC block-completion (interrupt) context.
+ */
+class WindowComparator {
+public:
+    WindowComparator();
+
+    void setWindow(uint16_t low, uint16_t high, uint16_t hysteresis = 0);
+    void disable();
+    bool isEnabled();
+
+    void clearCounters();
+    WindowAlarmStatus getStatus();
+
+    // Feed one sample; return true if the alarm state changed
+    bool update(uint16_t sample, uint32_t sample_index, uint64_t timestamp_us);
+    uint8_t getState();
+
+private:
+    bool _enabled;
+    uint16_t _low;
+    uint16_t _high;
+    uint16_t _low_release;
+    uint16_t _high_release;
+    WindowAlarmStatus _status;
+};
+
+#endif
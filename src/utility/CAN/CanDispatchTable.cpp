@@ -0,0 +1,265 @@
+#include "CanDispatchTable.h"
+
+static uint32_t formatBits(uint32_t id) {
+    return (id & CAN_ID_EXTENDED_FLAG) ? (CAN_ID_EXTENDED_FLAG | CAN_EXTENDED_ID_MASK) : (CAN_ID_EXTENDED_FLAG | CAN_STANDARD_ID_MASK);
+}
+
+CanDispatchTable::CanDispatchTable() {
+    clear();
+}
+
+int CanDispatchTable::addId(uint32_t id) {
+    if ((id & ~formatBits(id)) != 0) {
+        return -1;
+    }
+    return add(CAN_RULE_ID, id, id);
+}
+
+int CanDispatchTable::addRange(uint32_t first, uint32_t last) {
+    if ((first & ~formatBits(first)) != 0 || (last & ~formatBits(first)) != 0 || first > last) {
+        return -1;
+    }
+    // both ends of the same format, the flag bit keeps them apart
+    return add(CAN_RULE_RANGE, first, last);
+}
+
+int CanDispatchTable::addMask(uint32_t id, uint32_t mask) {
+    uint32_t bits = formatBits(id);
+
+    if ((id & ~bits) != 0) {
+        return -1;
+    }
+    // the format always has to match
+    mask = (mask | CAN_ID_EXTENDED_FLAG) & bits;
+    return add(CAN_RULE_MASK, id & mask, mask);
+}
+
+bool CanDispatchTable::remove(int rule) {
+    if (rule < 0 || rule >= MC_CAN_HANDLERS || !_used[rule]) {
+        return false;
+    }
+
+    _used[rule] = false;
+    for (int i = 0, j = 0; i < _rule_count; i++) {
+        if (_order[i] != rule) {
+            _order[j++] = _order[i];
+        }
+    }
+    _rule_count--;
+    _dirty = true;
+    return true;
+}
+
+void CanDispatchTable::clear() {
+    for (int i = 0; i < MC_CAN_HANDLERS; i++) {
+        _used[i] = false;
+    }
+    _rule_count = 0;
+    _intervals = 1;
+    _start[0] = 0;
+    _target[0] = -1;
+    _mask_count = 0;
+    _dirty = false;
+}
+
+bool CanDispatchTable::getRule(int rule, CanRule* out) {
+    if (rule < 0 || rule >= MC_CAN_HANDLERS || !_used[rule]) {
+        return false;
+    }
+    *out = _rules[rule];
+    return true;
+}
+
+int CanDispatchTable::count(bool extended) {
+    int n = 0;
+
+    for (int i = 0; i < _rule_count; i++) {
+        if (((_rules[_order[i]].first & CAN_ID_EXTENDED_FLAG) != 0) == extended) {
+            n++;
+        }
+    }
+    return n;
+}
+
+void CanDispatchTable::compile() {
+    uint8_t priority[MC_CAN_HANDLERS];
+    int rules = 0;
+
+    // exact identifiers first, then the other intervals in the order they were added
+    _mask_count = 0;
+    for (int i = 0; i < _rule_count; i++) {
+        if (_rules[_order[i]].type == CAN_RULE_ID) {
+            priority[rules++] = _order[i];
+        }
+    }
+    for (int i = 0; i < _rule_count; i++) {
+        int rule = _order[i];
+        if (_rules[rule].type == CAN_RULE_ID) {
+            continue;
+        }
+        if (isInterval(rule)) {
+            priority[rules++] = rule;
+        } else {
+            _masks[_mask_count++] = rule;
+        }
+    }
+
+    // elementary intervals start at each first identifier and after each last one
+    uint32_t bounds[2 * MC_CAN_HANDLERS + 1];
+    int n = 0;
+    bounds[n++] = 0;
+    for (int i = 0; i < rules; i++) {
+        uint32_t first, last;
+        const CanRule& r = _rules[priority[i]];
+        if (r.type == CAN_RULE_MASK) {
+            first = r.first;
+            last = r.first | (~r.last & formatBits(r.first));
+        } else {
+            first = r.first;
+            last = r.last;
+        }
+        bounds[n++] = first;
+        if (last != 0xFFFFFFFFUL) {
+            bounds[n++] = last + 1;
+        }
+    }
+
+    // insertion sort, the table is small
+    for (int i = 1; i < n; i++) {
+        uint32_t value = bounds[i];
+        int j = i - 1;
+        while (j >= 0 && bounds[j] > value) {
+            bounds[j + 1] = bounds[j];
+            j--;
+        }
+        bounds[j + 1] = value;
+    }
+
+    _intervals = 0;
+    for (int i = 0; i < n; i++) {
+        if (i > 0 && bounds[i] == bounds[i - 1]) {
+            continue;
+        }
+
+        int target = -1;
+        for (int k = 0; k < rules && target < 0; k++) {
+            if (matches(priority[k], bounds[i])) {
+                target = priority[k];
+            }
+        }
+
+        // merge with the previous interval when it routes to the same rule
+        if (_intervals > 0 && _target[_intervals - 1] == target) {
+            continue;
+        }
+        _start[_intervals] = bounds[i];
+        _target[_intervals] = target;
+        _intervals++;
+    }
+
+    _dirty = false;
+}
+
+int CanDispatchTable::lookup(uint32_t id) {
+    if (_dirty) {
+        compile();
+    }
+
+    // last interval starting at or before id
+    int lo = 0;
+    int hi = _intervals - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (_start[mid] <= id) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (_target[lo] >= 0) {
+        return _target[lo];
+    }
+
+    for (int i = 0; i < _mask_count; i++) {
+        if (matches(_masks[i], id)) {
+            return _masks[i];
+        }
+    }
+    return -1;
+}
+
+bool CanDispatchTable::filter(bool extended, uint32_t* id, uint32_t* mask) {
+    uint32_t bits = extended ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK;
+    uint32_t ref = 0;
+    uint32_t common = 0;
+    bool found = false;
+
+    for (int i = 0; i < _rule_count; i++) {
+        const CanRule& r = _rules[_order[i]];
+        uint32_t rule_id = r.first;
+        uint32_t rule_mask;
+
+        if (((r.first & CAN_ID_EXTENDED_FLAG) != 0) != extended) {
+            continue;
+        }
+
+        if (r.type == CAN_RULE_MASK) {
+            rule_mask = r.last;
+        } else {
+            // the bits above the highest one that differs in the range are fixed
+            uint32_t diff = r.first ^ r.last;
+            rule_mask = 0xFFFFFFFFUL;
+            while (diff != 0) {
+                rule_mask <<= 1;
+                diff >>= 1;
+            }
+        }
+
+        if (!found) {
+            ref = rule_id;
+            common = rule_mask;
+            found = true;
+        } else {
+            common &= rule_mask & ~(ref ^ rule_id);
+        }
+    }
+
+    *id = ref & common & bits;
+    *mask = common & bits;
+    return found;
+}
+
+int CanDispatchTable::add(uint8_t type, uint32_t first, uint32_t last) {
+    for (int i = 0; i < MC_CAN_HANDLERS; i++) {
+        if (!_used[i]) {
+            _rules[i].type = type;
+            _rules[i].first = first;
+            _rules[i].last = last;
+            _used[i] = true;
+            _order[_rule_count++] = i;
+            _dirty = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CanDispatchTable::isInterval(int rule) {
+    const CanRule& r = _rules[rule];
+
+    if (r.type != CAN_RULE_MASK) {
+        return true;
+    }
+    // the ignored bits must be the low bits: ~mask + 1 is a power of two
+    uint32_t ignored = ~r.last & formatBits(r.first);
+    return (ignored & (ignored + 1)) == 0;
+}
+
+bool CanDispatchTable::matches(int rule, uint32_t id) {
+    const CanRule& r = _rules[rule];
+
+    if (r.type == CAN_RULE_MASK) {
+        return (id & r.last) == r.first;
+    }
+    return id >= r.first && id <= r.last;
+}
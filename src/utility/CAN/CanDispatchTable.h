@@ -0,0 +1,78 @@
+#ifndef _CAN_DISPATCH_TABLE_H_
+#define _CAN_DISPATCH_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef MC_CAN_HANDLERS
+#define MC_CAN_HANDLERS         32
+#endif
+
+#define CAN_ID_EXTENDED_FLAG    0x80000000UL    // Same flag as CanMsg::id for 29-bit identifiers
+#define CAN_STANDARD_ID_MASK    0x7FFUL
+#define CAN_EXTENDED_ID_MASK    0x1FFFFFFFUL
+
+#define CAN_RULE_ID             0
+#define CAN_RULE_RANGE          1
+#define CAN_RULE_MASK           2
+
+typedef struct {
+    uint8_t type;           // CAN_RULE_x
+    uint32_t first;         // Identifier, first identifier of the range or identifier of the mask
+    uint32_t last;          // Last identifier of the range or mask (extended flag included)
+} CanRule;
+
+/*
+ * Routing of CAN identifiers (CanMsg::id, extended flag included) to rule
+ * slots: exact identifiers, inclusive ranges and identifier/mask pairs.
+ *
+ * compile() flattens the identifiers, the ranges and the masks that only
+ * ignore low bits into sorted disjoint intervals looked up by binary
+ * search: an exact identifier wins, then these rules match in the order
+ * they were added. The other masks are tried one by one, in the order they
+ * were added, only when no interval matches, so they should stay few. The table is not thread safe: add and compile from the
+ * thread that looks up.
+ *
+ * filter() gives the identifier/mask pair accepting every identifier of a
+ * format routed by the table, for an acceptance filter in hardware.
+ *
+ * It has no hardware dependency.
+ */
+class CanDispatchTable {
+public:
+    CanDispatchTable();
+
+    int addId(uint32_t id);
+    int addRange(uint32_t first, uint32_t last);
+    int addMask(uint32_t id, uint32_t mask);
+    bool remove(int rule);
+    void clear();
+
+    bool getRule(int rule, CanRule* out);
+    int count(bool extended);
+
+    void compile();
+    // rule slot of an identifier, -1 if none
+    int lookup(uint32_t id);
+    // acceptance filter of a format, false if no rule routes that format
+    bool filter(bool extended, uint32_t* id, uint32_t* mask);
+
+private:
+    CanRule _rules[MC_CAN_HANDLERS];
+    bool _used[MC_CAN_HANDLERS];
+    uint8_t _order[MC_CAN_HANDLERS];        // Rules in the order they were added
+    int _rule_count;
+    // compiled intervals: [_start[i], _start[i + 1]) routes to _target[i]
+    uint32_t _start[2 * MC_CAN_HANDLERS + 1];
+    int8_t _target[2 * MC_CAN_HANDLERS + 1];
+    int _intervals;
+    uint8_t _masks[MC_CAN_HANDLERS];        // Masks that are not intervals, by priority
+    int _mask_count;
+    bool _dirty;
+
+    int add(uint8_t type, uint32_t first, uint32_t last);
+    bool isInterval(int rule);
+    bool matches(int rule, uint32_t id);
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "FdcanFilter.h"
+
+// standard filter element
+#define SFT_RANGE           (0UL << 30)
+#define SFT_CLASSIC         (2UL << 30)
+#define SFEC_FIFO0          (1UL << 27)
+// extended filter element, F0 then F1
+#define EFEC_FIFO0          (1UL << 29)
+#define EFT_CLASSIC         (2UL << 30)
+#define EFT_RANGE           (3UL << 30)     // Range without the XIDAM mask
+
+#define GFC_ACCEPT          0UL
+#define GFC_REJECT          2UL
+
+static volatile uint32_t* standardList(FDCAN_GlobalTypeDef* fdcan, int* size) {
+    *size = (fdcan->SIDFC & FDCAN_SIDFC_LSS) >> FDCAN_SIDFC_LSS_Pos;
+    return (volatile uint32_t*)(SRAMCAN_BASE + (fdcan->SIDFC & FDCAN_SIDFC_FLSSA));
+}
+
+static volatile uint32_t* extendedList(FDCAN_GlobalTypeDef* fdcan, int* size) {
+    *size = (fdcan->XIDFC & FDCAN_XIDFC_LSE) >> FDCAN_XIDFC_LSE_Pos;
+    return (volatile uint32_t*)(SRAMCAN_BASE + (fdcan->XIDFC & FDCAN_XIDFC_FLESA));
+}
+
+static bool waitInit(FDCAN_GlobalTypeDef* fdcan, bool set) {
+    uint32_t start = micros();
+
+    while (((fdcan->CCCR & FDCAN_CCCR_INIT) != 0) != set) {
+        if (micros() - start >= MC_FDCAN_INIT_TIMEOUT_US) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the filters and GFC are only written in configuration mode
+static bool enterConfig(FDCAN_GlobalTypeDef* fdcan) {
+    fdcan->CCCR |= FDCAN_CCCR_INIT;
+    if (!waitInit(fdcan, true)) {
+        fdcan->CCCR &= ~FDCAN_CCCR_INIT;
+        return false;
+    }
+    fdcan->CCCR |= FDCAN_CCCR_CCE;
+    return true;
+}
+
+// the controller restarts once it sees the bus idle, CCE is cleared with INIT
+static bool leaveConfig(FDCAN_GlobalTypeDef* fdcan) {
+    fdcan->CCCR &= ~FDCAN_CCCR_INIT;
+    return waitInit(fdcan, false);
+}
+
+static void setNonMatching(FDCAN_GlobalTypeDef* fdcan, uint32_t standard, uint32_t extended) {
+    fdcan->GFC = (fdcan->GFC & ~(FDCAN_GFC_ANFS | FDCAN_GFC_ANFE)) | (standard << FDCAN_GFC_ANFS_Pos) | (extended << FDCAN_GFC_ANFE_Pos);
+}
+
+static int applyFormat(volatile uint32_t* list, int size, bool extended, CanDispatchTable* table) {
+    int words = extended ? 2 : 1;
+    int used = 0;
+    uint32_t bits = extended ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK;
+    uint32_t id, mask;
+
+    if (table->count(extended) <= size) {
+        CanRule rule;
+        for (int i = 0; i < MC_CAN_HANDLERS; i++) {
+            if (!table->getRule(i, &rule) || ((rule.first & CAN_ID_EXTENDED_FLAG) != 0) != extended) {
+                continue;
+            }
+
+            uint32_t first = rule.first & bits;
+            uint32_t second = (rule.type == CAN_RULE_ID) ? bits : rule.last & bits;
+            bool range = (rule.type == CAN_RULE_RANGE);
+            if (extended) {
+                list[used * 2] = EFEC_FIFO0 | first;
+                list[used * 2 + 1] = (range ? EFT_RANGE : EFT_CLASSIC) | second;
+            } else {
+                list[used] = (range ? SFT_RANGE : SFT_CLASSIC) | SFEC_FIFO0 | (first << 16) | second;
+            }
+            used++;
+        }
+    } else if (table->filter(extended, &id, &mask)) {
+        if (extended) {
+            list[0] = EFEC_FIFO0 | id;
+            list[1] = EFT_CLASSIC | mask;
+        } else {
+            list[0] = SFT_CLASSIC | SFEC_FIFO0 | (id << 16) | mask;
+        }
+        used = 1;
+    }
+
+    // a disabled element has its configuration field cleared
+    for (int i = used; i < size; i++) {
+        list[i * words] = 0;
+    }
+    return used;
+}
+
+int fdcanApplyFilters(FDCAN_GlobalTypeDef* fdcan, CanDispatchTable* table) {
+    int std_size, ext_size;
+    volatile uint32_t* std_list = standardList(fdcan, &std_size);
+    volatile uint32_t* ext_list = extendedList(fdcan, &ext_size);
+    int elements = 0;
+
+    if (!enterConfig(fdcan)) {
+        return -1;
+    }
+
+    if (std_size > 0) {
+        elements += applyFormat(std_list, std_size, false, table);
+    }
+    if (ext_size > 0) {
+        elements += applyFormat(ext_list, ext_size, true, table);
+    }
+    setNonMatching(fdcan, std_size > 0 ? GFC_REJECT : GFC_ACCEPT, ext_size > 0 ? GFC_REJECT : GFC_ACCEPT);
+
+    return leaveConfig(fdcan) ? elements : -1;
+}
+
+bool fdcanAcceptAll(FDCAN_GlobalTypeDef* fdcan) {
+    int size;
+    volatile uint32_t* list;
+
+    if (!enterConfig(fdcan)) {
+        return false;
+    }
+
+    list = standardList(fdcan, &size);
+    for (int i = 0; i < size; i++) {
+        list[i] = 0;
+    }
+    list = extendedList(fdcan, &size);
+    for (int i = 0; i < size; i++) {
+        list[i * 2] = 0;
+    }
+    setNonMatching(fdcan, GFC_ACCEPT, GFC_ACCEPT);
+
+    return leaveConfig(fdcan);
+}
@@ -0,0 +1,34 @@
+#ifndef _FDCAN_FILTER_H_
+#define _FDCAN_FILTER_H_
+
+#include <Arduino.h>
+#include <mbed.h>
+#include "CanDispatchTable.h"
+
+#ifndef MC_FDCAN_INIT_TIMEOUT_US
+#define MC_FDCAN_INIT_TIMEOUT_US    10000   // Longest wait for the controller to enter or leave the configuration mode
+#endif
+
+/*
+ * Acceptance filters of a FDCAN instance set up by mbed, written directly
+ * in the filter lists of the message RAM (their location and size are
+ * read back from SIDFC/XIDFC, mbed keeps ownership of the layout).
+ *
+ * fdcanApplyFilters() gives each rule of the table its own filter element
+ * when the list of its format is long enough, a single identifier/mask
+ * element covering all of them otherwise, and rejects the frames that no
+ * element accepts. A format without a filter list is left open.
+ * fdcanAcceptAll() disables the elements and accepts every frame.
+ *
+ * Both write the filters in configuration mode: the controller leaves the
+ * bus until they are written and comes back after 11 recessive bits, so
+ * they must only run before the traffic starts. They fail, leaving the
+ * filters as they were, if the controller does not enter the configuration
+ * mode within MC_FDCAN_INIT_TIMEOUT_US, and fail too if it does not leave
+ * it in time (it then joins the bus as soon as the bus is idle).
+ */
+// return the number of filter elements programmed, -1 on failure
+int fdcanApplyFilters(FDCAN_GlobalTypeDef* fdcan, CanDispatchTable* table);
+bool fdcanAcceptAll(FDCAN_GlobalTypeDef* fdcan);
+
+#endif
@@ -0,0 +1,136 @@
+#include "PidController.h"
+
+PidController::PidController() : _kp(0), _ki(0), _kd(0), _tau(0), _out_min(0), _out_max(100), _sign(1), _setpoint(0),
+                                 _integral(0), _derivative(0), _last_measurement(0), _output(0), _automatic(true), _first(true) {
+}
+
+void PidController::setTunings(float kp, float ki, float kd) {
+    _kp = kp;
+    _ki = ki;
+    _kd = kd;
+}
+
+void PidController::setDerivativeFilter(float tau_s) {
+    _tau = (tau_s > 0) ? tau_s : 0;
+}
+
+void PidController::setOutputLimits(float min, float max) {
+    if (min >= max) {
+        return;
+    }
+
+    _out_min = min;
+    _out_max = max;
+    _integral = clamp(_integral);
+    _output = clamp(_output);
+}
+
+float PidController::getOutputMin() {
+    return _out_min;
+}
+
+float PidController::getOutputMax() {
+    return _out_max;
+}
+
+void PidController::setDirection(uint8_t direction) {
+    _sign = (direction == PID_REVERSE) ? -1 : 1;
+}
+
+void PidController::setSetpoint(float setpoint) {
+    _setpoint = setpoint;
+}
+
+float PidController::getSetpoint() {
+    return _setpoint;
+}
+
+void PidController::setManual(float output) {
+    _automatic = false;
+    _output = clamp(output);
+}
+
+void PidController::setAutomatic(float measurement) {
+    if (_automatic) {
+        return;
+    }
+
+    // start from the current output: the integral term absorbs the proportional step
+    float error = _sign * (_setpoint - measurement);
+    _integral = clamp(_output - _kp * error);
+    _derivative = 0;
+    _last_measurement = measurement;
+    _first = false;
+    _automatic = true;
+}
+
+bool PidController::isAutomatic() {
+    return _automatic;
+}
+
+void PidController::reset() {
+    _integral = 0;
+    _derivative = 0;
+    _output = clamp(0);
+    _first = true;
+}
+
+float PidController::update(float measurement, float dt_s) {
+    if (!_automatic) {
+        _last_measurement = measurement;
+        return _output;
+    }
+
+    if (_first || dt_s <= 0) {
+        _last_measurement = measurement;
+        _first = false;
+        if (dt_s <= 0) {
+            return _output;
+        }
+    }
+
+    float error = _sign * (_setpoint - measurement);
+
+    // derivative on measurement avoids the kick on setpoint changes
+    float raw_derivative = -_sign * (measurement - _last_measurement) / dt_s;
+    _derivative += (raw_derivative - _derivative) * (dt_s / (_tau + dt_s));
+    _last_measurement = measurement;
+
+    float p = _kp * error;
+    float d = _kd * _derivative;
+    float integral = _integral + _ki * error * dt_s;
+    float output = p + integral + d;
+
+    if (output > _out_max || output < _out_min) {
+        if (_kp > 0) {
+            // back-calculation: the integral tracks the limit with the integral time
+            // constant, so a long saturation leaves it where the proportional term
+            // alone does not hold the output at the limit
+            float tracking = (_ki / _kp) * dt_s;
+            integral += (clamp(output) - output) * ((tracking < 1) ? tracking : 1);
+        } else if ((output > _out_max && error > 0) || (output < _out_min && error < 0)) {
+            // pure integral controller: freeze it while it pushes against the limit
+            integral = _integral;
+        }
+        output = p + integral + d;
+    }
+
+    _integral = clamp(integral);
+    _output = clamp(output);
+
+    return _output;
+}
+
+float PidController::getOutput() {
+    return _output;
+}
+
+float PidController::clamp(float value) {
+    if (value > _out_max) {
+        return _out_max;
+    }
+    if (value < _out_min) {
+        return _out_min;
+    }
+    return value;
+}
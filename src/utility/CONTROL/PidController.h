@@ -0,0 +1,62 @@
+#ifndef _PID_CONTROLLER_H_
+#define _PID_CONTROLLER_H_
+
+#include <stdint.h>
+
+#define PID_DIRECT  0 // Output increases when the measurement is below the setpoint
+#define PID_REVERSE 1 // Output increases when the measurement is above the setpoint
+
+/*
+ * Float PID in parallel form with:
+ * - derivative on measurement, filtered by a first order low-pass (tau),
+ * - integral term stored already multiplied by ki, so that gain changes
+ *   do not bump the output,
+ * - anti-windup by clamping the integral term to the output limits and
+ *   back-calculation while the output saturates (the excess over the
+ *   limit is fed back with the integral time constant kp / ki),
+ * - bumpless manual to automatic transfer (the integral term absorbs the
+ *   difference between the last manual output and the proportional term).
+ *
+ * It has no hardware dependency: update() is given the measurement and
+ * the elapsed time.
+ */
+class PidController {
+public:
+    PidController();
+
+    void setTunings(float kp, float ki, float kd);
+    void setDerivativeFilter(float tau_s);
+    void setOutputLimits(float min, float max);
+    float getOutputMin();
+    float getOutputMax();
+    void setDirection(uint8_t direction);
+    void setSetpoint(float setpoint);
+    float getSetpoint();
+
+    void setManual(float output);
+    void setAutomatic(float measurement);
+    bool isAutomatic();
+
+    void reset();
+
+    // Run one step of dt_s seconds and return the new output
+    float update(float measurement, float dt_s);
+    float getOutput();
+
+private:
+    float _kp, _ki, _kd;
+    float _tau;
+    float _out_min, _out_max;
+    float _sign;
+    float _setpoint;
+    float _integral;
+    float _derivative;
+    float _last_measurement;
+    float _output;
+    bool _automatic;
+    bool _first;
+
+    float clamp(float value);
+};
+
+#endif
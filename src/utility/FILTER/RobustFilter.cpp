@@ -0,0 +1,131 @@
+#include "RobustFilter.h"
+#include <math.h>
+
+RobustFilter::RobustFilter() : _median(1), _index(0), _maxRate(0), _alpha(1), _maxHold(0), _bad(0), _invalid(0),
+                               _limited(NAN), _output(NAN), _lastMs(0), _enabled(false), _primed(false) {
+}
+
+bool RobustFilter::configure(uint8_t median, float max_rate, float alpha, uint8_t max_hold) {
+    if ((median != 1 && median != 3 && median != 5) || max_rate < 0 || !(alpha > 0 && alpha <= 1)) {
+        return false;
+    }
+
+    _median = median;
+    _maxRate = max_rate;
+    _alpha = alpha;
+    _maxHold = max_hold;
+    reset();
+    return true;
+}
+
+void RobustFilter::enable(bool enable) {
+    if (enable && !_enabled) {
+        reset();
+    }
+    _enabled = enable;
+}
+
+bool RobustFilter::isEnabled() {
+    return _enabled;
+}
+
+void RobustFilter::reset() {
+    _index = 0;
+    _bad = 0;
+    _limited = NAN;
+    _output = NAN;
+    _primed = false;
+}
+
+float RobustFilter::update(float value, uint32_t now_ms) {
+    if (!_enabled) {
+        return value;
+    }
+
+    if (isnan(value)) {
+        _invalid++;
+        if (!_primed) {
+            return NAN;
+        }
+        if (_bad < _maxHold) {
+            // hold the last good value
+            _bad++;
+            return _output;
+        }
+        // the gap is too long: report it and restart on the next good sample
+        reset();
+        return NAN;
+    }
+
+    if (!_primed) {
+        for (int i = 0; i < _median; i++) {
+            _window[i] = value;
+        }
+        _index = 0;
+        _limited = value;
+        _output = value;
+        _lastMs = now_ms;
+        _primed = true;
+        return _output;
+    }
+
+    _bad = 0;
+    _window[_index] = value;
+    _index = (_index + 1 < _median) ? _index + 1 : 0;
+
+    float filtered = median();
+
+    if (_maxRate > 0) {
+        float step = _maxRate * (now_ms - _lastMs) / 1000.0f;
+        if (filtered > _limited + step) {
+            filtered = _limited + step;
+        } else if (filtered < _limited - step) {
+            filtered = _limited - step;
+        }
+    }
+    _limited = filtered;
+    _lastMs = now_ms;
+
+    _output += _alpha * (_limited - _output);
+    return _output;
+}
+
+float RobustFilter::getOutput() {
+    return _output;
+}
+
+uint32_t RobustFilter::getInvalidCount() {
+    return _invalid;
+}
+
+float RobustFilter::median() {
+    float a = _window[0];
+
+    if (_median == 1) {
+        return a;
+    }
+
+    float b = _window[1];
+    float c = _window[2];
+
+    if (_median == 3) {
+        return fmaxf(fminf(a, b), fminf(fmaxf(a, b), c));
+    }
+
+    // median of 5 with a fixed comparison network (7 compare/swaps)
+    float d = _window[3];
+    float e = _window[4];
+    float t;
+
+#define ROBUST_FILTER_SORT(x, y) if (x > y) { t = x; x = y; y = t; }
+    ROBUST_FILTER_SORT(a, b);
+    ROBUST_FILTER_SORT(d, e);
+    ROBUST_FILTER_SORT(a, d); // a is the minimum of a, b, d, e
+    ROBUST_FILTER_SORT(b, e); // e is the maximum of a, b, d, e
+    ROBUST_FILTER_SORT(b, c);
+    ROBUST_FILTER_SORT(c, d);
+    ROBUST_FILTER_SORT(b, c);
+#undef ROBUST_FILTER_SORT
+
+    return c;
+}
@@ -0,0 +1,49 @@
+#ifndef _ROBUST_FILTER_H_
+#define _ROBUST_FILTER_H_
+
+#include <stdint.h>
+
+#define ROBUST_FILTER_MAX_MEDIAN 5
+
+/*
+ * Spike-rejecting filter for slow process values (temperatures):
+ * median of the last 1/3/5 samples -> rate-of-change limiter ->
+ * exponential smoother. Invalid samples (NAN, converter faults) are not
+ * fed to the chain: the last good output is held for up to max_hold
+ * consecutive invalid samples, then NAN is returned until a good sample
+ * restarts the filter. The work per sample is constant.
+ */
+class RobustFilter {
+public:
+    RobustFilter();
+
+    // median: 1 (off), 3 or 5 samples; max_rate: units/s, 0 to disable;
+    // alpha: smoothing factor in (0, 1], 1 to disable; max_hold: invalid samples bridged
+    bool configure(uint8_t median, float max_rate, float alpha, uint8_t max_hold);
+    void enable(bool enable);
+    bool isEnabled();
+    void reset();
+
+    float update(float value, uint32_t now_ms);
+    float getOutput();
+    uint32_t getInvalidCount();
+
+private:
+    float _window[ROBUST_FILTER_MAX_MEDIAN];
+    uint8_t _median;
+    uint8_t _index;
+    float _maxRate;
+    float _alpha;
+    uint8_t _maxHold;
+    uint8_t _bad;
+    uint32_t _invalid;
+    float _limited;
+    float _output;
+    uint32_t _lastMs;
+    bool _enabled;
+    bool _primed;
+
+    float median();
+};
+
+#endif
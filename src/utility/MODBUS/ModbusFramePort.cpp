@@ -0,0 +1,32 @@
+#include "ModbusFramePort.h"
+
+ModbusFramePort::ModbusFramePort(ReadFunction read, WriteFunction write, void* context) : _read(read), _write(write), _context(context), _pos(0) {
+    _frame.length = 0;
+}
+
+bool ModbusFramePort::send(const uint8_t* frame, size_t len) {
+    return _write != nullptr && _write(_context, frame, len);
+}
+
+int ModbusFramePort::read() {
+    uint32_t end_us;
+    return readStamped(&end_us);
+}
+
+bool ModbusFramePort::stamped() {
+    return true;
+}
+
+int ModbusFramePort::readStamped(uint32_t* end_us) {
+    while (_pos >= _frame.length) {
+        if (_read == nullptr || !_read(_context, &_frame)) {
+            return -1;
+        }
+        _pos = 0;
+    }
+
+    // the bytes of a frame are back-to-back: the receiver cuts the frames at each idle character
+    _pos++;
+    *end_us = (uint32_t)(_frame.start_us + (_frame.end_us - _frame.start_us) * _pos / _frame.length);
+    return _frame.data[_pos - 1];
+}
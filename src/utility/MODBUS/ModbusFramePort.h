@@ -0,0 +1,36 @@
+#ifndef _MODBUS_FRAME_PORT_H_
+#define _MODBUS_FRAME_PORT_H_
+
+#include "ModbusRtu.h"
+#include "../SERIAL/SerialFramer.h"
+
+/*
+ * ModbusPort on a serial port in frame mode: the frames received by DMA
+ * are taken from the owner one after the other and their bytes are read
+ * with the timestamps of the receiver, so that the engine checks the
+ * silences inside a response without polling the port. The frames are
+ * sent without copy through the owner.
+ */
+class ModbusFramePort : public ModbusPort {
+public:
+    // get the next received frame without waiting, return false if there is none
+    typedef bool (*ReadFunction)(void* context, SerialFrame* frame);
+    // start the transmission of a frame, return false if it could not be started
+    typedef bool (*WriteFunction)(void* context, const uint8_t* frame, size_t len);
+
+    ModbusFramePort(ReadFunction read, WriteFunction write, void* context);
+
+    bool send(const uint8_t* frame, size_t len) override;
+    int read() override;
+    bool stamped() override;
+    int readStamped(uint32_t* end_us) override;
+
+private:
+    ReadFunction _read;
+    WriteFunction _write;
+    void* _context;
+    SerialFrame _frame;
+    size_t _pos;
+};
+
+#endif
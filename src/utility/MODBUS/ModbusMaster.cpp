@@ -0,0 +1,436 @@
+#include "ModbusMaster.h"
+#include <string.h>
+
+ModbusMaster::ModbusMaster() : _port(nullptr), _head(0), _tail(0), _current(nullptr), _state(IDLE), _tx_len(0), _rx_len(0), _expected(0), _rx_gap(false), _t15_us(0), _t35_us(0), _char_us(0), _sent_us(0), _last_rx_us(0), _idle_since_us(0), _holdoff_us(0) {
+    _default.slave = 0;
+    _default.retries = MODBUS_DEFAULT_RETRIES;
+    _default.timeout_ms = MODBUS_DEFAULT_TIMEOUT_MS;
+    for (int i = 0; i < MC_MB_POLICIES; i++) {
+        _policy[i] = _default;
+    }
+    resetStats();
+}
+
+void ModbusMaster::begin(ModbusPort* port, uint32_t baudrate) {
+    _port = port;
+    _current = nullptr;
+    _t15_us = modbusT15Us(baudrate);
+    _t35_us = modbusT35Us(baudrate);
+    _char_us = modbusCharTimeUs(baudrate);
+    _state = IDLE;
+    _holdoff_us = _t35_us;
+}
+
+bool ModbusMaster::validate(const ModbusRequest* request) {
+    uint16_t q = request->quantity;
+
+    switch (request->function) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            return request->slave != MODBUS_BROADCAST && request->coils != nullptr && q >= 1 && q <= MODBUS_MAX_READ_BITS;
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            return request->slave != MODBUS_BROADCAST && request->registers != nullptr && q >= 1 && q <= MODBUS_MAX_READ_REGS;
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            return request->coils != nullptr && q == 1;
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            return request->registers != nullptr && q == 1;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            return request->coils != nullptr && q >= 1 && q <= MODBUS_MAX_WRITE_BITS;
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            return request->registers != nullptr && q >= 1 && q <= MODBUS_MAX_WRITE_REGS;
+        default:
+            return false;
+    }
+}
+
+bool ModbusMaster::submit(ModbusRequest* request) {
+    if (request == nullptr || !validate(request) || request->slave > 247) {
+        if (request != nullptr) {
+            request->result = MODBUS_RESULT_INVALID;
+        }
+        return false;
+    }
+
+    uint8_t next = (_tail + 1) % MC_MB_QUEUE;
+    if (next == _head) {
+        request->result = MODBUS_RESULT_BUSY;
+        return false;
+    }
+
+    request->result = MODBUS_RESULT_PENDING;
+    request->exception = 0;
+    request->attempts = 0;
+    request->response_us = 0;
+    _queue[_tail] = request;
+    _tail = next;
+    return true;
+}
+
+bool ModbusMaster::isIdle() {
+    return _state == IDLE && _head == _tail;
+}
+
+void ModbusMaster::abort() {
+    ModbusRequest* r = _current;
+
+    _current = nullptr;
+    _state = IDLE;
+    if (r != nullptr) {
+        r->result = MODBUS_RESULT_BUSY;
+        if (r->callback != nullptr) {
+            r->callback(r);
+        }
+    }
+    while (_head != _tail) {
+        r = _queue[_head];
+        _head = (_head + 1) % MC_MB_QUEUE;
+        r->result = MODBUS_RESULT_BUSY;
+        if (r->callback != nullptr) {
+            r->callback(r);
+        }
+    }
+}
+
+bool ModbusMaster::poll(uint32_t now_us) {
+    if (_port == nullptr) {
+        return false;
+    }
+
+    if (_state == IDLE) {
+        // a request being retried goes before the queued ones
+        if (_current == nullptr && _head == _tail) {
+            return false;
+        }
+        // inter-frame silence (t3.5, or the broadcast delay)
+        if (now_us - _idle_since_us < _holdoff_us) {
+            return true;
+        }
+        if (_current == nullptr) {
+            _current = _queue[_head];
+            _head = (_head + 1) % MC_MB_QUEUE;
+            buildFrame();
+        }
+        transmit(now_us);
+        return true;
+    }
+
+    int c;
+    bool stamped = _port->stamped();
+    uint32_t end_us = now_us;
+    while (_rx_len < sizeof(_rx) && (c = stamped ? _port->readStamped(&end_us) : _port->read()) >= 0) {
+        // silence between the stop bit of the previous byte and the start bit of this one
+        if (stamped && _rx_len > 0 && (int32_t)(end_us - _char_us - _last_rx_us) > (int32_t)_t15_us) {
+            _rx_gap = true;
+        }
+        _rx[_rx_len++] = (uint8_t)c;
+        _last_rx_us = end_us;
+        if (_rx_len == 2) {
+            _expected = expectedLength();
+        }
+        if (_rx_len >= 2 && _rx_len == _expected) {
+            break;
+        }
+    }
+
+    if (_rx_len >= 2 && _rx_len == _expected) {
+        if (_rx_gap) {
+            // the bytes do not form one RTU frame
+            _stats.frame_errors++;
+            retryOrFinish(now_us);
+            return true;
+        }
+        uint8_t result = parseResponse();
+        if (result == MODBUS_RESULT_TIMEOUT) {
+            retryOrFinish(now_us);
+        } else {
+            finish(result, now_us);
+        }
+        return true;
+    }
+
+    if (_rx_len > 0) {
+        // the frame stopped before its expected length
+        if (now_us - _last_rx_us >= truncatedAfterUs()) {
+            _stats.frame_errors++;
+            retryOrFinish(now_us);
+        }
+    } else if ((int32_t)(now_us - _sent_us) >= (int32_t)policyOf(_current->slave).timeout_ms * 1000) {
+        // _sent_us is the end of the transmission, still ahead while the frame is going out
+        _stats.timeouts++;
+        retryOrFinish(now_us);
+    }
+    return true;
+}
+
+uint32_t ModbusMaster::pollDelayUs(uint32_t now_us) {
+    uint32_t elapsed;
+
+    if (_port == nullptr) {
+        return MODBUS_POLL_NEVER;
+    }
+
+    if (_state == IDLE) {
+        if (_current == nullptr && _head == _tail) {
+            return MODBUS_POLL_NEVER;
+        }
+        elapsed = now_us - _idle_since_us;
+        return (elapsed >= _holdoff_us) ? 0 : _holdoff_us - elapsed;
+    }
+
+    if (_rx_len > 0) {
+        // end of a truncated frame
+        uint32_t silence = truncatedAfterUs();
+        elapsed = now_us - _last_rx_us;
+        return ((int32_t)elapsed >= (int32_t)silence) ? 0 : silence - elapsed;
+    }
+    int32_t left = (int32_t)(_sent_us + (uint32_t)policyOf(_current->slave).timeout_ms * 1000 - now_us);
+    return (left > 0) ? (uint32_t)left : 0;
+}
+
+bool ModbusMaster::isReceiving() {
+    return _state == WAIT_RESPONSE;
+}
+
+void ModbusMaster::setDefaultPolicy(uint16_t timeout_ms, uint8_t retries) {
+    _default.timeout_ms = timeout_ms;
+    _default.retries = retries;
+}
+
+bool ModbusMaster::setSlavePolicy(uint8_t slave, uint16_t timeout_ms, uint8_t retries) {
+    int free_slot = -1;
+
+    if (slave == MODBUS_BROADCAST) {
+        return false;
+    }
+    for (int i = 0; i < MC_MB_POLICIES; i++) {
+        if (_policy[i].slave == slave) {
+            free_slot = i;
+            break;
+        }
+        if (_policy[i].slave == 0 && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (free_slot < 0) {
+        return false;
+    }
+
+    _policy[free_slot].slave = slave;
+    _policy[free_slot].timeout_ms = timeout_ms;
+    _policy[free_slot].retries = retries;
+    return true;
+}
+
+ModbusMasterStats ModbusMaster::getStats() {
+    return _stats;
+}
+
+void ModbusMaster::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+ModbusMaster::Policy ModbusMaster::policyOf(uint8_t slave) {
+    for (int i = 0; i < MC_MB_POLICIES; i++) {
+        if (_policy[i].slave == slave && slave != 0) {
+            return _policy[i];
+        }
+    }
+    return _default;
+}
+
+void ModbusMaster::buildFrame() {
+    ModbusRequest* r = _current;
+    uint8_t* p = _tx;
+
+    *p++ = r->slave;
+    *p++ = r->function;
+    modbusPutU16(p, r->address);
+    p += 2;
+
+    switch (r->function) {
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            modbusPutU16(p, (r->coils[0] & 0x01) ? 0xFF00 : 0x0000);
+            p += 2;
+            break;
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            modbusPutU16(p, r->registers[0]);
+            p += 2;
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS: {
+            uint8_t bytes = (r->quantity + 7) / 8;
+            modbusPutU16(p, r->quantity);
+            p += 2;
+            *p++ = bytes;
+            memcpy(p, r->coils, bytes);
+            // unused bits of the last byte are sent as 0
+            if (r->quantity % 8) {
+                p[bytes - 1] &= (1 << (r->quantity % 8)) - 1;
+            }
+            p += bytes;
+            break;
+        }
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            modbusPutU16(p, r->quantity);
+            p += 2;
+            *p++ = r->quantity * 2;
+            for (uint16_t i = 0; i < r->quantity; i++) {
+                modbusPutU16(p, r->registers[i]);
+                p += 2;
+            }
+            break;
+        default:
+            modbusPutU16(p, r->quantity);
+            p += 2;
+            break;
+    }
+
+    uint16_t crc = modbusCrc16(_tx, p - _tx);
+    *p++ = crc & 0xFF;
+    *p++ = crc >> 8;
+    _tx_len = p - _tx;
+}
+
+void ModbusMaster::transmit(uint32_t now_us) {
+    // drop anything left on the line from a previous transaction
+    while (_port->read() >= 0) {
+    }
+
+    _rx_len = 0;
+    _expected = 0;
+    _rx_gap = false;
+    _current->attempts++;
+    _port->send(_tx, _tx_len);
+    // the timeout runs from the end of the transmission
+    _sent_us = now_us + _tx_len * _char_us;
+
+    if (_current->slave == MODBUS_BROADCAST) {
+        finish(MODBUS_RESULT_OK, now_us);
+        _holdoff_us = MODBUS_BROADCAST_DELAY_MS * 1000 + _tx_len * _char_us;
+        return;
+    }
+    _state = WAIT_RESPONSE;
+}
+
+uint32_t ModbusMaster::truncatedAfterUs() {
+    if (!_port->stamped()) {
+        return _t35_us;
+    }
+
+    // a stamped port hands the bytes over at the end of each received frame: the rest of
+    // a valid response follows within t1.5 and is handed over one character after its end
+    size_t rest = (_expected > _rx_len) ? _expected - _rx_len : sizeof(_rx) - _rx_len;
+    return _t15_us + (uint32_t)(rest + 1) * _char_us;
+}
+
+size_t ModbusMaster::expectedLength() {
+    ModbusRequest* r = _current;
+
+    if (_rx[1] & 0x80) {
+        return 5;
+    }
+    switch (r->function) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            return 5 + (r->quantity + 7) / 8;
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            return 5 + r->quantity * 2;
+        default:
+            return 8;
+    }
+}
+
+uint8_t ModbusMaster::parseResponse() {
+    ModbusRequest* r = _current;
+    const uint8_t* p = _rx;
+
+    uint16_t crc = modbusCrc16(_rx, _rx_len - 2);
+    if (_rx[_rx_len - 2] != (crc & 0xFF) || _rx[_rx_len - 1] != (crc >> 8)) {
+        _stats.crc_errors++;
+        return MODBUS_RESULT_TIMEOUT;
+    }
+    if (p[0] != r->slave || (p[1] & 0x7F) != r->function) {
+        _stats.frame_errors++;
+        return MODBUS_RESULT_TIMEOUT;
+    }
+
+    _stats.responses++;
+    if (p[1] & 0x80) {
+        _stats.exceptions++;
+        r->exception = p[2];
+        return MODBUS_RESULT_EXCEPTION;
+    }
+
+    switch (r->function) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            if (p[2] != (r->quantity + 7) / 8) {
+                break;
+            }
+            memcpy(r->coils, &p[3], p[2]);
+            return MODBUS_RESULT_OK;
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            if (p[2] != r->quantity * 2) {
+                break;
+            }
+            for (uint16_t i = 0; i < r->quantity; i++) {
+                r->registers[i] = modbusGetU16(&p[3 + 2 * i]);
+            }
+            return MODBUS_RESULT_OK;
+        default:
+            // write responses echo the first 6 bytes of the request
+            if (memcmp(p, _tx, 6) != 0) {
+                break;
+            }
+            return MODBUS_RESULT_OK;
+    }
+
+    _stats.responses--;
+    _stats.frame_errors++;
+    return MODBUS_RESULT_TIMEOUT;
+}
+
+void ModbusMaster::finish(uint8_t result, uint32_t now_us) {
+    ModbusRequest* r = _current;
+
+    if (result == MODBUS_RESULT_OK || result == MODBUS_RESULT_EXCEPTION) {
+        if (r->slave != MODBUS_BROADCAST) {
+            uint32_t elapsed = (int32_t)(now_us - _sent_us) > 0 ? now_us - _sent_us : 0;
+            uint32_t ms = elapsed / 1000;
+            int bin = 0;
+
+            while (bin < MODBUS_HISTOGRAM_BINS - 1 && ms >= (1UL << bin)) {
+                bin++;
+            }
+            _stats.histogram[bin]++;
+            if (elapsed > _stats.max_us) {
+                _stats.max_us = elapsed;
+            }
+            r->response_us = elapsed;
+        }
+    }
+
+    _stats.requests++;
+    _current = nullptr;
+    _state = IDLE;
+    _idle_since_us = now_us;
+    _holdoff_us = _t35_us;
+
+    r->result = result;
+    if (r->callback != nullptr) {
+        r->callback(r);
+    }
+}
+
+void ModbusMaster::retryOrFinish(uint32_t now_us) {
+    if (_current->attempts <= policyOf(_current->slave).retries) {
+        _stats.retries++;
+        _state = IDLE;
+        _idle_since_us = now_us;
+        _holdoff_us = _t35_us;
+        return;
+    }
+    finish(MODBUS_RESULT_TIMEOUT, now_us);
+}
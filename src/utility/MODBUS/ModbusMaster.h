@@ -0,0 +1,131 @@
+#ifndef _MODBUS_MASTER_H_
+#define _MODBUS_MASTER_H_
+
+#include "ModbusRtu.h"
+
+#ifndef MC_MB_QUEUE
+#define MC_MB_QUEUE 16       // Requests waiting for the bus
+#endif
+#ifndef MC_MB_POLICIES
+#define MC_MB_POLICIES 8     // Slaves with their own timeout and retries
+#endif
+
+#define MODBUS_HISTOGRAM_BINS        8        // Response time bins: <1, <2, <4, ... <64, >=64 ms
+#define MODBUS_DEFAULT_TIMEOUT_MS    100
+#define MODBUS_DEFAULT_RETRIES       2
+#define MODBUS_BROADCAST_DELAY_MS    100      // Bus idle time after a broadcast, for the slaves to process it
+#define MODBUS_POLL_NEVER            0xFFFFFFFF
+
+typedef struct ModbusRequest ModbusRequest;
+
+struct ModbusRequest {
+    uint8_t slave;          // Slave address, MODBUS_BROADCAST for write functions to all the slaves
+    uint8_t function;       // MODBUS_FC_x
+    uint16_t address;       // First coil or register
+    uint16_t quantity;      // Number of coils or registers
+    uint16_t* registers;    // Register functions: destination of the read or source of the write
+    uint8_t* coils;         // Coil and input functions: packed bits (LSB first), destination or source
+    void (*callback)(ModbusRequest* request); // Called on completion, may be nullptr
+    void* user;             // User data for the callback
+    uint8_t result;         // MODBUS_RESULT_x
+    uint8_t exception;      // Exception code when result is MODBUS_RESULT_EXCEPTION
+    uint8_t attempts;       // Number of transmissions
+    uint32_t response_us;   // Time from the last transmission to the response
+};
+
+typedef struct {
+    uint32_t requests;      // Requests completed
+    uint32_t responses;     // Valid responses (exceptions included)
+    uint32_t timeouts;      // Transmissions without (complete) response
+    uint32_t crc_errors;    // Responses with a bad CRC
+    uint32_t frame_errors;  // Responses not matching the request
+    uint32_t exceptions;    // Exception responses
+    uint32_t retries;       // Retransmissions
+    uint32_t max_us;        // Longest response time in us
+    uint32_t histogram[MODBUS_HISTOGRAM_BINS]; // Response times
+} ModbusMasterStats;
+
+/*
+ * Modbus RTU master state machine. Requests are queued by pointer (the
+ * caller keeps them alive until the callback) and sent back-to-back: the
+ * next frame leaves t3.5 after the end of the previous transaction. A
+ * response is complete as soon as its length, known from the request, is
+ * reached; a silence of t3.5 ends a truncated frame early (on a port with
+ * receive timestamps, the time the rest of the frame would take to be
+ * handed over). Timeouts and retries are set per slave.
+ *
+ * On a port with receive timestamps a silence longer than t1.5 inside the
+ * response makes it invalid, as required by the RTU framing; the time
+ * the bytes are polled is too coarse to check it otherwise.
+ *
+ * It has no hardware dependency: poll() is given the time and the bytes
+ * go through a ModbusPort. pollDelayUs() tells the caller how long it can
+ * sleep when no byte arrives.
+ */
+class ModbusMaster {
+public:
+    ModbusMaster();
+
+    void begin(ModbusPort* port, uint32_t baudrate);
+    bool submit(ModbusRequest* request);
+    bool isIdle();
+    // complete the current and the queued requests with MODBUS_RESULT_BUSY
+    void abort();
+    // advance the state machine, return true while there is work to do
+    bool poll(uint32_t now_us);
+    // time until poll() has something to do if no byte is received, MODBUS_POLL_NEVER when idle
+    uint32_t pollDelayUs(uint32_t now_us);
+    // true while a response is awaited
+    bool isReceiving();
+
+    void setDefaultPolicy(uint16_t timeout_ms, uint8_t retries);
+    bool setSlavePolicy(uint8_t slave, uint16_t timeout_ms, uint8_t retries);
+
+    ModbusMasterStats getStats();
+    void resetStats();
+
+    static bool validate(const ModbusRequest* request);
+
+private:
+    typedef struct {
+        uint8_t slave;
+        uint8_t retries;
+        uint16_t timeout_ms;
+    } Policy;
+
+    enum { IDLE, WAIT_RESPONSE };
+
+    ModbusPort* _port;
+    ModbusRequest* volatile _queue[MC_MB_QUEUE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    ModbusRequest* _current;
+    uint8_t _state;
+    uint8_t _tx[MODBUS_MAX_ADU];
+    size_t _tx_len;
+    uint8_t _rx[MODBUS_MAX_ADU];
+    size_t _rx_len;
+    size_t _expected;
+    bool _rx_gap;
+    uint32_t _t15_us;
+    uint32_t _t35_us;
+    uint32_t _char_us;
+    uint32_t _sent_us;
+    uint32_t _last_rx_us;
+    uint32_t _idle_since_us;
+    uint32_t _holdoff_us;
+    Policy _default;
+    Policy _policy[MC_MB_POLICIES];
+    ModbusMasterStats _stats;
+
+    Policy policyOf(uint8_t slave);
+    void buildFrame();
+    void transmit(uint32_t now_us);
+    size_t expectedLength();
+    uint32_t truncatedAfterUs();
+    uint8_t parseResponse();
+    void finish(uint8_t result, uint32_t now_us);
+    void retryOrFinish(uint32_t now_us);
+};
+
+#endif
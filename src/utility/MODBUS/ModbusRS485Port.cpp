@@ -0,0 +1,18 @@
+#include "ModbusRS485Port.h"
+
+ModbusRS485Port::ModbusRS485Port(RS485Class& rs485) : _rs485(rs485) {
+}
+
+bool ModbusRS485Port::send(const uint8_t* frame, size_t len) {
+    _rs485.noReceive();
+    _rs485.beginTransmission();
+    size_t written = _rs485.write(frame, len);
+    _rs485.endTransmission();
+    _rs485.receive();
+
+    return written == len;
+}
+
+int ModbusRS485Port::read() {
+    return _rs485.read();
+}
@@ -0,0 +1,22 @@
+#ifndef _MODBUS_RS485_PORT_H_
+#define _MODBUS_RS485_PORT_H_
+
+#include <ArduinoRS485.h>
+#include "ModbusRtu.h"
+
+/*
+ * ModbusPort on a half duplex RS485 port: the receiver is switched off
+ * while a frame is sent, so the engines never read their own echo.
+ */
+class ModbusRS485Port : public ModbusPort {
+public:
+    ModbusRS485Port(RS485Class& rs485);
+
+    bool send(const uint8_t* frame, size_t len);
+    int read();
+
+private:
+    RS485Class& _rs485;
+};
+
+#endif
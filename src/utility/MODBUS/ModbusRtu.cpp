@@ -0,0 +1,126 @@
+#include "ModbusRtu.h"
+#include <stdio.h>
+
+#define MODBUS_HIGH_BAUDRATE   19200
+#define MODBUS_HIGH_T15_US     750
+#define MODBUS_HIGH_T35_US     1750
+#define MODBUS_CHAR_BITS       11
+
+// CRC-16/MODBUS (reflected polynomial 0xA001), one lookup per byte
+static const uint16_t MODBUS_CRC_TABLE[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,};
+
+uint16_t modbusCrc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc >> 8) ^ MODBUS_CRC_TABLE[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+uint32_t modbusCharTimeUs(uint32_t baudrate) {
+    if (baudrate == 0) {
+        return 0;
+    }
+    return (MODBUS_CHAR_BITS * 1000000UL + baudrate - 1) / baudrate;
+}
+
+uint32_t modbusT15Us(uint32_t baudrate) {
+    if (baudrate > MODBUS_HIGH_BAUDRATE) {
+        return MODBUS_HIGH_T15_US;
+    }
+    return (3 * modbusCharTimeUs(baudrate) + 1) / 2;
+}
+
+uint32_t modbusT35Us(uint32_t baudrate) {
+    if (baudrate > MODBUS_HIGH_BAUDRATE) {
+        return MODBUS_HIGH_T35_US;
+    }
+    return (7 * modbusCharTimeUs(baudrate) + 1) / 2;
+}
+
+static const char* modbusFunctionName(uint8_t function) {
+    switch (function) {
+        case MODBUS_FC_READ_COILS: return "read coils";
+        case MODBUS_FC_READ_DISCRETE_INPUTS: return "read discrete inputs";
+        case MODBUS_FC_READ_HOLDING_REGISTERS: return "read holding registers";
+        case MODBUS_FC_READ_INPUT_REGISTERS: return "read input registers";
+        case MODBUS_FC_WRITE_SINGLE_COIL: return "write single coil";
+        case MODBUS_FC_WRITE_SINGLE_REGISTER: return "write single register";
+        case MODBUS_FC_WRITE_MULTIPLE_COILS: return "write multiple coils";
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS: return "write multiple registers";
+        default: return "function";
+    }
+}
+
+size_t modbusDescribeRtu(const uint8_t* adu, size_t len, char* out, size_t size) {
+    int n;
+
+    if (size == 0) {
+        return 0;
+    }
+    if (len < 4) {
+        n = snprintf(out, size, "too short");
+    } else if (modbusCrc16(adu, len - 2) != (adu[len - 2] | ((uint16_t)adu[len - 1] << 8))) {
+        n = snprintf(out, size, "bad crc");
+    } else {
+        uint8_t slave = adu[0];
+        uint8_t function = adu[1];
+        const char* name = modbusFunctionName(function & 0x7F);
+        // frame length without address and CRC
+        size_t pdu = len - 3;
+
+        if (function & 0x80) {
+            n = snprintf(out, size, "slave %u %s (0x%02X) exception %u", slave, name, function & 0x7F, pdu >= 2 ? adu[2] : 0);
+        } else if (function <= MODBUS_FC_READ_INPUT_REGISTERS && pdu >= 2 && adu[2] + 2U == pdu) {
+            // read response: byte count then data, checked first since a request has no byte count
+            n = snprintf(out, size, "slave %u %s response %u bytes", slave, name, adu[2]);
+        } else if ((function <= MODBUS_FC_WRITE_SINGLE_REGISTER || function == MODBUS_FC_WRITE_MULTIPLE_COILS || function == MODBUS_FC_WRITE_MULTIPLE_REGISTERS) && pdu == 5) {
+            // read request, single write (request and echo) or multiple write response
+            n = snprintf(out, size, "slave %u %s 0x%04X %s %u", slave, name, modbusGetU16(&adu[2]),
+                         (function == MODBUS_FC_WRITE_SINGLE_COIL || function == MODBUS_FC_WRITE_SINGLE_REGISTER) ? "=" : "x", modbusGetU16(&adu[4]));
+        } else if ((function == MODBUS_FC_WRITE_MULTIPLE_COILS || function == MODBUS_FC_WRITE_MULTIPLE_REGISTERS) && pdu >= 6 && adu[6] + 6U == pdu) {
+            n = snprintf(out, size, "slave %u %s 0x%04X x %u, %u bytes", slave, name, modbusGetU16(&adu[2]), modbusGetU16(&adu[4]), adu[6]);
+        } else {
+            n = snprintf(out, size, "slave %u %s (0x%02X) %u bytes", slave, name, function, (unsigned)pdu - 1);
+        }
+    }
+
+    if (n < 0) {
+        out[0] = '\0';
+        return 0;
+    }
+    return ((size_t)n < size) ? (size_t)n : size - 1;
+}
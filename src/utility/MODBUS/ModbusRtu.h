@@ -0,0 +1,83 @@
+#ifndef _MODBUS_RTU_H_
+#define _MODBUS_RTU_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// function codes
+#define MODBUS_FC_READ_COILS              0x01
+#define MODBUS_FC_READ_DISCRETE_INPUTS    0x02
+#define MODBUS_FC_READ_HOLDING_REGISTERS  0x03
+#define MODBUS_FC_READ_INPUT_REGISTERS    0x04
+#define MODBUS_FC_WRITE_SINGLE_COIL       0x05
+#define MODBUS_FC_WRITE_SINGLE_REGISTER   0x06
+#define MODBUS_FC_WRITE_MULTIPLE_COILS    0x0F
+#define MODBUS_FC_WRITE_MULTIPLE_REGISTERS 0x10
+
+// exception codes
+#define MODBUS_EX_ILLEGAL_FUNCTION        0x01
+#define MODBUS_EX_ILLEGAL_DATA_ADDRESS    0x02
+#define MODBUS_EX_ILLEGAL_DATA_VALUE      0x03
+#define MODBUS_EX_SLAVE_DEVICE_FAILURE    0x04
+
+// transaction results
+#define MODBUS_RESULT_OK        0 // Valid response received
+#define MODBUS_RESULT_PENDING   1 // Queued or in progress
+#define MODBUS_RESULT_TIMEOUT   2 // No (valid) response after all the retries
+#define MODBUS_RESULT_EXCEPTION 3 // The slave answered with an exception, see the exception field
+#define MODBUS_RESULT_INVALID   4 // Invalid request (function, quantity, buffer)
+#define MODBUS_RESULT_BUSY      5 // Queue full or master not running
+
+#define MODBUS_BROADCAST        0
+#define MODBUS_MAX_ADU          256
+#define MODBUS_MAX_READ_BITS    2000
+#define MODBUS_MAX_READ_REGS    125
+#define MODBUS_MAX_WRITE_BITS   1968
+#define MODBUS_MAX_WRITE_REGS   123
+
+uint16_t modbusCrc16(const uint8_t* data, size_t len);
+
+// registers and MBAP fields are big-endian on the wire
+static inline void modbusPutU16(uint8_t* out, uint16_t value) {
+    out[0] = value >> 8;
+    out[1] = value & 0xFF;
+}
+
+static inline uint16_t modbusGetU16(const uint8_t* in) {
+    return ((uint16_t)in[0] << 8) | in[1];
+}
+
+// RTU timing: the character is 11 bits (start, 8 data, parity or second stop, stop),
+// above 19200 baud the standard fixes t1.5 to 750us and t3.5 to 1750us
+uint32_t modbusCharTimeUs(uint32_t baudrate);
+uint32_t modbusT15Us(uint32_t baudrate);
+uint32_t modbusT35Us(uint32_t baudrate);
+
+// describe a RTU frame captured on the bus (request, response or exception) as text,
+// return the length of the text (truncated to size - 1)
+size_t modbusDescribeRtu(const uint8_t* adu, size_t len, char* out, size_t size);
+
+/*
+ * Byte transport of a Modbus RTU engine: the RS485 port on the board,
+ * an in-memory loopback on the host.
+ *
+ * A port whose receiver timestamps the bytes (frame mode) reports it with
+ * stamped(): the engines then measure the silences between the bytes from
+ * the timestamps instead of the time they are polled.
+ */
+class ModbusPort {
+public:
+    virtual ~ModbusPort() {}
+
+    // transmit a whole frame, the frame must stay valid until the last byte is on the line
+    virtual bool send(const uint8_t* frame, size_t len) = 0;
+    // next received byte, -1 if none
+    virtual int read() = 0;
+
+    // true if readStamped() gives the reception time of the bytes
+    virtual bool stamped() { return false; }
+    // next received byte and the end of its stop bit in us (time base of the engine), -1 if none
+    virtual int readStamped(uint32_t* end_us) { *end_us = 0; return read(); }
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "ModbusSlave.h"
+#include <string.h>
+
+ModbusSlave::ModbusSlave() : _unit_id(1), _map(nullptr), _port(nullptr), _write_cb(nullptr), _write_ctx(nullptr), _rx_len(0), _skip(false), _t35_us(0), _last_rx_us(0) {
+    resetStats();
+}
+
+void ModbusSlave::begin(uint8_t unit_id, const ModbusDataMap* map, ModbusPort* port, uint32_t baudrate) {
+    _unit_id = unit_id;
+    _map = map;
+    _port = port;
+    _t35_us = modbusT35Us(baudrate);
+    _rx_len = 0;
+    _skip = false;
+}
+
+void ModbusSlave::setWriteCallback(void (*callback)(void* context, uint8_t table, uint16_t address, uint16_t quantity), void* context) {
+    _write_cb = callback;
+    _write_ctx = context;
+}
+
+uint8_t ModbusSlave::getUnitId() {
+    return _unit_id;
+}
+
+size_t ModbusSlave::processPdu(const uint8_t* pdu, size_t len, uint8_t* out) {
+    uint8_t function = pdu[0];
+
+    if (_map == nullptr) {
+        return exception(function, MODBUS_EX_SLAVE_DEVICE_FAILURE, out);
+    }
+
+    switch (function) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            if (len != 5) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+            }
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            if (len < 6 || len != 6 + (size_t)pdu[5]) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+            }
+            break;
+        default:
+            return exception(function, MODBUS_EX_ILLEGAL_FUNCTION, out);
+    }
+
+    uint16_t address = modbusGetU16(&pdu[1]);
+    uint16_t value = modbusGetU16(&pdu[3]);
+
+    switch (function) {
+        case MODBUS_FC_READ_COILS:
+            return readBits(_map->coils, _map->num_coils, pdu, out);
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            return readBits(_map->discrete_inputs, _map->num_discrete_inputs, pdu, out);
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+            return readRegisters(_map->holding_registers, _map->num_holding_registers, pdu, out);
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            return readRegisters(_map->input_registers, _map->num_input_registers, pdu, out);
+
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            if (value != 0xFF00 && value != 0x0000) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+            }
+            if (address >= _map->num_coils) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_ADDRESS, out);
+            }
+            if (value) {
+                _map->coils[address / 8] |= 1 << (address % 8);
+            } else {
+                _map->coils[address / 8] &= ~(1 << (address % 8));
+            }
+            if (_write_cb != nullptr) {
+                _write_cb(_write_ctx, MODBUS_TABLE_COILS, address, 1);
+            }
+            memcpy(out, pdu, 5);
+            return 5;
+
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            if (address >= _map->num_holding_registers) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_ADDRESS, out);
+            }
+            _map->holding_registers[address] = value;
+            if (_write_cb != nullptr) {
+                _write_cb(_write_ctx, MODBUS_TABLE_HOLDING_REGISTERS, address, 1);
+            }
+            memcpy(out, pdu, 5);
+            return 5;
+
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            if (value < 1 || value > MODBUS_MAX_WRITE_BITS || pdu[5] != (value + 7) / 8) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+            }
+            if ((uint32_t)address + value > _map->num_coils) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_ADDRESS, out);
+            }
+            for (uint16_t i = 0; i < value; i++) {
+                uint16_t bit = address + i;
+                if (pdu[6 + i / 8] & (1 << (i % 8))) {
+                    _map->coils[bit / 8] |= 1 << (bit % 8);
+                } else {
+                    _map->coils[bit / 8] &= ~(1 << (bit % 8));
+                }
+            }
+            if (_write_cb != nullptr) {
+                _write_cb(_write_ctx, MODBUS_TABLE_COILS, address, value);
+            }
+            memcpy(out, pdu, 5);
+            return 5;
+
+        default: // MODBUS_FC_WRITE_MULTIPLE_REGISTERS
+            if (value < 1 || value > MODBUS_MAX_WRITE_REGS || pdu[5] != value * 2) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+            }
+            if ((uint32_t)address + value > _map->num_holding_registers) {
+                return exception(function, MODBUS_EX_ILLEGAL_DATA_ADDRESS, out);
+            }
+            for (uint16_t i = 0; i < value; i++) {
+                _map->holding_registers[address + i] = modbusGetU16(&pdu[6 + 2 * i]);
+            }
+            if (_write_cb != nullptr) {
+                _write_cb(_write_ctx, MODBUS_TABLE_HOLDING_REGISTERS, address, value);
+            }
+            memcpy(out, pdu, 5);
+            return 5;
+    }
+}
+
+size_t ModbusSlave::processRtu(const uint8_t* adu, size_t len, uint8_t* out) {
+    if (len < 4) {
+        _stats.frame_errors++;
+        return 0;
+    }
+
+    if (!crcValid(adu, len)) {
+        _stats.crc_errors++;
+        return 0;
+    }
+    if (adu[0] != _unit_id && adu[0] != MODBUS_BROADCAST) {
+        _stats.ignored++;
+        return 0;
+    }
+
+    _stats.requests++;
+    out[0] = _unit_id;
+    size_t pdu_len = processPdu(&adu[1], len - 3, &out[1]);
+
+    // broadcasts are never answered, not even with an exception
+    if (adu[0] == MODBUS_BROADCAST) {
+        return 0;
+    }
+
+    uint16_t crc = modbusCrc16(out, pdu_len + 1);
+    out[pdu_len + 1] = crc & 0xFF;
+    out[pdu_len + 2] = crc >> 8;
+    return pdu_len + 3;
+}
+
+size_t ModbusSlave::processTcp(const uint8_t* adu, size_t len, uint8_t* out) {
+    int frame_len = tcpFrameLength(adu, len);
+
+    if (frame_len <= MODBUS_TCP_HEADER || (size_t)frame_len != len) {
+        _stats.frame_errors++;
+        return 0;
+    }
+
+    // unit identifier: ours, or 0/0xFF when the slave is addressed by its IP address only
+    uint8_t unit = adu[6];
+    if (unit != _unit_id && unit != 0 && unit != 0xFF) {
+        _stats.ignored++;
+        return 0;
+    }
+
+    _stats.requests++;
+    memcpy(out, adu, MODBUS_TCP_HEADER);
+    size_t pdu_len = processPdu(&adu[MODBUS_TCP_HEADER], len - MODBUS_TCP_HEADER, &out[MODBUS_TCP_HEADER]);
+    modbusPutU16(&out[4], pdu_len + 1);
+    return MODBUS_TCP_HEADER + pdu_len;
+}
+
+int ModbusSlave::pollTcp(uint8_t* rx, size_t* rx_len, uint8_t* out) {
+    for (;;) {
+        int len = tcpFrameLength(rx, *rx_len);
+        if (len < 0) {
+            *rx_len = 0;
+            return -1;
+        }
+        if (len == 0 || (size_t)len > *rx_len) {
+            return 0;
+        }
+
+        size_t out_len = processTcp(rx, len, out);
+        memmove(rx, &rx[len], *rx_len - len);
+        *rx_len -= len;
+        if (out_len > 0) {
+            return (int)out_len;
+        }
+    }
+}
+
+size_t ModbusSlave::pollRtu(uint32_t now_us, uint8_t* out) {
+    int c;
+
+    if (_port == nullptr) {
+        return 0;
+    }
+
+    // a silence of t3.5 ends any frame in progress
+    if ((_rx_len > 0 || _skip) && now_us - _last_rx_us >= _t35_us) {
+        if (!_skip) {
+            _stats.frame_errors++;
+        }
+        _rx_len = 0;
+        _skip = false;
+    }
+
+    while ((c = _port->read()) >= 0) {
+        _last_rx_us = now_us;
+        if (_skip) {
+            continue;
+        }
+
+        _rx[_rx_len++] = (uint8_t)c;
+        size_t expected = rtuRequestLength(_rx, _rx_len);
+        if (expected > MODBUS_MAX_ADU || (expected == 0 && _rx_len == MODBUS_MAX_ADU)) {
+            _skip = true;
+            continue;
+        }
+        if (expected == 0 || _rx_len < expected) {
+            continue;
+        }
+
+        if (!crcValid(_rx, _rx_len)) {
+            // not a request (e.g. the response of another slave) or corrupted:
+            // drop everything up to the next silence
+            _stats.crc_errors++;
+            _skip = true;
+            continue;
+        }
+
+        size_t len = processRtu(_rx, _rx_len, out);
+        _rx_len = 0;
+        if (len > 0) {
+            return len;
+        }
+    }
+    return 0;
+}
+
+bool ModbusSlave::isReceiving() {
+    return _rx_len > 0 || _skip;
+}
+
+size_t ModbusSlave::rtuRequestLength(const uint8_t* adu, size_t len) {
+    if (len < 2) {
+        return 0;
+    }
+
+    switch (adu[1]) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            return 8;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            // address, function, start, quantity, byte count, data, CRC
+            return (len < 7) ? 0 : 9 + adu[6];
+        default:
+            // unknown function: the end of the frame is given by the silence
+            return 0;
+    }
+}
+
+int ModbusSlave::tcpFrameLength(const uint8_t* data, size_t len) {
+    if (len < 6) {
+        return 0;
+    }
+
+    uint16_t protocol = modbusGetU16(&data[2]);
+    uint16_t length = modbusGetU16(&data[4]);
+    if (protocol != 0 || length < 2 || length > MODBUS_TCP_MAX_ADU - 6) {
+        return -1;
+    }
+    return 6 + length;
+}
+
+void ModbusSlave::recordLatency(uint32_t us) {
+    int bin = 0;
+
+    while (bin < MODBUS_LATENCY_BINS - 1 && us >= (128UL << bin)) {
+        bin++;
+    }
+    _stats.histogram[bin]++;
+    _stats.last_us = us;
+    if (us > _stats.max_us) {
+        _stats.max_us = us;
+    }
+}
+
+ModbusSlaveStats ModbusSlave::getStats() {
+    return _stats;
+}
+
+void ModbusSlave::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+size_t ModbusSlave::readBits(const uint8_t* bits, uint16_t count, const uint8_t* pdu, uint8_t* out) {
+    uint16_t address = modbusGetU16(&pdu[1]);
+    uint16_t quantity = modbusGetU16(&pdu[3]);
+
+    if (quantity < 1 || quantity > MODBUS_MAX_READ_BITS) {
+        return exception(pdu[0], MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+    }
+    if ((uint32_t)address + quantity > count) {
+        return exception(pdu[0], MODBUS_EX_ILLEGAL_DATA_ADDRESS, out);
+    }
+
+    uint8_t bytes = (quantity + 7) / 8;
+    out[0] = pdu[0];
+    out[1] = bytes;
+    memset(&out[2], 0, bytes);
+    for (uint16_t i = 0; i < quantity; i++) {
+        uint16_t bit = address + i;
+        if (bits[bit / 8] & (1 << (bit % 8))) {
+            out[2 + i / 8] |= 1 << (i % 8);
+        }
+    }
+    return 2 + bytes;
+}
+
+size_t ModbusSlave::readRegisters(const uint16_t* regs, uint16_t count, const uint8_t* pdu, uint8_t* out) {
+    uint16_t address = modbusGetU16(&pdu[1]);
+    uint16_t quantity = modbusGetU16(&pdu[3]);
+
+    if (quantity < 1 || quantity > MODBUS_MAX_READ_REGS) {
+        return exception(pdu[0], MODBUS_EX_ILLEGAL_DATA_VALUE, out);
+    }
+    if ((uint32_t)address + quantity > count) {
+        return exception(pdu[0], MODBUS_EX_ILLEGAL_DATA_ADDRESS, out);
+    }
+
+    out[0] = pdu[0];
+    out[1] = quantity * 2;
+    for (uint16_t i = 0; i < quantity; i++) {
+        modbusPutU16(&out[2 + 2 * i], regs[address + i]);
+    }
+    return 2 + quantity * 2;
+}
+
+bool ModbusSlave::crcValid(const uint8_t* adu, size_t len) {
+    uint16_t crc = modbusCrc16(adu, len - 2);
+    return adu[len - 2] == (crc & 0xFF) && adu[len - 1] == (crc >> 8);
+}
+
+size_t ModbusSlave::exception(uint8_t function, uint8_t code, uint8_t* out) {
+    _stats.exceptions++;
+    out[0] = function | 0x80;
+    out[1] = code;
+    return 2;
+}
@@ -0,0 +1,107 @@
+#ifndef _MODBUS_SLAVE_H_
+#define _MODBUS_SLAVE_H_
+
+#include "ModbusRtu.h"
+
+#define MODBUS_TABLE_COILS              0
+#define MODBUS_TABLE_DISCRETE_INPUTS    1
+#define MODBUS_TABLE_INPUT_REGISTERS    2
+#define MODBUS_TABLE_HOLDING_REGISTERS  3
+
+#define MODBUS_TCP_PORT         502
+#define MODBUS_TCP_HEADER       7           // MBAP header, unit identifier included
+#define MODBUS_TCP_MAX_ADU      260
+
+#define MODBUS_LATENCY_BINS     8           // Response latency bins: <128, <256, ... <8192, >=8192 us
+
+typedef struct {
+    uint8_t* coils;                     // Packed bits, LSB first
+    uint16_t num_coils;
+    uint8_t* discrete_inputs;           // Packed bits, LSB first
+    uint16_t num_discrete_inputs;
+    uint16_t* input_registers;
+    uint16_t num_input_registers;
+    uint16_t* holding_registers;
+    uint16_t num_holding_registers;
+} ModbusDataMap;
+
+typedef struct {
+    uint32_t requests;      // Requests addressed to this slave (broadcasts included)
+    uint32_t exceptions;    // Requests answered with an exception
+    uint32_t crc_errors;    // RTU frames with a bad CRC
+    uint32_t frame_errors;  // Frames too short or with a bad header
+    uint32_t ignored;       // Valid RTU frames for another slave
+    uint32_t last_us;       // Latency of the last response in us
+    uint32_t max_us;        // Longest latency in us
+    uint32_t histogram[MODBUS_LATENCY_BINS]; // Response latencies
+} ModbusSlaveStats;
+
+/*
+ * Modbus slave answering from a data map in memory: functions 0x01-0x06,
+ * 0x0F and 0x10, RTU (address and CRC) or TCP (MBAP header) framing.
+ * Writes go to the map and are reported through the write callback, the
+ * map is never refreshed by the slave itself.
+ *
+ * pollRtu() assembles RTU requests from the port: a request is complete
+ * as soon as the length given by its function code is reached, without
+ * waiting for t3.5, and a frame with a bad CRC is dropped up to the next
+ * t3.5 silence (the responses of the other slaves end up there too).
+ *
+ * It has no hardware dependency: the caller gives the time, sends the
+ * responses, owns the locking of the map and records the latencies it
+ * measures.
+ */
+class ModbusSlave {
+public:
+    ModbusSlave();
+
+    void begin(uint8_t unit_id, const ModbusDataMap* map, ModbusPort* port = nullptr, uint32_t baudrate = 19200);
+    void setWriteCallback(void (*callback)(void* context, uint8_t table, uint16_t address, uint16_t quantity), void* context);
+    uint8_t getUnitId();
+
+    // answer a PDU (function code first), return the length of the response PDU
+    size_t processPdu(const uint8_t* pdu, size_t len, uint8_t* out);
+    // answer a RTU ADU, return the length of the response ADU, 0 if none is due
+    size_t processRtu(const uint8_t* adu, size_t len, uint8_t* out);
+    // answer a TCP ADU (MBAP header first), return the length of the response ADU, 0 if none is due
+    size_t processTcp(const uint8_t* adu, size_t len, uint8_t* out);
+    // answer the next complete request of a TCP stream buffered in rx (requests may be split across
+    // segments or pipelined) and drop it from rx, return the length of the response ADU, 0 if none
+    // is due yet, -1 if the stream is invalid and the connection must be closed
+    int pollTcp(uint8_t* rx, size_t* rx_len, uint8_t* out);
+
+    // read the port, answer a complete request in out (the caller sends it),
+    // return the length of the response ADU, 0 if none is due
+    size_t pollRtu(uint32_t now_us, uint8_t* out);
+    // true while a RTU frame is being received or skipped
+    bool isReceiving();
+
+    // length of the RTU request in adu, 0 while it cannot be known yet
+    static size_t rtuRequestLength(const uint8_t* adu, size_t len);
+    // length of the TCP ADU in data, 0 while the header is incomplete, -1 if the header is invalid
+    static int tcpFrameLength(const uint8_t* data, size_t len);
+
+    void recordLatency(uint32_t us);
+    ModbusSlaveStats getStats();
+    void resetStats();
+
+private:
+    uint8_t _unit_id;
+    const ModbusDataMap* _map;
+    ModbusPort* _port;
+    void (*_write_cb)(void* context, uint8_t table, uint16_t address, uint16_t quantity);
+    void* _write_ctx;
+    uint8_t _rx[MODBUS_MAX_ADU];
+    size_t _rx_len;
+    bool _skip;
+    uint32_t _t35_us;
+    uint32_t _last_rx_us;
+    ModbusSlaveStats _stats;
+
+    size_t readBits(const uint8_t* bits, uint16_t count, const uint8_t* pdu, uint8_t* out);
+    size_t readRegisters(const uint16_t* regs, uint16_t count, const uint8_t* pdu, uint8_t* out);
+    size_t exception(uint8_t function, uint8_t code, uint8_t* out);
+    static bool crcValid(const uint8_t* adu, size_t len);
+};
+
+#endif
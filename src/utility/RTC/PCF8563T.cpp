@@ -6,9 +6,14 @@
 #define PCF8563T_MINUTES_REG    0x03
 #define PCF8563T_HOURS_REG      0X04
 #define PCF8563T_DAYS_REG       0x05
+#define PCF8563T_WEEKDAYS_REG   0x06
 #define PCF8563T_MONTHS_REG     0x07
 #define PCF8563T_YEARS_REG      0x08
 
+#define PCF8563T_TIME_REGS      7
+#define PCF8563T_VL_MASK        0x80
+#define PCF8563T_CENTURY_MASK   0x80
+
 // alarm management
 #define PCF8563T_MINUTE_ALARM_REG 0x09
 #define PCF8563T_MINUTE_ALARM_AE_M_MASK 0x80
@@ -22,14 +27,43 @@
 #define PCF8563T_DAY_ALARM_AE_D_MASK 0x80
 #define PCF8563T_DAY_ALARM_ON 0x7F
 
+#define PCF8563T_WEEKDAY_ALARM_REG 0x0C
+#define PCF8563T_WEEKDAY_ALARM_AE_W_MASK 0x80
+
 #define PCF8563T_TIMER_CONTROL_REG 0X0E
 #define PCF8563T_TIMER_CONTROL_ON 0x80
 #define PCF8563T_TIMER_CONTROL_OFF 0x7F
+#define PCF8563T_TIMER_CONTROL_TD_MASK 0x03
+#define PCF8563T_TIMER_REG 0x0F
 
 #define PCF8563T_STATUS_2_AIE_MASK 0x02
+#define PCF8563T_STATUS_2_TIE_MASK 0x01
+#define PCF8563T_STATUS_2_FLAGS_MASK (RTC_FLAG_TIMER | RTC_FLAG_ALARM)
 #define PCF8563T_STATUS_2_CLEAR_INT 0xF7
 #define PCF8563T_STATUS_2_INT_OFF 0x7d
 
+// valid bits of the time registers 0x02 to 0x08
+static const uint8_t PCF8563T_TIME_MASK[PCF8563T_TIME_REGS] = { 0x7F, 0x7F, 0x3F, 0x3F, 0x07, 0x1F, 0xFF };
+// valid range of the decoded time registers
+static const uint8_t PCF8563T_TIME_MIN[PCF8563T_TIME_REGS] = { 0, 0, 0, 1, 0, 1, 0 };
+static const uint8_t PCF8563T_TIME_MAX[PCF8563T_TIME_REGS] = { 59, 59, 23, 31, 6, 12, 99 };
+// value of the tens digit of a BCD byte, 0xFF for the invalid digits
+static const uint8_t PCF8563T_BCD_TENS[16] = { 0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+// binary value of a BCD byte, 0xFF if it is not a valid BCD number
+static inline uint8_t bcdToBin(uint8_t bcd) {
+  uint8_t tens = PCF8563T_BCD_TENS[bcd >> 4];
+  uint8_t unit = bcd & 0x0F;
+  return (tens == 0xFF || unit > 9) ? 0xFF : tens + unit;
+}
+
+static inline uint8_t binToBcd(uint8_t bin) {
+  uint8_t tens = bin / 10;
+  return (tens << 4) | (bin - tens * 10);
+}
+
+rtos::Mutex PCF8563TClass::_bus_mutex;
+
 /**
  *  Object constructor
  *  
@@ -46,13 +80,14 @@ PCF8563TClass::PCF8563TClass()
  */   
 bool PCF8563TClass::begin()
 {
+  lock();
   Wire1.begin(); // join i2c bus
 
   Wire1.beginTransmission(PCF8563T_ADDRESS);
-  if (!Wire1.endTransmission()) {
-    return true;
-  }
-  return false;
+  bool found = !Wire1.endTransmission();
+  unlock();
+
+  return found;
 }
 
 /**
@@ -192,16 +227,11 @@ uint8_t PCF8563TClass::getSeconds() {
  *  
  */   
 void PCF8563TClass::setEpoch() {
-  struct tm time;
-  time.tm_sec = getSeconds();
-  time.tm_min = getMinutes();
-  time.tm_hour = getHours();
-  time.tm_mday = getDay();
-  time.tm_mon = getMonth() - 1;
-  time.tm_year = getYear() + 100;
+  PCF8563TTime time;
   time_t seconds;
-  _rtc_maketime(&time, &seconds, RTC_FULL_LEAP_YEAR_SUPPORT);
-  set_time(seconds);
+  if (readTime(&time) && timeToEpoch(&time, &seconds)) {
+    set_time(seconds);
+  }
 }
 
 /**
@@ -212,14 +242,19 @@ void PCF8563TClass::setEpoch() {
  */    
 void PCF8563TClass::setEpoch(time_t seconds) {
   struct tm time;
+  PCF8563TTime rtc;
   _rtc_localtime(seconds, &time, RTC_FULL_LEAP_YEAR_SUPPORT);
 
-  setSeconds(time.tm_sec);
-  setMinutes(time.tm_min);
-  setHours( time.tm_hour);
-  setDay(time.tm_mday);
-  setMonth(time.tm_mon + 1);
-  setYear((time.tm_year - 100));
+  rtc.seconds = time.tm_sec;
+  rtc.minutes = time.tm_min;
+  rtc.hours = time.tm_hour;
+  rtc.days = time.tm_mday;
+  rtc.weekdays = time.tm_wday;
+  rtc.months = time.tm_mon + 1;
+  rtc.years = time.tm_year - 100;
+  rtc.century = false;
+  rtc.voltageLow = false;
+  writeTime(&rtc);
   set_time(seconds);
 }
 
@@ -255,32 +290,94 @@ void PCF8563TClass::setEpoch(uint8_t years, uint8_t months, uint8_t days, uint8_
  *  Get epoch number
  *  Convert real time to difference between actual time and Epoch(Unix time)
  *  Saved into time_t type
+ *  The time registers are read in a single transfer, so the result cannot tear across a rollover
  * 
  *  example:  1625572527 -> Tue, 06 Jul 2021 11:55:27 GMT 
  * 
- *  @return number of seconds after Unix time (time_t type)
+ *  @return number of seconds after Unix time (time_t type), -1 if the RTC could not be read
  */   
 time_t PCF8563TClass::getEpoch() {
-  struct tm time;
+  PCF8563TTime time;
   time_t seconds;
 
-  time.tm_sec = getSeconds();
-  time.tm_min = getMinutes();
-  time.tm_hour = getHours();
-  time.tm_mday = getDay();
-  time.tm_mon = getMonth() - 1;
-  time.tm_year = getYear() + 100;  // year since 1900
-
-  _rtc_maketime(&time, &seconds, RTC_FULL_LEAP_YEAR_SUPPORT);
+  if (!readTime(&time) || !timeToEpoch(&time, &seconds)) {
+    return (time_t)-1;
+  }
   return seconds;
 }
 
+/**
+ *  Read all the time registers (0x02 to 0x08) in a single auto-increment transfer
+ *  The RTC freezes its counters during the transfer: all the fields belong to the same second
+ *  
+ *  @param time decoded time, with the VL (voltage-low) and century bits
+ *  @return true if the registers were read, false on I2C error or if a register is not valid BCD or out of range
+ */   
+bool PCF8563TClass::readTime(PCF8563TTime* time) {
+  uint8_t regs[PCF8563T_TIME_REGS];
+  uint8_t value[PCF8563T_TIME_REGS];
+
+  if (!readBytes(PCF8563T_VL_SECONDS_REG, regs, PCF8563T_TIME_REGS)) {
+    return false;
+  }
+  for (int i = 0; i < PCF8563T_TIME_REGS; i++) {
+    value[i] = bcdToBin(regs[i] & PCF8563T_TIME_MASK[i]);
+    if (value[i] < PCF8563T_TIME_MIN[i] || value[i] > PCF8563T_TIME_MAX[i]) {
+      return false;
+    }
+  }
+
+  time->seconds = value[0];
+  time->minutes = value[1];
+  time->hours = value[2];
+  time->days = value[3];
+  time->weekdays = value[4];
+  time->months = value[5];
+  time->years = value[6];
+  time->century = (regs[5] & PCF8563T_CENTURY_MASK) != 0;
+  time->voltageLow = (regs[0] & PCF8563T_VL_MASK) != 0;
+  return true;
+}
+
+/**
+ *  Write all the time registers (0x02 to 0x08) in a single auto-increment transfer
+ *  Writing the seconds clears the VL bit
+ *  
+ *  @param time time to set, voltageLow is ignored
+ *  @return true if the registers were written, false on I2C error
+ */   
+bool PCF8563TClass::writeTime(const PCF8563TTime* time) {
+  uint8_t regs[PCF8563T_TIME_REGS];
+
+  regs[0] = binToBcd(time->seconds);
+  regs[1] = binToBcd(time->minutes);
+  regs[2] = binToBcd(time->hours);
+  regs[3] = binToBcd(time->days);
+  regs[4] = time->weekdays;
+  regs[5] = binToBcd(time->months) | (time->century ? PCF8563T_CENTURY_MASK : 0);
+  regs[6] = binToBcd(time->years);
+
+  return writeBytes(PCF8563T_VL_SECONDS_REG, regs, PCF8563T_TIME_REGS);
+}
+
+/**
+ *  Check the integrity of the RTC time
+ *  
+ *  @return false if the VL bit is set (the oscillator stopped since the time was last set) or the RTC could not be read
+ */   
+bool PCF8563TClass::isTimeValid() {
+  PCF8563TTime time;
+  return readTime(&time) && !time.voltageLow;
+}
+
 /**
  *  Enable alarm
  *  
  */   
 void PCF8563TClass::enableAlarm() {
+  lock();
   writeByte(PCF8563T_STATUS_2_REG, (readByte(PCF8563T_STATUS_2_REG) & PCF8563T_STATUS_2_CLEAR_INT) | PCF8563T_STATUS_2_AIE_MASK);
+  unlock();
 }
 
 /**
@@ -288,7 +385,9 @@ void PCF8563TClass::enableAlarm() {
  *  
  */   
 void PCF8563TClass::disableAlarm() {
+  lock();
    writeByte(PCF8563T_STATUS_2_REG, (readByte(PCF8563T_STATUS_2_REG) & PCF8563T_STATUS_2_INT_OFF));
+  unlock();
 }
 
 /**
@@ -296,7 +395,9 @@ void PCF8563TClass::disableAlarm() {
  *  
  */   
 void PCF8563TClass::clearAlarm() {
+  lock();
   writeByte(PCF8563T_STATUS_2_REG, (readByte(PCF8563T_STATUS_2_REG) & PCF8563T_STATUS_2_CLEAR_INT) | PCF8563T_STATUS_2_AIE_MASK);
+  unlock();
 }
 
 /**
@@ -316,7 +417,9 @@ void PCF8563TClass::setMinuteAlarm(uint8_t minutes) {
  *  
  */   
 void PCF8563TClass::disableMinuteAlarm() {
+  lock();
   writeByte(PCF8563T_MINUTE_ALARM_REG, readByte(PCF8563T_MINUTE_ALARM_REG) | PCF8563T_MINUTE_ALARM_AE_M_MASK);
+  unlock();
 }
 
 /**
@@ -327,7 +430,7 @@ void PCF8563TClass::disableMinuteAlarm() {
 void PCF8563TClass::setHourAlarm(uint8_t hours) {
   uint8_t dec = hours / 10;
   uint8_t unit = hours - (dec * 10);
-  uint8_t hour_alarm = PCF8563T_HOUR_ALARM_AE_H_MASK & ((dec << 4) + unit);
+  uint8_t hour_alarm = PCF8563T_HOUR_ALARM_ON & ((dec << 4) + unit);
   writeByte(PCF8563T_HOUR_ALARM_REG, hour_alarm); //check formula on datasheet val + 6 * (val / 10)
 }
 
@@ -336,7 +439,9 @@ void PCF8563TClass::setHourAlarm(uint8_t hours) {
  *  
  */   
 void PCF8563TClass::disableHourAlarm() {
+  lock();
   writeByte(PCF8563T_HOUR_ALARM_REG, readByte(PCF8563T_HOUR_ALARM_REG) | PCF8563T_HOUR_ALARM_AE_H_MASK);
+  unlock();
 }
 
 /**
@@ -356,21 +461,186 @@ void PCF8563TClass::setDayAlarm(uint8_t days) {
  *  
  */   
 void PCF8563TClass::disableDayAlarm() {
+  lock();
   writeByte(PCF8563T_DAY_ALARM_REG, readByte(PCF8563T_DAY_ALARM_REG) | PCF8563T_DAY_ALARM_AE_D_MASK );
+  unlock();
+}
+
+/**
+ *  Set the alarm to a single minute of the month in one transfer
+ *  The minute, hour and day alarms are enabled, the weekday alarm is disabled
+ *  
+ *  @param minutes minute of the alarm (0-59)
+ *  @param hours hour of the alarm (0-23)
+ *  @param days day of the month of the alarm (1-31)
+ *  @return true if the alarm registers were written, false on I2C error
+ */   
+bool PCF8563TClass::setAlarm(uint8_t minutes, uint8_t hours, uint8_t days) {
+  uint8_t regs[4];
+
+  regs[0] = binToBcd(minutes) & PCF8563T_MINUTE_ALARM_ON;
+  regs[1] = binToBcd(hours) & PCF8563T_HOUR_ALARM_ON;
+  regs[2] = binToBcd(days) & PCF8563T_DAY_ALARM_ON;
+  regs[3] = PCF8563T_WEEKDAY_ALARM_AE_W_MASK;
+
+  return writeBytes(PCF8563T_MINUTE_ALARM_REG, regs, sizeof(regs));
+}
+
+/**
+ *  Set the countdown timer, it raises RTC_FLAG_TIMER every count periods of the source clock
+ *  The timer is stopped until enableTimer() is called
+ *  
+ *  @param source timer clock (RTC_TIMER_4096HZ, RTC_TIMER_64HZ, RTC_TIMER_1HZ or RTC_TIMER_1_60HZ)
+ *  @param count number of source clock periods (1 to 255)
+ */   
+void PCF8563TClass::setTimer(uint8_t source, uint8_t count) {
+  lock();
+  writeByte(PCF8563T_TIMER_CONTROL_REG, source & PCF8563T_TIMER_CONTROL_TD_MASK);
+  writeByte(PCF8563T_TIMER_REG, count);
+  unlock();
+}
+
+/**
+ *  Start the countdown timer and enable its interrupt
+ *  
+ */   
+void PCF8563TClass::enableTimer() {
+  lock();
+  writeByte(PCF8563T_TIMER_CONTROL_REG, readByte(PCF8563T_TIMER_CONTROL_REG) | PCF8563T_TIMER_CONTROL_ON);
+  // the flags are written as 1 so that they are left unchanged
+  writeByte(PCF8563T_STATUS_2_REG, readByte(PCF8563T_STATUS_2_REG) | PCF8563T_STATUS_2_FLAGS_MASK | PCF8563T_STATUS_2_TIE_MASK);
+  unlock();
+}
+
+/**
+ *  Stop the countdown timer and disable its interrupt
+ *  
+ */   
+void PCF8563TClass::disableTimer() {
+  lock();
+  writeByte(PCF8563T_TIMER_CONTROL_REG, readByte(PCF8563T_TIMER_CONTROL_REG) & PCF8563T_TIMER_CONTROL_OFF);
+  writeByte(PCF8563T_STATUS_2_REG, (readByte(PCF8563T_STATUS_2_REG) | PCF8563T_STATUS_2_FLAGS_MASK) & ~PCF8563T_STATUS_2_TIE_MASK);
+  unlock();
+}
+
+/**
+ *  Get the pending interrupt flags
+ *  
+ *  @return RTC_FLAG_ALARM and/or RTC_FLAG_TIMER
+ */   
+uint8_t PCF8563TClass::getInterruptFlags() {
+  return readByte(PCF8563T_STATUS_2_REG) & PCF8563T_STATUS_2_FLAGS_MASK;
+}
+
+/**
+ *  Get the pending interrupt flags whose interrupt is enabled, the ones holding the INT pin low
+ *  
+ *  @return RTC_FLAG_ALARM and/or RTC_FLAG_TIMER
+ */   
+uint8_t PCF8563TClass::getActiveInterrupts() {
+  uint8_t status = readByte(PCF8563T_STATUS_2_REG);
+  uint8_t enabled = ((status & PCF8563T_STATUS_2_AIE_MASK) ? RTC_FLAG_ALARM : 0) | ((status & PCF8563T_STATUS_2_TIE_MASK) ? RTC_FLAG_TIMER : 0);
+
+  return status & enabled;
+}
+
+/**
+ *  Clear interrupt flags, the INT pin is released once no enabled flag is pending
+ *  
+ *  @param flags RTC_FLAG_ALARM and/or RTC_FLAG_TIMER
+ */   
+void PCF8563TClass::clearInterruptFlags(uint8_t flags) {
+  lock();
+  // a flag written as 1 is left unchanged, only the flags written as 0 are cleared
+  uint8_t status = readByte(PCF8563T_STATUS_2_REG) | PCF8563T_STATUS_2_FLAGS_MASK;
+  writeByte(PCF8563T_STATUS_2_REG, status & ~(flags & PCF8563T_STATUS_2_FLAGS_MASK));
+  unlock();
+}
+
+/**
+ *  Take exclusive use of the Wire1 bus
+ *  Every access to the RTC takes the lock, a thread making several accesses that must not be
+ *  interleaved with the other threads (e.g. a read-modify-write) holds it around all of them.
+ *  The lock is recursive.
+ *  
+ */   
+void PCF8563TClass::lock() {
+  _bus_mutex.lock();
+}
+
+/**
+ *  Release the Wire1 bus taken with lock()
+ *  
+ */   
+void PCF8563TClass::unlock() {
+  _bus_mutex.unlock();
 }
 
 void PCF8563TClass::writeByte(uint8_t regAddres, uint8_t data) {
+  lock();
   Wire1.beginTransmission(PCF8563T_ADDRESS);
   Wire1.write(regAddres);
   Wire1.write(data);
   Wire1.endTransmission();
+  unlock();
 }
 
 uint8_t PCF8563TClass::readByte(uint8_t regAddres) {
+  lock();
   Wire1.beginTransmission(PCF8563T_ADDRESS);
   Wire1.write(regAddres);  // Day Register
   Wire1.endTransmission();
   Wire1.requestFrom(PCF8563T_ADDRESS, 1);
+  uint8_t data = Wire1.read();
+  unlock();
+
+  return data;
+}
+
+bool PCF8563TClass::readBytes(uint8_t regAddres, uint8_t* data, uint8_t len) {
+  bool read = false;
+
+  lock();
+  Wire1.beginTransmission(PCF8563T_ADDRESS);
+  Wire1.write(regAddres);
+  if (Wire1.endTransmission(false) == 0 && Wire1.requestFrom(PCF8563T_ADDRESS, len) == len) {
+    for (uint8_t i = 0; i < len; i++) {
+      data[i] = Wire1.read();
+    }
+    read = true;
+  }
+  unlock();
+
+  return read;
+}
+
+bool PCF8563TClass::writeBytes(uint8_t regAddres, const uint8_t* data, uint8_t len) {
+  lock();
+  Wire1.beginTransmission(PCF8563T_ADDRESS);
+  Wire1.write(regAddres);
+  Wire1.write(data, len);
+  bool written = Wire1.endTransmission() == 0;
+  unlock();
+
+  return written;
+}
+
+/**
+ *  Convert a time read from the RTC to Epoch format
+ *  
+ *  @param time time read with readTime()
+ *  @param seconds number of seconds after Unix time
+ *  @return true if the time could be converted, false otherwise
+ */   
+bool PCF8563TClass::timeToEpoch(const PCF8563TTime* time, time_t* seconds) {
+  struct tm tm;
+
+  tm.tm_sec = time->seconds;
+  tm.tm_min = time->minutes;
+  tm.tm_hour = time->hours;
+  tm.tm_mday = time->days;
+  tm.tm_mon = time->months - 1;
+  tm.tm_year = time->years + 100;  // year since 1900
 
-  return Wire1.read();
+  return _rtc_maketime(&tm, seconds, RTC_FULL_LEAP_YEAR_SUPPORT);
 }
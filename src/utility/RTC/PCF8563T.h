@@ -7,6 +7,29 @@
 #include "mbed_mktime.h"
 #include "Wire.h"
 #define RTC_INT PB_9
+
+// interrupt flags of the control/status 2 register
+#define RTC_FLAG_TIMER 0x04
+#define RTC_FLAG_ALARM 0x08
+
+// countdown timer source clock
+#define RTC_TIMER_4096HZ 0x00
+#define RTC_TIMER_64HZ   0x01
+#define RTC_TIMER_1HZ    0x02
+#define RTC_TIMER_1_60HZ 0x03
+
+typedef struct {
+  uint8_t seconds;   // 0-59
+  uint8_t minutes;   // 0-59
+  uint8_t hours;     // 0-23
+  uint8_t days;      // 1-31
+  uint8_t weekdays;  // 0-6, 0 is Sunday
+  uint8_t months;    // 1-12
+  uint8_t years;     // 0-99
+  bool century;      // century bit, toggled by the RTC when years rolls over from 99 to 0
+  bool voltageLow;   // VL bit: the oscillator stopped, the time is not reliable until it is set again
+} PCF8563TTime;
+
 class PCF8563TClass {
 
 public:
@@ -31,6 +54,11 @@ public:
   void setEpoch(time_t seconds);
   time_t getEpoch();
 
+  bool readTime(PCF8563TTime* time);
+  bool writeTime(const PCF8563TTime* time);
+  bool isTimeValid();
+  bool timeToEpoch(const PCF8563TTime* time, time_t* seconds);
+
 void enableAlarm();
 void disableAlarm();
 void clearAlarm();
@@ -40,11 +68,25 @@ void setHourAlarm(uint8_t hours);
 void disableHourAlarm();
 void setDayAlarm(uint8_t days);
 void disableDayAlarm();
+  bool setAlarm(uint8_t minutes, uint8_t hours, uint8_t days);
+
+  void setTimer(uint8_t source, uint8_t count);
+  void enableTimer();
+  void disableTimer();
+  uint8_t getInterruptFlags();
+  uint8_t getActiveInterrupts();
+  void clearInterruptFlags(uint8_t flags);
 
+  static void lock();
+  static void unlock();
 
 private:
+  static rtos::Mutex _bus_mutex;  // Serializes the Wire1 transfers of all the threads
+
   void writeByte(uint8_t regAddres, uint8_t data);
   uint8_t readByte(uint8_t regAddres);
+  bool readBytes(uint8_t regAddres, uint8_t* data, uint8_t len);
+  bool writeBytes(uint8_t regAddres, const uint8_t* data, uint8_t len);
 };
 
 #endif
@@ -1,27 +1,55 @@
 #include "MAX31865.h"
 
-MAX31865Class::MAX31865Class(PinName cs, SPIClass& spi) : _cs(cs), _spi(&spi), _spiSettings(1000000, MSBFIRST, SPI_MODE1) {
+MAX31865Class::MAX31865Class(PinName cs, SPIClass& spi) : _cs(cs), _bus(&SpiBusManager::forBus(spi)), _dev(cs, SPISettings(1000000, MSBFIRST, SPI_MODE1)), _chip(&chipFor(cs)) {
+}
+
+MAX31865Chip& MAX31865Class::chipFor(PinName cs) {
+    // created on first use so that the drivers can look their chip up from global constructors
+    static MAX31865Chip chips[MAX31865_CHIPS_MAX];
+    static uint8_t count = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (chips[i].cs == cs) {
+            return chips[i];
+        }
+    }
+
+    if (count == MAX31865_CHIPS_MAX) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_DRIVER_SPI, MBED_ERROR_CODE_OUT_OF_RESOURCES), "Too many MAX31865 chips");
+    }
+
+    chips[count] = { cs, 0x00, PROBE_RTD_2W, false, 0 };
+    return chips[count++];
 }
 
 bool MAX31865Class::begin() {
-    _spi->begin();
+    _bus->acquire(_dev);
 
     pinMode(_cs, OUTPUT);
     digitalWrite(_cs, HIGH);
 
-    // disable bias
-    writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_BIAS_MASK);
+    // keep the wiring configured on the chip, then write the config once:
+    // bias disabled, auto convert mode disabled, fault cleared, 60Hz filter
+    _chip->autoConvert = false;
+    _chip->config = readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_3_WIRE;
+    _chip->probeType = (_chip->config & MAX31856_CONFIG_3_WIRE) ? PROBE_RTD_3W : PROBE_RTD_2W;
+    writeByte(MAX31856_CONFIG_REG, _chip->config | MAX31856_CONFIG_CLEAR_FAULT);
 
-    // disable auto convert mode
-    writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_CONV_MODE_MASK);
+    return true;
+}
 
-    // clear fault
-    writeByte(MAX31856_CONFIG_REG, (readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_CLEAR_FAULT_CYCLE) | MAX31856_CONFIG_CLEAR_FAULT);
+void MAX31865Class::end() {
+    if (!_dev.isAcquired()) {
+        return;
+    }
 
-    // set filter frequency
-    writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_60_50_HZ_FILTER_MASK);
+    // leave the chip idle: no bias current through the RTD
+    _chip->autoConvert = false;
+    writeConfig(_chip->config & MAX31856_CONFIG_BIAS_MASK & MAX31856_CONFIG_CONV_MODE_MASK);
 
-    return true;
+    pinMode(_cs, INPUT);
+    digitalWrite(_cs, LOW);
+    _bus->release(_dev);
 }
 
 bool MAX31865Class::begin(uint8_t probeType) { // Deprecate in future
@@ -35,15 +63,47 @@ bool MAX31865Class::begin(uint8_t probeType) { // Deprecate in future
 void MAX31865Class::setRTDType(uint8_t probeType) {
     // sets 2 or 4 wire
     if (probeType == PROBE_RTD_3W) {
-        writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) | MAX31856_CONFIG_3_WIRE);
+        writeConfig(_chip->config | MAX31856_CONFIG_3_WIRE);
     } else {
-        writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_WIRE_MASK);
+        writeConfig(_chip->config & MAX31856_CONFIG_WIRE_MASK);
     }
-    _current_probe_type = probeType;
+    _chip->probeType = probeType;
 }
 
 uint8_t MAX31865Class::getRTDType() {
-    return _current_probe_type;
+    return _chip->probeType;
+}
+
+void MAX31865Class::setRTDFilter(uint8_t hz) {
+    // the filter must not be changed while converting
+    if (_chip->autoConvert) {
+        return;
+    }
+
+    if (hz == 50) {
+        writeConfig(_chip->config | MAX31856_CONFIG_50_HZ_FILTER);
+    } else {
+        writeConfig(_chip->config & MAX31856_CONFIG_60_50_HZ_FILTER_MASK);
+    }
+}
+
+void MAX31865Class::setRTDAutoConvert(bool enable) {
+    if (enable == _chip->autoConvert) {
+        return;
+    }
+
+    if (enable) {
+        // bias stays on and the chip converts continuously at the filter rate
+        writeConfig(_chip->config | MAX31856_CONFIG_BIAS_ON | MAX31856_CONFIG_CONV_MODE_AUTO);
+        _chip->autoReadyMs = millis() + MAX31865_AUTO_CONVERT_SETTLE_MS;
+    } else {
+        writeConfig(_chip->config & MAX31856_CONFIG_BIAS_MASK & MAX31856_CONFIG_CONV_MODE_MASK);
+    }
+    _chip->autoConvert = enable;
+}
+
+bool MAX31865Class::getRTDAutoConvert() {
+    return _chip->autoConvert;
 }
 
 void MAX31865Class::clearFault(void) {
@@ -51,7 +111,30 @@ void MAX31865Class::clearFault(void) {
 }
 
 void MAX31865Class::clearRTDFault(void) {
-    writeByte(MAX31856_CONFIG_REG, (readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_CLEAR_FAULT_CYCLE) | MAX31856_CONFIG_CLEAR_FAULT);
+    writeByte(MAX31856_CONFIG_REG, _chip->config | MAX31856_CONFIG_CLEAR_FAULT);
+}
+
+uint8_t MAX31865Class::runRTDFaultDetection(void) {
+    // automatic fault detection cycle: bias on, conversion mode off
+    uint8_t config = (_chip->config & MAX31856_CONFIG_CONV_MODE_MASK) | MAX31856_CONFIG_BIAS_ON;
+
+    writeByte(MAX31856_CONFIG_REG, config);
+    delay(10);
+    writeByte(MAX31856_CONFIG_REG, config | MAX31856_CONFIG_FAULT_DECT_AUTO);
+
+    // the fault detection cycle bits return to 0 when the cycle is over
+    for (int i = 0; i < 10 && (readByte(MAX31856_CONFIG_REG) & ~MAX31856_CONFIG_FAULT_DECT_CYCLE_MASK); i++) {
+        delay(1);
+    }
+    uint8_t fault = readRTDFault();
+
+    // restore the configuration and clear the fault
+    writeByte(MAX31856_CONFIG_REG, _chip->config | MAX31856_CONFIG_CLEAR_FAULT);
+    if (_chip->autoConvert) {
+        _chip->autoReadyMs = millis() + MAX31865_AUTO_CONVERT_SETTLE_MS;
+    }
+
+    return fault;
 }
 
 uint8_t MAX31865Class::readFault(void) {
@@ -129,53 +212,37 @@ bool MAX31865Class::getRTDVoltageFault(uint8_t fault) {
 }
 
 float MAX31865Class::convertRTDTemperature(float RTDnominal, float refResistor) {
-    float Z1, Z2, Z3, Z4, Rt, temp;
-
-    Rt = readRTD();
-    Rt /= 32768;
-    Rt *= refResistor;
-
-    Z1 = -RTD_A;
-    Z2 = RTD_A * RTD_A - (4 * RTD_B);
-    Z3 = (4 * RTD_B) / RTDnominal;
-    Z4 = 2 * RTD_B;
-
-    temp = Z2 + (Z3 * Rt);
-    temp = (sqrt(temp) + Z1) / Z4;
-
-    if (temp >= 0)
-        return temp;
-
-    // ugh.
-    Rt /= RTDnominal;
-    Rt *= 100; // normalize to 100 ohm
-
-    float rpoly = Rt;
-
-    temp = -242.02;
-    temp += 2.2228 * rpoly;
-    rpoly *= Rt; // square
-    temp += 2.5859e-3 * rpoly;
-    rpoly *= Rt; // ^3
-    temp -= 4.8260e-6 * rpoly;
-    rpoly *= Rt; // ^4
-    temp -= 2.8183e-8 * rpoly;
-    rpoly *= Rt; // ^5
-    temp += 1.5243e-10 * rpoly;
+    // Callendar-Van Dusen inversion through the code table of this (nominal, reference) pair,
+    // the table belongs to this driver and is rebuilt only when the pair changes
+    if (!_lut.matches(RTDnominal, refResistor) && !_lut.build(RTDnominal, refResistor)) {
+        return NAN;
+    }
 
-    return temp;
+    return _lut.convert(readRTD());
 }
 
 uint32_t MAX31865Class::readRTD() {
+    if (_chip->autoConvert) {
+        // wait for the first conversion after the bias has been enabled,
+        // afterwards the register always holds the latest conversion
+        // (the channel switch delay of TempProbeClass covers more than two conversions)
+        int32_t wait = (int32_t)(_chip->autoReadyMs - millis());
+        if (wait > 0) {
+            delay(wait);
+        }
+
+        return readWord(MAX31856_RTD_MSB_REG) >> 1;
+    }
+
     // clear fault
-    writeByte(MAX31856_CONFIG_REG, (readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_CLEAR_FAULT_CYCLE) | MAX31856_CONFIG_CLEAR_FAULT);
+    writeByte(MAX31856_CONFIG_REG, _chip->config | MAX31856_CONFIG_CLEAR_FAULT);
 
     // enable bias
-    writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) | MAX31856_CONFIG_BIAS_ON);
+    writeConfig(_chip->config | MAX31856_CONFIG_BIAS_ON);
     delay(10);
 
     // one shot config and make readings change with readByte
-    writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) | MAX31856_CONFIG_ONE_SHOT);
+    writeByte(MAX31856_CONFIG_REG, _chip->config | MAX31856_CONFIG_ONE_SHOT);
     delay(65);
 
     //reading word
@@ -183,23 +250,71 @@ uint32_t MAX31865Class::readRTD() {
     read = read >> 1;
 
     // disable bias
-    writeByte(MAX31856_CONFIG_REG, readByte(MAX31856_CONFIG_REG) & MAX31856_CONFIG_BIAS_MASK);
+    writeConfig(_chip->config & MAX31856_CONFIG_BIAS_MASK);
 
     return read;
 }
 
+bool MAX31865Class::setRTDThresholds(float lowTemp, float highTemp, float RTDnominal, float refResistor) {
+    if (lowTemp >= highTemp || RTDnominal <= 0 || refResistor <= 0) {
+        return false;
+    }
+
+    setRTDThresholdCodes(RtdLinearizer::code(lowTemp, RTDnominal, refResistor),
+                         RtdLinearizer::code(highTemp, RTDnominal, refResistor));
+    return true;
+}
+
+void MAX31865Class::setRTDThresholdCodes(uint16_t lowCode, uint16_t highCode) {
+    // 15-bit codes left aligned as in the RTD registers, high and low
+    // thresholds are consecutive: write them in one burst
+    uint16_t high = highCode << 1;
+    uint16_t low = lowCode << 1;
+    uint8_t buffer[4] = { (uint8_t)(high >> 8), (uint8_t)high, (uint8_t)(low >> 8), (uint8_t)low };
+
+    writeBytes(MAX31856_HIGH_FAULT_MSB_REG, buffer, sizeof(buffer));
+}
+
+void MAX31865Class::clearRTDThresholds() {
+    // power-on defaults: the threshold faults never trigger
+    uint8_t buffer[4] = { 0xFF, 0xFF, 0x00, 0x00 };
+
+    writeBytes(MAX31856_HIGH_FAULT_MSB_REG, buffer, sizeof(buffer));
+}
+
+void MAX31865Class::getRTDSpiStats(SpiDeviceStats* stats) {
+    _dev.getStats(stats);
+}
+
+RTDStatus MAX31865Class::readRTDStatus() {
+    // RTD, thresholds and fault status registers are consecutive: read them in one burst
+    uint8_t buffer[MAX31856_FAULT_STATUS_REG - MAX31856_RTD_MSB_REG + 1];
+    RTDStatus status;
+
+    readBytes(MAX31856_RTD_MSB_REG, buffer, sizeof(buffer));
+
+    status.rtd = ((buffer[0] << 8) | buffer[1]) >> 1;
+    status.highThreshold = ((buffer[2] << 8) | buffer[3]) >> 1;
+    status.lowThreshold = ((buffer[4] << 8) | buffer[5]) >> 1;
+    status.fault = buffer[6];
+    status.highThresholdFault = getRTDHighThresholdFault(status.fault);
+    status.lowThresholdFault = getRTDLowThresholdFault(status.fault);
+    status.lowREFINFault = getRTDLowREFINFault(status.fault);
+    status.highREFINFault = getRTDHighREFINFault(status.fault);
+    status.lowRTDINFault = getRTDLowRTDINFault(status.fault);
+    status.voltageFault = getRTDVoltageFault(status.fault);
+
+    return status;
+}
+
 uint8_t MAX31865Class::readByte(uint8_t addr) {
     addr &= 0x7F;
     uint8_t read = 0;
 
-    digitalWrite(_cs, LOW);
-
-    _spi->beginTransaction(_spiSettings);
-    _spi->transfer(addr);
-    _spi->transfer(&read,1);
-    _spi->endTransaction();
-
-    digitalWrite(_cs, HIGH);
+    _bus->beginTransaction(_dev);
+    _bus->transfer(addr);
+    _bus->transfer(&read,1);
+    _bus->endTransaction(_dev);
 
     return read;
 }
@@ -207,30 +322,53 @@ uint8_t MAX31865Class::readByte(uint8_t addr) {
 uint16_t MAX31865Class::readWord(uint8_t addr) {
     uint16_t read = 0x00;
 
-    digitalWrite(_cs, LOW);
-
-    _spi->beginTransaction(_spiSettings);
-    _spi->transfer(addr);
+    _bus->beginTransaction(_dev);
+    _bus->transfer(addr);
     for (int i = 0; i < 2; i++) {
         read = read << 8;
-        read |= _spi->transfer(0);
+        read |= _bus->transfer(0);
     }
-    _spi->endTransaction();
-
-    digitalWrite(_cs, HIGH);
+    _bus->endTransaction(_dev);
 
     return read;
 }
 
+void MAX31865Class::readBytes(uint8_t addr, uint8_t* data, size_t len) {
+    addr &= 0x7F;
+
+    memset(data, 0, len);
+
+    _bus->beginTransaction(_dev);
+    _bus->transfer(addr);
+    _bus->transfer(data, len);
+    _bus->endTransaction(_dev);
+}
+
+void MAX31865Class::writeBytes(uint8_t addr, const uint8_t* data, size_t len) {
+    uint8_t buffer[MAX31856_FAULT_STATUS_REG + 1];
+
+    if (len >= sizeof(buffer)) {
+        return;
+    }
+
+    buffer[0] = addr | 0x80; // make sure top bit is set
+    memcpy(&buffer[1], data, len);
+
+    _bus->beginTransaction(_dev);
+    _bus->transfer(buffer, len + 1);
+    _bus->endTransaction(_dev);
+}
+
+void MAX31865Class::writeConfig(uint8_t config) {
+    _chip->config = config;
+    writeByte(MAX31856_CONFIG_REG, config);
+}
+
 void MAX31865Class::writeByte(uint8_t addr, uint8_t data) {
     addr |= 0x80; // make sure top bit is set
     uint8_t buffer[2] = {addr, data};
 
-    digitalWrite(_cs, LOW);
-
-    _spi->beginTransaction(_spiSettings);
-    _spi->transfer(buffer,2);
-    _spi->endTransaction();
-
-    digitalWrite(_cs, HIGH);
+    _bus->beginTransaction(_dev);
+    _bus->transfer(buffer,2);
+    _bus->endTransaction(_dev);
 }
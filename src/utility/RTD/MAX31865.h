@@ -5,9 +5,13 @@
 #include <mbed.h>
 #include <SPI.h>
 #include "pins_mc.h"
+#include "RtdLinearizer.h"
+#include "../SPIBUS/SpiBusManager.h"
 
 #define MAX31856_CONFIG_REG 0x00
 #define MAX31856_RTD_MSB_REG 0x01
+#define MAX31856_HIGH_FAULT_MSB_REG 0x03
+#define MAX31856_LOW_FAULT_MSB_REG 0x05
 #define MAX31856_FAULT_STATUS_REG 0x07
 
 //config bias mask
@@ -29,6 +33,7 @@
 //config wire fault detection cycle mask
 #define MAX31856_CONFIG_FAULT_DECT_CYCLE_MASK 0xF3
 #define MAX31856_CONFIG_CLEAR_FAULT_CYCLE 0xD3
+#define MAX31856_CONFIG_FAULT_DECT_AUTO 0x04
 
 //config fault status mask
 #define MAX31856_CONFIG_FAULT_STATUS_MASK 0xFD
@@ -36,6 +41,10 @@
 
 // config 50 60 filter frequency mask
 #define MAX31856_CONFIG_60_50_HZ_FILTER_MASK 0xFE
+#define MAX31856_CONFIG_50_HZ_FILTER 0x01
+
+// time for the first conversion after the bias is enabled (bias settling + 50Hz conversion)
+#define MAX31865_AUTO_CONVERT_SETTLE_MS 75
 
 // fault mask
 #define MAX31865_FAULT_HIGH_THRESH 0x80
@@ -54,6 +63,37 @@
 #define TWO_WIRE PROBE_RTD_2W
 #define THREE_WIRE PROBE_RTD_3W
 
+#ifndef MAX31865_CHIPS_MAX
+#define MAX31865_CHIPS_MAX 2 // Number of distinct MAX31865 chip selects that can be driven
+#endif
+
+typedef struct {
+    uint16_t rtd;             // RTD ratio code of the last conversion
+    uint16_t highThreshold;   // High fault threshold code
+    uint16_t lowThreshold;    // Low fault threshold code
+    uint8_t fault;            // Fault status register
+    bool highThresholdFault;
+    bool lowThresholdFault;
+    bool lowREFINFault;
+    bool highREFINFault;
+    bool lowRTDINFault;
+    bool voltageFault;
+} RTDStatus;
+
+/*
+ * State of a MAX31865 chip, shared by all the drivers on its chip select:
+ * the drivers of the temperature probe connector are distinct objects on
+ * the same chip, a per object copy would be stale after another object
+ * has changed the wiring or the conversion mode.
+ */
+typedef struct {
+    PinName cs;
+    uint8_t config;           // Shadow of the config register without the self-clearing bits (one shot, fault cycle, fault clear)
+    uint8_t probeType;        // Wiring configured on the chip
+    bool autoConvert;
+    uint32_t autoReadyMs;     // Time of the first conversion after auto convert has been enabled
+} MAX31865Chip;
+
 class MAX31865Class {
 public:
     MAX31865Class(PinName cs = MC_RTD_CS_PIN, SPIClass& spi = SPI);
@@ -65,15 +105,27 @@ public:
     void setRTDType(uint8_t probeType);
     uint8_t getRTDType();
 
+    void setRTDFilter(uint8_t hz);
+    void setRTDAutoConvert(bool enable);
+    bool getRTDAutoConvert();
+
     float convertRTDTemperature(float RTDnominal, float refResistor);
 
     uint8_t readFault(void); //Deprecate in future
     uint8_t readRTDFault(void);
     void clearFault(void); //Deprecate in future
     void clearRTDFault(void);
+    uint8_t runRTDFaultDetection(void);
 
     uint32_t readRTD();
 
+    bool setRTDThresholds(float lowTemp, float highTemp, float RTDnominal, float refResistor);
+    void setRTDThresholdCodes(uint16_t lowCode, uint16_t highCode);
+    void clearRTDThresholds();
+    RTDStatus readRTDStatus();
+
+    void getRTDSpiStats(SpiDeviceStats* stats);
+
     bool getHighThresholdFault(uint8_t fault); //Deprecate in future
     bool getRTDHighThresholdFault(uint8_t fault);
     bool getLowThresholdFault(uint8_t fault); //Deprecate in future
@@ -90,12 +142,20 @@ public:
 private:
     uint8_t readByte(uint8_t addr);
     uint16_t readWord(uint8_t addr);
+    void readBytes(uint8_t addr, uint8_t* data, size_t len);
+    void writeBytes(uint8_t addr, const uint8_t* data, size_t len);
     void writeByte(uint8_t addr, uint8_t data);
+    void writeConfig(uint8_t config);
+
+    static MAX31865Chip& chipFor(PinName cs);
 
     PinName _cs;
-    SPIClass* _spi;
-    SPISettings _spiSettings;
-    uint8_t _current_probe_type;
+    SpiBusManager* _bus;
+    SpiDevice _dev;
+    MAX31865Chip* _chip;
+
+    // Code to temperature table of the last (nominal, reference) pair converted
+    RtdLinearizer _lut;
 };
 
 #endif
@@ -0,0 +1,107 @@
+#include "RtdLinearizer.h"
+#include <math.h>
+
+RtdLinearizer::RtdLinearizer() : _r0(0), _ref(0), _codeMin(0), _codeMax(0), _shift(0) {
+}
+
+double RtdLinearizer::resistance(double temp, double r0) {
+    double r = 1 + RTD_CVD_A * temp + RTD_CVD_B * temp * temp;
+
+    if (temp < 0) {
+        r += RTD_CVD_C * (temp - 100) * temp * temp * temp;
+    }
+    return r0 * r;
+}
+
+double RtdLinearizer::temperature(double resistance, double r0) {
+    double ratio = resistance / r0;
+
+    if (resistance < RtdLinearizer::resistance(RTD_TEMP_MIN, r0) || resistance > RtdLinearizer::resistance(RTD_TEMP_MAX, r0)) {
+        return NAN;
+    }
+
+    // exact above 0 °C: the C term is zero, solve the quadratic
+    double temp = (-RTD_CVD_A + sqrt(RTD_CVD_A * RTD_CVD_A - 4 * RTD_CVD_B * (1 - ratio))) / (2 * RTD_CVD_B);
+    if (ratio >= 1) {
+        return temp;
+    }
+
+    // below 0 °C refine the quadratic solution with Newton on the full equation
+    for (int i = 0; i < 8; i++) {
+        double t2 = temp * temp;
+        double f = 1 + RTD_CVD_A * temp + RTD_CVD_B * t2 + RTD_CVD_C * (temp - 100) * t2 * temp - ratio;
+        double df = RTD_CVD_A + 2 * RTD_CVD_B * temp + RTD_CVD_C * (4 * t2 * temp - 300 * t2);
+        double step = f / df;
+
+        temp -= step;
+        if (fabs(step) < 1e-9) {
+            break;
+        }
+    }
+    return temp;
+}
+
+uint16_t RtdLinearizer::code(double temp, double r0, double ref) {
+    double code = resistance(temp, r0) / ref * RTD_CODE_FULL_SCALE;
+
+    if (code < 0) {
+        return 0;
+    }
+    if (code > RTD_CODE_FULL_SCALE - 1) {
+        return RTD_CODE_FULL_SCALE - 1;
+    }
+    return (uint16_t)(code + 0.5);
+}
+
+bool RtdLinearizer::build(float r0, float ref) {
+    if (r0 <= 0 || ref <= 0) {
+        return false;
+    }
+
+    double codeMin = ceil(resistance(RTD_TEMP_MIN, r0) / ref * RTD_CODE_FULL_SCALE);
+    double codeMax = floor(resistance(RTD_TEMP_MAX, r0) / ref * RTD_CODE_FULL_SCALE);
+    if (codeMin >= RTD_CODE_FULL_SCALE) {
+        return false;
+    }
+    if (codeMax > RTD_CODE_FULL_SCALE - 1) {
+        codeMax = RTD_CODE_FULL_SCALE - 1;
+    }
+
+    _codeMin = (uint16_t)codeMin;
+    _codeMax = (uint16_t)codeMax;
+    _shift = 0;
+    while (((uint32_t)(_codeMax - _codeMin) >> _shift) >= RTD_LUT_SIZE - 1) {
+        _shift++;
+    }
+
+    for (int i = 0; i < RTD_LUT_SIZE; i++) {
+        // the last entries may lie above 850 °C: extrapolate the CVD equation there
+        double r = (_codeMin + ((uint32_t)i << _shift)) * (double)ref / RTD_CODE_FULL_SCALE;
+        double ratio = r / r0;
+        double temp = (-RTD_CVD_A + sqrt(RTD_CVD_A * RTD_CVD_A - 4 * RTD_CVD_B * (1 - ratio))) / (2 * RTD_CVD_B);
+        if (ratio < 1) {
+            temp = temperature(r, r0);
+        }
+        _table[i] = (float)temp;
+    }
+
+    _r0 = r0;
+    _ref = ref;
+    return true;
+}
+
+bool RtdLinearizer::matches(float r0, float ref) {
+    return _r0 == r0 && _ref == ref;
+}
+
+float RtdLinearizer::convert(uint16_t code) {
+    if (code < _codeMin || code > _codeMax) {
+        return NAN;
+    }
+
+    uint32_t offset = code - _codeMin;
+    uint32_t index = offset >> _shift;
+    float frac = (float)(offset & ((1UL << _shift) - 1)) / (float)(1UL << _shift);
+
+    return _table[index] + (_table[index + 1] - _table[index]) * frac;
+}
@@ -0,0 +1,57 @@
+#ifndef RTD_LINEARIZER_H
+#define RTD_LINEARIZER_H
+
+#include <stdint.h>
+
+// Callendar-Van Dusen coefficients (IEC 60751)
+#define RTD_CVD_A 3.9083e-3
+#define RTD_CVD_B -5.775e-7
+#define RTD_CVD_C -4.183e-12
+
+// IEC 60751 temperature range
+#define RTD_TEMP_MIN -200.0
+#define RTD_TEMP_MAX 850.0
+
+// 15-bit ratio code of the MAX31865: code = 32768 * R / Rref
+#define RTD_CODE_FULL_SCALE 32768
+
+#ifndef RTD_LUT_SIZE
+#define RTD_LUT_SIZE 257 // Table entries, the code step is the smallest power of two covering the range
+#endif
+
+/*
+ * Platinum RTD linearization: exact Callendar-Van Dusen forward and inverse
+ * functions (including the C coefficient below 0 °C) and a per
+ * (nominal, reference) table mapping the MAX31865 ratio code to
+ * temperature, with a power-of-two code step so that a conversion is a
+ * shift, a table read and a linear interpolation.
+ *
+ * Each MAX31865 driver owns its table: there is no shared state to lock,
+ * the table is rebuilt when the (nominal, reference) pair changes.
+ */
+class RtdLinearizer {
+public:
+    RtdLinearizer();
+
+    // Resistance of the RTD at the given temperature
+    static double resistance(double temp, double r0);
+    // Temperature of the RTD at the given resistance, NAN outside the IEC 60751 range
+    static double temperature(double resistance, double r0);
+    // Ratio code of the RTD at the given temperature
+    static uint16_t code(double temp, double r0, double ref);
+
+    bool build(float r0, float ref);
+    bool matches(float r0, float ref);
+    // Temperature of a ratio code, NAN outside the IEC 60751 range
+    float convert(uint16_t code);
+
+private:
+    float _r0;
+    float _ref;
+    uint16_t _codeMin;
+    uint16_t _codeMax;
+    uint8_t _shift;
+    float _table[RTD_LUT_SIZE];
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include "CronSchedule.h"
+#include <stdlib.h>
+#include <ctype.h>
+
+static const uint8_t DAYS_IN_MONTH[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+static bool isLeap(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int daysInMonth(int year, int month) {
+    return (month == 2 && isLeap(year)) ? 29 : DAYS_IN_MONTH[month - 1];
+}
+
+// days since 1970-01-01 of a civil date (proleptic Gregorian calendar)
+static int64_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yoe = year - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civilFromDays(int64_t days, int* year, int* month, int* day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t doe = days - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    *day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *year = (int)(yoe + era * 400 + (*month <= 2));
+}
+
+// 0 is Sunday
+static int weekday(int64_t days) {
+    return (int)((days % 7 + 11) % 7);
+}
+
+// lowest set bit at or above from, -1 if none
+static int nextBit(uint64_t mask, int from) {
+    if (from > 63) {
+        return -1;
+    }
+    mask &= ~0ULL << from;
+    return (mask == 0) ? -1 : __builtin_ctzll(mask);
+}
+
+// parse one field into a bit mask, false on syntax or range error
+static bool parseField(const char** spec, int min, int max, uint64_t* mask) {
+    const char* p = *spec;
+    *mask = 0;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+
+    for (;;) {
+        long from, to, step = 1;
+        char* end;
+
+        if (*p == '*') {
+            from = min;
+            to = max;
+            p++;
+        } else {
+            if (!isdigit((unsigned char)*p)) {
+                return false;
+            }
+            from = strtol(p, &end, 10);
+            p = end;
+            to = from;
+            if (*p == '-') {
+                p++;
+                if (!isdigit((unsigned char)*p)) {
+                    return false;
+                }
+                to = strtol(p, &end, 10);
+                p = end;
+            }
+        }
+        if (*p == '/') {
+            p++;
+            if (!isdigit((unsigned char)*p)) {
+                return false;
+            }
+            step = strtol(p, &end, 10);
+            p = end;
+        }
+        if (from < min || to > max || from > to || step <= 0) {
+            return false;
+        }
+        for (long v = from; v <= to; v += step) {
+            *mask |= 1ULL << v;
+        }
+
+        if (*p != ',') {
+            break;
+        }
+        p++;
+    }
+
+    if (*p != '\0' && *p != ' ' && *p != '\t') {
+        return false;
+    }
+    *spec = p;
+    return true;
+}
+
+CronRule::CronRule() : _minutes(0), _hours(0), _days(0), _months(0), _weekdays(0), _any_day(true), _any_weekday(true) {
+}
+
+bool CronRule::parse(const char* spec) {
+    uint64_t minutes, hours, days, months, weekdays;
+    const char* p = spec;
+
+    if (spec == nullptr ||
+        !parseField(&p, 0, 59, &minutes) ||
+        !parseField(&p, 0, 23, &hours) ||
+        !parseField(&p, 1, 31, &days) ||
+        !parseField(&p, 1, 12, &months) ||
+        !parseField(&p, 0, 7, &weekdays)) {
+        return false;
+    }
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    if (*p != '\0') {
+        return false;
+    }
+
+    // 7 is an alias of Sunday
+    if (weekdays & (1 << 7)) {
+        weekdays = (weekdays | 1) & 0x7F;
+    }
+
+    _minutes = minutes;
+    _hours = (uint32_t)hours;
+    _days = (uint32_t)days;
+    _months = (uint16_t)months;
+    _weekdays = (uint8_t)weekdays;
+    _any_day = (_days == 0xFFFFFFFE);
+    _any_weekday = (_weekdays == 0x7F);
+    return true;
+}
+
+bool CronRule::dayMatches(int year, int month, int day) const {
+    bool day_ok = (_days >> day) & 1;
+    bool weekday_ok = (_weekdays >> weekday(daysFromCivil(year, month, day))) & 1;
+
+    if (!_any_day && !_any_weekday) {
+        return day_ok || weekday_ok;
+    }
+    return day_ok && weekday_ok;
+}
+
+bool CronRule::matches(time_t time) const {
+    int64_t days = (int64_t)time / 86400;
+    int32_t seconds = (int32_t)((int64_t)time - days * 86400);
+    int year, month, day;
+
+    civilFromDays(days, &year, &month, &day);
+    return ((_months >> month) & 1) && dayMatches(year, month, day) &&
+           ((_hours >> (seconds / 3600)) & 1) && ((_minutes >> ((seconds / 60) % 60)) & 1);
+}
+
+time_t CronRule::next(time_t time) const {
+    if (_minutes == 0 || _hours == 0 || _months == 0 || (_days == 0 && _weekdays == 0)) {
+        return CRON_NEVER;
+    }
+
+    int64_t start = ((int64_t)time / 60 + 1) * 60;
+    int64_t days = start / 86400;
+    int32_t seconds = (int32_t)(start - days * 86400);
+    int year, month, day;
+    int hour = seconds / 3600;
+    int minute = (seconds / 60) % 60;
+
+    civilFromDays(days, &year, &month, &day);
+    int last_year = year + CRON_SEARCH_YEARS;
+
+    while (year <= last_year) {
+        if (!((_months >> month) & 1)) {
+            int m = nextBit(_months, month + 1);
+            if (m < 0) {
+                year++;
+                m = nextBit(_months, 1);
+            }
+            month = m;
+            day = 1;
+            hour = 0;
+            minute = 0;
+            continue;
+        }
+
+        if (day > daysInMonth(year, month) || !dayMatches(year, month, day)) {
+            if (++day > daysInMonth(year, month)) {
+                day = 1;
+                if (++month > 12) {
+                    month = 1;
+                    year++;
+                }
+            }
+            hour = 0;
+            minute = 0;
+            continue;
+        }
+
+        int h = nextBit(_hours, hour);
+        if (h < 0) {
+            day++;
+            hour = 0;
+            minute = 0;
+            continue;
+        }
+        if (h != hour) {
+            hour = h;
+            minute = 0;
+        }
+
+        int m = nextBit(_minutes, minute);
+        if (m < 0) {
+            hour++;
+            minute = 0;
+            if (hour > 23) {
+                day++;
+                hour = 0;
+            }
+            continue;
+        }
+
+        return (time_t)(daysFromCivil(year, month, day) * 86400 + hour * 3600 + m * 60);
+    }
+
+    return CRON_NEVER;
+}
+
+CronSchedule::CronSchedule() : _count(0) {
+    for (int i = 0; i < MC_SCHED_RULES; i++) {
+        _pos[i] = -1;
+        _next[i] = CRON_NEVER;
+    }
+}
+
+int CronSchedule::add(const CronRule& rule, time_t now) {
+    for (int id = 0; id < MC_SCHED_RULES; id++) {
+        if (_pos[id] < 0) {
+            _rule[id] = rule;
+            _next[id] = rule.next(now);
+            _heap[_count] = id;
+            _pos[id] = _count;
+            siftUp(_count++);
+            return id;
+        }
+    }
+    return -1;
+}
+
+bool CronSchedule::remove(int id) {
+    if (id < 0 || id >= MC_SCHED_RULES || _pos[id] < 0) {
+        return false;
+    }
+
+    int pos = _pos[id];
+    _count--;
+    if (pos != _count) {
+        swap(pos, _count);
+        update(pos);
+    }
+    _pos[id] = -1;
+    return true;
+}
+
+void CronSchedule::clear() {
+    for (int i = 0; i < MC_SCHED_RULES; i++) {
+        _pos[i] = -1;
+    }
+    _count = 0;
+}
+
+int CronSchedule::count() const {
+    return _count;
+}
+
+time_t CronSchedule::nextTime() const {
+    return (_count == 0) ? CRON_NEVER : _next[_heap[0]];
+}
+
+int CronSchedule::popDue(time_t now) {
+    if (_count == 0) {
+        return -1;
+    }
+
+    int id = _heap[0];
+    if (_next[id] == CRON_NEVER || _next[id] > now) {
+        return -1;
+    }
+
+    // occurrences missed while the caller was late are run once
+    _next[id] = _rule[id].next(now);
+    siftDown(0);
+    return id;
+}
+
+void CronSchedule::reschedule(time_t now) {
+    for (int i = 0; i < _count; i++) {
+        int id = _heap[i];
+        _next[id] = _rule[id].next(now);
+    }
+    // rebuild the heap bottom-up
+    for (int i = _count / 2 - 1; i >= 0; i--) {
+        siftDown(i);
+    }
+}
+
+bool CronSchedule::before(int a, int b) const {
+    time_t ta = _next[_heap[a]];
+    time_t tb = _next[_heap[b]];
+
+    if (ta == CRON_NEVER) {
+        return false;
+    }
+    return tb == CRON_NEVER || ta < tb;
+}
+
+void CronSchedule::swap(int a, int b) {
+    int8_t id = _heap[a];
+    _heap[a] = _heap[b];
+    _heap[b] = id;
+    _pos[_heap[a]] = a;
+    _pos[_heap[b]] = b;
+}
+
+void CronSchedule::siftUp(int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!before(pos, parent)) {
+            break;
+        }
+        swap(pos, parent);
+        pos = parent;
+    }
+}
+
+void CronSchedule::siftDown(int pos) {
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= _count) {
+            break;
+        }
+        if (child + 1 < _count && before(child + 1, child)) {
+            child++;
+        }
+        if (!before(child, pos)) {
+            break;
+        }
+        swap(pos, child);
+        pos = child;
+    }
+}
+
+void CronSchedule::update(int pos) {
+    int id = _heap[pos];
+    siftUp(pos);
+    siftDown(_pos[id]);
+}
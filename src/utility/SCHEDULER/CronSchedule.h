@@ -0,0 +1,78 @@
+#ifndef _CRON_SCHEDULE_H_
+#define _CRON_SCHEDULE_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#ifndef MC_SCHED_RULES
+#define MC_SCHED_RULES 16
+#endif
+
+#define CRON_NEVER ((time_t)-1)
+#define CRON_SEARCH_YEARS 8 // Longest search for the next occurrence (Feb 29 on a given weekday repeats within 28 years)
+
+/*
+ * Calendar rule with the fields of a cron line: "minute hour day month weekday".
+ * Each field is "*", a value, a range "a-b", a step "*\/n" or "a-b/n", or a
+ * comma separated list of those. Weekdays are 0-6 (0 or 7 is Sunday). As in
+ * cron, a rule restricting both the day and the weekday matches either.
+ *
+ * Times are broken down as UTC: rules apply to the time held by the RTC.
+ */
+class CronRule {
+public:
+    CronRule();
+
+    bool parse(const char* spec);
+    bool matches(time_t time) const;
+    // first matching minute strictly after time, CRON_NEVER if there is none
+    time_t next(time_t time) const;
+
+private:
+    uint64_t _minutes;  // bits 0-59
+    uint32_t _hours;    // bits 0-23
+    uint32_t _days;     // bits 1-31
+    uint16_t _months;   // bits 1-12
+    uint8_t _weekdays;  // bits 0-6
+    bool _any_day;
+    bool _any_weekday;
+
+    bool dayMatches(int year, int month, int day) const;
+};
+
+/*
+ * Up to MC_SCHED_RULES rules kept in a binary min-heap ordered by their next
+ * occurrence: the nearest occurrence is read in O(1), adding, removing or
+ * rescheduling a rule is O(log n).
+ *
+ * It has no hardware dependency: the current time is given by the caller.
+ */
+class CronSchedule {
+public:
+    CronSchedule();
+
+    int add(const CronRule& rule, time_t now);
+    bool remove(int id);
+    void clear();
+    int count() const;
+
+    time_t nextTime() const;
+    // pop the rule of the nearest occurrence if it is due and schedule it again after now, -1 if none is due
+    int popDue(time_t now);
+    void reschedule(time_t now);
+
+private:
+    CronRule _rule[MC_SCHED_RULES];
+    time_t _next[MC_SCHED_RULES];
+    int8_t _heap[MC_SCHED_RULES];   // rule ids, ordered by _next
+    int8_t _pos[MC_SCHED_RULES];    // position of each rule in _heap, -1 if unused
+    int _count;
+
+    bool before(int a, int b) const;
+    void swap(int a, int b);
+    void siftUp(int pos);
+    void siftDown(int pos);
+    void update(int pos);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _SERIAL_BACKEND_H_
+#define _SERIAL_BACKEND_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// receive errors, as reported by the UART
+#define SERIAL_ERROR_OVERRUN    0x01    // Byte lost, the receiver was not read in time
+#define SERIAL_ERROR_FRAMING    0x02    // Missing stop bit
+#define SERIAL_ERROR_NOISE      0x04    // Noise detected on a bit
+#define SERIAL_ERROR_PARITY     0x08    // Parity mismatch
+
+/*
+ * Events of a serial backend, called from interrupt context.
+ */
+class SerialBackendListener {
+public:
+    virtual ~SerialBackendListener() {}
+
+    // the receiver wrote up to head in the ring, idle if the line went idle at now_us
+    virtual void onRxProgress(size_t head, uint64_t now_us, bool idle) = 0;
+    // the receiver detected SERIAL_ERROR_x on the byte being received
+    virtual void onRxError(uint8_t errors) = 0;
+    // the last byte of the transmission left the shift register
+    virtual void onTxComplete() = 0;
+};
+
+/*
+ * Receiver writing continuously into a circular buffer and transmitter
+ * sending from the caller buffer: the STM32 UART with DMA on the board,
+ * a simulation on the host.
+ */
+class SerialBackend {
+public:
+    virtual ~SerialBackend() {}
+
+    // start receiving into ring (size multiple of 32 bytes, 32-byte aligned)
+    virtual bool start(uint8_t* ring, size_t size, SerialBackendListener* listener) = 0;
+    virtual void stop() = 0;
+    // send data without copy, the buffer must stay valid until onTxComplete()
+    virtual bool transmit(const uint8_t* data, size_t len) = 0;
+    // duration of one character on the line in ns
+    virtual uint32_t charTimeNs() = 0;
+};
+
+#endif
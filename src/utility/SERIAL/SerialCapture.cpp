@@ -0,0 +1,303 @@
+#include "SerialCapture.h"
+#include <string.h>
+
+#define RECORD_MAX_DELTA    0xFFFFFFFFULL
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    putU16(out, value & 0xFFFF);
+    putU16(out + 2, value >> 16);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+SerialCapture::SerialCapture(uint8_t* log, size_t size) : _backend(nullptr), _ring(nullptr), _ring_tail(0), _log(log), _size(size), _char_ns(0), _gap_us(0), _base_us(0),
+                                                         _head(0), _commit(0), _open(false), _open_pos(0), _open_len(0), _open_flags(0), _next_flags(0), _rx_flags(0), _last_start_us(0), _last_end_us(0),
+                                                         _tail(0), _read_us(0) {
+    // the ring must not share a cache line with other data since the DMA writes it
+    _ring = (uint8_t*)(((uintptr_t)_ring_mem + 31) & ~(uintptr_t)31);
+    resetStats();
+}
+
+bool SerialCapture::begin(SerialBackend* backend, uint32_t gap_us, uint64_t now_us) {
+    // the positions run freely and wrap with the log: its size must be a power of two
+    if (backend == nullptr || _log == nullptr || _size < 2 * MC_CAPTURE_RECORD_SIZE || (_size & (_size - 1)) != 0) {
+        return false;
+    }
+
+    _backend = backend;
+    _char_ns = backend->charTimeNs();
+    _gap_us = gap_us;
+    _base_us = now_us;
+    _ring_tail = 0;
+    _head = 0;
+    _commit = 0;
+    _tail = 0;
+    _open = false;
+    _next_flags = 0;
+    _rx_flags = 0;
+    _last_start_us = now_us;
+    _last_end_us = now_us;
+    _read_us = now_us;
+
+    return backend->start(_ring, MC_SERIAL_RING_SIZE, this);
+}
+
+void SerialCapture::end() {
+    if (_backend != nullptr) {
+        _backend->stop();
+        _backend = nullptr;
+    }
+    if (_open) {
+        close();
+    }
+}
+
+void SerialCapture::flush(uint64_t now_us) {
+    if (_open && now_us - _last_end_us >= _gap_us) {
+        close();
+    }
+}
+
+size_t SerialCapture::header(uint8_t* out) {
+    memcpy(out, SERIAL_CAPTURE_MAGIC, 4);
+    out[4] = SERIAL_CAPTURE_VERSION;
+    putU32(&out[5], _char_ns);
+    putU32(&out[9], _gap_us);
+    putU32(&out[13], (uint32_t)_base_us);
+    putU32(&out[17], (uint32_t)(_base_us >> 32));
+    return SERIAL_CAPTURE_HEADER;
+}
+
+size_t SerialCapture::available() {
+    return _commit - _tail;
+}
+
+size_t SerialCapture::read(uint8_t* out, size_t len) {
+    size_t tail = _tail;
+    size_t count = _commit - tail;
+
+    if (count > len) {
+        count = len;
+    }
+    get(tail, out, count);
+    _tail = tail + count;
+
+    return count;
+}
+
+bool SerialCapture::readRecord(SerialCaptureRecord* record) {
+    uint8_t header[SERIAL_CAPTURE_RECORD];
+
+    while (_commit - _tail >= SERIAL_CAPTURE_RECORD) {
+        size_t tail = _tail;
+        get(tail, header, SERIAL_CAPTURE_RECORD);
+
+        uint16_t length = header[1] | ((uint16_t)header[2] << 8);
+        _read_us += getU32(&header[3]);
+
+        if (length == 0) {
+            // time filler of a gap longer than 71 minutes
+            _tail = tail + SERIAL_CAPTURE_RECORD;
+            continue;
+        }
+
+        record->start_us = _read_us;
+        record->flags = header[0];
+        record->length = length;
+        get(tail + SERIAL_CAPTURE_RECORD, record->data, length);
+        _tail = tail + SERIAL_CAPTURE_RECORD + length;
+        return true;
+    }
+
+    return false;
+}
+
+uint32_t SerialCapture::getGapUs() {
+    return _gap_us;
+}
+
+uint64_t SerialCapture::getBaseUs() {
+    return _base_us;
+}
+
+SerialCaptureStats SerialCapture::getStats() {
+    return _stats;
+}
+
+void SerialCapture::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void SerialCapture::onRxProgress(size_t head, uint64_t now_us, bool idle) {
+    // the idle line is detected one character after the last stop bit
+    uint64_t end_us = now_us - (idle ? _char_ns / 1000 : 0);
+
+    if (_ring_tail == head) {
+        return;
+    }
+
+    if (head < _ring_tail) {
+        // the ring wrapped: the end of the ring was received before its start
+        size_t first = MC_SERIAL_RING_SIZE - _ring_tail;
+        append(&_ring[_ring_tail], first, end_us - (uint64_t)head * _char_ns / 1000);
+        _ring_tail = 0;
+    }
+
+    append(&_ring[_ring_tail], head - _ring_tail, end_us);
+    _ring_tail = head;
+}
+
+void SerialCapture::onRxError(uint8_t errors) {
+    uint8_t flags = 0;
+
+    if (errors & SERIAL_ERROR_OVERRUN) {
+        flags |= SERIAL_RECORD_OVERRUN;
+        _stats.overruns++;
+    }
+    if (errors & (SERIAL_ERROR_FRAMING | SERIAL_ERROR_NOISE | SERIAL_ERROR_PARITY)) {
+        flags |= SERIAL_RECORD_ERROR;
+        _stats.errors++;
+    }
+
+    // the byte is reported by the next progress event, after the gap that may close the open record
+    _rx_flags |= flags;
+}
+
+void SerialCapture::onTxComplete() {
+}
+
+void SerialCapture::append(const uint8_t* data, size_t len, uint64_t end_us) {
+    uint64_t start_us = end_us - (uint64_t)len * _char_ns / 1000;
+
+    if (len == 0) {
+        return;
+    }
+
+    // the estimate can fall before the previous byte because of the interrupt latency
+    if (start_us < _last_end_us) {
+        start_us = _last_end_us;
+    }
+    if (start_us - _last_end_us >= _gap_us) {
+        if (_open) {
+            close();
+        }
+        _next_flags &= ~SERIAL_RECORD_CONTINUED;
+    }
+    if (_open) {
+        _open_flags |= _rx_flags;
+    } else {
+        _next_flags |= _rx_flags;
+    }
+    _rx_flags = 0;
+
+    while (len > 0) {
+        if (!_open && !open(start_us, _next_flags)) {
+            break;
+        }
+
+        size_t count = MC_CAPTURE_RECORD_SIZE - _open_len;
+        size_t room = _size - used();
+        if (count > len) {
+            count = len;
+        }
+        if (count > room) {
+            count = room;
+        }
+
+        put(_head, data, count);
+        _head += count;
+        _open_len += count;
+        _stats.bytes += count;
+        data += count;
+        len -= count;
+        start_us += (uint64_t)count * _char_ns / 1000;
+
+        if (_open_len == MC_CAPTURE_RECORD_SIZE) {
+            close();
+            _next_flags |= SERIAL_RECORD_CONTINUED;
+        } else if (len > 0) {
+            // log full: keep what was recorded
+            close();
+            break;
+        }
+    }
+
+    if (len > 0) {
+        _stats.lost += len;
+        _next_flags |= SERIAL_RECORD_LOST;
+    }
+    _last_end_us = end_us;
+}
+
+bool SerialCapture::open(uint64_t start_us, uint8_t flags) {
+    uint8_t header[SERIAL_CAPTURE_RECORD];
+    uint64_t delta = start_us - _last_start_us;
+
+    // room for the header, its time fillers and at least one byte
+    if (_size - used() < (delta / RECORD_MAX_DELTA + 1) * SERIAL_CAPTURE_RECORD + 1) {
+        return false;
+    }
+
+    memset(header, 0, sizeof(header));
+    while (delta > RECORD_MAX_DELTA) {
+        putU32(&header[3], (uint32_t)RECORD_MAX_DELTA);
+        put(_head, header, SERIAL_CAPTURE_RECORD);
+        _head += SERIAL_CAPTURE_RECORD;
+        delta -= RECORD_MAX_DELTA;
+    }
+
+    // flags and length are written when the record is closed
+    putU32(&header[3], (uint32_t)delta);
+    put(_head, header, SERIAL_CAPTURE_RECORD);
+    _open_pos = _head;
+    _head += SERIAL_CAPTURE_RECORD;
+
+    _last_start_us = start_us;
+    _open_len = 0;
+    _open_flags = flags;
+    _next_flags = 0;
+    _open = true;
+    return true;
+}
+
+void SerialCapture::close() {
+    uint8_t header[3];
+
+    header[0] = _open_flags;
+    putU16(&header[1], _open_len);
+    put(_open_pos, header, sizeof(header));
+
+    _open = false;
+    _stats.records++;
+    if (used() > _stats.max_used) {
+        _stats.max_used = used();
+    }
+    _commit = _head;
+}
+
+size_t SerialCapture::used() {
+    return _head - _tail;
+}
+
+void SerialCapture::put(size_t pos, const uint8_t* data, size_t len) {
+    size_t offset = pos & (_size - 1);
+    size_t first = (len < _size - offset) ? len : _size - offset;
+
+    memcpy(&_log[offset], data, first);
+    memcpy(_log, data + first, len - first);
+}
+
+void SerialCapture::get(size_t pos, uint8_t* data, size_t len) {
+    size_t offset = pos & (_size - 1);
+    size_t first = (len < _size - offset) ? len : _size - offset;
+
+    memcpy(data, &_log[offset], first);
+    memcpy(data + first, _log, len - first);
+}
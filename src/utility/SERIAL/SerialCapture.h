@@ -0,0 +1,123 @@
+#ifndef _SERIAL_CAPTURE_H_
+#define _SERIAL_CAPTURE_H_
+
+#include "SerialBackend.h"
+#include "SerialFramer.h"
+
+#ifndef MC_CAPTURE_LOG_SIZE
+#define MC_CAPTURE_LOG_SIZE     32768       // Capture log, about 0.3 s of a saturated 1 Mbaud line
+#endif
+#ifndef MC_CAPTURE_RECORD_SIZE
+#define MC_CAPTURE_RECORD_SIZE  512         // Longest record, longer ones are continued in the next one
+#endif
+
+#define SERIAL_CAPTURE_MAGIC        "MCAP"
+#define SERIAL_CAPTURE_VERSION      1
+#define SERIAL_CAPTURE_HEADER       21      // magic, version, char_ns, gap_us, base_us
+#define SERIAL_CAPTURE_RECORD       7       // flags, length, delta_us
+
+#define SERIAL_RECORD_CONTINUED     0x01    // Continues the previous record without a gap
+#define SERIAL_RECORD_LOST          0x02    // Bytes were dropped before this record (log full)
+#define SERIAL_RECORD_OVERRUN       0x04    // Bytes were lost by the UART inside the record
+#define SERIAL_RECORD_ERROR         0x08    // Framing, noise or parity error inside the record
+
+typedef struct {
+    uint64_t start_us;      // Start bit of the first byte
+    uint16_t length;
+    uint8_t flags;          // SERIAL_RECORD_x
+    uint8_t data[MC_CAPTURE_RECORD_SIZE];
+} SerialCaptureRecord;
+
+typedef struct {
+    uint32_t bytes;         // Bytes recorded
+    uint32_t records;       // Records closed
+    uint32_t lost;          // Bytes dropped because the log was full
+    uint32_t errors;        // Framing, noise and parity errors
+    uint32_t overruns;      // Overrun errors
+    uint32_t max_used;      // Highest fill of the log in bytes
+} SerialCaptureStats;
+
+/*
+ * Passive recorder of the bytes received by a serial backend. The bytes
+ * are grouped in records separated by line gaps of at least gap_us and
+ * appended to a log, each record as a 7-byte header (flags, length and
+ * start time as a delta from the previous record, little-endian) followed
+ * by its bytes. The time of each byte is the start of its record plus its
+ * position times the character time.
+ *
+ * The log is a FIFO: the backend events append from interrupt context,
+ * read() or readRecord() drain closed records from a single thread. A
+ * record is closed by the next byte after a gap, by its length, or by
+ * flush() once the line has been idle long enough; flush() must run with
+ * the backend interrupts masked. When the log is full the new bytes are
+ * dropped and the next record is flagged SERIAL_RECORD_LOST.
+ *
+ * The binary stream is header() followed by the bytes of read(); use
+ * either read() or readRecord() during a capture, not both.
+ *
+ * It has no hardware dependency: the backend owns the UART, the DMA and the
+ * time source.
+ */
+class SerialCapture : public SerialBackendListener {
+public:
+    SerialCapture(uint8_t* log, size_t size);
+
+    bool begin(SerialBackend* backend, uint32_t gap_us, uint64_t now_us);
+    void end();
+
+    // close the open record if the line has been idle for the gap since its last byte
+    void flush(uint64_t now_us);
+
+    // header of the binary stream, SERIAL_CAPTURE_HEADER bytes
+    size_t header(uint8_t* out);
+    // bytes of closed records waiting in the log
+    size_t available();
+    // copy closed records to out as a byte stream, return the count copied
+    size_t read(uint8_t* out, size_t len);
+    // get the oldest closed record with its absolute start time
+    bool readRecord(SerialCaptureRecord* record);
+
+    uint32_t getGapUs();
+    uint64_t getBaseUs();
+    SerialCaptureStats getStats();
+    void resetStats();
+
+    void onRxProgress(size_t head, uint64_t now_us, bool idle) override;
+    void onRxError(uint8_t errors) override;
+    void onTxComplete() override;
+
+private:
+    SerialBackend* _backend;
+    uint8_t _ring_mem[MC_SERIAL_RING_SIZE + 31];
+    uint8_t* _ring;
+    size_t _ring_tail;
+    uint8_t* _log;
+    size_t _size;
+    uint32_t _char_ns;
+    uint32_t _gap_us;
+    uint64_t _base_us;
+    // producer
+    size_t _head;
+    volatile size_t _commit;
+    bool _open;
+    size_t _open_pos;
+    uint16_t _open_len;
+    uint8_t _open_flags;
+    uint8_t _next_flags;
+    uint8_t _rx_flags;
+    uint64_t _last_start_us;
+    uint64_t _last_end_us;
+    // consumer
+    volatile size_t _tail;
+    uint64_t _read_us;
+    SerialCaptureStats _stats;
+
+    void append(const uint8_t* data, size_t len, uint64_t end_us);
+    bool open(uint64_t start_us, uint8_t flags);
+    void close();
+    size_t used();
+    void put(size_t pos, const uint8_t* data, size_t len);
+    void get(size_t pos, uint8_t* data, size_t len);
+};
+
+#endif
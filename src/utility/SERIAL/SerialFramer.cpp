@@ -0,0 +1,169 @@
+#include "SerialFramer.h"
+#include <string.h>
+
+SerialFramer::SerialFramer() : _backend(nullptr), _ring(nullptr), _tail(0), _char_ns(0), _wr(0), _rd(0), _frame_cb(nullptr), _frame_ctx(nullptr), _tx_cb(nullptr), _tx_ctx(nullptr), _writing(false), _rx_flags(0) {
+    // the ring must not share a cache line with other data since the DMA writes it
+    _ring = (uint8_t*)(((uintptr_t)_ring_mem + 31) & ~(uintptr_t)31);
+    resetStats();
+}
+
+bool SerialFramer::begin(SerialBackend* backend) {
+    if (backend == nullptr) {
+        return false;
+    }
+
+    _backend = backend;
+    _tail = 0;
+    _wr = 0;
+    _rd = 0;
+    _frames[0].length = 0;
+    _frames[0].flags = 0;
+    _writing = false;
+    _rx_flags = 0;
+    _char_ns = backend->charTimeNs();
+
+    return backend->start(_ring, MC_SERIAL_RING_SIZE, this);
+}
+
+void SerialFramer::end() {
+    if (_backend != nullptr) {
+        _backend->stop();
+        _backend = nullptr;
+    }
+    _writing = false;
+}
+
+void SerialFramer::setFrameCallback(void (*callback)(void* context), void* context) {
+    _frame_cb = callback;
+    _frame_ctx = context;
+}
+
+bool SerialFramer::pop(SerialFrame* frame) {
+    uint8_t rd = _rd;
+
+    // the slot at _wr is the frame being received
+    if (rd == _wr) {
+        return false;
+    }
+
+    const SerialFrame* slot = &_frames[rd];
+    frame->start_us = slot->start_us;
+    frame->end_us = slot->end_us;
+    frame->length = slot->length;
+    frame->flags = slot->flags;
+    memcpy(frame->data, slot->data, slot->length);
+
+    _rd = (rd + 1) % MC_SERIAL_FRAMES;
+    return true;
+}
+
+int SerialFramer::available() {
+    return (_wr + MC_SERIAL_FRAMES - _rd) % MC_SERIAL_FRAMES;
+}
+
+bool SerialFramer::write(const uint8_t* data, size_t len, void (*callback)(void* context), void* context) {
+    if (_backend == nullptr || data == nullptr || len == 0 || _writing) {
+        return false;
+    }
+
+    _tx_cb = callback;
+    _tx_ctx = context;
+    _writing = true;
+    if (!_backend->transmit(data, len)) {
+        _writing = false;
+        return false;
+    }
+    return true;
+}
+
+bool SerialFramer::isWriting() {
+    return _writing;
+}
+
+SerialFramerStats SerialFramer::getStats() {
+    return _stats;
+}
+
+void SerialFramer::resetStats() {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void SerialFramer::onRxProgress(size_t head, uint64_t now_us, bool idle) {
+    while (_tail != head) {
+        SerialFrame* frame = &_frames[_wr];
+
+        // copy up to the head or to the end of the ring, whichever comes first
+        size_t count = (head > _tail) ? head - _tail : MC_SERIAL_RING_SIZE - _tail;
+        size_t room = MC_SERIAL_FRAME_SIZE - frame->length;
+        if (count > room) {
+            count = room;
+        }
+
+        memcpy(&frame->data[frame->length], &_ring[_tail], count);
+        frame->length += count;
+        frame->flags |= _rx_flags;
+        _rx_flags = 0;
+        _stats.bytes += count;
+        _tail = (_tail + count) % MC_SERIAL_RING_SIZE;
+
+        if (frame->length == MC_SERIAL_FRAME_SIZE) {
+            // the remaining bytes were received after the last one copied
+            size_t pending = (head + MC_SERIAL_RING_SIZE - _tail) % MC_SERIAL_RING_SIZE;
+            frame->flags |= SERIAL_FRAME_TRUNCATED;
+            _stats.truncated++;
+            commit(now_us - (uint64_t)(pending + (idle ? 1 : 0)) * _char_ns / 1000);
+        }
+    }
+
+    if (idle && _frames[_wr].length > 0) {
+        // the idle line is detected one character after the last stop bit
+        commit(now_us - _char_ns / 1000);
+    }
+}
+
+void SerialFramer::onRxError(uint8_t errors) {
+    // the byte is reported by the next progress event, after the idle line that may close the open frame
+    if (errors & SERIAL_ERROR_OVERRUN) {
+        _rx_flags |= SERIAL_FRAME_OVERRUN;
+        _stats.overruns++;
+    }
+    if (errors & (SERIAL_ERROR_FRAMING | SERIAL_ERROR_NOISE | SERIAL_ERROR_PARITY)) {
+        _rx_flags |= SERIAL_FRAME_ERROR;
+        _stats.errors++;
+    }
+}
+
+void SerialFramer::onTxComplete() {
+    void (*callback)(void* context) = _tx_cb;
+
+    _stats.tx_frames++;
+    _writing = false;
+    if (callback != nullptr) {
+        callback(_tx_ctx);
+    }
+}
+
+void SerialFramer::commit(uint64_t end_us) {
+    SerialFrame* frame = &_frames[_wr];
+    uint8_t next = (_wr + 1) % MC_SERIAL_FRAMES;
+
+    frame->end_us = end_us;
+    frame->start_us = end_us - (uint64_t)frame->length * _char_ns / 1000;
+
+    if (next == _rd) {
+        // queue full: the slot is reused for the next frame
+        _stats.dropped++;
+        frame->length = 0;
+        frame->flags = 0;
+        return;
+    }
+
+    _stats.frames++;
+    _wr = next;
+    _frames[next].length = 0;
+    _frames[next].flags = 0;
+
+    if (_frame_cb != nullptr) {
+        _frame_cb(_frame_ctx);
+    }
+}
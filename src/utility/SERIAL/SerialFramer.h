@@ -0,0 +1,97 @@
+#ifndef _SERIAL_FRAMER_H_
+#define _SERIAL_FRAMER_H_
+
+#include "SerialBackend.h"
+
+#ifndef MC_SERIAL_RING_SIZE
+#define MC_SERIAL_RING_SIZE     2048        // Receive ring, multiple of 32 bytes
+#endif
+#ifndef MC_SERIAL_FRAME_SIZE
+#define MC_SERIAL_FRAME_SIZE    256         // Longest frame, longer ones are split
+#endif
+#ifndef MC_SERIAL_FRAMES
+#define MC_SERIAL_FRAMES        8           // Frame queue, one slot is the frame being received
+#endif
+
+#define SERIAL_FRAME_TRUNCATED  0x01        // The frame continues in the next one
+#define SERIAL_FRAME_OVERRUN    0x02        // Bytes were lost inside the frame
+#define SERIAL_FRAME_ERROR      0x04        // Framing, noise or parity error inside the frame
+
+typedef struct {
+    uint64_t start_us;      // Start bit of the first byte (estimated from the character time)
+    uint64_t end_us;        // Stop bit of the last byte (estimated from the idle-line detection)
+    uint16_t length;
+    uint8_t flags;          // SERIAL_FRAME_x
+    uint8_t data[MC_SERIAL_FRAME_SIZE];
+} SerialFrame;
+
+typedef struct {
+    uint32_t frames;        // Frames queued
+    uint32_t bytes;         // Bytes received
+    uint32_t truncated;     // Frames split at MC_SERIAL_FRAME_SIZE
+    uint32_t dropped;       // Frames lost because the queue was full
+    uint32_t errors;        // Framing, noise and parity errors
+    uint32_t overruns;      // Overrun errors
+    uint32_t tx_frames;     // Transmissions completed
+} SerialFramerStats;
+
+/*
+ * Cuts the byte stream of a serial backend into frames at each idle line
+ * and queues them with their timestamps, so that a whole frame is handed
+ * over with one interrupt at its end instead of one per byte. Transmissions
+ * are sent from the caller buffer, without copy, and report their end
+ * through a callback.
+ *
+ * The backend events run in interrupt context and are the only producer
+ * of the frame queue, pop() is the only consumer: no lock is needed as
+ * long as a single thread pops.
+ *
+ * It has no hardware dependency: the backend owns the UART, the DMA and the
+ * time source.
+ */
+class SerialFramer : public SerialBackendListener {
+public:
+    SerialFramer();
+
+    bool begin(SerialBackend* backend);
+    void end();
+
+    // callback called in interrupt context each time a frame is queued
+    void setFrameCallback(void (*callback)(void* context), void* context);
+
+    bool pop(SerialFrame* frame);
+    int available();
+
+    // send data without copy, return false if a transmission is in progress;
+    // data must stay valid until the callback (interrupt context) is called
+    bool write(const uint8_t* data, size_t len, void (*callback)(void* context) = nullptr, void* context = nullptr);
+    bool isWriting();
+
+    SerialFramerStats getStats();
+    void resetStats();
+
+    void onRxProgress(size_t head, uint64_t now_us, bool idle) override;
+    void onRxError(uint8_t errors) override;
+    void onTxComplete() override;
+
+private:
+    SerialBackend* _backend;
+    uint8_t _ring_mem[MC_SERIAL_RING_SIZE + 31];
+    uint8_t* _ring;
+    size_t _tail;
+    uint32_t _char_ns;
+    SerialFrame _frames[MC_SERIAL_FRAMES];
+    volatile uint8_t _wr;
+    volatile uint8_t _rd;
+    void (*_frame_cb)(void* context);
+    void* _frame_ctx;
+    void (*_tx_cb)(void* context);
+    void* _tx_ctx;
+    volatile bool _writing;
+    uint8_t _rx_flags;
+    SerialFramerStats _stats;
+
+    void commit(uint64_t end_us);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include "SerialTiming.h"
+
+uint32_t serialFrameHalfBits(uint16_t config) {
+    uint32_t half_bits = 2;     // start bit
+
+    switch (config & SERIAL_DATA_MASK) {
+        case SERIAL_DATA_5: half_bits += 10; break;
+        case SERIAL_DATA_6: half_bits += 12; break;
+        case SERIAL_DATA_7: half_bits += 14; break;
+        case SERIAL_DATA_8: half_bits += 16; break;
+        default: return 0;
+    }
+
+    switch (config & SERIAL_PARITY_MASK) {
+        case SERIAL_PARITY_NONE: break;
+        case SERIAL_PARITY_EVEN:
+        case SERIAL_PARITY_ODD:
+        case SERIAL_PARITY_MARK:
+        case SERIAL_PARITY_SPACE: half_bits += 2; break;
+        default: return 0;
+    }
+
+    switch (config & SERIAL_STOP_BIT_MASK) {
+        case SERIAL_STOP_BIT_1: half_bits += 2; break;
+        case SERIAL_STOP_BIT_1_5: half_bits += 3; break;
+        case SERIAL_STOP_BIT_2: half_bits += 4; break;
+        default: return 0;
+    }
+
+    return half_bits;
+}
+
+bool serialTiming(uint32_t baudrate, uint16_t config, SerialTiming* timing) {
+    uint32_t half_bits = serialFrameHalfBits(config);
+
+    if (baudrate == 0 || half_bits == 0) {
+        return false;
+    }
+
+    timing->bit_ns = (uint32_t)((1000000000ULL + baudrate - 1) / baudrate);
+    timing->char_ns = (uint32_t)((500000000ULL * half_bits + baudrate - 1) / baudrate);
+
+    // the receivers must see an idle bit before the first start bit
+    timing->predelay_us = (timing->bit_ns + 999) / 1000;
+    if (timing->predelay_us < MC_RS485_DE_SETUP_US) {
+        timing->predelay_us = MC_RS485_DE_SETUP_US;
+    }
+
+    timing->postdelay_us = (timing->char_ns + timing->bit_ns / 2 + 999) / 1000;
+
+    return true;
+}
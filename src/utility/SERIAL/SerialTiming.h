@@ -0,0 +1,33 @@
+#ifndef _SERIAL_TIMING_H_
+#define _SERIAL_TIMING_H_
+
+#include <Arduino.h>
+
+#ifndef MC_RS485_DE_SETUP_US
+#define MC_RS485_DE_SETUP_US    2           // Driver enable time of the transceiver
+#endif
+
+#define SERIAL_TIMING_LATENCY_BINS  8       // Turnaround bins: <1, <2, <4 ... <64, >=64 us
+
+typedef struct {
+    uint32_t bit_ns;        // One bit
+    uint32_t char_ns;       // One character, start, parity and stop bits included
+    uint32_t predelay_us;   // Driver enabled before the first start bit: enable time of the transceiver, at least one bit
+    uint32_t postdelay_us;  // Driver held once flush() returns: the character in the shift register plus half a bit
+} SerialTiming;
+
+typedef struct {
+    uint32_t transmissions;     // Transmissions completed
+    uint32_t hold_last_us;      // Driver still enabled after the last stop bit of the last transmission
+    uint32_t hold_max_us;
+    uint32_t reply_last_us;     // Line idle between the last received stop bit and the driver enable
+    uint32_t reply_min_us;
+    uint32_t histogram[SERIAL_TIMING_LATENCY_BINS]; // Driver hold times
+} SerialTurnaroundStats;
+
+// length of a character in half bits from a SERIAL_xxx frame format, 0 if it is not valid
+uint32_t serialFrameHalfBits(uint16_t config);
+// character and turnaround timing of a baud rate and frame format
+bool serialTiming(uint32_t baudrate, uint16_t config, SerialTiming* timing);
+
+#endif
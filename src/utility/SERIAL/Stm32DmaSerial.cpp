@@ -0,0 +1,287 @@
+#include "Stm32DmaSerial.h"
+#include <string.h>
+
+#define DMA_UART4_RX_REQUEST    63
+#define DMA_UART4_TX_REQUEST    64
+
+#define DTCM_START              0x20000000UL
+#define DTCM_END                0x20020000UL
+
+// DMA1 streams, their DMAMUX1 channels and their flags in LISR/HISR
+#define DMA_STREAM(n)           ((DMA_Stream_TypeDef*)(DMA1_BASE + 0x10 + 0x18 * (n)))
+#define DMAMUX_CHANNEL(n)       (DMAMUX1_Channel0 + (n))
+#define DMA_FLAGS               0x3DUL      // TCIF, HTIF, TEIF, DMEIF, FEIF of stream 0
+
+#define UART_ERRORS             (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE | USART_ISR_PE)
+
+Stm32DmaSerial* Stm32DmaSerial::_instance = nullptr;
+
+static IRQn_Type dmaIrq(int stream) {
+    static const IRQn_Type irq[8] = { DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+                                      DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn };
+    return irq[stream];
+}
+
+static void dmaClearFlags(int stream) {
+    static const uint8_t shift[4] = { 0, 6, 16, 22 };
+
+    if (stream < 4) {
+        DMA1->LIFCR = DMA_FLAGS << shift[stream];
+    } else {
+        DMA1->HIFCR = DMA_FLAGS << shift[stream - 4];
+    }
+}
+
+static void dmaDisable(DMA_Stream_TypeDef* dma) {
+    dma->CR &= ~DMA_SxCR_EN;
+    while (dma->CR & DMA_SxCR_EN) {
+    }
+}
+
+Stm32DmaSerial::Stm32DmaSerial(PinName de_pin, PinName re_pin) : _de_pin(de_pin), _re_pin(re_pin), _ring(nullptr), _size(0), _listener(nullptr), _uart_vector(0), _tx_start_us(0), _tx_end_ns(0), _rx_idle_us(0), _full_duplex(false), _running(false) {
+    serialTiming(115200, SERIAL_8N1, &_timing);
+    resetTurnaroundStats();
+}
+
+bool Stm32DmaSerial::start(uint8_t* ring, size_t size, SerialBackendListener* listener) {
+    if (_running || _instance != nullptr || ring == nullptr || listener == nullptr || (size % 32) != 0 || ((uint32_t)ring & 31) != 0) {
+        return false;
+    }
+    if ((uint32_t)ring >= DTCM_START && (uint32_t)ring < DTCM_END) {
+        return false;
+    }
+
+    DMA_Stream_TypeDef* rx = DMA_STREAM(MC_RS485_DMA_RX_STREAM);
+    DMA_Stream_TypeDef* tx = DMA_STREAM(MC_RS485_DMA_TX_STREAM);
+
+    _ring = ring;
+    _size = size;
+    _listener = listener;
+    _instance = this;
+
+    // driver disabled, receiver enabled
+    gpio_init_out_ex(&_de, _de_pin, 0);
+    gpio_init_out_ex(&_re, _re_pin, 0);
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+    (void)RCC->AHB1ENR;
+
+    // the mbed receive interrupt would steal the bytes from the DMA
+    UART4->CR1 &= ~(USART_CR1_RXNEIE | USART_CR1_TXEIE | USART_CR1_TCIE);
+    UART4->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NECF | USART_ICR_PECF | USART_ICR_IDLECF;
+
+    SCB_InvalidateDCache_by_Addr((uint32_t*)_ring, _size);
+
+    dmaDisable(rx);
+    dmaClearFlags(MC_RS485_DMA_RX_STREAM);
+    DMAMUX_CHANNEL(MC_RS485_DMA_RX_STREAM)->CCR = DMA_UART4_RX_REQUEST;
+    rx->PAR = (uint32_t)&UART4->RDR;
+    rx->M0AR = (uint32_t)_ring;
+    rx->NDTR = _size;
+    rx->FCR = 0;
+    rx->CR = DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+    dmaDisable(tx);
+    dmaClearFlags(MC_RS485_DMA_TX_STREAM);
+    DMAMUX_CHANNEL(MC_RS485_DMA_TX_STREAM)->CCR = DMA_UART4_TX_REQUEST;
+    tx->PAR = (uint32_t)&UART4->TDR;
+    tx->FCR = 0;
+
+    // the three interrupts share the priority of the UART so that they never preempt each other
+    uint32_t priority = NVIC_GetPriority(UART4_IRQn);
+    _uart_vector = NVIC_GetVector(UART4_IRQn);
+    NVIC_SetVector(UART4_IRQn, (uint32_t)&Stm32DmaSerial::uartIrq);
+    NVIC_SetVector(dmaIrq(MC_RS485_DMA_RX_STREAM), (uint32_t)&Stm32DmaSerial::rxDmaIrq);
+    NVIC_SetVector(dmaIrq(MC_RS485_DMA_TX_STREAM), (uint32_t)&Stm32DmaSerial::txDmaIrq);
+    NVIC_SetPriority(dmaIrq(MC_RS485_DMA_RX_STREAM), priority);
+    NVIC_SetPriority(dmaIrq(MC_RS485_DMA_TX_STREAM), priority);
+    NVIC_EnableIRQ(dmaIrq(MC_RS485_DMA_RX_STREAM));
+    NVIC_EnableIRQ(dmaIrq(MC_RS485_DMA_TX_STREAM));
+
+    _running = true;
+
+    rx->CR |= DMA_SxCR_EN;
+    UART4->CR3 |= USART_CR3_DMAR | USART_CR3_EIE;
+    UART4->CR1 |= USART_CR1_IDLEIE | USART_CR1_PEIE;
+    NVIC_EnableIRQ(UART4_IRQn);
+
+    return true;
+}
+
+void Stm32DmaSerial::stop() {
+    if (!_running) {
+        return;
+    }
+
+    NVIC_DisableIRQ(dmaIrq(MC_RS485_DMA_RX_STREAM));
+    NVIC_DisableIRQ(dmaIrq(MC_RS485_DMA_TX_STREAM));
+
+    UART4->CR1 &= ~(USART_CR1_IDLEIE | USART_CR1_PEIE | USART_CR1_TCIE);
+    UART4->CR3 &= ~(USART_CR3_DMAR | USART_CR3_DMAT | USART_CR3_EIE);
+    dmaDisable(DMA_STREAM(MC_RS485_DMA_RX_STREAM));
+    dmaDisable(DMA_STREAM(MC_RS485_DMA_TX_STREAM));
+    dmaClearFlags(MC_RS485_DMA_RX_STREAM);
+    dmaClearFlags(MC_RS485_DMA_TX_STREAM);
+
+    gpio_write(&_de, 0);
+    gpio_write(&_re, 0);
+
+    // give the UART back to mbed
+    NVIC_SetVector(UART4_IRQn, _uart_vector);
+    UART4->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NECF | USART_ICR_PECF | USART_ICR_IDLECF;
+    UART4->CR1 |= USART_CR1_RXNEIE;
+
+    _running = false;
+    _instance = nullptr;
+}
+
+bool Stm32DmaSerial::transmit(const uint8_t* data, size_t len) {
+    if (!_running || data == nullptr || len == 0 || len > 0xFFFF) {
+        return false;
+    }
+    if ((uint32_t)data >= DTCM_START && (uint32_t)data < DTCM_END) {
+        return false;
+    }
+
+    DMA_Stream_TypeDef* tx = DMA_STREAM(MC_RS485_DMA_TX_STREAM);
+
+    // write the buffer back to the memory for the DMA, whole cache lines only
+    uint32_t start = (uint32_t)data & ~31UL;
+    SCB_CleanDCache_by_Addr((uint32_t*)start, (int32_t)(((uint32_t)data + len - start + 31) & ~31UL));
+
+    if (!_full_duplex) {
+        gpio_write(&_re, 1);
+    }
+    gpio_write(&_de, 1);
+
+    uint64_t de_us = now();
+    core_util_critical_section_enter();
+    if (_rx_idle_us != 0) {
+        // the idle line is detected one character after the last stop bit
+        uint32_t reply = (uint32_t)(de_us - _rx_idle_us) + _timing.char_ns / 1000;
+        _stats.reply_last_us = reply;
+        if (reply < _stats.reply_min_us) {
+            _stats.reply_min_us = reply;
+        }
+        _rx_idle_us = 0;
+    }
+    core_util_critical_section_exit();
+
+    wait_us(_timing.predelay_us);
+
+    dmaClearFlags(MC_RS485_DMA_TX_STREAM);
+    tx->M0AR = (uint32_t)data;
+    tx->NDTR = len;
+    tx->CR = DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+    UART4->ICR = USART_ICR_TCCF;
+    _tx_start_us = now();
+    _tx_end_ns = (uint64_t)len * _timing.char_ns;
+    UART4->CR3 |= USART_CR3_DMAT;
+    tx->CR |= DMA_SxCR_EN;
+
+    return true;
+}
+
+uint32_t Stm32DmaSerial::charTimeNs() {
+    return _timing.char_ns;
+}
+
+void Stm32DmaSerial::setTiming(const SerialTiming& timing) {
+    _timing = timing;
+}
+
+void Stm32DmaSerial::setFullDuplex(bool enable) {
+    _full_duplex = enable;
+}
+
+SerialTurnaroundStats Stm32DmaSerial::getTurnaroundStats() {
+    SerialTurnaroundStats stats;
+
+    core_util_critical_section_enter();
+    stats = _stats;
+    core_util_critical_section_exit();
+
+    return stats;
+}
+
+void Stm32DmaSerial::resetTurnaroundStats() {
+    core_util_critical_section_enter();
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.reply_min_us = UINT32_MAX;
+    core_util_critical_section_exit();
+}
+
+uint64_t Stm32DmaSerial::now() {
+    return ticker_read_us(get_us_ticker_data());
+}
+
+void Stm32DmaSerial::txRelease() {
+    gpio_write(&_de, 0);
+    gpio_write(&_re, 0);
+
+    // the last stop bit ended len characters after the first start bit
+    uint64_t hold_ns = (now() - _tx_start_us) * 1000;
+    uint32_t hold = (hold_ns > _tx_end_ns) ? (uint32_t)((hold_ns - _tx_end_ns) / 1000) : 0;
+    int bin = 0;
+    while (bin < SERIAL_TIMING_LATENCY_BINS - 1 && hold >= (1UL << bin)) {
+        bin++;
+    }
+
+    _stats.transmissions++;
+    _stats.hold_last_us = hold;
+    if (hold > _stats.hold_max_us) {
+        _stats.hold_max_us = hold;
+    }
+    _stats.histogram[bin]++;
+}
+
+void Stm32DmaSerial::rxProgress(bool idle) {
+    size_t head = (_size - DMA_STREAM(MC_RS485_DMA_RX_STREAM)->NDTR) % _size;
+
+    SCB_InvalidateDCache_by_Addr((uint32_t*)_ring, _size);
+    _listener->onRxProgress(head, now(), idle);
+}
+
+void Stm32DmaSerial::uartIrq() {
+    Stm32DmaSerial* self = _instance;
+    uint32_t isr = UART4->ISR;
+
+    if (isr & UART_ERRORS) {
+        uint8_t errors = 0;
+        errors |= (isr & USART_ISR_ORE) ? SERIAL_ERROR_OVERRUN : 0;
+        errors |= (isr & USART_ISR_FE) ? SERIAL_ERROR_FRAMING : 0;
+        errors |= (isr & USART_ISR_NE) ? SERIAL_ERROR_NOISE : 0;
+        errors |= (isr & USART_ISR_PE) ? SERIAL_ERROR_PARITY : 0;
+        UART4->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NECF | USART_ICR_PECF;
+        // hand over the bytes received before the error first
+        self->rxProgress(false);
+        self->_listener->onRxError(errors);
+    }
+
+    if ((isr & USART_ISR_IDLE) && (UART4->CR1 & USART_CR1_IDLEIE)) {
+        UART4->ICR = USART_ICR_IDLECF;
+        self->_rx_idle_us = now();
+        self->rxProgress(true);
+    }
+
+    if ((isr & USART_ISR_TC) && (UART4->CR1 & USART_CR1_TCIE)) {
+        // the stop bit of the last byte is out: release the bus
+        UART4->CR1 &= ~USART_CR1_TCIE;
+        UART4->ICR = USART_ICR_TCCF;
+        self->txRelease();
+        self->_listener->onTxComplete();
+    }
+}
+
+void Stm32DmaSerial::rxDmaIrq() {
+    dmaClearFlags(MC_RS485_DMA_RX_STREAM);
+    _instance->rxProgress(false);
+}
+
+void Stm32DmaSerial::txDmaIrq() {
+    dmaClearFlags(MC_RS485_DMA_TX_STREAM);
+    // the last byte is in the UART, wait for it to leave the shift register
+    UART4->CR3 &= ~USART_CR3_DMAT;
+    UART4->CR1 |= USART_CR1_TCIE;
+}
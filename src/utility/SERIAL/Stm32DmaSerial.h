@@ -0,0 +1,81 @@
+#ifndef _STM32_DMA_SERIAL_H_
+#define _STM32_DMA_SERIAL_H_
+
+#include <Arduino.h>
+#include <mbed.h>
+#include "SerialBackend.h"
+#include "SerialTiming.h"
+
+#ifndef MC_RS485_DMA_RX_STREAM
+#define MC_RS485_DMA_RX_STREAM  4           // DMA1 stream receiving from UART4
+#endif
+#ifndef MC_RS485_DMA_TX_STREAM
+#define MC_RS485_DMA_TX_STREAM  5           // DMA1 stream transmitting to UART4
+#endif
+
+/*
+ * Serial backend on UART4 (the RS485 transceiver) with DMA1: the receiver
+ * writes continuously into a circular buffer and reports its progress on
+ * the half-transfer, transfer-complete and idle-line interrupts, the
+ * transmitter sends from the caller buffer and releases the driver enable
+ * on the UART transmission-complete interrupt.
+ *
+ * The UART must have been configured by mbed (pins, baud rate, frame
+ * format) before start(): the receive interrupt of mbed is disabled and the
+ * UART vector is taken over until stop(), so the UART must not be accessed
+ * through mbed in between.
+ *
+ * The driver is enabled the predelay of the timing before the first start
+ * bit and released by the transmission-complete interrupt, right after the
+ * last stop bit: the time it stays enabled past the stop bit and the line
+ * idle time before each transmission are measured.
+ *
+ * The buffers must be in a memory reachable by DMA1 (not the DTCM), the
+ * ring must be aligned on the 32-byte cache lines since it is invalidated
+ * before each read.
+ */
+class Stm32DmaSerial : public SerialBackend {
+public:
+    Stm32DmaSerial(PinName de_pin, PinName re_pin);
+
+    bool start(uint8_t* ring, size_t size, SerialBackendListener* listener) override;
+    void stop() override;
+    bool transmit(const uint8_t* data, size_t len) override;
+    uint32_t charTimeNs() override;
+
+    // timing of the baud rate and frame format programmed by mbed
+    void setTiming(const SerialTiming& timing);
+    // keep the receiver enabled while transmitting (full duplex)
+    void setFullDuplex(bool enable);
+
+    SerialTurnaroundStats getTurnaroundStats();
+    void resetTurnaroundStats();
+
+private:
+    PinName _de_pin;
+    PinName _re_pin;
+    gpio_t _de;
+    gpio_t _re;
+    uint8_t* _ring;
+    size_t _size;
+    SerialBackendListener* _listener;
+    uint32_t _uart_vector;
+    SerialTiming _timing;
+    uint64_t _tx_start_us;
+    uint64_t _tx_end_ns;
+    uint64_t _rx_idle_us;
+    SerialTurnaroundStats _stats;
+    bool _full_duplex;
+    bool _running;
+
+    void rxProgress(bool idle);
+    void txRelease();
+    static uint64_t now();
+
+    static Stm32DmaSerial* _instance;
+    static void uartIrq();
+    static void rxDmaIrq();
+    static void txDmaIrq();
+};
+
+#endif
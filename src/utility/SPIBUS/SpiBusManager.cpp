@@ -0,0 +1,123 @@
+#include "SpiBusManager.h"
+
+SpiDevice::SpiDevice(PinName cs, SPISettings settings) : _cs(cs), _settings(settings), _total_us(0), _start_us(0), _acquired(false) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+PinName SpiDevice::getCs() {
+    return _cs;
+}
+
+bool SpiDevice::isAcquired() {
+    return _acquired;
+}
+
+void SpiDevice::getStats(SpiDeviceStats* stats) {
+    core_util_critical_section_enter();
+    *stats = _stats;
+    core_util_critical_section_exit();
+}
+
+void SpiDevice::resetStats() {
+    core_util_critical_section_enter();
+    memset(&_stats, 0, sizeof(_stats));
+    _total_us = 0;
+    core_util_critical_section_exit();
+}
+
+SpiBusManager::SpiBusManager(SPIClass& spi) : _spi(&spi), _last(nullptr), _users(0) {
+}
+
+SpiBusManager& SpiBusManager::forBus(SPIClass& spi) {
+    // created on first use so that the drivers can look their bus up from global constructors
+    static SpiBusManager* buses[SPI_BUS_MAX];
+    static uint8_t count = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (buses[i]->_spi == &spi) {
+            return *buses[i];
+        }
+    }
+
+    if (count == SPI_BUS_MAX) {
+        MBED_ERROR(MBED_MAKE_ERROR(MBED_MODULE_DRIVER_SPI, MBED_ERROR_CODE_OUT_OF_RESOURCES), "Too many SPI buses");
+    }
+
+    buses[count] = new SpiBusManager(spi);
+    return *buses[count++];
+}
+
+void SpiBusManager::acquire(SpiDevice& device) {
+    _mutex.lock();
+    if (!device._acquired) {
+        device._acquired = true;
+        if (_users++ == 0) {
+            _spi->begin();
+            _last = nullptr;
+        }
+    }
+    _mutex.unlock();
+}
+
+void SpiBusManager::release(SpiDevice& device) {
+    _mutex.lock();
+    if (device._acquired) {
+        device._acquired = false;
+        if (--_users == 0) {
+            _spi->end();
+            _last = nullptr;
+        }
+    }
+    _mutex.unlock();
+}
+
+uint8_t SpiBusManager::users() {
+    return _users;
+}
+
+void SpiBusManager::beginTransaction(SpiDevice& device) {
+    uint32_t start_us = micros();
+
+    _mutex.lock();
+
+    uint32_t wait_us = micros() - start_us;
+    if (wait_us > device._stats.max_wait_us) {
+        device._stats.max_wait_us = wait_us;
+    }
+    device._start_us = start_us;
+
+    // the settings are applied before the chip is selected
+    _spi->beginTransaction(device._settings);
+    if (_last != &device) {
+        _last = &device;
+        device._stats.reconfigurations++;
+    }
+
+    digitalWrite(device._cs, LOW);
+}
+
+void SpiBusManager::endTransaction(SpiDevice& device) {
+    digitalWrite(device._cs, HIGH);
+    _spi->endTransaction();
+
+    uint32_t elapsed_us = micros() - device._start_us;
+
+    device._stats.transactions++;
+    device._stats.last_us = elapsed_us;
+    if (elapsed_us > device._stats.max_us) {
+        device._stats.max_us = elapsed_us;
+    }
+    device._total_us += elapsed_us;
+    device._stats.avg_us = (uint32_t)(device._total_us / device._stats.transactions);
+
+    _mutex.unlock();
+}
+
+uint8_t SpiBusManager::transfer(uint8_t data) {
+    return _spi->transfer(data);
+}
+
+void SpiBusManager::transfer(void* buffer, size_t len) {
+    // multi-byte frames go to the driver in a single block transfer
+    _spi->transfer(buffer, len);
+}
@@ -0,0 +1,79 @@
+#ifndef _SPI_BUS_MANAGER_H_
+#define _SPI_BUS_MANAGER_H_
+
+#include <Arduino.h>
+#include <mbed.h>
+#include <SPI.h>
+
+#ifndef SPI_BUS_MAX
+#define SPI_BUS_MAX 2 // Number of distinct SPIClass buses that can be managed
+#endif
+
+typedef struct {
+    uint32_t transactions;     // Number of transactions
+    uint32_t reconfigurations; // Transactions that had to change the bus settings
+    uint32_t last_us;          // Latency of the last transaction (wait for the bus + transfer) in us
+    uint32_t max_us;           // Longest latency in us
+    uint32_t avg_us;           // Average latency in us
+    uint32_t max_wait_us;      // Longest wait for the bus in us
+} SpiDeviceStats;
+
+/*
+ * A chip on a managed SPI bus: chip select pin, bus settings and
+ * transaction statistics.
+ */
+class SpiDevice {
+public:
+    SpiDevice(PinName cs, SPISettings settings);
+
+    PinName getCs();
+    bool isAcquired();
+    void getStats(SpiDeviceStats* stats);
+    void resetStats();
+
+private:
+    friend class SpiBusManager;
+
+    PinName _cs;
+    SPISettings _settings;
+    SpiDeviceStats _stats;
+    uint64_t _total_us;
+    uint32_t _start_us;
+    bool _acquired;   // The device holds one reference on the bus
+};
+
+/*
+ * Shares one SPIClass between several drivers:
+ * - the bus is begun by the first device and ended by the last one, each
+ *   device holds at most one reference so that a repeated release cannot
+ *   end the bus under another device,
+ * - transactions are serialized (callers queue on a mutex),
+ * - every transaction is enclosed in SPIClass::beginTransaction() and
+ *   endTransaction(), so other libraries using the bus see it free between
+ *   transactions; the core reprograms the peripheral only when the
+ *   settings change, which happens when a different device takes the bus.
+ */
+class SpiBusManager {
+public:
+    static SpiBusManager& forBus(SPIClass& spi);
+
+    // Take and drop the reference of a device, both are idempotent
+    void acquire(SpiDevice& device);
+    void release(SpiDevice& device);
+    uint8_t users();
+
+    void beginTransaction(SpiDevice& device);
+    void endTransaction(SpiDevice& device);
+    uint8_t transfer(uint8_t data);
+    void transfer(void* buffer, size_t len);
+
+private:
+    SpiBusManager(SPIClass& spi);
+
+    SPIClass* _spi;
+    rtos::Mutex _mutex;
+    SpiDevice* _last;   // Device of the last transaction, for the reconfiguration statistics
+    uint8_t _users;
+};
+
+#endif
@@ -28,7 +28,7 @@ const MAX31855Class::coefftable MAX31855Class::InvCoeffJ[];
 const MAX31855Class::coefftable MAX31855Class::InvCoeffK[];
 const MAX31855Class::coefftable MAX31855Class::InvCoeffT[];
 
-MAX31855Class::MAX31855Class(PinName cs, SPIClass& spi) : _cs(cs), _spi(&spi), _spiSettings(4000000, MSBFIRST, SPI_MODE0), _coldOffset(2.10f) {
+MAX31855Class::MAX31855Class(PinName cs, SPIClass& spi) : _coldOffset(2.10f), _cs(cs), _bus(&SpiBusManager::forBus(spi)), _dev(cs, SPISettings(4000000, MSBFIRST, SPI_MODE0)) {
 }
 
 bool MAX31855Class::begin() {
@@ -36,10 +36,11 @@ bool MAX31855Class::begin() {
 
     pinMode(_cs, OUTPUT);
     digitalWrite(_cs, HIGH);
-    _spi->begin();
+    _bus->acquire(_dev);
 
+    // a missing chip leaves MISO pulled up
     rawword = readSensor();
-    if (rawword == 0xFFFFFF) {
+    if (rawword == 0xFFFFFFFF) {
         end();
 
         return false;
@@ -49,27 +50,29 @@ bool MAX31855Class::begin() {
 }
 
 void MAX31855Class::end() {
+    // the bus reference is dropped once, a failed begin() followed by end() is harmless
+    if (!_dev.isAcquired()) {
+        return;
+    }
+
     pinMode(_cs, INPUT);
     digitalWrite(_cs, LOW);
-    _spi->end();
+    _bus->release(_dev);
 }
 
 uint32_t MAX31855Class::readSensor() {
     uint32_t read = 0x00;
 
-    digitalWrite(_cs, LOW);
+    _bus->beginTransaction(_dev);
     delayMicroseconds(1);
 
-    _spi->beginTransaction(_spiSettings);
-
     for (int i = 0; i < 4; i++) {
         read <<= 8;
-        read |= _spi->transfer(0);
+        read |= _bus->transfer(0);
     }
 
-    _spi->endTransaction();
+    _bus->endTransaction(_dev);
 
-    digitalWrite(_cs, HIGH);
     return read;
 }
 
@@ -77,7 +80,8 @@ double MAX31855Class::polynomial(double value, int tableEntries, coefftable cons
     double output = 0;
     double valuePower = 1;
     for (int i = 0; i < tableEntries; i++) {
-        if (value < table[i].max) {
+        // the upper end of the last range is part of it
+        if (value < table[i].max || (i == tableEntries - 1 && value == table[i].max)) {
             if (table[i].size == 0) {
                 return NAN;
             } else {
@@ -111,6 +115,38 @@ double MAX31855Class::tempTomv(double temp) {
             table = CoeffT;
             tableEntries = sizeof(CoeffT) / sizeof(coefftable);
         break;
+#if MC_TC_TYPE_E
+        case PROBE_TC_E:
+            table = TC_E_COEFF;
+            tableEntries = sizeof(TC_E_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_N
+        case PROBE_TC_N:
+            table = TC_N_COEFF;
+            tableEntries = sizeof(TC_N_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_R
+        case PROBE_TC_R:
+            table = TC_R_COEFF;
+            tableEntries = sizeof(TC_R_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_S
+        case PROBE_TC_S:
+            table = TC_S_COEFF;
+            tableEntries = sizeof(TC_S_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_B
+        case PROBE_TC_B:
+            table = TC_B_COEFF;
+            tableEntries = sizeof(TC_B_COEFF) / sizeof(coefftable);
+        break;
+#endif
+        default:
+            return NAN;
     }
     voltage = polynomial(temp, tableEntries, table);
     // special case... for K probes in temperature range 0-1372 we need
@@ -138,51 +174,74 @@ double MAX31855Class::mvtoTemp(double voltage) {
             table = InvCoeffT;
             tableEntries = sizeof(InvCoeffT) / sizeof(coefftable);
         break;
+#if MC_TC_TYPE_E
+        case PROBE_TC_E:
+            table = TC_E_INV_COEFF;
+            tableEntries = sizeof(TC_E_INV_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_N
+        case PROBE_TC_N:
+            table = TC_N_INV_COEFF;
+            tableEntries = sizeof(TC_N_INV_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_R
+        case PROBE_TC_R:
+            table = TC_R_INV_COEFF;
+            tableEntries = sizeof(TC_R_INV_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_S
+        case PROBE_TC_S:
+            table = TC_S_INV_COEFF;
+            tableEntries = sizeof(TC_S_INV_COEFF) / sizeof(coefftable);
+        break;
+#endif
+#if MC_TC_TYPE_B
+        case PROBE_TC_B:
+            table = TC_B_INV_COEFF;
+            tableEntries = sizeof(TC_B_INV_COEFF) / sizeof(coefftable);
+        break;
+#endif
+        default:
+            return NAN;
     }
     return polynomial(voltage, tableEntries, table);
 }
 
-double MAX31855Class::readTCVoltage() {
-    uint32_t rawword;
-    int32_t measuredTempInt;
-    int32_t measuredColdInt;
-    double measuredTemp;
-    double measuredCold;
-    double measuredVolt;
-
-    rawword = readSensor();
+TCSample MAX31855Class::readTCSample() {
+    // hot junction, cold junction and faults all come from the same conversion
+    return decodeSample(readSensor());
+}
 
-    // Check for reading error
-    _lastFault = rawword & _faultMask;
-    if (_lastFault) {
-        return NAN;
-    }
+TCSample MAX31855Class::decodeSample(uint32_t rawword) {
+    TCSample sample;
+    int32_t measuredTempInt;
+    int16_t measuredColdInt;
 
     // The cold junction temperature is stored in the last 14 word's bits
     // whereas the thermocouple temperature (non linearized) is in the topmost 18 bits
     // sent by the Thermocouple-to-Digital Converter
 
-    // sign extend thermocouple value
-    if (rawword & 0x80000000) {
-        // Negative value, drop the lower 18 bits and explicitly extend sign bits.
-        measuredTempInt = 0xFFFC0000 | ((rawword >> 18) & 0x00003FFFF);
-    } else {
-        // Positive value, just drop the lower 18 bits.
-        measuredTempInt = rawword >> 18;
-    }
+    // sign extend thermocouple value (14 bits, 0.25 °C)
+    measuredTempInt = (int32_t)rawword >> 18;
+
+    // sign extend cold junction temperature (12 bits, 0.0625 °C)
+    measuredColdInt = (int16_t)(rawword & 0xFFFF) >> 4;
 
-    // convert it to degrees
-    measuredTemp = measuredTempInt * 0.25f;
+    sample.hot_junction = measuredTempInt * 0.25f;
+    sample.cold_junction = measuredColdInt * 0.0625f - _coldOffset;
 
-    // sign extend cold junction temperature
-    measuredColdInt = (rawword >> 4) & 0xfff;
-    if (measuredColdInt & 0x800) {
-        // Negative value, sign extend
-        measuredColdInt |= 0xfffff000;
+    // Check for reading error
+    sample.fault = rawword & _faultMask;
+    _lastFault = sample.fault;
+    if (sample.fault) {
+        sample.voltage = NAN;
+        sample.temperature = NAN;
+        return sample;
     }
 
-    // convert it to degrees
-    measuredCold = (measuredColdInt / 16.0f);
     // now the tricky part... since MAX31855K is considering a linear response
     // and is trimmed for K thermocouples, we have to convert the reading back
     // to mV and then use NIST polynomial approximation to determine temperature
@@ -195,15 +254,32 @@ double MAX31855Class::readTCVoltage() {
     // this way we calculate the voltage we would have measured if cold junction
     // was at 0 degrees celsius
 
-    measuredVolt = tempTomv(measuredCold - _coldOffset) + (measuredTemp - measuredCold) * 0.041276f;
+    sample.voltage = coldJunctionVoltage(measuredColdInt) + (measuredTempInt * 0.25f - measuredColdInt * 0.0625f) * 0.041276f;
+
+    // finally from the cold junction compensated voltage we calculate the temperature
+    // using NIST polynomial approximation for the thermocouple type we are using
+    sample.temperature = mvtoTemp(sample.voltage);
+
+    return sample;
+}
+
+double MAX31855Class::coldJunctionVoltage(int16_t coldRaw) {
+    // the cold junction moves slowly: skip the NIST polynomial when nothing changed
+    if (coldRaw != _cjRaw || _current_probe_type != _cjType || _coldOffset != _cjOffset) {
+        _cjVoltage = tempTomv(coldRaw * 0.0625f - _coldOffset);
+        _cjRaw = coldRaw;
+        _cjType = _current_probe_type;
+        _cjOffset = _coldOffset;
+    }
+    return _cjVoltage;
+}
 
-    return measuredVolt;
+double MAX31855Class::readTCVoltage() {
+    return readTCSample().voltage;
 }
 
 double MAX31855Class::readTCTemperature() {
-    // finally from the cold junction compensated voltage we calculate the temperature
-    // using NIST polynomial approximation for the thermocouple type we are using
-    return mvtoTemp(readTCVoltage());
+    return readTCSample().temperature;
 }
 
 float MAX31855Class::readReferenceTemperature() {
@@ -211,27 +287,9 @@ float MAX31855Class::readReferenceTemperature() {
 }
 
 float MAX31855Class::readTCReferenceTemperature() {
-    //TODO. Actually use TC _current_probe_type and _coldOffset
-    uint32_t rawword;
-    float referenceTemperature;
-
-    rawword = readSensor();
-
-    // ignore first 4 FAULT bits
-    rawword >>= 4;
-
-    // The cold junction reference temperature is stored in the first 11 word's bits
-    // sent by the Thermocouple-to-Digital Converter
-    rawword = rawword & 0x7FF;
-    // check sign bit and convert to negative value.
-    if (rawword & 0x800) {
-        referenceTemperature = (0xF800 | (rawword & 0x7FF)) * 0.0625;
-    } else {
-        // multiply for the LSB value
-        referenceTemperature = rawword * 0.0625f;
-    }
-
-    return referenceTemperature;
+    // The cold junction temperature does not depend on the thermocouple type,
+    // the cold offset is applied as for the compensation
+    return readTCSample().cold_junction;
 }
 
 void MAX31855Class::setColdOffset(float offset) {
@@ -275,3 +333,7 @@ void MAX31855Class::setTCType(uint8_t type) {
 uint8_t MAX31855Class::getTCType() {
     return _current_probe_type;
 }
+
+void MAX31855Class::getTCSpiStats(SpiDeviceStats* stats) {
+    _dev.getStats(stats);
+}
@@ -5,10 +5,17 @@
 #include <mbed.h>
 #include <SPI.h>
 #include "pins_mc.h"
+#include "../SPIBUS/SpiBusManager.h"
+#include "TCTables.h"
 
 #define PROBE_TC_K 0
 #define PROBE_TC_J 1
 #define PROBE_TC_T 2
+#define PROBE_TC_E 5
+#define PROBE_TC_N 6
+#define PROBE_TC_R 7
+#define PROBE_TC_S 8
+#define PROBE_TC_B 9
 
 #define PROBE_K PROBE_TC_K
 #define PROBE_J PROBE_TC_J
@@ -20,6 +27,14 @@
 #define TC_FAULT_SHORT_VCC (0x04) // Enable short to VCC fault check
 #define TC_FAULT_ALL       (0x07) // Enable all fault checks
 
+typedef struct {
+    float hot_junction;  // Hot junction temperature as linearized by the chip for a K thermocouple (°C)
+    float cold_junction; // Cold junction temperature, cold offset applied (°C)
+    double voltage;      // Cold junction compensated thermocouple voltage (mV), NAN on fault
+    double temperature;  // Linearized thermocouple temperature for the selected type (°C), NAN on fault
+    uint8_t fault;       // Fault bits (TC_FAULT_OPEN, TC_FAULT_SHORT_GND, TC_FAULT_SHORT_VCC) enabled by the fault mask
+} TCSample;
+
 class MAX31855Class {
 public:
     MAX31855Class(PinName cs = MC_TC_CS_PIN, SPIClass& spi = SPI);
@@ -27,6 +42,7 @@ public:
     bool begin();
     void end();
 
+    TCSample readTCSample();
     double readTCVoltage();
     double readTCTemperature();
     float readReferenceTemperature();
@@ -45,14 +61,26 @@ public:
     void setTCType(uint8_t type);
     uint8_t getTCType();
 
+    // NIST reference function of the selected type and its inverse, NAN outside their range
+    double tempTomv(double temp);
+    double mvtoTemp(double voltage);
+
+    void getTCSpiStats(SpiDeviceStats* stats);
+
 private:
     float _coldOffset;
     uint8_t _faultMask = TC_FAULT_ALL;
     uint8_t _lastFault = TC_FAULT_NONE;
     uint8_t _current_probe_type;
     PinName _cs;
-    SPIClass* _spi;
-    SPISettings _spiSettings;
+    SpiBusManager* _bus;
+    SpiDevice _dev;
+
+    // Cold junction compensation term, recomputed only when its inputs change
+    int16_t _cjRaw = INT16_MIN;
+    uint8_t _cjType;
+    float _cjOffset;
+    double _cjVoltage;
 
     // NIST coefficient tables
     static constexpr double Jm210_760[]    = {  0.000000000000E+00,  0.503811878150E-01, 0.304758369300E-04, -0.856810657200E-07,  0.132281952950E-09, -0.170529583370E-12,  0.209480906970E-15, -0.125383953360E-18,  0.156317256970E-22 };
@@ -76,11 +104,7 @@ private:
     static constexpr double InvT_m200_0[]  = {  0.0000000E+00,  2.5949192E+01,  -2.1316967E-01,  7.9018692E-01,   4.2527777E-01,  1.3304473E-01,  2.0241446E-02,  1.2668171E-03 };
     static constexpr double InvT0_400[]    = {  0.000000E+00,   2.592800E+01,   -7.602961E-01,   4.637791E-02,   -2.165394E-03,   6.048144E-05,  -7.293422E-07,   0.000000E+00 };
 
-    typedef struct {
-        int size;
-        double max;
-        const double *coeffs;
-    } coefftable;
+    typedef TCCoeffTable coefftable;
 
     static constexpr coefftable CoeffJ[] = {
         {0, -210.0f, NULL},
@@ -121,8 +145,8 @@ private:
     };
 
     uint32_t readSensor();
-    double mvtoTemp(double voltage);
-    double tempTomv(double temp);
+    TCSample decodeSample(uint32_t rawword);
+    double coldJunctionVoltage(int16_t coldRaw);
     double polynomial(double value, int tableEntries, coefftable const (*table));
 };
 
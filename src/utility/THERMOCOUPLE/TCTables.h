@@ -0,0 +1,145 @@
+// Generated by extras/tools/generate_tc_tables.py, do not edit.
+// NIST ITS-90 thermocouple reference functions for the types E, N, R, S and B.
+//
+// Each type is compiled only if its MC_TC_TYPE_x macro is not 0, define it to 0
+// in the build flags to remove the tables of a type that is not used.
+
+#ifndef _TC_TABLES_H_
+#define _TC_TABLES_H_
+
+typedef struct {
+    int size;
+    double max;
+    const double *coeffs;
+} TCCoeffTable;
+
+#ifndef MC_TC_TYPE_E
+#define MC_TC_TYPE_E 1
+#endif
+
+#if MC_TC_TYPE_E
+static constexpr double TC_E_FWD0[] = { 0.000000000000E+00, 5.866550870800E-02, 4.541097712400E-05, -7.799804868600E-07, -2.580016084300E-08, -5.945258305700E-10, -9.321405866700E-12, -1.028760553400E-13, -8.037012362100E-16, -4.397949739100E-18, -1.641477635500E-20, -3.967361951600E-23, -5.582732872100E-26, -3.465784201300E-29 };
+static constexpr double TC_E_FWD1[] = { 0.000000000000E+00, 5.866550871000E-02, 4.503227558200E-05, 2.890840721200E-08, -3.305689665200E-10, 6.502440327000E-13, -1.919749550400E-16, -1.253660049700E-18, 2.148921756900E-21, -1.438804178200E-24, 3.596089948100E-28 };
+static constexpr double TC_E_INV0[] = { 0.000000000000E+00, 1.697728800000E+01, -4.351497000000E-01, -1.585969700000E-01, -9.250287100000E-02, -2.608431400000E-02, -4.136019900000E-03, -3.403403000000E-04, -1.156489000000E-05, 0.000000000000E+00 };
+static constexpr double TC_E_INV1[] = { 0.000000000000E+00, 1.705703500000E+01, -2.330175900000E-01, 6.543558500000E-03, -7.356274900000E-05, -1.789600100000E-06, 8.403616500000E-08, -1.373587900000E-09, 1.062982300000E-11, -3.244708700000E-14 };
+
+static constexpr TCCoeffTable TC_E_COEFF[] = {
+    {0, -270.000000, nullptr},
+    {14, 0.000000, TC_E_FWD0},
+    {11, 1000.000000, TC_E_FWD1},
+};
+
+static constexpr TCCoeffTable TC_E_INV_COEFF[] = {
+    {0, -8.825000, nullptr},
+    {10, 0.000000, TC_E_INV0},
+    {10, 76.373000, TC_E_INV1},
+};
+#endif
+
+#ifndef MC_TC_TYPE_N
+#define MC_TC_TYPE_N 1
+#endif
+
+#if MC_TC_TYPE_N
+static constexpr double TC_N_FWD0[] = { 0.000000000000E+00, 2.615910596200E-02, 1.095748422800E-05, -9.384111155400E-08, -4.641203975900E-11, -2.630335771600E-12, -2.265343800300E-14, -7.608930079100E-17, -9.341966783500E-20 };
+static constexpr double TC_N_FWD1[] = { 0.000000000000E+00, 2.592939460100E-02, 1.571014188000E-05, 4.382562723700E-08, -2.526116979400E-10, 6.431181933900E-13, -1.006347151900E-15, 9.974533899200E-19, -6.086324560700E-22, 2.084922933900E-25, -3.068219615100E-29 };
+static constexpr double TC_N_INV0[] = { 0.000000000000E+00, 3.843684700000E+01, 1.101048500000E+00, 5.222931200000E+00, 7.206052500000E+00, 5.848858600000E+00, 2.775491600000E+00, 7.707516600000E-01, 1.158266500000E-01, 7.313886800000E-03 };
+static constexpr double TC_N_INV1[] = { 0.000000000000E+00, 3.868960000000E+01, -1.082670000000E+00, 4.702050000000E-02, -2.121690000000E-06, -1.172720000000E-04, 5.392800000000E-06, -7.981560000000E-08 };
+static constexpr double TC_N_INV2[] = { 1.972485000000E+01, 3.300943000000E+01, -3.915159000000E-01, 9.855391000000E-03, -1.274371000000E-04, 7.767022000000E-07 };
+
+static constexpr TCCoeffTable TC_N_COEFF[] = {
+    {0, -270.000000, nullptr},
+    {9, 0.000000, TC_N_FWD0},
+    {11, 1300.000000, TC_N_FWD1},
+};
+
+static constexpr TCCoeffTable TC_N_INV_COEFF[] = {
+    {0, -3.990000, nullptr},
+    {10, 0.000000, TC_N_INV0},
+    {8, 20.613000, TC_N_INV1},
+    {6, 47.513000, TC_N_INV2},
+};
+#endif
+
+#ifndef MC_TC_TYPE_R
+#define MC_TC_TYPE_R 1
+#endif
+
+#if MC_TC_TYPE_R
+static constexpr double TC_R_FWD0[] = { 0.000000000000E+00, 5.289617297650E-03, 1.391665897820E-05, -2.388556930170E-08, 3.569160010630E-11, -4.623476662980E-14, 5.007774410340E-17, -3.731058861910E-20, 1.577164823670E-23, -2.810386252510E-27 };
+static constexpr double TC_R_FWD1[] = { 2.951579253160E+00, -2.520612513320E-03, 1.595645018650E-05, -7.640859475760E-09, 2.053052910240E-12, -2.933596681730E-16 };
+static constexpr double TC_R_FWD2[] = { 1.522321182090E+02, -2.688198885450E-01, 1.712802804710E-04, -3.458957064530E-08, -9.346339710460E-15 };
+static constexpr double TC_R_INV0[] = { 0.000000000000E+00, 1.889138000000E+02, -9.383529000000E+01, 1.306861900000E+02, -2.270358000000E+02, 3.514565900000E+02, -3.895390000000E+02, 2.823947100000E+02, -1.260728100000E+02, 3.135361100000E+01, -3.318776900000E+00 };
+static constexpr double TC_R_INV1[] = { 1.334584505000E+01, 1.472644573000E+02, -1.844024844000E+01, 4.031129726000E+00, -6.249428360000E-01, 6.468412046000E-02, -4.458750426000E-03, 1.994710149000E-04, -5.313401790000E-06, 6.481976217000E-08 };
+static constexpr double TC_R_INV2[] = { -8.199599416000E+01, 1.553962042000E+02, -8.342197663000E+00, 4.279433549000E-01, -1.191577910000E-02, 1.492290091000E-04 };
+static constexpr double TC_R_INV3[] = { 3.406177836000E+04, -7.023729171000E+03, 5.582903813000E+02, -1.952394635000E+01, 2.560740231000E-01 };
+
+static constexpr TCCoeffTable TC_R_COEFF[] = {
+    {0, -50.000000, nullptr},
+    {10, 1064.180000, TC_R_FWD0},
+    {6, 1664.500000, TC_R_FWD1},
+    {5, 1768.100000, TC_R_FWD2},
+};
+
+static constexpr TCCoeffTable TC_R_INV_COEFF[] = {
+    {0, -0.226000, nullptr},
+    {11, 1.923000, TC_R_INV0},
+    {10, 11.361000, TC_R_INV1},
+    {6, 19.739000, TC_R_INV2},
+    {5, 21.103000, TC_R_INV3},
+};
+#endif
+
+#ifndef MC_TC_TYPE_S
+#define MC_TC_TYPE_S 1
+#endif
+
+#if MC_TC_TYPE_S
+static constexpr double TC_S_FWD0[] = { 0.000000000000E+00, 5.403133086310E-03, 1.259342897400E-05, -2.324779686890E-08, 3.220288230360E-11, -3.314651963890E-14, 2.557442517860E-17, -1.250688713930E-20, 2.714431761450E-24 };
+static constexpr double TC_S_FWD1[] = { 1.329004440850E+00, 3.345093113440E-03, 6.548051928180E-06, -1.648562592090E-09, 1.299896051740E-14 };
+static constexpr double TC_S_FWD2[] = { 1.466282326360E+02, -2.584305167520E-01, 1.636935746410E-04, -3.304390469870E-08, -9.432236906120E-15 };
+static constexpr double TC_S_INV0[] = { 0.000000000000E+00, 1.849494600000E+02, -8.005040620000E+01, 1.022374300000E+02, -1.522485920000E+02, 1.888213430000E+02, -1.590859410000E+02, 8.230278800000E+01, -2.341819440000E+01, 2.797862600000E+00 };
+static constexpr double TC_S_INV1[] = { 1.291507177000E+01, 1.466298863000E+02, -1.534713402000E+01, 3.145945973000E+00, -4.163257839000E-01, 3.187963771000E-02, -1.291637500000E-03, 2.183475087000E-05, -1.447379511000E-07, 8.211272125000E-09 };
+static constexpr double TC_S_INV2[] = { -8.087801117000E+01, 1.621573104000E+02, -8.536869453000E+00, 4.719686976000E-01, -1.441693666000E-02, 2.081618890000E-04 };
+static constexpr double TC_S_INV3[] = { 5.333875126000E+04, -1.235892298000E+04, 1.092657613000E+03, -4.265693686000E+01, 6.247205420000E-01 };
+
+static constexpr TCCoeffTable TC_S_COEFF[] = {
+    {0, -50.000000, nullptr},
+    {9, 1064.180000, TC_S_FWD0},
+    {5, 1664.500000, TC_S_FWD1},
+    {5, 1768.100000, TC_S_FWD2},
+};
+
+static constexpr TCCoeffTable TC_S_INV_COEFF[] = {
+    {0, -0.235000, nullptr},
+    {10, 1.874000, TC_S_INV0},
+    {10, 10.332000, TC_S_INV1},
+    {6, 17.536000, TC_S_INV2},
+    {5, 18.693000, TC_S_INV3},
+};
+#endif
+
+#ifndef MC_TC_TYPE_B
+#define MC_TC_TYPE_B 1
+#endif
+
+#if MC_TC_TYPE_B
+static constexpr double TC_B_FWD0[] = { 0.000000000000E+00, -2.465081834600E-04, 5.904042117100E-06, -1.325793163600E-09, 1.566829190100E-12, -1.694452924000E-15, 6.299034709400E-19 };
+static constexpr double TC_B_FWD1[] = { -3.893816862100E+00, 2.857174747000E-02, -8.488510478500E-05, 1.578528016400E-07, -1.683534486400E-10, 1.110979401300E-13, -4.451543103300E-17, 9.897564082100E-21, -9.379133028900E-25 };
+static constexpr double TC_B_INV0[] = { 9.842332100000E+01, 6.997150000000E+02, -8.476530400000E+02, 1.005264400000E+03, -8.334595200000E+02, 4.550854200000E+02, -1.552303700000E+02, 2.988675000000E+01, -2.474286000000E+00 };
+static constexpr double TC_B_INV1[] = { 2.131507100000E+02, 2.851050400000E+02, -5.274288700000E+01, 9.916080400000E+00, -1.296530300000E+00, 1.119587000000E-01, -6.062519900000E-03, 1.866169600000E-04, -2.487858500000E-06 };
+
+static constexpr TCCoeffTable TC_B_COEFF[] = {
+    {0, 0.000000, nullptr},
+    {7, 630.615000, TC_B_FWD0},
+    {9, 1820.000000, TC_B_FWD1},
+};
+
+static constexpr TCCoeffTable TC_B_INV_COEFF[] = {
+    {0, 0.291000, nullptr},
+    {9, 2.431000, TC_B_INV0},
+    {9, 13.820000, TC_B_INV1},
+};
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+#include "MonotonicClock.h"
+
+static int64_t clampPpb(int64_t value, int64_t limit) {
+    if (value > limit) {
+        return limit;
+    }
+    if (value < -limit) {
+        return -limit;
+    }
+    return value;
+}
+
+// value * ppb / 10^9 rounded down, split at 10^9 so that the product cannot overflow
+static int64_t scalePpb(int64_t value, int64_t ppb, int64_t extra = 0) {
+    int64_t whole = value / 1000000000;
+    int64_t rest = (value % 1000000000) * ppb + extra;
+    int64_t scaled = rest / 1000000000;
+
+    if (rest % 1000000000 < 0) {
+        scaled--;
+    }
+    return whole * ppb + scaled;
+}
+
+MonotonicClock::MonotonicClock() : _base_raw(0), _base_time(0), _slew_len(0), _slew_ppb(0), _freq_ppb(0), _max_slew_ppb(MCLOCK_MAX_SLEW_PPB), _slew_window_us(MCLOCK_SLEW_WINDOW_US), _step_us(MCLOCK_STEP_US), _ref_raw(0), _ref_time(0), _offset(0), _ref_count(0) {
+}
+
+void MonotonicClock::setSlew(uint32_t max_ppb, uint32_t window_us) {
+    // keep the sum of both corrections above -100%
+    _max_slew_ppb = (max_ppb > 500000000) ? 500000000 : max_ppb;
+    _slew_window_us = (window_us == 0) ? 1 : window_us;
+}
+
+void MonotonicClock::setStepThreshold(uint32_t step_us) {
+    _step_us = (step_us > MCLOCK_MAX_SLEW_US) ? MCLOCK_MAX_SLEW_US : step_us;
+}
+
+uint64_t MonotonicClock::toTime(uint64_t raw_us) const {
+    if (raw_us < _base_raw) {
+        // before the last reference (e.g. a stored timestamp): extrapolate at the corrected frequency
+        int64_t before = (int64_t)(_base_raw - raw_us);
+        return _base_time - before - scalePpb(before, _freq_ppb);
+    }
+
+    int64_t delta = (int64_t)(raw_us - _base_raw);
+    int64_t slewed = (delta < _slew_len) ? delta : _slew_len;
+
+    // single rounding: the correction changes by at most 1us per us, so the time cannot decrease,
+    // however long since the last reference
+    return _base_time + delta + scalePpb(delta, _freq_ppb, slewed * _slew_ppb);
+}
+
+void MonotonicClock::discipline(uint64_t raw_us, uint64_t ref_us) {
+    uint64_t now = toTime(raw_us);
+    int64_t offset = (int64_t)(ref_us - now);
+
+    // frequency of the raw counter against the reference, smoothed over the last references
+    if (_ref_count > 0 && raw_us > _ref_raw && raw_us - _ref_raw >= MCLOCK_MIN_FREQ_US) {
+        int64_t raw_elapsed = (int64_t)(raw_us - _ref_raw);
+        int64_t error = (int64_t)(ref_us - _ref_time) - raw_elapsed;
+        int64_t measured;
+
+        // anything beyond the correction range (e.g. a step of the reference) is clamped
+        // before the product, which would overflow
+        if (error > raw_elapsed / (1000000000 / MCLOCK_MAX_FREQ_PPB)) {
+            measured = MCLOCK_MAX_FREQ_PPB;
+        } else if (error < -raw_elapsed / (1000000000 / MCLOCK_MAX_FREQ_PPB)) {
+            measured = -MCLOCK_MAX_FREQ_PPB;
+        } else {
+            // the product overflows after about 213 days between references: count in ms then
+            if (raw_elapsed > 1000000000000LL) {
+                error /= 1000;
+                raw_elapsed /= 1000;
+            }
+            measured = (error * 1000000000) / raw_elapsed;
+        }
+        _freq_ppb = (int32_t)clampPpb(_freq_ppb + (measured - _freq_ppb) / 4, MCLOCK_MAX_FREQ_PPB);
+    }
+
+    _base_raw = raw_us;
+    _slew_len = 0;
+    _slew_ppb = 0;
+
+    if (offset > (int64_t)_step_us) {
+        _base_time = ref_us;
+    } else {
+        _base_time = now;
+        // an early clock further than MCLOCK_MAX_SLEW_US is caught up over several references
+        if (offset < -MCLOCK_MAX_SLEW_US) {
+            offset = -MCLOCK_MAX_SLEW_US;
+        }
+        if (offset != 0) {
+            int64_t ppb = clampPpb((offset * 1000000000) / _slew_window_us, _max_slew_ppb);
+            if (ppb == 0) {
+                ppb = (offset > 0) ? 1 : -1;
+            }
+            _slew_ppb = (int32_t)ppb;
+            _slew_len = (offset * 1000000000) / ppb;
+        }
+    }
+
+    _ref_raw = raw_us;
+    _ref_time = ref_us;
+    _offset = (int64_t)(ref_us - now);
+    _ref_count++;
+}
+
+void MonotonicClock::reset(uint64_t raw_us, uint64_t time_us) {
+    _base_raw = raw_us;
+    _base_time = time_us;
+    _slew_len = 0;
+    _slew_ppb = 0;
+    _freq_ppb = 0;
+    _offset = 0;
+    _ref_count = 0;
+}
+
+int64_t MonotonicClock::getOffset() const {
+    return _offset;
+}
+
+int32_t MonotonicClock::getFrequency() const {
+    return _freq_ppb;
+}
+
+uint32_t MonotonicClock::getReferenceCount() const {
+    return _ref_count;
+}
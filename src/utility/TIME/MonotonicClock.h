@@ -0,0 +1,57 @@
+#ifndef _MONOTONIC_CLOCK_H_
+#define _MONOTONIC_CLOCK_H_
+
+#include <stdint.h>
+
+#define MCLOCK_MAX_FREQ_PPB   500000         // Largest frequency correction (500 ppm)
+#define MCLOCK_MAX_SLEW_PPB   500000         // Default largest phase slew rate (500 ppm)
+#define MCLOCK_SLEW_WINDOW_US 60000000       // Default time over which a phase error is absorbed
+#define MCLOCK_STEP_US        1000000        // Default forward error above which the clock steps
+#define MCLOCK_MAX_SLEW_US    1000000000LL   // Largest backward error slewed by a single reference
+#define MCLOCK_MIN_FREQ_US    10000000       // Shortest interval between references used to estimate the frequency
+
+/*
+ * Maps a free running microsecond counter (raw) to a disciplined 64-bit
+ * time (e.g. Unix time in us), corrected from reference observations.
+ *
+ * The time is piecewise linear in raw: a frequency correction estimated
+ * from consecutive references, plus a phase slew that absorbs the last
+ * reference offset over a bounded time. The total correction never
+ * reaches -100%, so the time never goes backward: a late clock is
+ * stepped forward when the error exceeds the step threshold, an early
+ * clock is only slowed down.
+ *
+ * It has no hardware dependency and is not thread safe: the caller
+ * serializes toTime() and discipline().
+ */
+class MonotonicClock {
+public:
+    MonotonicClock();
+
+    void setSlew(uint32_t max_ppb, uint32_t window_us);
+    void setStepThreshold(uint32_t step_us);
+
+    uint64_t toTime(uint64_t raw_us) const;
+    void discipline(uint64_t raw_us, uint64_t ref_us);
+    void reset(uint64_t raw_us, uint64_t time_us);
+
+    int64_t getOffset() const;
+    int32_t getFrequency() const;
+    uint32_t getReferenceCount() const;
+
+private:
+    uint64_t _base_raw;
+    uint64_t _base_time;
+    int64_t _slew_len;
+    int32_t _slew_ppb;
+    int32_t _freq_ppb;
+    uint32_t _max_slew_ppb;
+    uint32_t _slew_window_us;
+    uint32_t _step_us;
+    uint64_t _ref_raw;
+    uint64_t _ref_time;
+    int64_t _offset;
+    uint32_t _ref_count;
+};
+
+#endif